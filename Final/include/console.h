@@ -0,0 +1,35 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Buffered console output for the print syscalls.
+ *
+ * What a process prints collects in its own buffer and goes out in one
+ * write when the scheduler takes it off the CPU, when the buffer fills,
+ * or, in line mode, at every newline. Each host thread writes into the
+ * buffer of the process it is running, so cores never share a buffer.
+ * With no process attached the output is written straight through.
+ */
+
+#define CONSOLE_BUFFER_SIZE 4096
+
+// Print syscalls on this thread now write to pid's buffer. A negative
+// pid (e.g. SYSTEM_PROCESS_ID) detaches. Flushes the previous buffer.
+void console_attach(int pid);
+
+// Queue output from the attached process
+void console_write(const char *data, size_t len);
+
+// Write out what the attached process has queued
+void console_flush(void);
+
+// Also flush at every newline, for watching output live. Off by default.
+void console_set_line_mode(bool enabled);
+
+// Flush every buffer and free them
+void console_free(void);
+
+#endif // !CONSOLE_H
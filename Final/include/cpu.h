@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 
+// Upper bound on simulated cores in SMP mode
+#define MAX_CORES 64
+
 #define GP_REGISTER(register) (THE_CPU.gp_registers[register])
 #define HW_REGISTER(register) (THE_CPU.hw_registers[register])
 
@@ -69,7 +72,9 @@ typedef struct Cpu {
   uint32_t hw_registers[HW_REG_COUNT];
 } Cpu;
 
-extern Cpu THE_CPU;
+// Every host thread that drives a simulated core gets its own
+// register file, so the ISA code can keep using THE_CPU directly
+extern _Thread_local Cpu THE_CPU;
 
 //initialize a CPU to fetch, decode, and execute instructions
 void init_cpu(uint32_t entry_point);
@@ -0,0 +1,37 @@
+#ifndef DEQUE_H
+#define DEQUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Chase-Lev work-stealing deque.
+ *
+ * Only the owning thread may push or pop (the "bottom" end). Any
+ * thread, the owner included, may steal from the "top" end, which
+ * hands items out in FIFO order. No locks are taken on any path.
+ * Items are 32-bit handles; DEQUE_EMPTY is reserved.
+ */
+typedef struct WorkDeque WorkDeque;
+
+#define DEQUE_EMPTY UINT32_MAX
+
+// Create a deque with room for at least `capacity` items (it grows on demand)
+WorkDeque *deque_create(size_t capacity);
+
+// Free the deque and every buffer it has outgrown
+void deque_destroy(WorkDeque *dq);
+
+// Push an item onto the bottom (owner only)
+void deque_push(WorkDeque *dq, uint32_t item);
+
+// Pop the most recently pushed item (owner only), DEQUE_EMPTY if empty
+uint32_t deque_pop(WorkDeque *dq);
+
+// Take the oldest item (any thread), DEQUE_EMPTY if empty
+uint32_t deque_steal(WorkDeque *dq);
+
+// Number of items, exact only when no other thread is touching the deque
+size_t deque_size(WorkDeque *dq);
+
+#endif // !DEQUE_H
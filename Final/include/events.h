@@ -0,0 +1,59 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Discrete-event queue.
+ *
+ * Events are kept in timestamp order; events due at the same time come
+ * out in the order they were scheduled. The scheduler pops whatever is
+ * due at the current simulated time, and when the CPU has nothing to
+ * run it jumps the clock straight to event_next_time() instead of
+ * ticking through the gap.
+ */
+typedef enum {
+  EVENT_ARRIVAL,     // A process is submitted to the system
+  EVENT_IO_COMPLETE, // A blocked process's I/O request is done
+  EVENT_TIMER,       // A timer set by the system fires
+  EVENT_SWAP_IN,     // A suspended process's memory is back in RAM
+  EVENT_RELEASE      // A periodic task's next job is released
+} EventType;
+
+typedef struct {
+  int time;          // Simulated time the event is due
+  EventType type;
+  uint32_t subject;  // Process handle (or timer id) the event is about
+  uint64_t seq;      // Scheduling order, breaks ties between equal times
+} Event;
+
+typedef struct EventQueue EventQueue;
+
+// No event pending
+#define EVENT_NEVER INT_MAX
+
+// Create an empty queue with room for `capacity` events (it grows on demand)
+EventQueue *event_queue_create(size_t capacity);
+
+// Free the queue and any events still in it
+void event_queue_destroy(EventQueue *q);
+
+// Drop every pending event
+void event_queue_clear(EventQueue *q);
+
+// Schedule an event of `type` about `subject` at simulated time `time`
+void event_schedule(EventQueue *q, int time, EventType type, uint32_t subject);
+
+// Pop the earliest event if it is due at or before `now`, false otherwise
+bool event_pop_due(EventQueue *q, int now, Event *out);
+
+// Time of the earliest pending event, EVENT_NEVER if none
+int event_next_time(const EventQueue *q);
+
+// Number of pending events
+size_t event_count(const EventQueue *q);
+
+#endif // !EVENTS_H
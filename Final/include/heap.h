@@ -0,0 +1,59 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Indexed 4-ary min-heap of 32-bit handles.
+ *
+ * Ordering comes from a comparator, so the same heap serves any key
+ * (burst time, priority, ...). The heap remembers where every handle
+ * sits, which makes changing a key or removing an arbitrary handle
+ * O(log n). Each handle may be in a heap at most once; HEAP_EMPTY is
+ * reserved.
+ */
+typedef struct IndexedHeap IndexedHeap;
+
+#define HEAP_EMPTY UINT32_MAX
+
+/*
+ * Should `a` be served before `b`?
+ *
+ * Must be a strict ordering; break ties (e.g. on the handle) if the
+ * order of equal keys matters.
+ */
+typedef bool (*HeapBefore)(uint32_t a, uint32_t b, void *ctx);
+
+// Create a heap with room for at least `capacity` handles (it grows on demand)
+IndexedHeap *heap_create(size_t capacity, HeapBefore before, void *ctx);
+
+// Free the heap
+void heap_destroy(IndexedHeap *heap);
+
+// Insert a handle that is not already in the heap
+void heap_push(IndexedHeap *heap, uint32_t item);
+
+// Remove and return the first handle, HEAP_EMPTY if empty
+uint32_t heap_pop(IndexedHeap *heap);
+
+// The first handle without removing it, HEAP_EMPTY if empty
+uint32_t heap_peek(const IndexedHeap *heap);
+
+// Is the handle currently in the heap
+bool heap_contains(const IndexedHeap *heap, uint32_t item);
+
+// The handle's key moved towards the front, restore order
+void heap_decrease_key(IndexedHeap *heap, uint32_t item);
+
+// The handle's key changed in either direction, restore order
+void heap_update(IndexedHeap *heap, uint32_t item);
+
+// Take the handle out wherever it is, false if it was not in the heap
+bool heap_remove(IndexedHeap *heap, uint32_t item);
+
+// Number of handles in the heap
+size_t heap_size(const IndexedHeap *heap);
+
+#endif // !HEAP_H
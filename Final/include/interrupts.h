@@ -0,0 +1,86 @@
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Interrupt controller with a programmable interval timer.
+ *
+ * Pending interrupts wait in a min-heap on priority (lower number =
+ * higher priority, equal priorities in the order they were raised).
+ * The timer is armed for an absolute simulated time; the scheduler runs
+ * instructions back to back until then and calls timer_advance(), which
+ * raises IRQ_TIMER once the deadline is reached. Every host thread
+ * driving a core has its own controller, like THE_CPU.
+ *
+ * Other threads (simulated devices) cannot touch that heap. They post
+ * into an InterruptInbox instead: a bounded lock-free multi-producer,
+ * single-consumer ring. The controller that has the inbox attached
+ * drains it into the heap before looking for pending interrupts, i.e.
+ * between instruction batches.
+ */
+typedef enum {
+  IRQ_TIMER,   // The timer reached its deadline: the quantum expired
+  IRQ_COUNT
+} IRQ;
+
+typedef struct {
+  IRQ irq;
+  int priority;
+} Interrupt;
+
+typedef struct InterruptInbox InterruptInbox;
+
+#define MAX_INTERRUPTS 128
+#define TIMER_IRQ_PRIORITY 0
+
+// The timer is not armed
+#define TIMER_OFF INT_MAX
+
+// Drop every pending interrupt and disarm the timer
+void init_interrupt_controller(void);
+
+// Raise an interrupt (lower number = higher priority)
+void add_interrupt(IRQ irq, int priority);
+
+// Drain the attached inbox, then pop the highest priority pending
+// interrupt. False if none is pending.
+bool check_for_interrupt(Interrupt *out);
+
+// Number of pending interrupts
+size_t pending_interrupts(void);
+
+// Arm the timer to fire at simulated time `deadline`. Re-arming drops a
+// timer interrupt still pending from the previous deadline.
+void timer_set(int deadline);
+
+// Disarm the timer and drop its pending interrupt, if any
+void timer_cancel(void);
+
+// When the timer fires, TIMER_OFF if it is not armed
+int timer_deadline(void);
+
+// The clock reached `now`: raise IRQ_TIMER if the deadline has passed
+void timer_advance(int now);
+
+// Create an inbox holding at least `capacity` posted interrupts
+InterruptInbox *interrupt_inbox_create(size_t capacity);
+
+// Free the inbox. Nothing may post to it or have it attached any more.
+void interrupt_inbox_destroy(InterruptInbox *inbox);
+
+// Post an interrupt from any thread without taking a lock. False if the
+// inbox is full, the device should retry or count it as lost.
+bool interrupt_post(InterruptInbox *inbox, IRQ irq, int priority);
+
+// Posts to `inbox` now reach the calling thread's controller, NULL
+// detaches. Only one thread may have a given inbox attached.
+void interrupt_attach_inbox(InterruptInbox *inbox);
+
+// Move everything posted to the attached inbox into the pending heap,
+// returns how many were moved
+size_t interrupt_drain(void);
+
+#endif // !INTERRUPTS_H
@@ -1,7 +1,9 @@
 #ifndef ISA_H
 #define ISA_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include "cpu.h"
 #define CPU_HALT (uint32_t)0xFFFFFFFF
 #define SET_FLAG(flag)   (THE_CPU.hw_registers[FLAGS] |= (flag))
 #define CLEAR_FLAG(flag) (THE_CPU.hw_registers[FLAGS] &= ~(flag))
@@ -108,6 +110,43 @@ enum {
   FUNCT_BREAK = 0x0D,
 };
 
+// Syscalls that wait on something outside the CPU
+enum {
+  SYSCALL_READ_INT = 5,
+  SYSCALL_SLEEP_MS = 13,
+};
+
+// Polls the keyboard, answered at once (0 when no key is waiting)
+enum {
+  SYSCALL_READ_CHAR = 12,
+};
+
+// Syscalls the OS answers for the running process
+enum {
+  SYSCALL_GET_TIME_MS = 14,  // Returns the simulated clock in milliseconds
+  SYSCALL_SET_TICKETS = 15,  // $a0 = new ticket count (0 = keep), returns the old count
+  SYSCALL_LEND_TICKETS = 16, // $a0 = pid, $a1 = tickets to lend it, returns tickets lent
+};
+
+// Answers a syscall the CPU does not handle itself: gets the code and
+// $a0/$a1, returns the value for $v0
+typedef uint32_t (*SyscallHandler)(uint32_t code, uint32_t a0, uint32_t a1);
+
 void execute_instruction(uint32_t instruction);
 
+// With deferred syscalls on, a blocking syscall does not wait on the
+// host: it leaves its code in IO_AR and its argument in IO_BR and
+// returns, and the OS blocks the process until it completes the request
+// with complete_syscall(). Off by default, so bare CPU runs behave as before.
+void set_deferred_syscalls(bool enabled);
+
+// Carry out the syscall deferred in pid's saved register file, put its
+// result in $v0 and clear the request. False, with the request left in
+// place, if it cannot complete yet because its input is not all typed.
+bool complete_syscall(Cpu *cpu, int pid);
+
+// Route the OS syscalls to `handler`. Without one (the default) they
+// do nothing and return 0, except get_time_ms, which reads the host clock.
+void set_syscall_handler(SyscallHandler handler);
+
 #endif // !ISA_H
@@ -0,0 +1,59 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Keyboard device for the input syscalls.
+ *
+ * A process can be given a script: a file whose bytes it reads as keys,
+ * one per read_char_nb, so interactive programs run headless and every
+ * run sees the same input. Without a script a process reads the
+ * terminal. The first time one reads it a reader thread starts, filling
+ * the input ring of whichever process has focus; the first single-key
+ * poll also puts the terminal into raw mode (once, restored at exit).
+ * Focus goes to the first process that reads, until it exits or is
+ * moved with keyboard_focus. A poll is then a read from memory.
+ */
+
+// Bytes a process's terminal input ring holds before keys are dropped
+#define KEYBOARD_RING_SIZE 1024
+
+// read_char_nb on this thread now reads pid's input. A negative pid
+// (e.g. SYSTEM_PROCESS_ID) never has a script.
+void keyboard_attach(int pid);
+
+// The pid attached on this thread
+int keyboard_attached(void);
+
+// Feed pid the contents of `path` instead of the terminal. False if the
+// file cannot be read.
+bool keyboard_script(int pid, const char *path);
+
+// Start every script over and hand the terminal back, for the next run
+// of the same workload
+void keyboard_rewind(void);
+
+// Send the keys typed from now on to pid
+void keyboard_focus(int pid);
+
+// pid exited: its unread keys are dropped, and if it had focus the next
+// process to read takes it
+void keyboard_release(int pid);
+
+// The next key for the attached process, 0 if none is waiting
+uint32_t keyboard_read_char(void);
+
+// Read a decimal integer for pid, waiting for its keys if need be. 0 if
+// the input holds no number.
+uint32_t keyboard_read_int(int pid);
+
+// The same without waiting: false, with nothing taken, while the number
+// is not yet typed to the end
+bool keyboard_try_read_int(int pid, uint32_t *value);
+
+// Stop the reader thread, restore the terminal and drop every script
+void keyboard_close(void);
+
+#endif // !KEYBOARD_H
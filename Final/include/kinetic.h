@@ -0,0 +1,51 @@
+#ifndef KINETIC_H
+#define KINETIC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Kinetic tournament tree over response ratios.
+ *
+ * Every item is a line in time: its score at time t is
+ * (t - arrival) / burst, i.e. its response ratio minus one. Each
+ * internal node keeps the winner of its subtree together with the
+ * time at which that match is next decided differently, so asking for
+ * the highest ratio is O(1) and moving time forward only replays the
+ * matches that actually flipped. Insert and remove are O(log n).
+ *
+ * Time may only move forward. Items are 32-bit handles used directly
+ * as leaf indices, so they should be small and dense; KINETIC_EMPTY is
+ * reserved. Items with a burst of zero or less always lose, equal
+ * scores go to the lower handle.
+ */
+typedef struct KineticTree KineticTree;
+
+#define KINETIC_EMPTY UINT32_MAX
+
+// Create a tree with leaves for handles below `capacity` (it grows on demand)
+KineticTree *kinetic_create(size_t capacity);
+
+// Free the tree
+void kinetic_destroy(KineticTree *tree);
+
+// Add an item that arrived at `arrival` and needs `burst` ticks
+void kinetic_insert(KineticTree *tree, uint32_t item, int arrival, int burst);
+
+// Take an item out, false if it was not in the tree
+bool kinetic_remove(KineticTree *tree, uint32_t item);
+
+// Move the tree's clock to `now`, earlier times are ignored
+void kinetic_advance(KineticTree *tree, int now);
+
+// The item with the highest ratio at the current time, KINETIC_EMPTY if empty
+uint32_t kinetic_peek(const KineticTree *tree);
+
+// Remove and return the item with the highest ratio at the current time
+uint32_t kinetic_pop(KineticTree *tree);
+
+// Number of items in the tree
+size_t kinetic_size(const KineticTree *tree);
+
+#endif // !KINETIC_H
@@ -0,0 +1,47 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Leveled logging for the simulator's own messages on stdout.
+ *
+ * A message is formatted only when its level is both compiled in (up to
+ * LOG_MAX_LEVEL, e.g. make LOG_MAX=0) and enabled at run time (--quiet,
+ * --log-level). Below that, a log call costs one compare and no I/O.
+ * Errors still go to stderr, and the result reports and what the
+ * simulated programs print are not logging.
+ */
+typedef enum {
+  LOG_QUIET,   // Nothing but results and program output
+  LOG_INFO,    // Setup: memory, assembly, process creation, run banners
+  LOG_DEBUG,   // Every scheduling and memory event as it happens (default)
+  LOG_TRACE    // CPU state dumps
+} LogLevel;
+
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LOG_TRACE
+#endif
+
+extern LogLevel g_log_level;
+
+#define log_enabled(level) ((level) <= LOG_MAX_LEVEL && (level) <= g_log_level)
+
+#define log_at(level, ...)      \
+  do {                          \
+    if (log_enabled(level)) {   \
+      printf(__VA_ARGS__);      \
+    }                           \
+  } while (0)
+
+#define log_info(...) log_at(LOG_INFO, __VA_ARGS__)
+#define log_debug(...) log_at(LOG_DEBUG, __VA_ARGS__)
+#define log_trace(...) log_at(LOG_TRACE, __VA_ARGS__)
+
+void set_log_level(LogLevel level);
+
+// "quiet", "info", "debug" or "trace". False for anything else.
+bool parse_log_level(const char *name, LogLevel *out);
+
+#endif // !LOG_H
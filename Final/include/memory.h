@@ -22,6 +22,12 @@ typedef enum {
   CACHE_WRITE_BACK
 } CachePolicy;
 
+// Backing store a suspended process is swapped out to
+typedef enum {
+  SWAP_SSD,
+  SWAP_HDD
+} SwapDevice;
+
 // Initialize the memory and storage for the system
 void init_memory(const CachePolicy policy);
 
@@ -52,6 +58,21 @@ uint16_t read_hword(uint32_t addr);
  */
 uint32_t read_word(uint32_t addr);
 
+/*
+ * Copy the NUL-terminated string at the given memory adress into buf,
+ * without the terminator. Takes the memory lock once and checks access
+ * rights once per region rather than per byte.
+ *
+ * Parameters:
+ *  addr: Memory adress of the first character
+ *  buf: Where to copy the characters
+ *  max: Most characters to copy
+ *
+ * Returns the number of characters copied, stopping early at the
+ * terminator or at an address the process may not read
+ */
+size_t read_string(uint32_t addr, char *buf, size_t max);
+
 /*
  * Write the given byte to the given memory adress
  *
@@ -79,11 +100,38 @@ void write_hword(uint32_t addr, uint16_t data);
  */
 void write_word(uint32_t addr, uint32_t data);
 
+/*
+ * Copy a block of bytes into memory in one go, bypassing the caches:
+ * cached lines in the range are written back and dropped first. For
+ * loading program images, not for the running program.
+ *
+ * Parameters:
+ *  addr: Memory adress to begin writing to
+ *  src: Bytes to write
+ *  len: Number of bytes
+ *
+ * Returns false, writing nothing, if the current process may not
+ * write the whole range
+ */
+bool write_block(uint32_t addr, const void *src, size_t len);
+
 /*
  * Set the currently executing process (for access control)
  */
 void set_current_process(int pid);
 
+/*
+ * Set the number of simulated cores sharing the memory system.
+ * Each core gets a private L1; L2 and RAM stay shared and the
+ * accessors are serialized once more than one core is active.
+ */
+void set_core_count(int cores);
+
+/*
+ * Bind the calling thread to the given core's L1 cache
+ */
+void set_current_core(int core);
+
 /*
  * Control whether liberate actually frees memory blocks.
  * Useful for comparison runs where the same allocations are
@@ -91,6 +139,10 @@ void set_current_process(int pid);
  */
 void set_memory_freeze(bool freeze);
 
+// write back every dirty line and empty all caches, so the next
+// run starts cold
+void flush_caches(void);
+
 /*
  * Allocate memory for the given process
  *
@@ -104,13 +156,38 @@ void set_memory_freeze(bool freeze);
 uint32_t mallocate(int pid, size_t size);
 
 /*
- * Write the given halfword to the given memory adress
+ * Free every block allocated to the given process
  *
  * Parameters:
  *  pid: Process id of the process to be freed
  */
 void liberate(int pid);
 
+// Bytes of RAM not allocated to any process
+size_t get_free_ram(void);
+
+// Bytes of RAM allocated to the given process
+size_t get_process_ram(int pid);
+
+/*
+ * Suspend a process's memory: copy its text, data and stack blocks to
+ * the SSD (the HDD once the SSD is full) and free them in RAM
+ *
+ * Returns:
+ *  Simulated time the transfer takes, -1 if it could not be swapped
+ */
+int swap_out(int pid);
+
+/*
+ * Resume a process's memory: copy its blocks back from swap to the
+ * addresses they were swapped out of
+ *
+ * Returns:
+ *  Simulated time the transfer takes, -1 if it is not swapped out or
+ *  its RAM has been allocated to someone else
+ */
+int swap_in(int pid);
+
 // getters for memory stats
 unsigned long get_L1_hits(void);
 unsigned long get_L1_misses(void);
@@ -118,6 +195,19 @@ unsigned long get_L2_hits(void);
 unsigned long get_L2_misses(void);
 unsigned long get_write_backs(void);
 
+// cache hits & misses caused by one process
+typedef struct {
+  unsigned long l1_hits;
+  unsigned long l1_misses;
+  unsigned long l2_hits;
+  unsigned long l2_misses;
+} CacheCounters;
+
+CacheCounters get_process_cache_counters(int pid);
+
+// number of lines in each core's private L1
+size_t get_L1_line_count(void);
+
 
 // print the number of cache hits & misses
 void print_cache_stats(void);
@@ -0,0 +1,84 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Relocatable object format for assembled programs.
+ *
+ * An object holds the encoded text, the initial data, the symbols as
+ * offsets into their segment, and a relocation for every instruction
+ * that holds an absolute address. Loading it only has to allocate the
+ * segments, patch those instructions for where the segments landed and
+ * copy both into RAM. Objects are cached on disk under a hash of their
+ * source, so an unchanged program is never assembled twice.
+ *
+ * The file is written in host byte order; the cache is local.
+ */
+
+#define OBJECT_MAGIC "MIPSOBJ"
+// Bump when the layout changes or the assembler encodes the same source
+// differently, so cached objects from older builds are reassembled
+#define OBJECT_VERSION 3
+
+typedef enum {
+  SEGMENT_TEXT,
+  SEGMENT_DATA,
+  SEGMENT_ABSOLUTE   // Not in either segment, the value is used as is
+} ObjectSegment;
+
+typedef enum {
+  RELOC_JUMP,        // j/jal: the 26-bit target field
+  RELOC_LOAD_ADDRESS // la: addiu rt, $zero, addr or lui rt, addr >> 16
+} RelocationType;
+
+typedef struct {
+  char name[64];
+  uint32_t value;    // Offset into its segment, or the address itself
+  uint8_t segment;   // ObjectSegment
+  bool is_global;
+  bool is_procedure;
+} ObjectSymbol;
+
+typedef struct {
+  uint32_t offset;   // Byte offset of the instruction in text
+  uint32_t type;     // RelocationType
+  uint32_t symbol;   // Index into the symbol table
+} Relocation;
+
+typedef struct {
+  uint64_t source_hash;
+  uint32_t *text;
+  uint32_t text_count;     // Instructions
+  uint8_t *data;
+  uint32_t data_size;
+  ObjectSymbol *symbols;
+  uint32_t symbol_count;
+  Relocation *relocations;
+  uint32_t relocation_count;
+  int32_t entry_symbol;    // Index of main, -1 to start at the first instruction
+} ObjectFile;
+
+// 64-bit FNV-1a of a source file's bytes, the cache key
+uint64_t object_hash(const void *data, size_t len);
+
+// Write obj to path, atomically so concurrent runs never see half a file
+bool object_write(const ObjectFile *obj, const char *path);
+
+// Read an object. False (obj left empty) if the file is missing, from
+// another format version, or its header claims more than the file holds.
+bool object_read(ObjectFile *obj, const char *path);
+
+void object_free(ObjectFile *obj);
+
+// Keep objects in dir, created on first use. NULL (the default) turns
+// the cache off.
+void set_object_cache(const char *dir);
+
+// Where the object for a source with this hash is cached. False if the
+// cache is off.
+bool object_cache_path(uint64_t source_hash, char *path, size_t size);
+
+#endif // !OBJECT_H
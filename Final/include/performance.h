@@ -1,13 +1,18 @@
 #ifndef PERFORMANCE_H
 #define PERFORMANCE_H
 
+#include "cpu.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 #include <sys/time.h>
 
 // Maximum number of algorithms to track
-#define MAX_ALGORITHMS 10
-#define MAX_PROCESSES 100
+#define MAX_ALGORITHMS 16
+
+// Run-queue length histogram buckets: 0, 1, 2, 3, 4-7, 8-15, 16-31, 32+
+#define QUEUE_LENGTH_BUCKETS 8
 
 // Performance metrics for individual processes
 typedef struct {
@@ -19,6 +24,7 @@ typedef struct {
   int turnaround_time;
   int response_time;
   int priority;
+  double target_cpu;               // CPU time its tickets entitled it to, -1 outside lottery/stride
 } ProcessMetrics;
 
 // Performance metrics for scheduling algorithms
@@ -31,6 +37,7 @@ typedef struct {
   double avg_response_time;        // Average response time
   double cpu_utilization;          // CPU utilization percentage
   double throughput;               // Processes completed per unit time
+  double fairness_index;           // Jain's index of per-process slowdown, 1.0 = fair
   
   // Memory metrics
   unsigned long l1_cache_hits;
@@ -39,20 +46,52 @@ typedef struct {
   unsigned long l2_cache_misses;
   unsigned long write_backs;
   
-  // Per-process metrics
-  ProcessMetrics process_metrics[MAX_PROCESSES];
+  // Per-process metrics, grown as processes complete
+  ProcessMetrics *process_metrics;
   int process_count;
+  int process_capacity;
   
   // Timing breakdown
   double scheduler_time;           // Time spent in scheduler
   double context_switch_time;      // Time spent context switching
   double execution_time_total;     // Total process execution time
   double idle_time;                // CPU idle time
+  int idle_skipped;                // Idle ticks jumped over rather than simulated
+  int idle_jumps;                  // Number of such jumps
   
   // System time tracking
   int start_time;
   int end_time;
   int total_burst_time;
+
+  // Multiprocessor tracking
+  int cores;                       // Simulated CPUs (0 or 1 = uniprocessor)
+  int core_busy_time[MAX_CORES];   // Ticks each core spent executing
+
+  // Load balancing (per-core run queues)
+  int steals;                      // Processes taken from another core's queue
+  int migrations;                  // Dispatches on a different core than last time
+  int same_core_dispatches;        // Dispatches on the core that last ran the process
+  unsigned long queue_length_histogram[QUEUE_LENGTH_BUCKETS]; // Per core, per round
+
+  // Cache affinity
+  int affinity_aware;              // Dispatcher tried to keep processes on warm cores
+  int affinity_baseline;           // Algorithm id of the affinity-blind run, -1 if none
+
+  // Medium-term scheduling
+  double avg_multiprogramming;     // Time-averaged processes resident in RAM
+  int peak_multiprogramming;       // Most processes resident at once
+  int swap_outs;                   // Processes suspended to swap
+  int swap_ins;                    // Processes brought back from swap
+  unsigned long swap_bytes;        // Bytes moved either way
+  int swap_time;                   // Simulated time the swap device was busy
+
+  // Real-time (EDF, RM)
+  int rt_jobs;                     // Jobs of admitted periodic tasks completed
+  int deadline_misses;             // Of those, finished after their deadline
+  long total_lateness;             // Summed over the late jobs
+  int max_lateness;
+  int admission_rejections;        // Tasks that failed the utilization test
 } PerformanceMetrics;
 
 // Global metrics storage
@@ -87,15 +126,59 @@ int start_algorithm_tracking(const char *algorithm_name);
 // End tracking for current algorithm
 void end_algorithm_tracking(int algorithm_id);
 
+// Id of the algorithm tracked last, -1 before the first
+int get_current_algorithm_id(void);
+
+// Metrics of a tracked algorithm, NULL for an unknown id
+const PerformanceMetrics *get_algorithm_metrics(int algorithm_id);
+
 // Record process metrics
 void record_process_metrics(int algorithm_id, int pid, int arrival_time, 
                            int burst_time, int completion_time, 
                            int waiting_time, int turnaround_time,
                            int response_time, int priority);
 
+// Record the CPU time a process's tickets entitled it to, for the
+// achieved-against-target share of proportional-share runs
+void record_process_share(int algorithm_id, int pid, double target_cpu);
+
 // Record a context switch
 void record_context_switch(int algorithm_id);
 
+// Record how many simulated CPUs the algorithm ran on
+void record_core_count(int algorithm_id, int cores);
+
+// Record the busy ticks of one simulated CPU
+void record_core_busy_time(int algorithm_id, int core, int ticks);
+
+// Record an idle gap the clock jumped over
+void record_idle_time(int algorithm_id, int ticks);
+
+// Record work stealing activity of one simulated CPU
+void record_load_balance(int algorithm_id, int steals, int migrations,
+                         int same_core_dispatches);
+
+// Mark a run as cache-affinity aware, compared against an affinity-blind run
+void record_affinity_run(int algorithm_id, int baseline_id);
+
+// Add one core's run-queue length samples into the histogram
+void record_queue_length_histogram(int algorithm_id, const unsigned long *buckets);
+
+// Record one swap transfer of a suspended process
+void record_swap(int algorithm_id, bool swap_in, size_t bytes, int ticks);
+
+// Record a finished real-time job, `lateness` = finish - deadline
+void record_job(int algorithm_id, int lateness);
+
+// Record a periodic task refused by admission control
+void record_admission_rejection(int algorithm_id);
+
+// Record how many processes were resident in RAM over the run
+void record_multiprogramming(int algorithm_id, double average, int peak);
+
+// Histogram bucket a run-queue length falls into
+int queue_length_bucket(int length);
+
 // Record scheduler time
 void record_scheduler_time(int algorithm_id, double time_ms);
 
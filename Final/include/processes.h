@@ -1,6 +1,8 @@
 #ifndef PROCESSES_H
 #define PROCESSES_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum {
@@ -10,9 +12,23 @@ typedef enum {
   SCHED_SRT,
   SCHED_HRRN,
   SCHED_SPN,
-  SCHED_MLFQ
+  SCHED_MLFQ,
+  SCHED_CFS,
+  SCHED_LOTTERY,
+  SCHED_STRIDE,
+  SCHED_EDF,
+  SCHED_RM
 } SchedulingAlgorithm;
 
+// A periodic real-time task: one job is released every `period` ticks
+// from its arrival and must get up to `wcet` ticks of CPU within
+// `deadline` ticks of its release. A period of 0 means best-effort.
+typedef struct {
+  int period;
+  int deadline;   // 0 = the period
+  int wcet;
+} RealTimeParams;
+
 void init_queues(void);
 
 void free_queues(void);
@@ -41,6 +57,10 @@ void reset_process_storage(void);
  * @param stack_ptr Initial stack pointer value
  * @param priority Process priority (for priority scheduling)
  * @param burstTime Estimated CPU burst time (for SPN/SRT scheduling)
+ * @param arrival_time Simulated time the process is submitted
+ * @param hard_affinity Bit mask of CPUs the process may run on (0 = any)
+ * @param soft_affinity Bit mask of CPUs the process prefers (0 = none)
+ * @param realtime Period, deadline and WCET for EDF/RM (period 0 = none)
  * @return Address of allocated memory, or UINT32_MAX on failure
  */
 uint32_t makeProcess(int pID, 
@@ -51,7 +71,49 @@ uint32_t makeProcess(int pID,
                      uint32_t data_size,
                      uint32_t stack_ptr,
                      int priority, 
-                     int burstTime);
+                     int burstTime,
+                     int arrival_time,
+                     uint64_t hard_affinity,
+                     uint64_t soft_affinity,
+                     RealTimeParams realtime);
+
+// Number of simulated CPUs to dispatch onto. With more than one,
+// every core runs on its own host thread and time advances in lockstep.
+void set_scheduler_cores(int cores);
+
+// Cache-warmth aware dispatch for multiprocessor runs: honour soft
+// affinity and leave processes with a warm L1 on their last core
+// unless that core is backed up.
+void set_scheduler_affinity(bool enabled);
+
+// Medium-term scheduling: whenever free RAM drops below `bytes`, suspend
+// processes to the SSD/HDD until it is back above, and resume them once
+// there is room again or nothing else can run. 0 (the default) never
+// swaps. Uniprocessor runs only.
+void set_swap_watermark(size_t bytes);
+
+// Simulated clock: sleep_ms and get_time_ms count ticks_per_ms
+// instructions as a millisecond (default 1). With `paced`, the scheduler
+// waits for the host clock whenever the simulated one gets ahead of it,
+// for playing the interactive programs; otherwise a run goes as fast as
+// the host allows.
+void set_clock_params(int ticks_per_ms, bool paced);
+
+// Completely fair scheduling: every ready process runs within `latency`
+// ticks, in slices proportional to its weight but never shorter than
+// `granularity` ticks. Defaults 24 and 3.
+void set_cfs_params(int latency, int granularity);
+
+// Multi-level feedback queue: `levels` round-robin levels (at most
+// MLFQ_MAX_LEVELS), quanta[i] ticks at level i. A process drops a level
+// once it has used that level's quantum in total, and every `boost`
+// ticks everything returns to the top (0 = never). Defaults 2, 4, 8
+// and 100.
+#define MLFQ_MAX_LEVELS 32
+void set_mlfq_params(const int *quanta, int levels, int boost);
+
+// Seed for the lottery draws, so a run can be repeated. Default 1.
+void set_lottery_seed(uint64_t seed);
 
 void scheduler(SchedulingAlgorithm algorithm);
 #endif
@@ -0,0 +1,52 @@
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Red-black tree of 32-bit handles.
+ *
+ * Ordering comes from a comparator, as for the heap. Nodes live in an
+ * array indexed by handle, so nothing is allocated per insert, and the
+ * leftmost handle is cached: peeking at the first handle is O(1),
+ * insert and remove are O(log n). Each handle may be in a tree at most
+ * once; RB_EMPTY is reserved. A handle's key must not change while it
+ * is in the tree: remove it, change the key, insert it again.
+ */
+typedef struct RBTree RBTree;
+
+#define RB_EMPTY UINT32_MAX
+
+// Should `a` come before `b`? Must be a strict ordering.
+typedef bool (*RBBefore)(uint32_t a, uint32_t b, void *ctx);
+
+// Create a tree with nodes for handles below `capacity` (it grows on demand)
+RBTree *rb_create(size_t capacity, RBBefore before, void *ctx);
+
+// Free the tree
+void rb_destroy(RBTree *tree);
+
+// Insert a handle that is not already in the tree
+void rb_insert(RBTree *tree, uint32_t item);
+
+// Take the handle out wherever it is, false if it was not in the tree
+bool rb_remove(RBTree *tree, uint32_t item);
+
+// The first handle without removing it, RB_EMPTY if empty
+uint32_t rb_first(const RBTree *tree);
+
+// Remove and return the first handle, RB_EMPTY if empty
+uint32_t rb_pop_first(RBTree *tree);
+
+// Is the handle currently in the tree
+bool rb_contains(const RBTree *tree, uint32_t item);
+
+// Number of handles in the tree
+size_t rb_size(const RBTree *tree);
+
+// Check the ordering and red-black invariants, for tests
+bool rb_valid(const RBTree *tree);
+
+#endif // !RBTREE_H
@@ -0,0 +1,43 @@
+#ifndef TICKETS_H
+#define TICKETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Lottery ticket tree over 32-bit handles.
+ *
+ * Every handle holds some number of tickets; ticket numbers are laid
+ * out handle by handle, so drawing ticket number r finds the handle
+ * whose range contains it. Backed by a Fenwick tree of prefix sums:
+ * setting a count and drawing are both O(log n). A handle with zero
+ * tickets is not in the tree. Handles are used directly as indices, so
+ * they should be small and dense; TICKETS_EMPTY is reserved.
+ */
+typedef struct TicketTree TicketTree;
+
+#define TICKETS_EMPTY UINT32_MAX
+
+// Create a tree for handles below `capacity` (it grows on demand)
+TicketTree *tickets_create(size_t capacity);
+
+// Free the tree
+void tickets_destroy(TicketTree *tree);
+
+// Give a handle `count` tickets, replacing what it held; 0 takes it out
+void tickets_set(TicketTree *tree, uint32_t item, uint64_t count);
+
+// Tickets the handle holds, 0 if it is not in the tree
+uint64_t tickets_get(const TicketTree *tree, uint32_t item);
+
+// Tickets held by all handles together
+uint64_t tickets_total(const TicketTree *tree);
+
+// The handle holding ticket number `ticket` (0 <= ticket < total),
+// TICKETS_EMPTY if there is no such ticket
+uint32_t tickets_draw(const TicketTree *tree, uint64_t ticket);
+
+// Number of handles holding tickets
+size_t tickets_size(const TicketTree *tree);
+
+#endif // !TICKETS_H
@@ -0,0 +1,99 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Workloads: which programs arrive when, and how much CPU they want.
+ *
+ * A workload file lists one process per line,
+ *
+ *   # program            arrival  burst  priority  [period deadline wcet]
+ *   hello_world.asm      0        50     1
+ *   factorial.asm        40
+ *   snake.asm            0        5000   1         100    100      20
+ *
+ * where everything after the program is optional. The last three make
+ * the process a periodic real-time task for EDF and RM. Relative program
+ * paths are taken relative to the workload file.
+ *
+ * The generator draws a seeded synthetic workload: inter-arrival gaps
+ * from one of the arrival patterns, and alternating CPU and I/O bursts
+ * from the burst distributions. Each process can be written out as a
+ * .asm program that spins through its CPU bursts and sleeps for its
+ * I/O bursts, and the whole workload as a workload file that replays it.
+ */
+typedef enum {
+  ARRIVAL_POISSON,      // Exponential gaps
+  ARRIVAL_BURSTY,       // Tight clusters separated by long quiet spells
+  ARRIVAL_HEAVY_TAILED  // Pareto gaps, mostly short with rare huge ones
+} ArrivalPattern;
+
+typedef enum {
+  BURST_FIXED,
+  BURST_UNIFORM,
+  BURST_EXPONENTIAL,
+  BURST_PARETO
+} BurstDistribution;
+
+typedef struct {
+  BurstDistribution shape;
+  int mean;
+} BurstSpec;
+
+typedef struct {
+  uint64_t seed;
+  int count;              // Processes to generate
+  ArrivalPattern arrivals;
+  int mean_gap;           // Mean time between arrivals
+  BurstSpec cpu;          // Length of each CPU burst, in instructions
+  BurstSpec io;           // Length of each I/O burst (sleep_ms), mean 0 for none
+  int phases;             // CPU bursts per process, with an I/O burst between each
+  int max_priority;       // Priorities are drawn from 1..max_priority
+} WorkloadConfig;
+
+typedef struct {
+  char *program;   // Path of the program to run
+  int arrival;     // Simulated time the process is submitted
+  int burst;       // CPU burst estimate, -1 if not given
+  int priority;    // -1 if not given
+  int period;      // Real-time task parameters, 0 if not given
+  int deadline;
+  int wcet;
+
+  // Generated processes only
+  int phases;
+  int *cpu_bursts;
+  int *io_bursts;  // phases - 1 entries
+} WorkloadEntry;
+
+typedef struct {
+  WorkloadEntry *entries;
+  int count;
+  int capacity;
+} Workload;
+
+// Sensible defaults: 20 Poisson arrivals, exponential CPU bursts, no I/O
+void workload_defaults(WorkloadConfig *cfg);
+
+// Draw a synthetic workload. Programs are left unset until written out.
+Workload *workload_generate(const WorkloadConfig *cfg);
+
+// Read a workload file, NULL if it cannot be read or is malformed
+Workload *workload_load(const char *path);
+
+// Write each process's program as <dir>/gen_<n>.asm and the workload
+// file replaying them as <dir>/workload.txt. False on I/O errors.
+bool workload_write(Workload *workload, const char *dir);
+
+// Write one generated process as a .asm program
+bool workload_write_asm(const WorkloadEntry *entry, const char *path);
+
+void workload_free(Workload *workload);
+
+// Parse names used on the command line, false if unknown
+bool workload_parse_arrivals(const char *name, ArrivalPattern *out);
+bool workload_parse_burst(const char *name, BurstDistribution *out);
+
+#endif // !WORKLOAD_H
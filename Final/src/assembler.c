@@ -1,16 +1,21 @@
 // MIPS-1 Assembler Implementation
 #include "../include/assembler.h"
 #include "../include/memory.h"
+#include "../include/log.h"
+#include "../include/object.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-
-#define MAX_LINE 512
-#define MAX_SYMBOLS 1024
-#define MAX_INSTRUCTIONS 4096
-#define MAX_DATA 8192
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SYMBOL_BUCKETS 2048 // Starting size, a power of two kept at most half full
 #define MAX_MACROS 256
 #define MAX_MACRO_LINES 128
 #define MAX_MACRO_PARAMS 16
@@ -18,8 +23,16 @@
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================= INTERNAL STRUCTS ========================================= */
 
+// A piece of the source file, which stays mapped until the text is
+// assembled. Not NUL-terminated.
+typedef struct {
+  const char *text;   // NULL for a missing operand
+  uint32_t len;
+} Span;
+
 typedef struct {
   char name[64];
+  uint32_t hash;      // Of name, so a probe only compares names that match it
   uint32_t address;
   bool is_global;
   bool is_procedure;
@@ -35,30 +48,58 @@ typedef struct {
 
 typedef struct {
   uint32_t address;
-  uint8_t data[MAX_DATA];
+  uint8_t *data;
   uint32_t size;
+  uint32_t capacity;  // Bytes past size are kept zeroed, for .align and .space
 } DataSegment;
 
+// An operand, or a '(' or ')' of a memory operand
+typedef struct {
+  uint32_t start;     // Offset into the source
+  uint32_t len;
+} Token;
+
 typedef struct {
   uint32_t address;
-  char* line;
-  int line_number;
+  const char *op;     // From the mnemonic table, NULL if unknown
+  uint32_t first_token;
+  uint32_t token_count;
+  uint32_t line_number;
 } TextEntry;
 
+// Walks the operands of one instruction
+typedef struct {
+  const char *source;
+  const Token *next;
+  const Token *end;
+} Operands;
+
 // Assembly context (keeps state during assembly)
 typedef struct {
-  Symbol symbols[MAX_SYMBOLS];
-  uint16_t symbol_count;
+  Symbol *symbols;
+  uint32_t symbol_count;
+  uint32_t symbol_capacity;
+  // Open addressing over symbols, linear probing. Each bucket holds a
+  // symbol index + 1, 0 when empty. Doubled and refilled before it is
+  // more than half full.
+  uint32_t *symbol_buckets;
+  uint32_t bucket_count;
 
   Macro macros[MAX_MACROS];
   uint8_t macro_count;
 
+  const char *source;
+  Token *tokens;
+  uint32_t token_count;
+  uint32_t token_capacity;
+
   DataSegment data_segment;
-  TextEntry text_segment[MAX_INSTRUCTIONS];
-  uint16_t text_count;
+  TextEntry *text_segment;
+  uint32_t text_count;
+  uint32_t text_capacity;
 
   uint32_t current_address;
-  uint16_t source_line;
+  uint32_t source_line;
 
   bool in_data_section;
   bool align_mode;
@@ -66,58 +107,133 @@ typedef struct {
   uint32_t text_base;
   uint32_t data_base;
 
-  // Keeps track of the physical memory 
-  // addresses given by the system
-  // when malocate is called
-  uint32_t allocated_text_addr;
-  uint32_t allocated_data_addr;
+  // Instructions holding an absolute address, found while assembling
+  // the text entry at current_index
+  Relocation *relocations;
+  uint32_t relocation_count;
+  uint32_t relocation_capacity;
+  uint32_t current_index;
 
   int process_id;
+
+  // Errors reported so far. A program with any is still loaded, with a
+  // zero word where the bad instruction was, but never cached.
+  uint32_t error_count;
 } AssemblyContext;
 
+// Every mnemonic the assembler knows. The parser points each
+// instruction at its entry, so no line is copied to get a C string.
+static const char *const MNEMONICS[] = {
+  "add", "addu", "sub", "subu", "and", "or", "xor", "nor", "slt", "sltu",
+  "sll", "srl", "sra", "mult", "multu", "div", "divu",
+  "mfhi", "mflo", "mthi", "mtlo",
+  "addi", "addiu", "andi", "ori", "xori", "slti", "sltiu", "lui",
+  "lw", "sw", "lb", "sb", "lh", "sh", "lbu", "lhu",
+  "beq", "bne", "j", "jal", "jr", "syscall", "break", "eret",
+  "li", "la", "move", "nop"
+};
+
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================== UTILITY FUNCTS ========================================== */
 
-// Trim the leading and trailing white space from a string.
-static char* trim(char* str){
-  // Trim leading white spaces
-  while(isspace(*str)) {str++;}
-  if (*str == 0){return str;}
+static Span span_of(const char *str) {
+  return (Span){ str, (uint32_t)strlen(str) };
+}
 
-  char* end = str + strlen(str) -1;
+static bool span_is(Span s, const char *str) {
+  return s.text && strlen(str) == s.len && memcmp(s.text, str, s.len) == 0;
+}
 
-  // Trim trailing blank spaces
-  while (end > str && isspace(*end)) {end--;}
+// Trim the leading and trailing white space from a span.
+static Span trim(Span s) {
+  while (s.len > 0 && isspace((unsigned char)s.text[0])) {
+    s.text++;
+    s.len--;
+  }
+  while (s.len > 0 && isspace((unsigned char)s.text[s.len - 1])) {
+    s.len--;
+  }
+  return s;
+}
 
-  // Add back null terminator
-  *(end + 1) = 0;
-  return str;
+// Make room for one more element, doubling the array when it is full
+static void *reserve(void *array, uint32_t count, uint32_t *capacity, size_t size, const char *what) {
+  if (count < *capacity) {
+    return array;
+  }
+  uint32_t grown = *capacity ? *capacity * 2 : 256;
+  void *resized = realloc(array, grown * size);
+  if (!resized) {
+    perror(what);
+    exit(EXIT_FAILURE);
+  }
+  *capacity = grown;
+  return resized;
+}
+
+// strtol over a span: optional sign, then digits up to the first one
+// that is not, saturating like strtol does
+static int32_t span_to_int(const char *p, uint32_t len, int base) {
+  uint32_t i = 0;
+  bool negative = false;
+  if (i < len && (p[i] == '-' || p[i] == '+')) {
+    negative = (p[i] == '-');
+    i++;
+  }
+  if (base == 16 && i + 2 < len && p[i] == '0' && (p[i + 1] == 'x' || p[i + 1] == 'X') &&
+      isxdigit((unsigned char)p[i + 2])) {
+    i += 2;
+  }
+  uint64_t value = 0;
+  bool saturated = false;
+  for (; i < len; i++) {
+    int digit;
+    if (isdigit((unsigned char)p[i])) digit = p[i] - '0';
+    else if (isalpha((unsigned char)p[i])) digit = tolower((unsigned char)p[i]) - 'a' + 10;
+    else break;
+    if (digit >= base) break;
+    if (value > (UINT64_MAX - (uint64_t)digit) / (uint64_t)base) {
+      saturated = true;
+    } else {
+      value = value * (uint64_t)base + (uint64_t)digit;
+    }
+  }
+  long result;
+  if (negative) {
+    result = (saturated || value > (uint64_t)LONG_MAX + 1) ? LONG_MIN : (long)(0 - value);
+  } else {
+    result = (saturated || value > (uint64_t)LONG_MAX) ? LONG_MAX : (long)value;
+  }
+  return (int32_t)result;
 }
 
 // Convert a string into it's numeric value
-static int32_t parse_num (const char* str){
-  if (!str) {return 0;}
+static int32_t parse_num(Span s) {
+  if (!s.text) {return 0;}
 
   // Binary number
-  if (str[0] == '0' && (str[1] == 'b' || str[1] == 'B'))
-    return (int32_t)strtol(str + 2, NULL, 2);
+  if (s.len >= 2 && s.text[0] == '0' && (s.text[1] == 'b' || s.text[1] == 'B'))
+    return span_to_int(s.text + 2, s.len - 2, 2);
 
   // Hex number
-  if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
-    return (int32_t)strtol(str, NULL, 16);
+  if (s.len >= 2 && s.text[0] == '0' && (s.text[1] == 'x' || s.text[1] == 'X'))
+    return span_to_int(s.text, s.len, 16);
 
   // Octal number
-  if (str[0] == '0' && isdigit(str[1]))
-    return (int32_t)strtol(str, NULL, 8);
+  if (s.len >= 2 && s.text[0] == '0' && isdigit((unsigned char)s.text[1]))
+    return span_to_int(s.text, s.len, 8);
 
   // Decimal Number
-  return (int32_t)strtol(str, NULL, 10); 
+  return span_to_int(s.text, s.len, 10);
 }
 
-static int get_register(const char* reg){
-  if (!reg || reg[0] != '$') {return -1;}
-  if (isdigit(reg[1])){
-    int num = atoi(reg +1);
+static int get_register(Span reg){
+  if (!reg.text || reg.len == 0 || reg.text[0] != '$') {return -1;}
+  if (reg.len > 1 && isdigit((unsigned char)reg.text[1])){
+    int num = 0;
+    for (uint32_t i = 1; i < reg.len && isdigit((unsigned char)reg.text[i]) && num <= 31; i++) {
+      num = num * 10 + (reg.text[i] - '0');
+    }
     return (num >= 0 && num <=31 ) ? num : -1;
   }
 
@@ -129,44 +245,166 @@ static int get_register(const char* reg){
   };
 
   for (int i = 0; i < 32; i++){
-    if (strcmp(reg, names[i]) == 0) {return i;}
+    if (span_is(reg, names[i])) {return i;}
   }
   return -1;
 }
 
-// At some point maybe i'll hash this so it can be faster
-static void add_symbol(AssemblyContext *ctx, const char *name, uint32_t address, int is_global, int is_proc) {
-  // Update symbol if it already exists
-  for (int i = 0; i < ctx->symbol_count; i++) {
-    if (strcmp(ctx->symbols[i].name, name) == 0) {
-      ctx->symbols[i].address = address;
+// The next operand, skipping the parentheses; a NULL span once there
+// are none left
+static Span next_operand(Operands *ops) {
+  while (ops->next < ops->end) {
+    const Token *tok = ops->next++;
+    const char *text = ops->source + tok->start;
+    if (tok->len != 1 || (text[0] != '(' && text[0] != ')')) {
+      return (Span){ text, tok->len };
+    }
+  }
+  return (Span){ NULL, 0 };
+}
+
+// 32-bit FNV-1a
+static uint32_t hash_name(Span name) {
+  uint32_t hash = 0x811c9dc5u;
+  for (uint32_t i = 0; i < name.len; i++) {
+    hash ^= (unsigned char)name.text[i];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
 
-      if (is_global) { ctx->symbols[i].is_global = 1;}
-      if (is_proc) {ctx->symbols[i].is_procedure = 1;}
+// The bucket holding `name`, or the empty one where it would go
+static uint32_t *symbol_bucket(AssemblyContext *ctx, Span name, uint32_t hash) {
+  uint32_t mask = ctx->bucket_count - 1;
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    uint32_t *bucket = &ctx->symbol_buckets[i];
+    if (*bucket == 0) {
+      return bucket;
+    }
+    Symbol *sym = &ctx->symbols[*bucket - 1];
+    if (sym->hash == hash && name.len < sizeof(sym->name) &&
+        memcmp(sym->name, name.text, name.len) == 0 && sym->name[name.len] == '\0') {
+      return bucket;
+    }
+  }
+}
 
-      return;
+// Twice the buckets, every symbol filed again under its stored hash
+static void grow_symbol_buckets(AssemblyContext *ctx) {
+  uint32_t count = ctx->bucket_count ? ctx->bucket_count * 2 : SYMBOL_BUCKETS;
+  uint32_t *buckets = calloc(count, sizeof(uint32_t));
+  if (!buckets) {
+    perror("calloc symbol buckets");
+    exit(EXIT_FAILURE);
+  }
+  free(ctx->symbol_buckets);
+  ctx->symbol_buckets = buckets;
+  ctx->bucket_count = count;
+  for (uint32_t i = 0; i < ctx->symbol_count; i++) {
+    uint32_t mask = count - 1;
+    uint32_t b = ctx->symbols[i].hash & mask;
+    while (buckets[b] != 0) {
+      b = (b + 1) & mask;
     }
+    buckets[b] = i + 1;
+  }
+}
+
+static int find_symbol(AssemblyContext *ctx, Span name) {
+  return (int)*symbol_bucket(ctx, name, hash_name(name)) - 1;
+}
+
+static void add_symbol(AssemblyContext *ctx, Span name, uint32_t address, int is_global, int is_proc) {
+  uint32_t *bucket = symbol_bucket(ctx, name, hash_name(name));
+
+  // Update symbol if it already exists
+  if (*bucket != 0) {
+    Symbol *sym = &ctx->symbols[*bucket - 1];
+    sym->address = address;
+
+    if (is_global) { sym->is_global = 1;}
+    if (is_proc) {sym->is_procedure = 1;}
+
+    return;
   }
 
   // Add in the new symbol
-  if (ctx->symbol_count < MAX_SYMBOLS) {
-    strncpy(ctx->symbols[ctx->symbol_count].name, name, 63);
-    ctx->symbols[ctx->symbol_count].name[63] = '\0';
-    ctx->symbols[ctx->symbol_count].address = address;
-    ctx->symbols[ctx->symbol_count].is_global = is_global ? 1 : 0;
-    ctx->symbols[ctx->symbol_count].is_procedure = is_proc ? 1 : 0;
-    ctx->symbol_count++;
+  ctx->symbols = reserve(ctx->symbols, ctx->symbol_count, &ctx->symbol_capacity,
+                         sizeof(Symbol), "realloc symbols");
+  Symbol *sym = &ctx->symbols[ctx->symbol_count];
+  uint32_t len = (name.len < 63) ? name.len : 63;
+  memcpy(sym->name, name.text, len);
+  sym->name[len] = '\0';
+  // A name cut short is filed under what was kept, which no lookup of
+  // the full name matches, the same as comparing the strings
+  sym->hash = hash_name((Span){ sym->name, len });
+  sym->address = address;
+  sym->is_global = is_global ? 1 : 0;
+  sym->is_procedure = is_proc ? 1 : 0;
+  ctx->symbol_count++;
+  if (ctx->symbol_count * 2 > ctx->bucket_count) {
+    grow_symbol_buckets(ctx);
+  }
+  bucket = symbol_bucket(ctx, (Span){ sym->name, len }, sym->hash);
+  if (*bucket == 0) {
+    *bucket = ctx->symbol_count;
   }
 }
 
-// Same, hash this as well
-static int get_symbol_address(AssemblyContext *ctx, const char *name) {
-  for (int i = 0; i < ctx->symbol_count; i++) {
-    if (strcmp(ctx->symbols[i].name, name) == 0) {
-      return ctx->symbols[i].address;
-    }
+static int get_symbol_address(AssemblyContext *ctx, Span name) {
+  int sym = find_symbol(ctx, name);
+  return (sym == -1) ? -1 : (int)ctx->symbols[sym].address;
+}
+
+// Which segment an assembled address lies in
+static ObjectSegment segment_of(AssemblyContext *ctx, uint32_t address) {
+  if (address >= ctx->text_base && address < ctx->text_base + ctx->text_count * 4) {
+    return SEGMENT_TEXT;
   }
-  return -1;
+  if (address >= ctx->data_base && address < ctx->data_base + ctx->data_segment.size) {
+    return SEGMENT_DATA;
+  }
+  return SEGMENT_ABSOLUTE;
+}
+
+// The instruction being assembled holds the address of `name`, which has
+// to be patched once the loader knows where its segment went
+static void add_relocation(AssemblyContext *ctx, RelocationType type, Span name) {
+  int sym = find_symbol(ctx, name);
+  if (sym == -1 || segment_of(ctx, ctx->symbols[sym].address) == SEGMENT_ABSOLUTE) {
+    return;
+  }
+  ctx->relocations = reserve(ctx->relocations, ctx->relocation_count,
+                             &ctx->relocation_capacity, sizeof(Relocation), "realloc relocations");
+  Relocation *reloc = &ctx->relocations[ctx->relocation_count++];
+  reloc->offset = ctx->current_index * 4;
+  reloc->type = type;
+  reloc->symbol = (uint32_t)sym;
+}
+
+// Room for `bytes` more bytes of data, zeroed
+static void reserve_data(AssemblyContext *ctx, uint32_t bytes) {
+  DataSegment *seg = &ctx->data_segment;
+  if (seg->size + bytes <= seg->capacity) {
+    return;
+  }
+  uint32_t grown = seg->capacity ? seg->capacity : 1024;
+  while (grown < seg->size + bytes) {
+    grown *= 2;
+  }
+  uint8_t *data = realloc(seg->data, grown);
+  if (!data) {
+    perror("realloc data segment");
+    exit(EXIT_FAILURE);
+  }
+  memset(data + seg->capacity, 0, grown - seg->capacity);
+  seg->data = data;
+  seg->capacity = grown;
+}
+
+static void emit_byte(AssemblyContext *ctx, uint8_t byte) {
+  reserve_data(ctx, 1);
+  ctx->data_segment.data[ctx->data_segment.size++] = byte;
 }
 
 // Evil ass wizardry
@@ -174,97 +412,98 @@ static int get_symbol_address(AssemblyContext *ctx, const char *name) {
 // disable with .align 0
 static void align_data(AssemblyContext *ctx, int boundary) {
   if (ctx->align_mode && boundary > 0) {
-    int mask = (1 << boundary) - 1;
+    uint32_t mask = (1u << boundary) - 1;
     if (ctx->data_segment.size & mask) {
-      ctx->data_segment.size = (ctx->data_segment.size + mask) & ~mask;
+      uint32_t aligned = (ctx->data_segment.size + mask) & ~mask;
+      reserve_data(ctx, aligned - ctx->data_segment.size);
+      ctx->data_segment.size = aligned;
     }
   }
 }
 
-static void handle_word(AssemblyContext *ctx, char *values) {
+// The next of a directive's comma separated values, trimmed. Empty
+// values are skipped.
+static bool next_value(Span *values, Span *value) {
+  while (values->len > 0) {
+    const char *comma = memchr(values->text, ',', values->len);
+    uint32_t len = comma ? (uint32_t)(comma - values->text) : values->len;
+    *value = trim((Span){ values->text, len });
+    values->text += comma ? len + 1 : len;
+    values->len -= comma ? len + 1 : len;
+    if (value->len > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void handle_word(AssemblyContext *ctx, Span values) {
   // Words need to be aligned to 4 bytes
   align_data(ctx, 2);
-  char *token = strtok(values, ",");
-  while (token && ctx->data_segment.size + 4 <= MAX_DATA) {
-    token = trim(token);
-    if (!token || token[0] == '\0') {
-      token = strtok(NULL, ",");
-      continue;
-    }
+  Span token;
+  while (next_value(&values, &token)) {
     int32_t value = parse_num(token);
-    ctx->data_segment.data[ctx->data_segment.size++] = value & 0xFF;
-    ctx->data_segment.data[ctx->data_segment.size++] = (value >> 8) & 0xFF;
-    ctx->data_segment.data[ctx->data_segment.size++] = (value >> 16) & 0xFF;
-    ctx->data_segment.data[ctx->data_segment.size++] = (value >> 24) & 0xFF;
-    token = strtok(NULL, ",");
+    emit_byte(ctx, value & 0xFF);
+    emit_byte(ctx, (value >> 8) & 0xFF);
+    emit_byte(ctx, (value >> 16) & 0xFF);
+    emit_byte(ctx, (value >> 24) & 0xFF);
   }
 }
 
-static void handle_half(AssemblyContext *ctx, char *values) {
+static void handle_half(AssemblyContext *ctx, Span values) {
   // halfwords need to be aligned to 2 bytes
   align_data(ctx, 1);
-  char *token = strtok(values, ",");
-  while (token && ctx->data_segment.size + 2 <= MAX_DATA) {
-    token = trim(token);
-    if (!token || token[0] == '\0') {
-      token = strtok(NULL, ",");
-      continue;
-    }
+  Span token;
+  while (next_value(&values, &token)) {
     int16_t value = (int16_t)parse_num(token);
-    ctx->data_segment.data[ctx->data_segment.size++] = value & 0xFF;
-    ctx->data_segment.data[ctx->data_segment.size++] = (value >> 8) & 0xFF;
-    token = strtok(NULL, ",");
+    emit_byte(ctx, value & 0xFF);
+    emit_byte(ctx, (value >> 8) & 0xFF);
   }
 }
 
-static void handle_byte(AssemblyContext *ctx, char *values) {
-  char *token = strtok(values, ",");
-  while (token && ctx->data_segment.size < MAX_DATA) {
-    token = trim(token);
-    if (!token || token[0] == '\0') {
-      token = strtok(NULL, ",");
-      continue;
-    }
-    if (token[0] == '\'' && token[2] == '\'') {
-      ctx->data_segment.data[ctx->data_segment.size++] = token[1];
+static void handle_byte(AssemblyContext *ctx, Span values) {
+  Span token;
+  while (next_value(&values, &token)) {
+    if (token.len >= 3 && token.text[0] == '\'' && token.text[2] == '\'') {
+      emit_byte(ctx, token.text[1]);
     } else {
       int8_t value = (int8_t)parse_num(token);
-      ctx->data_segment.data[ctx->data_segment.size++] = value;
+      emit_byte(ctx, value);
     }
-    token = strtok(NULL, ",");
   }
 }
 
-static void handle_ascii(AssemblyContext *ctx, char *str, int null_terminate) {
+static void handle_ascii(AssemblyContext *ctx, Span str, int null_terminate) {
   int in_string = 0;
-  for (int i = 0; str[i] && ctx->data_segment.size < MAX_DATA; i++) {
-    if (str[i] == '"') {
+  for (uint32_t i = 0; i < str.len; i++) {
+    if (str.text[i] == '"') {
       in_string = !in_string;
     } else if (in_string) {
-      if (str[i] == '\\' && str[i+1]) {
+      if (str.text[i] == '\\' && i + 1 < str.len) {
         i++;
-        switch (str[i]) {
-          case 'n': ctx->data_segment.data[ctx->data_segment.size++] = '\n'; break;
-          case 't': ctx->data_segment.data[ctx->data_segment.size++] = '\t'; break;
-          case 'r': ctx->data_segment.data[ctx->data_segment.size++] = '\r'; break;
-          case '0': ctx->data_segment.data[ctx->data_segment.size++] = '\0'; break;
-          case '\\': ctx->data_segment.data[ctx->data_segment.size++] = '\\'; break;
-          case '"': ctx->data_segment.data[ctx->data_segment.size++] = '"'; break;
-          default: ctx->data_segment.data[ctx->data_segment.size++] = str[i]; break;
+        switch (str.text[i]) {
+          case 'n': emit_byte(ctx, '\n'); break;
+          case 't': emit_byte(ctx, '\t'); break;
+          case 'r': emit_byte(ctx, '\r'); break;
+          case '0': emit_byte(ctx, '\0'); break;
+          case '\\': emit_byte(ctx, '\\'); break;
+          case '"': emit_byte(ctx, '"'); break;
+          default: emit_byte(ctx, str.text[i]); break;
         }
       } else {
-        ctx->data_segment.data[ctx->data_segment.size++] = str[i];
+        emit_byte(ctx, str.text[i]);
       }
     }
   }
-  if (null_terminate && ctx->data_segment.size < MAX_DATA) {
-    ctx->data_segment.data[ctx->data_segment.size++] = '\0';
+  if (null_terminate) {
+    emit_byte(ctx, '\0');
   }
 }
 
 static void handle_space(AssemblyContext *ctx, int bytes) {
-  for (int i = 0; i < bytes && ctx->data_segment.size < MAX_DATA; i++) {
-    ctx->data_segment.data[ctx->data_segment.size++] = 0;
+  if (bytes > 0) {
+    reserve_data(ctx, (uint32_t)bytes);
+    ctx->data_segment.size += (uint32_t)bytes;
   }
 }
 
@@ -274,11 +513,27 @@ static void handle_space(AssemblyContext *ctx, int bytes) {
 static void init_context(AssemblyContext *ctx, int process_id) {
   memset(ctx, 0, sizeof(AssemblyContext));
   ctx->process_id = process_id;
-  ctx->text_base = TEXT_BASE + (process_id * MAX_PROCESS_SIZE);  // 1MB per process
-  ctx->data_base = DATA_BASE + (process_id * MAX_PROCESS_SIZE);
+  ctx->text_base = TEXT_BASE + (uint32_t)process_id * MAX_PROCESS_SIZE;  // 1MB per process
+  ctx->data_base = DATA_BASE + (uint32_t)process_id * MAX_PROCESS_SIZE;
   ctx->current_address = ctx->text_base;
   ctx->data_segment.address = ctx->data_base;
   ctx->align_mode = 1;
+  grow_symbol_buckets(ctx);
+}
+
+static void free_context(AssemblyContext *ctx) {
+  free(ctx->tokens);
+  free(ctx->text_segment);
+  free(ctx->data_segment.data);
+  free(ctx->relocations);
+  free(ctx->symbols);
+  free(ctx->symbol_buckets);
+  ctx->tokens = NULL;
+  ctx->text_segment = NULL;
+  ctx->data_segment.data = NULL;
+  ctx->relocations = NULL;
+  ctx->symbols = NULL;
+  ctx->symbol_buckets = NULL;
 }
 
 // Stupid ass language can't match with strings so BEHOLD
@@ -349,96 +604,105 @@ static uint32_t assemble_j_type(const char *op, uint32_t addr) {
   return (opcode << 26) | ((addr >> 2) & 0x3FFFFFF);
 }
 
-static int validate_register_num(int reg, const char *name, const char *op, uint32_t pc) {
+// Report an error in the source and count it
+static void assembly_error(AssemblyContext *ctx, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  ctx->error_count++;
+}
+
+static int validate_register_num(AssemblyContext *ctx, int reg, Span name, const char *op, uint32_t pc) {
   if (reg < 0 || reg > 31) {
-    fprintf(stderr, "Error: Invalid register '%s' for %s at PC 0x%08x\n",
-            name ? name : "<null>", op, pc);
+    if (name.text) {
+      assembly_error(ctx, "Error: Invalid register '%.*s' for %s at PC 0x%08x\n",
+              (int)name.len, name.text, op, pc);
+    } else {
+      assembly_error(ctx, "Error: Invalid register '<null>' for %s at PC 0x%08x\n", op, pc);
+    }
     return 0;
   }
   return 1;
 }
 
-// Assemble MIPS-1 psuedo instructions
-static int expand_pseudo(AssemblyContext *ctx, const char *op, char *operands, 
-    char output[][MAX_LINE], uint32_t pc) {
-  (void)pc;
-  char args[4][64];
+// addiu rt, $zero, imm if imm fits, else lui rt, imm >> 16
+static uint32_t assemble_load_immediate(AssemblyContext *ctx, Span rt, int32_t imm, uint32_t pc) {
+  int rt_num = get_register(rt);
+  if (imm >= -32768 && imm <= 32767) {
+    if (!validate_register_num(ctx, rt_num, rt, "addiu", pc)) {
+      return 0;
+    }
+    return assemble_i_type("addiu", rt_num, 0, (int16_t)imm);
+  }
+  if (!validate_register_num(ctx, rt_num, rt, "lui", pc)) {
+    return 0;
+  }
+  return assemble_i_type("lui", rt_num, 0, (int16_t)((imm >> 16) & 0xFFFF));
+}
+
+// Assemble MIPS-1 psuedo instructions. Each takes a single word, so a
+// 32-bit li or la only gets its upper half.
+static bool expand_pseudo(AssemblyContext *ctx, const char *op, Operands ops,
+    uint32_t pc, uint32_t *code) {
+  Span args[4];
   int argc = 0;
-  char *saveptr = NULL;
-  char *token = strtok_r(operands, " ,\t()", &saveptr);
-  while (token && argc < 4) {
-    strcpy(args[argc++], trim(token));
-    token = strtok_r(NULL, " ,\t()", &saveptr);
+  Span arg = next_operand(&ops);
+  while (arg.text && argc < 4) {
+    args[argc++] = arg;
+    arg = next_operand(&ops);
   }
 
   if (strcmp(op, "li") == 0 && argc == 2) {
-    int32_t imm = parse_num(args[1]);
-    if (imm >= -32768 && imm <= 32767) {
-      sprintf(output[0], "addiu %s, $zero, %d", args[0], imm);
-      return 1;
-    } else {
-      sprintf(output[0], "lui %s, %d", args[0], (imm >> 16) & 0xFFFF);
-      sprintf(output[1], "ori %s, %s, %d", args[0], args[0], imm & 0xFFFF);
-      return 2;
-    }
+    *code = assemble_load_immediate(ctx, args[0], parse_num(args[1]), pc);
+    return true;
   }
 
   if (strcmp(op, "la") == 0 && argc == 2) {
     int addr = get_symbol_address(ctx, args[1]);
     if (addr == -1) {
-      fprintf(stderr, "Warning: Undefined label '%s' for la, using 0\n", args[1]);
+      assembly_error(ctx, "Error: Undefined label '%.*s' for la, using 0\n",
+              (int)args[1].len, args[1].text);
       addr = 0;
-    }
-    if (addr >= -32768 && addr <= 32767) {
-      sprintf(output[0], "addiu %s, $zero, %d", args[0], addr);
-      return 1;
     } else {
-      sprintf(output[0], "lui %s, %d", args[0], (addr >> 16) & 0xFFFF);
-      sprintf(output[1], "ori %s, %s, %d", args[0], args[0], addr & 0xFFFF);
-      return 2;
+      add_relocation(ctx, RELOC_LOAD_ADDRESS, args[1]);
     }
+    *code = assemble_load_immediate(ctx, args[0], addr, pc);
+    return true;
   }
 
   if (strcmp(op, "move") == 0 && argc == 2) {
-    sprintf(output[0], "addu %s, %s, $zero", args[0], args[1]);
-    return 1;
+    // addu rd, rs, $zero
+    int rd_num = get_register(args[0]);
+    int rs_num = get_register(args[1]);
+    if (!validate_register_num(ctx, rd_num, args[0], "addu", pc) ||
+        !validate_register_num(ctx, rs_num, args[1], "addu", pc)) {
+      *code = 0;
+    } else {
+      *code = assemble_r_type("addu", rd_num, rs_num, 0, 0);
+    }
+    return true;
   }
 
   if (strcmp(op, "nop") == 0) {
-    sprintf(output[0], "sll $zero, $zero, 0");
-    return 1;
+    *code = assemble_r_type("sll", 0, 0, 0, 0);
+    return true;
   }
 
-  return 0;
+  return false;
 }
 
-static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t pc) {
-  char buffer[MAX_LINE];
-  strncpy(buffer, line, MAX_LINE - 1);
-  buffer[MAX_LINE - 1] = '\0';
-
-  char *saveptr = NULL;
-  char *op = strtok_r(buffer, " \t,()", &saveptr);
+static uint32_t assemble_line(AssemblyContext *ctx, const TextEntry *entry, uint32_t pc) {
+  const char *op = entry->op;
   if (!op) return 0;
 
-  // Check pseudo-instructions
-  char expanded[4][MAX_LINE];
-  char rest[MAX_LINE] = "";
-  const char *operand_str = line;
-  while (*operand_str && !isspace((unsigned char)*operand_str)) {
-    operand_str++;
-  }
-  while (*operand_str && isspace((unsigned char)*operand_str)) {
-    operand_str++;
-  }
-  if (*operand_str) {
-    strncpy(rest, operand_str, MAX_LINE - 1);
-    rest[MAX_LINE - 1] = '\0';
-  }
+  const Token *first = ctx->tokens + entry->first_token;
+  Operands ops = { ctx->source, first, first + entry->token_count };
 
-  int exp_count = expand_pseudo(ctx, op, rest, expanded, pc);
-  if (exp_count > 0) {
-    return assemble_line(ctx, expanded[0], pc);
+  // Check pseudo-instructions
+  uint32_t code;
+  if (expand_pseudo(ctx, op, ops, pc, &code)) {
+    return code;
   }
 
   // R-type
@@ -447,28 +711,28 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
       strcmp(op, "and") == 0 || strcmp(op, "or") == 0 ||
       strcmp(op, "xor") == 0 || strcmp(op, "nor") == 0 ||
       strcmp(op, "slt") == 0 || strcmp(op, "sltu") == 0) {
-    char *rd = strtok_r(NULL, " \t,()", &saveptr);
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
+    Span rd = next_operand(&ops);
+    Span rs = next_operand(&ops);
+    Span rt = next_operand(&ops);
     int rd_num = get_register(rd);
     int rs_num = get_register(rs);
     int rt_num = get_register(rt);
-    if (!validate_register_num(rd_num, rd, op, pc) ||
-        !validate_register_num(rs_num, rs, op, pc) ||
-        !validate_register_num(rt_num, rt, op, pc)) {
+    if (!validate_register_num(ctx, rd_num, rd, op, pc) ||
+        !validate_register_num(ctx, rs_num, rs, op, pc) ||
+        !validate_register_num(ctx, rt_num, rt, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, rd_num, rs_num, rt_num, 0);
   }
 
   if (strcmp(op, "sll") == 0 || strcmp(op, "srl") == 0 || strcmp(op, "sra") == 0) {
-    char *rd = strtok_r(NULL, " \t,()", &saveptr);
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
-    char *shamt = strtok_r(NULL, " \t,()", &saveptr);
+    Span rd = next_operand(&ops);
+    Span rt = next_operand(&ops);
+    Span shamt = next_operand(&ops);
     int rd_num = get_register(rd);
     int rt_num = get_register(rt);
-    if (!validate_register_num(rd_num, rd, op, pc) ||
-        !validate_register_num(rt_num, rt, op, pc)) {
+    if (!validate_register_num(ctx, rd_num, rd, op, pc) ||
+        !validate_register_num(ctx, rt_num, rt, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, rd_num, 0, rt_num, parse_num(shamt));
@@ -476,30 +740,30 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
 
   if (strcmp(op, "mult") == 0 || strcmp(op, "multu") == 0 ||
       strcmp(op, "div") == 0  || strcmp(op, "divu") == 0) {
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
+    Span rs = next_operand(&ops);
+    Span rt = next_operand(&ops);
     int rs_num = get_register(rs);
     int rt_num = get_register(rt);
-    if (!validate_register_num(rs_num, rs, op, pc) ||
-        !validate_register_num(rt_num, rt, op, pc)) {
+    if (!validate_register_num(ctx, rs_num, rs, op, pc) ||
+        !validate_register_num(ctx, rt_num, rt, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, 0, rs_num, rt_num, 0);
   }
 
   if (strcmp(op, "mfhi") == 0 || strcmp(op, "mflo") == 0) {
-    char *rd = strtok_r(NULL, " \t,()", &saveptr);
+    Span rd = next_operand(&ops);
     int rd_num = get_register(rd);
-    if (!validate_register_num(rd_num, rd, op, pc)) {
+    if (!validate_register_num(ctx, rd_num, rd, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, rd_num, 0, 0, 0);
   }
 
   if (strcmp(op, "mthi") == 0 || strcmp(op, "mtlo") == 0) {
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
+    Span rs = next_operand(&ops);
     int rs_num = get_register(rs);
-    if (!validate_register_num(rs_num, rs, op, pc)) {
+    if (!validate_register_num(ctx, rs_num, rs, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, 0, rs_num, 0, 0);
@@ -510,23 +774,23 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
       strcmp(op, "andi") == 0 || strcmp(op, "ori") == 0 ||
       strcmp(op, "xori") == 0 || strcmp(op, "slti") == 0 ||
       strcmp(op, "sltiu") == 0) {
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
-    char *imm = strtok_r(NULL, " \t,()", &saveptr);
+    Span rt = next_operand(&ops);
+    Span rs = next_operand(&ops);
+    Span imm = next_operand(&ops);
     int rt_num = get_register(rt);
     int rs_num = get_register(rs);
-    if (!validate_register_num(rt_num, rt, op, pc) ||
-        !validate_register_num(rs_num, rs, op, pc)) {
+    if (!validate_register_num(ctx, rt_num, rt, op, pc) ||
+        !validate_register_num(ctx, rs_num, rs, op, pc)) {
       return 0;
     }
     return assemble_i_type(op, rt_num, rs_num, (int16_t)parse_num(imm));
   }
 
   if (strcmp(op, "lui") == 0) {
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
-    char *imm = strtok_r(NULL, " \t,()", &saveptr);
+    Span rt = next_operand(&ops);
+    Span imm = next_operand(&ops);
     int rt_num = get_register(rt);
-    if (!validate_register_num(rt_num, rt, op, pc)) {
+    if (!validate_register_num(ctx, rt_num, rt, op, pc)) {
       return 0;
     }
     return assemble_i_type(op, rt_num, 0, (int16_t)parse_num(imm));
@@ -537,49 +801,48 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
       strcmp(op, "lb") == 0 || strcmp(op, "sb") == 0 ||
       strcmp(op, "lh") == 0 || strcmp(op, "sh") == 0 ||
       strcmp(op, "lbu") == 0 || strcmp(op, "lhu") == 0) {
-    char *rt = strtok_r(NULL, " \t,", &saveptr);
-    if (!rt) {
-      fprintf(stderr, "Error: Missing rt register for %s at PC 0x%08x\n", op, pc);
+    Span rt = next_operand(&ops);
+    if (!rt.text) {
+      assembly_error(ctx, "Error: Missing rt register for %s at PC 0x%08x\n", op, pc);
       return 0;
     }
 
     // Now parse "offset($rs)" or just "($rs)"
-    char *offset_part = strtok_r(NULL, "", &saveptr);  // Get rest of line
-    if (!offset_part) {
-      fprintf(stderr, "Error: Missing offset/base for %s at PC 0x%08x\n", op, pc);
+    if (ops.next == ops.end) {
+      assembly_error(ctx, "Error: Missing offset/base for %s at PC 0x%08x\n", op, pc);
       return 0;
     }
 
-    // Trim leading whitespace
-    while (*offset_part && isspace((unsigned char)*offset_part)) offset_part++;
-
-    char *paren_open = strchr(offset_part, '(');
-    char *paren_close = strchr(offset_part, ')');
+    const Token *paren_open = NULL;
+    const Token *paren_close = NULL;
+    for (const Token *tok = ops.next; tok < ops.end; tok++) {
+      const char *text = ctx->source + tok->start;
+      if (tok->len == 1 && text[0] == '(' && !paren_open) paren_open = tok;
+      if (tok->len == 1 && text[0] == ')' && !paren_close) paren_close = tok;
+    }
 
     if (!paren_open || !paren_close) {
-      fprintf(stderr, "Error: Invalid memory operand syntax for %s at PC 0x%08x\n", op, pc);
+      assembly_error(ctx, "Error: Invalid memory operand syntax for %s at PC 0x%08x\n", op, pc);
       return 0;
     }
 
-    // Extract offset (everything before '(')
-    *paren_open = '\0';
-    char *offset_str = offset_part;
-
-    // Extract base register (between '(' and ')')
-    *paren_close = '\0';
-    char *rs_str = paren_open + 1;
+    // Offset before '(', base register between '(' and ')'
+    Span rs = { ctx->source + paren_close->start, 0 };
+    if (paren_open + 1 < paren_close) {
+      rs = (Span){ ctx->source + paren_open[1].start, paren_open[1].len };
+    }
 
     int rt_num = get_register(rt);
-    int rs_num = get_register(rs_str);
+    int rs_num = get_register(rs);
     int16_t offset = 0;
 
     // Handle empty offset (means 0)
-    if (offset_str && *offset_str) {
-      offset = (int16_t)parse_num(offset_str);
+    if (ops.next < paren_open) {
+      offset = (int16_t)parse_num((Span){ ctx->source + ops.next->start, ops.next->len });
     }
 
-    if (!validate_register_num(rt_num, rt, op, pc) ||
-        !validate_register_num(rs_num, rs_str, op, pc)) {
+    if (!validate_register_num(ctx, rt_num, rt, op, pc) ||
+        !validate_register_num(ctx, rs_num, rs, op, pc)) {
       return 0;
     }
     return assemble_i_type(op, rt_num, rs_num, offset);
@@ -587,25 +850,26 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
 
   // Branches
   if (strcmp(op, "beq") == 0 || strcmp(op, "bne") == 0) {
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
-    char *rt = strtok_r(NULL, " \t,()", &saveptr);
-    char *label = strtok_r(NULL, " \t,()", &saveptr);
+    Span rs = next_operand(&ops);
+    Span rt = next_operand(&ops);
+    Span label = next_operand(&ops);
 
-    if (!label) {
-      fprintf(stderr, "Error: Missing label for %s at PC 0x%08x\n", op, pc);
+    if (!label.text) {
+      assembly_error(ctx, "Error: Missing label for %s at PC 0x%08x\n", op, pc);
       return 0;
     }
 
     int rs_num = get_register(rs);
     int rt_num = get_register(rt);
-    if (!validate_register_num(rs_num, rs, op, pc) ||
-        !validate_register_num(rt_num, rt, op, pc)) {
+    if (!validate_register_num(ctx, rs_num, rs, op, pc) ||
+        !validate_register_num(ctx, rt_num, rt, op, pc)) {
       return 0;
     }
 
     int target = get_symbol_address(ctx, label);
     if (target == -1) {
-      fprintf(stderr, "Error: Undefined label '%s' at PC 0x%08x\n", label, pc);
+      assembly_error(ctx, "Error: Undefined label '%.*s' at PC 0x%08x\n",
+              (int)label.len, label.text, pc);
       return 0;
     }
     int16_t offset = (target - (pc + 4)) / 4;
@@ -614,24 +878,25 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
 
   // Jumps
   if (strcmp(op, "j") == 0 || strcmp(op, "jal") == 0) {
-    char *label = strtok_r(NULL, " \t,()", &saveptr);
-    if (!label) {
-      fprintf(stderr, "Error: Missing label for %s at PC 0x%08x\n", op, pc);
+    Span label = next_operand(&ops);
+    if (!label.text) {
+      assembly_error(ctx, "Error: Missing label for %s at PC 0x%08x\n", op, pc);
       return 0;
     }
     int target = get_symbol_address(ctx, label);
     if (target == -1) {
-      fprintf(stderr, "Error: Undefined label '%s' for %s at PC 0x%08x\n", 
-          label, op, pc);
+      assembly_error(ctx, "Error: Undefined label '%.*s' for %s at PC 0x%08x\n",
+          (int)label.len, label.text, op, pc);
       return 0;
     }
+    add_relocation(ctx, RELOC_JUMP, label);
     return assemble_j_type(op, target);
   }
 
   if (strcmp(op, "jr") == 0) {
-    char *rs = strtok_r(NULL, " \t,()", &saveptr);
+    Span rs = next_operand(&ops);
     int rs_num = get_register(rs);
-    if (!validate_register_num(rs_num, rs, op, pc)) {
+    if (!validate_register_num(ctx, rs_num, rs, op, pc)) {
       return 0;
     }
     return assemble_r_type(op, 0, rs_num, 0, 0);
@@ -648,185 +913,425 @@ static uint32_t assemble_line(AssemblyContext *ctx, const char *line, uint32_t p
   return 0;
 }
 
+// Assemble every line at its virtual address and keep the result as a
+// relocatable object: symbols become segment offsets and the relocations
+// say which instructions still need the real addresses
+static void build_object(AssemblyContext *ctx, uint64_t source_hash, ObjectFile *obj) {
+  memset(obj, 0, sizeof(ObjectFile));
+  obj->source_hash = source_hash;
+
+  obj->text_count = ctx->text_count;
+  if (obj->text_count > 0) {
+    obj->text = malloc(obj->text_count * sizeof(uint32_t));
+    if (!obj->text) {
+      perror("malloc object text");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (uint32_t i = 0; i < ctx->text_count; i++) {
+    ctx->current_index = i;
+    obj->text[i] = assemble_line(ctx, &ctx->text_segment[i], ctx->text_segment[i].address);
+  }
+
+  // The object takes over the data and relocations
+  obj->data_size = ctx->data_segment.size;
+  if (obj->data_size > 0) {
+    obj->data = ctx->data_segment.data;
+    ctx->data_segment.data = NULL;
+  }
+
+  obj->symbol_count = ctx->symbol_count;
+  if (obj->symbol_count > 0) {
+    obj->symbols = calloc(obj->symbol_count, sizeof(ObjectSymbol)); // No stray padding on disk
+    if (!obj->symbols) {
+      perror("calloc object symbols");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (uint32_t i = 0; i < ctx->symbol_count; i++) {
+    ObjectSymbol *sym = &obj->symbols[i];
+    memcpy(sym->name, ctx->symbols[i].name, sizeof(sym->name));
+    sym->segment = segment_of(ctx, ctx->symbols[i].address);
+    sym->value = ctx->symbols[i].address;
+    if (sym->segment == SEGMENT_TEXT) {
+      sym->value -= ctx->text_base;
+    } else if (sym->segment == SEGMENT_DATA) {
+      sym->value -= ctx->data_base;
+    }
+    sym->is_global = ctx->symbols[i].is_global;
+    sym->is_procedure = ctx->symbols[i].is_procedure;
+  }
+
+  obj->relocation_count = ctx->relocation_count;
+  if (obj->relocation_count > 0) {
+    obj->relocations = ctx->relocations;
+    ctx->relocations = NULL;
+  }
+
+  obj->entry_symbol = find_symbol(ctx, span_of("main"));
+}
+
+static uint32_t symbol_address(const ObjectSymbol *sym, uint32_t text_addr, uint32_t data_addr) {
+  switch (sym->segment) {
+    case SEGMENT_TEXT: return text_addr + sym->value;
+    case SEGMENT_DATA: return data_addr + sym->value;
+    default:           return sym->value;
+  }
+}
+
+// Rewrite an instruction for the address its symbol ended up at, the
+// same encoding the assembler would have picked for that address
+static uint32_t relocate(uint32_t word, RelocationType type, uint32_t address) {
+  if (type == RELOC_JUMP) {
+    return (word & 0xFC000000) | ((address >> 2) & 0x3FFFFFF);
+  }
+  uint32_t rt = (word >> 16) & 0x1F;
+  if (address <= 32767) {
+    return (0x09u << 26) | (rt << 16) | address;                   // addiu rt, $zero, address
+  }
+  return (0x0Fu << 26) | (rt << 16) | ((address >> 16) & 0xFFFF);  // lui rt, address >> 16
+}
+
 // Mallocate now uses mallocate instead of just rawdogging it
 // like they did in the 70's. so now the isntructions can be 
 // properly loaded in to memory, and freed with just the pid
-static int write_to_memory(AssemblyContext *ctx) {
+static int load_object(const ObjectFile *obj, int process_id, AssemblyResult *result) {
   // Set current process for memory access control
-  set_current_process(ctx->process_id);
+  set_current_process(process_id);
 
   // Mallocates memory for text segment, cause i lowkey just
   // realized we don't have to allocate one big blob at once
-  uint32_t text_size = ctx->text_count * 4;
+  uint32_t text_addr = 0;
+  uint32_t data_addr = 0;
+  uint32_t text_size = obj->text_count * 4;
   if (text_size > 0) { // No allocation if corrupted program
-    ctx->allocated_text_addr = mallocate(ctx->process_id, text_size);
-    if (ctx->allocated_text_addr == UINT32_MAX) {
+    text_addr = mallocate(process_id, text_size);
+    if (text_addr == UINT32_MAX) {
       fprintf(stderr, "Failed to allocate %u bytes for text segment (PID %d)\n", 
-              text_size, ctx->process_id);
+              text_size, process_id);
       set_current_process(SYSTEM_PROCESS_ID);
       return 0;
     }
-    printf("Allocated text: 0x%08x (%u bytes)\n", 
-           ctx->allocated_text_addr, text_size);
+    log_info("Allocated text: 0x%08x (%u bytes)\n", text_addr, text_size);
   }
 
   // And now just allocate the text segment cause it's so much
   // simpler than tryin to manually split up the memory :]
   // don't ask what i was doing before this
-  if (ctx->data_segment.size > 0) {
-    ctx->allocated_data_addr = mallocate(ctx->process_id, ctx->data_segment.size);
-    if (ctx->allocated_data_addr == UINT32_MAX) {
+  if (obj->data_size > 0) {
+    data_addr = mallocate(process_id, obj->data_size);
+    if (data_addr == UINT32_MAX) {
       fprintf(stderr, "Failed to allocate %u bytes for data segment (PID %d)\n", 
-              ctx->data_segment.size, ctx->process_id);
+              obj->data_size, process_id);
       // Clean up text allocation if data fails
-      if (ctx->allocated_text_addr != UINT32_MAX) {
-        liberate(ctx->process_id);
+      if (text_size > 0) {
+        liberate(process_id);
       }
       set_current_process(SYSTEM_PROCESS_ID);
       return 0;
     }
-    printf("  ✓ Allocated data: 0x%08x (%u bytes)\n", 
-           ctx->allocated_data_addr, ctx->data_segment.size);
+    log_info("  ✓ Allocated data: 0x%08x (%u bytes)\n", data_addr, obj->data_size);
   }
 
-  // Rebase symbol addresses to the allocated physical addresses so that
-  // any references (e.g., via `la`) point at real memory we control.
-  for (int i = 0; i < ctx->symbol_count; i++) {
-    if (ctx->symbols[i].address >= ctx->text_base &&
-        ctx->symbols[i].address < ctx->text_base + ctx->text_count * 4) {
-      uint32_t off = ctx->symbols[i].address - ctx->text_base;
-      ctx->symbols[i].address = ctx->allocated_text_addr + off;
-    } else if (ctx->symbols[i].address >= ctx->data_base &&
-               ctx->symbols[i].address < ctx->data_base + ctx->data_segment.size) {
-      uint32_t off = ctx->symbols[i].address - ctx->data_base;
-      ctx->symbols[i].address = ctx->allocated_data_addr + off;
+  // Patch the absolute addresses, then copy both segments in one go
+  uint8_t *image = NULL;
+  if (text_size > 0) {
+    image = malloc(text_size);
+    if (!image) {
+      perror("malloc text image");
+      exit(EXIT_FAILURE);
     }
   }
+  uint32_t *text = NULL;
+  if (obj->relocation_count > 0) {
+    text = malloc(text_size);
+    if (!text) {
+      perror("malloc relocated text");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(text, obj->text, text_size);
+    for (uint32_t i = 0; i < obj->relocation_count; i++) {
+      const Relocation *reloc = &obj->relocations[i];
+      uint32_t address = symbol_address(&obj->symbols[reloc->symbol], text_addr, data_addr);
+      text[reloc->offset / 4] = relocate(text[reloc->offset / 4], reloc->type, address);
+    }
+  }
+  const uint32_t *words = text ? text : obj->text;
+  for (uint32_t i = 0; i < obj->text_count; i++) { // Little-endian, like write_word
+    image[i * 4 + 0] = (uint8_t)(words[i] & 0xFF);
+    image[i * 4 + 1] = (uint8_t)((words[i] >> 8) & 0xFF);
+    image[i * 4 + 2] = (uint8_t)((words[i] >> 16) & 0xFF);
+    image[i * 4 + 3] = (uint8_t)((words[i] >> 24) & 0xFF);
+  }
+  bool written = write_block(text_addr, image, text_size) &&
+                 write_block(data_addr, obj->data, obj->data_size);
+  free(text);
+  free(image);
 
-  // Write text segment
-  for (int i = 0; i < ctx->text_count; i++) {
-    uint32_t offset = i * 4;
-    uint32_t addr = ctx->allocated_text_addr + offset;
-    uint32_t code = assemble_line(ctx, ctx->text_segment[i].line,
-                                  ctx->allocated_text_addr + offset);
-    
-    write_word(addr, code);
-    
-    free(ctx->text_segment[i].line);
+  // Reset to system mode after loading
+  set_current_process(SYSTEM_PROCESS_ID);
+  if (!written) {
+    liberate(process_id);
+    return 0;
   }
 
-  // Write data segment
-  for (uint32_t i = 0; i < ctx->data_segment.size; i++) {
-    write_byte(ctx->allocated_data_addr + i, ctx->data_segment.data[i]);
+  // Fill in process image
+  result->program->text_start = text_addr;  // ACTUAL allocated address
+  result->program->text_size = text_size;
+  result->program->data_start = data_addr;  // ACTUAL allocated address
+  result->program->data_size = obj->data_size;
+  uint32_t stack_size = 4096; // 4KB stack
+  uint32_t stack_addr = mallocate(process_id, stack_size);
+  result->program->stack_ptr = stack_addr + stack_size - 4;
+  result->program->globl_ptr = GLOBAL_PTR + (uint32_t)process_id * MAX_PROCESS_SIZE;
+
+  // Find entry point, defaulting to the first instruction
+  if (obj->entry_symbol >= 0) {
+    result->program->entry_point = symbol_address(&obj->symbols[obj->entry_symbol],
+                                                  text_addr, data_addr);
+  } else if (text_size > 0) {
+    result->program->entry_point = text_addr;
+  } else {
+    result->program->entry_point = TEXT_BASE + (uint32_t)process_id * MAX_PROCESS_SIZE;
+  }
+
+  // Copy symbols for debugging, at their physical addresses
+  result->symbol_count = (int)obj->symbol_count;
+  result->symbols = malloc(sizeof(SymbolInfo) * obj->symbol_count);
+  if (result->symbols) {
+    for (uint32_t i = 0; i < obj->symbol_count; i++) {
+      memcpy(result->symbols[i].name, obj->symbols[i].name, sizeof(result->symbols[i].name));
+      result->symbols[i].name[63] = '\0';
+      result->symbols[i].address = symbol_address(&obj->symbols[i], text_addr, data_addr);
+      result->symbols[i].is_global = obj->symbols[i].is_global;
+      result->symbols[i].is_procedure = obj->symbols[i].is_procedure;
+    }
   }
-  
-  // Reset to system mode after assembly
-  set_current_process(SYSTEM_PROCESS_ID);
 
   return 1;
 }
 /* ---------------------------------------------------------------------------------------------------- */
 /* ============================================== PARSER ============================================== */
 
-static int parse_file(AssemblyContext *ctx, const char *filename) {
-  FILE *fp = fopen(filename, "r");
-  if (!fp) return 0;
-
-  char line[MAX_LINE];
+// A source file, mapped rather than read where the system allows
+typedef struct {
+  const char *text;
+  size_t size;
+  void *mapping;      // munmap on close, else text is free'd
+} SourceFile;
+
+// Map the whole file with one call, or read it if it cannot be mapped
+// (a pipe, say). False if it cannot be opened.
+static bool open_source(const char *filename, SourceFile *source) {
+  memset(source, 0, sizeof(SourceFile));
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+      source->mapping = mapping;
+      source->text = mapping;
+      source->size = (size_t)st.st_size;
+      close(fd);
+      return true;
+    }
+  }
 
-  // Pass 1: Collect symbols and directives
-  while (fgets(line, MAX_LINE, fp)) {
-    ctx->source_line++;
-    char *trimmed = trim(line);
-    if (trimmed[0] == '\0' || trimmed[0] == '#') continue;
-
-    char buffer[MAX_LINE];
-    strcpy(buffer, trimmed);
-
-    // Labels
-    char *colon = strchr(buffer, ':');
-    if (colon) {
-      *colon = '\0';
-      char *label = trim(buffer);
-      if (ctx->in_data_section) {
-        add_symbol(ctx, label, ctx->data_segment.size + ctx->data_base, 0, 0);
-      } else {
-        add_symbol(ctx, label, ctx->current_address, 0, 0);
-      }
-      trimmed = trim(colon + 1);
-      if (trimmed[0] == '\0' || trimmed[0] == '#') continue;
-      memmove(buffer, trimmed, strlen(trimmed));
-      buffer[MAX_LINE - 1] = '\0';
-    }
-
-    // Strip inline comments
-    char *comment = strchr(buffer, '#');
-    if (comment) {
-      *comment = '\0';
-      trimmed = trim(buffer);
-      if (trimmed[0] == '\0') continue;
-      if (trimmed != buffer) {
-        memmove(buffer, trimmed, strlen(trimmed) + 1);
+  size_t capacity = 4096;
+  char *text = malloc(capacity);
+  if (!text) {
+    perror("malloc source");
+    exit(EXIT_FAILURE);
+  }
+  ssize_t n;
+  while ((n = read(fd, text + source->size, capacity - source->size)) > 0) {
+    source->size += (size_t)n;
+    if (source->size == capacity) {
+      capacity *= 2;
+      char *grown = realloc(text, capacity);
+      if (!grown) {
+        perror("realloc source");
+        exit(EXIT_FAILURE);
       }
+      text = grown;
     }
+  }
+  close(fd);
+  source->text = text;
+  return true;
+}
 
-    // Directives
-    if (buffer[0] == '.') {
-      char *directive = strtok(buffer, " \t");
-      char *rest = strtok(NULL, "");
-      if (rest) rest = trim(rest);
+static void close_source(SourceFile *source) {
+  if (source->mapping) {
+    munmap(source->mapping, source->size);
+  } else {
+    free((char *)source->text);
+  }
+  memset(source, 0, sizeof(SourceFile));
+}
 
-      if (strcmp(directive, ".data") == 0) {
-        ctx->in_data_section = 1;
-      }
-      else if (strcmp(directive, ".text") == 0) {
-        ctx->in_data_section = 0;
-        ctx->current_address = ctx->text_base;
-      }
-      else if (strcmp(directive, ".globl") == 0 && rest) {
-        add_symbol(ctx, rest, 0, 1, 0);
-      }
-      else if (ctx->in_data_section) {
-        if (strcmp(directive, ".word") == 0 && rest) handle_word(ctx, rest);
-        else if (strcmp(directive, ".half") == 0 && rest) handle_half(ctx, rest);
-        else if (strcmp(directive, ".byte") == 0 && rest) handle_byte(ctx, rest);
-        else if (strcmp(directive, ".ascii") == 0 && rest) handle_ascii(ctx, rest, 0);
-        else if (strcmp(directive, ".asciiz") == 0 && rest) handle_ascii(ctx, rest, 1);
-        else if (strcmp(directive, ".space") == 0 && rest) handle_space(ctx, parse_num(rest));
-        else if (strcmp(directive, ".align") == 0 && rest) {
-          int n = parse_num(rest);
-          if (n == 0) ctx->align_mode = 0;
-          else { ctx->align_mode = 1; align_data(ctx, n); }
-        }
-      }
-      continue;
+// Cut the line at a '#' that is not inside a string or character literal
+static Span strip_comment(Span line) {
+  char quote = 0;
+  for (uint32_t i = 0; i < line.len; i++) {
+    char c = line.text[i];
+    if (quote) {
+      if (c == '\\') i++;
+      else if (c == quote) quote = 0;
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    } else if (c == '#') {
+      line.len = i;
+      break;
+    }
+  }
+  return line;
+}
+
+// Take a leading "label:" off the line
+static bool take_label(Span *line, Span *label) {
+  uint32_t i = 0;
+  while (i < line->len && !isspace((unsigned char)line->text[i]) && line->text[i] != ':' &&
+         line->text[i] != '"' && line->text[i] != '\'' && line->text[i] != ',') {
+    i++;
+  }
+  uint32_t colon = i;
+  while (colon < line->len && isspace((unsigned char)line->text[colon])) {
+    colon++;
+  }
+  if (i == 0 || colon == line->len || line->text[colon] != ':') {
+    return false;
+  }
+  *label = (Span){ line->text, i };
+  *line = trim((Span){ line->text + colon + 1, line->len - colon - 1 });
+  return true;
+}
+
+static const char *lookup_mnemonic(Span op) {
+  for (size_t i = 0; i < sizeof(MNEMONICS) / sizeof(MNEMONICS[0]); i++) {
+    if (span_is(op, MNEMONICS[i])) {
+      return MNEMONICS[i];
     }
+  }
+  return NULL;
+}
 
-    // Instructions
-    if (!ctx->in_data_section) {
+static void add_token(AssemblyContext *ctx, const char *text, uint32_t len) {
+  ctx->tokens = reserve(ctx->tokens, ctx->token_count, &ctx->token_capacity,
+                        sizeof(Token), "realloc tokens");
+  ctx->tokens[ctx->token_count].start = (uint32_t)(text - ctx->source);
+  ctx->tokens[ctx->token_count].len = len;
+  ctx->token_count++;
+}
 
-      if (ctx->text_count >= MAX_INSTRUCTIONS) {
-        fprintf(stderr, "Error: Too many instructions (max %d) at line %d\n", 
-            MAX_INSTRUCTIONS, ctx->source_line);
-        fclose(fp);
-        return 0;
+// Record an instruction: its mnemonic, then its operands split at
+// blanks and commas, with each parenthesis a token of its own
+static void add_instruction(AssemblyContext *ctx, Span line) {
+  uint32_t i = 0;
+  while (i < line.len && !isspace((unsigned char)line.text[i]) && line.text[i] != ',' &&
+         line.text[i] != '(' && line.text[i] != ')') {
+    i++;
+  }
+
+  ctx->text_segment = reserve(ctx->text_segment, ctx->text_count, &ctx->text_capacity,
+                              sizeof(TextEntry), "realloc text segment");
+  TextEntry *entry = &ctx->text_segment[ctx->text_count];
+  entry->address = ctx->current_address;
+  entry->op = lookup_mnemonic((Span){ line.text, i });
+  entry->first_token = ctx->token_count;
+  entry->line_number = ctx->source_line;
+
+  while (i < line.len) {
+    char c = line.text[i];
+    if (isspace((unsigned char)c) || c == ',') {
+      i++;
+    } else if (c == '(' || c == ')') {
+      add_token(ctx, line.text + i, 1);
+      i++;
+    } else {
+      uint32_t start = i;
+      while (i < line.len && !isspace((unsigned char)line.text[i]) && line.text[i] != ',' &&
+             line.text[i] != '(' && line.text[i] != ')') {
+        i++;
       }
+      add_token(ctx, line.text + start, i - start);
+    }
+  }
+  entry->token_count = ctx->token_count - entry->first_token;
 
-      ctx->text_segment[ctx->text_count].address = ctx->current_address;
-      ctx->text_segment[ctx->text_count].line = strdup(trimmed);
-      if (!ctx->text_segment[ctx->text_count].line) {
-        fprintf(stderr, "Error: Memory allocation failed at line %d\n", ctx->source_line);
-        fclose(fp);
-        return 0;
+  ctx->text_count++;
+  ctx->current_address += 4;
+}
+
+static void parse_line(AssemblyContext *ctx, Span line) {
+  line = trim(strip_comment(line));
+
+  // Labels
+  Span label;
+  while (take_label(&line, &label)) {
+    if (ctx->in_data_section) {
+      add_symbol(ctx, label, ctx->data_segment.size + ctx->data_base, 0, 0);
+    } else {
+      add_symbol(ctx, label, ctx->current_address, 0, 0);
+    }
+  }
+  if (line.len == 0) return;
+
+  // Directives
+  if (line.text[0] == '.') {
+    uint32_t i = 0;
+    while (i < line.len && !isspace((unsigned char)line.text[i])) i++;
+    Span directive = { line.text, i };
+    Span rest = trim((Span){ line.text + i, line.len - i });
+    bool has_rest = rest.len > 0;
+
+    if (span_is(directive, ".data")) {
+      ctx->in_data_section = 1;
+    }
+    else if (span_is(directive, ".text")) {
+      ctx->in_data_section = 0;
+      ctx->current_address = ctx->text_base;
+    }
+    else if (span_is(directive, ".globl") && has_rest) {
+      add_symbol(ctx, rest, 0, 1, 0);
+    }
+    else if (ctx->in_data_section && has_rest) {
+      if (span_is(directive, ".word")) handle_word(ctx, rest);
+      else if (span_is(directive, ".half")) handle_half(ctx, rest);
+      else if (span_is(directive, ".byte")) handle_byte(ctx, rest);
+      else if (span_is(directive, ".ascii")) handle_ascii(ctx, rest, 0);
+      else if (span_is(directive, ".asciiz")) handle_ascii(ctx, rest, 1);
+      else if (span_is(directive, ".space")) handle_space(ctx, parse_num(rest));
+      else if (span_is(directive, ".align")) {
+        int n = parse_num(rest);
+        if (n == 0) ctx->align_mode = 0;
+        else { ctx->align_mode = 1; align_data(ctx, n); }
       }
-      ctx->text_segment[ctx->text_count].line_number = ctx->source_line;
-      ctx->text_count++;
-      ctx->current_address += 4;
     }
+    return;
   }
 
-  fclose(fp);
-  return 1;
+  // Instructions
+  if (!ctx->in_data_section) {
+    add_instruction(ctx, line);
+  }
+}
+
+// Pass 1: collect symbols and data, and tokenize the instructions. The
+// tokens point into source, which has to outlive the context.
+static void parse_source(AssemblyContext *ctx, const char *source, size_t size) {
+  ctx->source = source;
+  size_t pos = 0;
+  while (pos < size) {
+    const char *newline = memchr(source + pos, '\n', size - pos);
+    size_t end = newline ? (size_t)(newline - source) : size;
+    ctx->source_line++;
+    parse_line(ctx, (Span){ source + pos, (uint32_t)(end - pos) });
+    pos = end + 1;
+  }
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -843,10 +1348,6 @@ AssemblyResult assemble(const char *filename, int process_id) {
   }
   memset(result.program, 0, sizeof(AssembledProgram));
 
-  AssemblyContext ctx;
-
-  init_context(&ctx, process_id);
-
   // Extract process name from filename
   const char *basename = strrchr(filename, '/');
   basename = basename ? basename + 1 : filename;
@@ -865,17 +1366,52 @@ AssemblyResult assemble(const char *filename, int process_id) {
   strncpy(result.program->program_name, sanitized, 255);
   result.program->program_name[255] = '\0';
 
-  // Parse assembly file
-  if (!parse_file(&ctx, filename)) {
+  // Map the source and hash it; an object cached under the same hash
+  // is this program already assembled
+  SourceFile source;
+  if (!open_source(filename, &source)) {
     snprintf(result.error_message, 511, "Failed to open file: %s", filename);
     result.success = 0;
     free(result.program);
     result.program = NULL;
     return result;
   }
+  uint64_t source_hash = object_hash(source.text, source.size);
+
+  ObjectFile obj;
+  char cache_path[4096];
+  bool cached = object_cache_path(source_hash, cache_path, sizeof(cache_path));
+  if (cached && object_read(&obj, cache_path) && obj.source_hash == source_hash) {
+    log_info("Loaded %s from the object cache\n", filename);
+  } else {
+    if (cached) {
+      object_free(&obj);
+    }
+
+    AssemblyContext ctx;
+
+    init_context(&ctx, process_id);
+
+    // Parse assembly file, then assemble its tokens
+    parse_source(&ctx, source.text, source.size);
+    build_object(&ctx, source_hash, &obj);
+    uint32_t errors = ctx.error_count;
+    free_context(&ctx);
+
+    // A program with errors is not cached, so the next run reports them
+    // again rather than quietly loading the broken object
+    if (errors > 0) {
+      log_info("%s has %u errors, not cached\n", filename, errors);
+    } else if (cached && !object_write(&obj, cache_path)) {
+      fprintf(stderr, "Warning: Could not cache %s in %s\n", filename, cache_path);
+    }
+  }
+  close_source(&source);
 
   // Write to memory
-  if (!write_to_memory(&ctx)) {
+  int loaded = load_object(&obj, process_id, &result);
+  object_free(&obj);
+  if (!loaded) {
     snprintf(result.error_message, 511, "Failed to allocate/write memory");
     result.success = 0;
     free(result.program);
@@ -883,60 +1419,6 @@ AssemblyResult assemble(const char *filename, int process_id) {
     return result;
   }
 
-  // Fill in process image
-  result.program->text_start = ctx.allocated_text_addr;  // ACTUAL allocated address
-  result.program->text_size = ctx.text_count * 4;
-  result.program->data_start = ctx.allocated_data_addr;  // ACTUAL allocated address
-  result.program->data_size = ctx.data_segment.size;
-  uint32_t stack_size = 4096; // 4KB stack
-  uint32_t stack_addr = mallocate(process_id, stack_size);
-  result.program->stack_ptr = stack_addr + stack_size - 4;
-  result.program->globl_ptr = GLOBAL_PTR + (process_id * MAX_PROCESS_SIZE);
-
-  // Find entry point
-  int entry_sym = get_symbol_address(&ctx, "main");
-  if (entry_sym == -1) {
-    // Default to first instruction at TEXT_BASE
-    result.program->entry_point = ctx.text_base;
-  } else {
-    result.program->entry_point = entry_sym;
-  }
-
-  // Readjust the memory adress to a physical adress
-  if (result.program->entry_point >= ctx.text_base &&
-      result.program->entry_point < ctx.text_base + ctx.text_count * 4) {
-    uint32_t offset = result.program->entry_point - ctx.text_base;
-    result.program->entry_point = ctx.allocated_text_addr + offset;
-  }
-
-  // Copy symbols for debugging
-  result.symbol_count = ctx.symbol_count;
-  result.symbols = malloc(sizeof(SymbolInfo) * ctx.symbol_count);
-  if (result.symbols) {
-    for (int i = 0; i < ctx.symbol_count; i++) {
-      strncpy(result.symbols[i].name, ctx.symbols[i].name, 63);
-      result.symbols[i].name[63] = '\0';
-      
-      // Adjust symbol addresses to physical addresses
-      if (ctx.symbols[i].address >= ctx.text_base && 
-          ctx.symbols[i].address < ctx.text_base + ctx.text_count * 4) {
-        // Text symbol
-        uint32_t text_offset = ctx.symbols[i].address - ctx.text_base;
-        result.symbols[i].address = ctx.allocated_text_addr + text_offset;
-      } else if (ctx.symbols[i].address >= ctx.data_base &&
-                 ctx.symbols[i].address < ctx.data_base + ctx.data_segment.size) {
-        // Data symbol
-        uint32_t data_offset = ctx.symbols[i].address - ctx.data_base;
-        result.symbols[i].address = ctx.allocated_data_addr + data_offset;
-      } else {
-        result.symbols[i].address = ctx.symbols[i].address;
-      }
-      
-      result.symbols[i].is_global = ctx.symbols[i].is_global;
-      result.symbols[i].is_procedure = ctx.symbols[i].is_procedure;
-    }
-  }
-
   result.success = 1;
   return result;
 }
@@ -0,0 +1,121 @@
+#include "../include/console.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+typedef struct {
+  char data[CONSOLE_BUFFER_SIZE];
+  size_t len;
+} ConsoleBuffer;
+
+// Indexed by pid, allocated on first attach. The buffers themselves
+// never move, so a thread can keep writing to its own while another
+// grows the table.
+static ConsoleBuffer **g_buffers = NULL;
+static size_t g_buffer_capacity = 0;
+static pthread_mutex_t g_buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Thread_local ConsoleBuffer *g_attached = NULL;
+static bool g_line_mode = false;
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+// One write(2) for everything queued
+static void write_out(ConsoleBuffer *buf) {
+  if (buf->len == 0) {
+    return;
+  }
+  fwrite(buf->data, 1, buf->len, stdout);
+  fflush(stdout);
+  buf->len = 0;
+}
+
+static ConsoleBuffer *buffer_for(int pid) {
+  pthread_mutex_lock(&g_buffers_lock);
+  if ((size_t)pid >= g_buffer_capacity) {
+    size_t capacity = g_buffer_capacity ? g_buffer_capacity : 16;
+    while (capacity <= (size_t)pid) {
+      capacity *= 2;
+    }
+    ConsoleBuffer **buffers = realloc(g_buffers, capacity * sizeof(ConsoleBuffer *));
+    if (!buffers) {
+      perror("realloc console buffers");
+      exit(EXIT_FAILURE);
+    }
+    memset(buffers + g_buffer_capacity, 0, (capacity - g_buffer_capacity) * sizeof(ConsoleBuffer *));
+    g_buffers = buffers;
+    g_buffer_capacity = capacity;
+  }
+  if (!g_buffers[pid]) {
+    g_buffers[pid] = calloc(1, sizeof(ConsoleBuffer));
+    if (!g_buffers[pid]) {
+      perror("calloc console buffer");
+      exit(EXIT_FAILURE);
+    }
+  }
+  ConsoleBuffer *buf = g_buffers[pid];
+  pthread_mutex_unlock(&g_buffers_lock);
+  return buf;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+void console_attach(int pid) {
+  if (g_attached) {
+    write_out(g_attached);
+  }
+  g_attached = (pid < 0) ? NULL : buffer_for(pid);
+}
+
+void console_write(const char *data, size_t len) {
+  if (!g_attached) {
+    fwrite(data, 1, len, stdout);
+    fflush(stdout);
+    return;
+  }
+  ConsoleBuffer *buf = g_attached;
+  bool newline = g_line_mode && memchr(data, '\n', len) != NULL;
+  while (len > 0) {
+    if (buf->len == CONSOLE_BUFFER_SIZE) {
+      write_out(buf);
+    }
+    size_t room = CONSOLE_BUFFER_SIZE - buf->len;
+    size_t n = (len < room) ? len : room;
+    memcpy(buf->data + buf->len, data, n);
+    buf->len += n;
+    data += n;
+    len -= n;
+  }
+  if (newline) {
+    write_out(buf);
+  }
+}
+
+void console_flush(void) {
+  if (g_attached) {
+    write_out(g_attached);
+  }
+}
+
+void console_set_line_mode(bool enabled) {
+  g_line_mode = enabled;
+}
+
+void console_free(void) {
+  for (size_t i = 0; i < g_buffer_capacity; i++) {
+    if (g_buffers[i]) {
+      write_out(g_buffers[i]);
+      free(g_buffers[i]);
+    }
+  }
+  free(g_buffers);
+  g_buffers = NULL;
+  g_buffer_capacity = 0;
+  g_attached = NULL;
+}
@@ -1,21 +1,22 @@
 #include "../include/cpu.h"
 #include "../include/memory.h"
 #include "../include/isa.h"
+#include "../include/log.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
-Cpu THE_CPU;
+_Thread_local Cpu THE_CPU;
 
 // Prints the state of the given CPU
 static void print_cpu_state() {
-  printf("CPU STATE\n");
-  printf("PC:  %X\n", HW_REGISTER(PC));
-  printf("IR:  %X\n", HW_REGISTER(IR));
-  printf("FLAGS:\n");
-  printf("  ZERO:      %1d\n", (HW_REGISTER(FLAGS) >> 0) & 1);
-  printf("  OVERFLOW:  %1d\n",  (HW_REGISTER(FLAGS) >> 1) & 1);
-  printf("  CARRY:     %1d\n\n\n", (HW_REGISTER(FLAGS) >> 2) & 1);
+  log_trace("CPU STATE\n");
+  log_trace("PC:  %X\n", HW_REGISTER(PC));
+  log_trace("IR:  %X\n", HW_REGISTER(IR));
+  log_trace("FLAGS:\n");
+  log_trace("  ZERO:      %1d\n", (HW_REGISTER(FLAGS) >> 0) & 1);
+  log_trace("  OVERFLOW:  %1d\n",  (HW_REGISTER(FLAGS) >> 1) & 1);
+  log_trace("  CARRY:     %1d\n\n\n", (HW_REGISTER(FLAGS) >> 2) & 1);
 }
 
 void init_cpu(const uint32_t entry_point)
@@ -28,7 +29,7 @@ void init_cpu(const uint32_t entry_point)
 
   GP_REGISTER(REG_ZERO) = 0;
 
-  printf("Initialized the cpu!\n");
+  log_info("Initialized the cpu!\n");
   print_cpu_state();
 }
 
@@ -50,7 +51,7 @@ void cpu_run()
   int i = 0;
   while(HW_REGISTER(PC) != CPU_HALT)
   {
-    printf("=== Cycle %d ===\n", i + 1);
+    log_trace("=== Cycle %d ===\n", i + 1);
     fetch();
     execute();
     // check_for_interrupt(); //when processes.c is finished i guess we'll need this. probably not.
@@ -0,0 +1,166 @@
+// Chase-Lev deque, following the C11 formulation from
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.)
+#include "../include/deque.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+// A power of two sized ring of slots
+typedef struct DequeBuffer {
+  int64_t mask;
+  _Atomic uint32_t slots[];
+} DequeBuffer;
+
+struct WorkDeque {
+  _Atomic int64_t top;
+  _Atomic int64_t bottom;
+  _Atomic(DequeBuffer *) buffer;
+
+  // Outgrown buffers, a thief may still be reading from one of them
+  // so they are only released when the deque itself is destroyed
+  DequeBuffer **retired;
+  size_t retired_count;
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static DequeBuffer *buffer_create(int64_t size) {
+  DequeBuffer *buf = calloc(1, sizeof(DequeBuffer) + (size_t)size * sizeof(_Atomic uint32_t));
+  if (!buf) {
+    perror("calloc deque buffer");
+    exit(EXIT_FAILURE);
+  }
+  buf->mask = size - 1;
+  return buf;
+}
+
+static inline uint32_t buffer_get(DequeBuffer *buf, int64_t i) {
+  return atomic_load_explicit(&buf->slots[i & buf->mask], memory_order_relaxed);
+}
+
+static inline void buffer_put(DequeBuffer *buf, int64_t i, uint32_t item) {
+  atomic_store_explicit(&buf->slots[i & buf->mask], item, memory_order_relaxed);
+}
+
+// Double the buffer, copying the live range [top, bottom)
+static DequeBuffer *grow(WorkDeque *dq, DequeBuffer *old, int64_t top, int64_t bottom) {
+  DequeBuffer *buf = buffer_create((old->mask + 1) * 2);
+  for (int64_t i = top; i < bottom; i++) {
+    buffer_put(buf, i, buffer_get(old, i));
+  }
+
+  DequeBuffer **retired = realloc(dq->retired, (dq->retired_count + 1) * sizeof(DequeBuffer *));
+  if (!retired) {
+    perror("realloc deque retired list");
+    exit(EXIT_FAILURE);
+  }
+  dq->retired = retired;
+  dq->retired[dq->retired_count++] = old;
+
+  atomic_store_explicit(&dq->buffer, buf, memory_order_release);
+  return buf;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+WorkDeque *deque_create(size_t capacity) {
+  WorkDeque *dq = calloc(1, sizeof(WorkDeque));
+  if (!dq) {
+    perror("calloc deque");
+    exit(EXIT_FAILURE);
+  }
+
+  int64_t size = 2;
+  while ((size_t)size < capacity) {
+    size <<= 1;
+  }
+
+  atomic_init(&dq->top, 0);
+  atomic_init(&dq->bottom, 0);
+  atomic_init(&dq->buffer, buffer_create(size));
+  return dq;
+}
+
+void deque_destroy(WorkDeque *dq) {
+  if (!dq) {
+    return;
+  }
+  for (size_t i = 0; i < dq->retired_count; i++) {
+    free(dq->retired[i]);
+  }
+  free(dq->retired);
+  free(atomic_load_explicit(&dq->buffer, memory_order_relaxed));
+  free(dq);
+}
+
+void deque_push(WorkDeque *dq, uint32_t item) {
+  int64_t b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+  int64_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+  DequeBuffer *buf = atomic_load_explicit(&dq->buffer, memory_order_relaxed);
+
+  if (b - t > buf->mask) {
+    buf = grow(dq, buf, t, b);
+  }
+
+  buffer_put(buf, b, item);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+}
+
+uint32_t deque_pop(WorkDeque *dq) {
+  int64_t b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+  DequeBuffer *buf = atomic_load_explicit(&dq->buffer, memory_order_relaxed);
+  atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+  uint32_t item = DEQUE_EMPTY;
+  if (t <= b) {
+    item = buffer_get(buf, b);
+    if (t == b) {
+      // Last item, race the thieves for it
+      if (!atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed)) {
+        item = DEQUE_EMPTY;
+      }
+      atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    }
+  } else {
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+  }
+  return item;
+}
+
+uint32_t deque_steal(WorkDeque *dq) {
+  while (true) {
+    int64_t t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    if (t >= b) {
+      return DEQUE_EMPTY;
+    }
+
+    DequeBuffer *buf = atomic_load_explicit(&dq->buffer, memory_order_acquire);
+    uint32_t item = buffer_get(buf, t);
+    if (atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                memory_order_seq_cst,
+                                                memory_order_relaxed)) {
+      return item;
+    }
+    // Lost the race to another thief or the owner, try again
+  }
+}
+
+size_t deque_size(WorkDeque *dq) {
+  int64_t b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+  int64_t t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+  return b > t ? (size_t)(b - t) : 0;
+}
@@ -0,0 +1,125 @@
+#include "../include/events.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+// Binary min-heap on (time, seq)
+struct EventQueue {
+  Event *events;
+  size_t count;
+  size_t capacity;
+  uint64_t next_seq;
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static inline bool earlier(const Event *a, const Event *b) {
+  if (a->time != b->time) {
+    return a->time < b->time;
+  }
+  return a->seq < b->seq;
+}
+
+static void sift_up(EventQueue *q, size_t i) {
+  Event ev = q->events[i];
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!earlier(&ev, &q->events[parent])) {
+      break;
+    }
+    q->events[i] = q->events[parent];
+    i = parent;
+  }
+  q->events[i] = ev;
+}
+
+static void sift_down(EventQueue *q, size_t i) {
+  Event ev = q->events[i];
+  while (true) {
+    size_t child = 2 * i + 1;
+    if (child >= q->count) {
+      break;
+    }
+    if (child + 1 < q->count && earlier(&q->events[child + 1], &q->events[child])) {
+      child++;
+    }
+    if (!earlier(&q->events[child], &ev)) {
+      break;
+    }
+    q->events[i] = q->events[child];
+    i = child;
+  }
+  q->events[i] = ev;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+EventQueue *event_queue_create(size_t capacity) {
+  EventQueue *q = calloc(1, sizeof(EventQueue));
+  if (!q) {
+    perror("calloc event queue");
+    exit(EXIT_FAILURE);
+  }
+  q->capacity = capacity ? capacity : 16;
+  q->events = malloc(q->capacity * sizeof(Event));
+  if (!q->events) {
+    perror("malloc event queue");
+    exit(EXIT_FAILURE);
+  }
+  return q;
+}
+
+void event_queue_destroy(EventQueue *q) {
+  if (!q) {
+    return;
+  }
+  free(q->events);
+  free(q);
+}
+
+void event_queue_clear(EventQueue *q) {
+  q->count = 0;
+}
+
+void event_schedule(EventQueue *q, int time, EventType type, uint32_t subject) {
+  if (q->count == q->capacity) {
+    size_t capacity = q->capacity * 2;
+    Event *events = realloc(q->events, capacity * sizeof(Event));
+    if (!events) {
+      perror("realloc event queue");
+      exit(EXIT_FAILURE);
+    }
+    q->events = events;
+    q->capacity = capacity;
+  }
+  Event *ev = &q->events[q->count];
+  ev->time = time;
+  ev->type = type;
+  ev->subject = subject;
+  ev->seq = q->next_seq++;
+  sift_up(q, q->count++);
+}
+
+bool event_pop_due(EventQueue *q, int now, Event *out) {
+  if (q->count == 0 || q->events[0].time > now) {
+    return false;
+  }
+  *out = q->events[0];
+  q->events[0] = q->events[--q->count];
+  if (q->count > 0) {
+    sift_down(q, 0);
+  }
+  return true;
+}
+
+int event_next_time(const EventQueue *q) {
+  return q->count ? q->events[0].time : EVENT_NEVER;
+}
+
+size_t event_count(const EventQueue *q) {
+  return q->count;
+}
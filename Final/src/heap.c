@@ -0,0 +1,210 @@
+#include "../include/heap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Four children per node keeps the tree shallow and a node's children
+// in one or two cache lines, at the price of more compares per level
+#define ARITY 4
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+struct IndexedHeap {
+  uint32_t *items;   // The heap itself
+  size_t count;
+  size_t capacity;
+
+  // Slot of every handle in `items`, HEAP_EMPTY when absent
+  uint32_t *pos;
+  size_t pos_capacity;
+
+  HeapBefore before;
+  void *ctx;
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static void reserve_items(IndexedHeap *heap) {
+  if (heap->count < heap->capacity) {
+    return;
+  }
+  size_t capacity = heap->capacity ? heap->capacity * 2 : 16;
+  uint32_t *items = realloc(heap->items, capacity * sizeof(uint32_t));
+  if (!items) {
+    perror("realloc heap items");
+    exit(EXIT_FAILURE);
+  }
+  heap->items = items;
+  heap->capacity = capacity;
+}
+
+// Make sure `item` has a slot in the position map
+static void reserve_pos(IndexedHeap *heap, uint32_t item) {
+  if (item < heap->pos_capacity) {
+    return;
+  }
+  size_t capacity = heap->pos_capacity ? heap->pos_capacity : 16;
+  while (capacity <= item) {
+    capacity *= 2;
+  }
+  uint32_t *pos = realloc(heap->pos, capacity * sizeof(uint32_t));
+  if (!pos) {
+    perror("realloc heap positions");
+    exit(EXIT_FAILURE);
+  }
+  // Every byte 0xff spells HEAP_EMPTY
+  memset(pos + heap->pos_capacity, 0xff, (capacity - heap->pos_capacity) * sizeof(uint32_t));
+  heap->pos = pos;
+  heap->pos_capacity = capacity;
+}
+
+static inline void place(IndexedHeap *heap, size_t i, uint32_t item) {
+  heap->items[i] = item;
+  heap->pos[item] = (uint32_t)i;
+}
+
+// Move the item at slot i towards the root, return where it ended up
+static size_t sift_up(IndexedHeap *heap, size_t i) {
+  uint32_t item = heap->items[i];
+  while (i > 0) {
+    size_t parent = (i - 1) / ARITY;
+    if (!heap->before(item, heap->items[parent], heap->ctx)) {
+      break;
+    }
+    place(heap, i, heap->items[parent]);
+    i = parent;
+  }
+  place(heap, i, item);
+  return i;
+}
+
+// Move the item at slot i towards the leaves
+static void sift_down(IndexedHeap *heap, size_t i) {
+  uint32_t item = heap->items[i];
+  while (true) {
+    size_t first = i * ARITY + 1;
+    if (first >= heap->count) {
+      break;
+    }
+    size_t last = first + ARITY < heap->count ? first + ARITY : heap->count;
+    size_t best = first;
+    for (size_t c = first + 1; c < last; c++) {
+      if (heap->before(heap->items[c], heap->items[best], heap->ctx)) {
+        best = c;
+      }
+    }
+    if (!heap->before(heap->items[best], item, heap->ctx)) {
+      break;
+    }
+    place(heap, i, heap->items[best]);
+    i = best;
+  }
+  place(heap, i, item);
+}
+
+// Take the item at slot i out, filling the hole with the last item
+static uint32_t remove_slot(IndexedHeap *heap, size_t i) {
+  uint32_t item = heap->items[i];
+  heap->pos[item] = HEAP_EMPTY;
+  heap->count--;
+  if (i < heap->count) {
+    place(heap, i, heap->items[heap->count]);
+    if (sift_up(heap, i) == i) {
+      sift_down(heap, i);
+    }
+  }
+  return item;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+IndexedHeap *heap_create(size_t capacity, HeapBefore before, void *ctx) {
+  IndexedHeap *heap = calloc(1, sizeof(IndexedHeap));
+  if (!heap) {
+    perror("calloc heap");
+    exit(EXIT_FAILURE);
+  }
+  heap->before = before;
+  heap->ctx = ctx;
+  heap->capacity = capacity;
+  if (capacity > 0) {
+    heap->items = malloc(capacity * sizeof(uint32_t));
+    if (!heap->items) {
+      perror("malloc heap items");
+      exit(EXIT_FAILURE);
+    }
+    reserve_pos(heap, (uint32_t)(capacity - 1));
+  }
+  return heap;
+}
+
+void heap_destroy(IndexedHeap *heap) {
+  if (!heap) {
+    return;
+  }
+  free(heap->items);
+  free(heap->pos);
+  free(heap);
+}
+
+void heap_push(IndexedHeap *heap, uint32_t item) {
+  if (item == HEAP_EMPTY) {
+    fprintf(stderr, "heap_push: invalid handle\n");
+    return;
+  }
+  if (heap_contains(heap, item)) {
+    fprintf(stderr, "heap_push: handle %u already queued\n", item);
+    return;
+  }
+  reserve_items(heap);
+  reserve_pos(heap, item);
+  place(heap, heap->count++, item);
+  sift_up(heap, heap->count - 1);
+}
+
+uint32_t heap_pop(IndexedHeap *heap) {
+  if (heap->count == 0) {
+    return HEAP_EMPTY;
+  }
+  return remove_slot(heap, 0);
+}
+
+uint32_t heap_peek(const IndexedHeap *heap) {
+  return heap->count ? heap->items[0] : HEAP_EMPTY;
+}
+
+bool heap_contains(const IndexedHeap *heap, uint32_t item) {
+  return item < heap->pos_capacity && heap->pos[item] != HEAP_EMPTY;
+}
+
+void heap_decrease_key(IndexedHeap *heap, uint32_t item) {
+  if (!heap_contains(heap, item)) {
+    return;
+  }
+  sift_up(heap, heap->pos[item]);
+}
+
+void heap_update(IndexedHeap *heap, uint32_t item) {
+  if (!heap_contains(heap, item)) {
+    return;
+  }
+  size_t i = heap->pos[item];
+  if (sift_up(heap, i) == i) {
+    sift_down(heap, i);
+  }
+}
+
+bool heap_remove(IndexedHeap *heap, uint32_t item) {
+  if (!heap_contains(heap, item)) {
+    return false;
+  }
+  remove_slot(heap, heap->pos[item]);
+  return true;
+}
+
+size_t heap_size(const IndexedHeap *heap) {
+  return heap->count;
+}
@@ -0,0 +1,256 @@
+#include "../include/interrupts.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+typedef struct {
+  Interrupt intr;
+  uint64_t seq;      // Raise order, breaks ties between equal priorities
+} PendingInterrupt;
+
+// Binary min-heap on (priority, seq)
+typedef struct {
+  PendingInterrupt data[MAX_INTERRUPTS];
+  size_t size;
+  uint64_t next_seq;
+  int timer;         // Deadline, TIMER_OFF when disarmed
+  InterruptInbox *inbox;
+} InterruptController;
+
+// A slot is free for the producer claiming position p when its sequence
+// is p, and holds that producer's interrupt once the sequence is p + 1
+typedef struct {
+  _Atomic size_t seq;
+  Interrupt intr;
+} InboxSlot;
+
+// Bounded MPSC ring (Vyukov). Producers claim positions with a CAS on
+// tail; the single consumer owns head. Kept on separate cache lines so
+// posting and draining do not false-share.
+struct InterruptInbox {
+  InboxSlot *slots;
+  size_t mask;
+  _Alignas(64) _Atomic size_t tail;
+  _Alignas(64) size_t head;
+};
+
+static _Thread_local InterruptController INTERRUPTCONTROLLER = { .timer = TIMER_OFF };
+#define INTBLOCK(location) INTERRUPTCONTROLLER.data[location]
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static inline bool before(const PendingInterrupt *a, const PendingInterrupt *b) {
+  if (a->intr.priority != b->intr.priority) {
+    return a->intr.priority < b->intr.priority;
+  }
+  return a->seq < b->seq;
+}
+
+static void sift_up(size_t i) {
+  PendingInterrupt p = INTBLOCK(i);
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!before(&p, &INTBLOCK(parent))) {
+      break;
+    }
+    INTBLOCK(i) = INTBLOCK(parent);
+    i = parent;
+  }
+  INTBLOCK(i) = p;
+}
+
+static void sift_down(size_t i) {
+  PendingInterrupt p = INTBLOCK(i);
+  while (true) {
+    size_t child = 2 * i + 1;
+    if (child >= INTERRUPTCONTROLLER.size) {
+      break;
+    }
+    if (child + 1 < INTERRUPTCONTROLLER.size && before(&INTBLOCK(child + 1), &INTBLOCK(child))) {
+      child++;
+    }
+    if (!before(&INTBLOCK(child), &p)) {
+      break;
+    }
+    INTBLOCK(i) = INTBLOCK(child);
+    i = child;
+  }
+  INTBLOCK(i) = p;
+}
+
+// Withdraw every pending interrupt of one kind
+static void drop_pending(IRQ irq) {
+  size_t kept = 0;
+  for (size_t i = 0; i < INTERRUPTCONTROLLER.size; i++) {
+    if (INTBLOCK(i).intr.irq != irq) {
+      INTBLOCK(kept++) = INTBLOCK(i);
+    }
+  }
+  if (kept == INTERRUPTCONTROLLER.size) {
+    return;
+  }
+  INTERRUPTCONTROLLER.size = kept;
+  for (size_t i = kept / 2; i-- > 0;) {
+    sift_down(i);
+  }
+}
+
+// Take the oldest posted interrupt (consumer only), false if there is
+// none or its producer has not finished writing it yet
+static bool inbox_take(InterruptInbox *inbox, Interrupt *out) {
+  InboxSlot *slot = &inbox->slots[inbox->head & inbox->mask];
+  size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+  if (seq != inbox->head + 1) {
+    return false;
+  }
+  *out = slot->intr;
+  // Free the slot for the producer that comes round the ring next
+  atomic_store_explicit(&slot->seq, inbox->head + inbox->mask + 1, memory_order_release);
+  inbox->head++;
+  return true;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+void init_interrupt_controller(void) {
+  INTERRUPTCONTROLLER.size = 0;
+  INTERRUPTCONTROLLER.next_seq = 0;
+  INTERRUPTCONTROLLER.timer = TIMER_OFF;
+}
+
+void add_interrupt(IRQ irq, int priority) {
+  if (INTERRUPTCONTROLLER.size >= MAX_INTERRUPTS) {
+    fprintf(stderr, "Interrupt queue full, IRQ %d lost\n", irq);
+    return;
+  }
+  size_t i = INTERRUPTCONTROLLER.size++;
+  INTBLOCK(i).intr.irq = irq;
+  INTBLOCK(i).intr.priority = priority;
+  INTBLOCK(i).seq = INTERRUPTCONTROLLER.next_seq++;
+  sift_up(i);
+}
+
+bool check_for_interrupt(Interrupt *out) {
+  if (INTERRUPTCONTROLLER.inbox) {
+    interrupt_drain();
+  }
+  if (INTERRUPTCONTROLLER.size == 0) {
+    return false;
+  }
+  *out = INTBLOCK(0).intr;
+  INTBLOCK(0) = INTBLOCK(--INTERRUPTCONTROLLER.size);
+  if (INTERRUPTCONTROLLER.size > 0) {
+    sift_down(0);
+  }
+  return true;
+}
+
+size_t pending_interrupts(void) {
+  return INTERRUPTCONTROLLER.size;
+}
+
+void timer_set(int deadline) {
+  drop_pending(IRQ_TIMER);
+  INTERRUPTCONTROLLER.timer = deadline;
+}
+
+void timer_cancel(void) {
+  timer_set(TIMER_OFF);
+}
+
+int timer_deadline(void) {
+  return INTERRUPTCONTROLLER.timer;
+}
+
+void timer_advance(int now) {
+  if (INTERRUPTCONTROLLER.timer == TIMER_OFF || now < INTERRUPTCONTROLLER.timer) {
+    return;
+  }
+  // One-shot: the scheduler re-arms it for the next quantum
+  INTERRUPTCONTROLLER.timer = TIMER_OFF;
+  add_interrupt(IRQ_TIMER, TIMER_IRQ_PRIORITY);
+}
+
+InterruptInbox *interrupt_inbox_create(size_t capacity) {
+  InterruptInbox *inbox = calloc(1, sizeof(InterruptInbox));
+  if (!inbox) {
+    perror("calloc interrupt inbox");
+    exit(EXIT_FAILURE);
+  }
+  size_t size = 16;
+  while (size < capacity) {
+    size *= 2;
+  }
+  inbox->slots = calloc(size, sizeof(InboxSlot));
+  if (!inbox->slots) {
+    perror("calloc interrupt inbox");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < size; i++) {
+    atomic_init(&inbox->slots[i].seq, i);
+  }
+  inbox->mask = size - 1;
+  atomic_init(&inbox->tail, 0);
+  inbox->head = 0;
+  return inbox;
+}
+
+void interrupt_inbox_destroy(InterruptInbox *inbox) {
+  if (!inbox) {
+    return;
+  }
+  free(inbox->slots);
+  free(inbox);
+}
+
+bool interrupt_post(InterruptInbox *inbox, IRQ irq, int priority) {
+  size_t pos = atomic_load_explicit(&inbox->tail, memory_order_relaxed);
+  InboxSlot *slot;
+  while (true) {
+    slot = &inbox->slots[pos & inbox->mask];
+    size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    intptr_t lag = (intptr_t)(seq - pos);
+    if (lag == 0) {
+      // Free: claim it, on failure pos holds the current tail
+      if (atomic_compare_exchange_weak_explicit(&inbox->tail, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (lag < 0) {
+      // Still holds the interrupt posted one lap ago: full
+      return false;
+    } else {
+      // Another producer claimed it first
+      pos = atomic_load_explicit(&inbox->tail, memory_order_relaxed);
+    }
+  }
+  slot->intr.irq = irq;
+  slot->intr.priority = priority;
+  atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+  return true;
+}
+
+void interrupt_attach_inbox(InterruptInbox *inbox) {
+  INTERRUPTCONTROLLER.inbox = inbox;
+}
+
+size_t interrupt_drain(void) {
+  InterruptInbox *inbox = INTERRUPTCONTROLLER.inbox;
+  if (!inbox) {
+    return 0;
+  }
+  size_t moved = 0;
+  Interrupt intr;
+  // Leave posts in the inbox rather than lose them when the heap is full
+  while (INTERRUPTCONTROLLER.size < MAX_INTERRUPTS && inbox_take(inbox, &intr)) {
+    add_interrupt(intr.irq, intr.priority);
+    moved++;
+  }
+  return moved;
+}
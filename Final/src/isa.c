@@ -1,13 +1,13 @@
 #include "../include/isa.h"
 #include "../include/cpu.h"
 #include "../include/memory.h"
+#include "../include/console.h"
+#include "../include/keyboard.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <termios.h>
 #include <time.h>
 #include <sys/time.h>
 
@@ -337,32 +337,88 @@ static void jalr(uint32_t rs, uint32_t rd) {
   THE_CPU.hw_registers[PC] = target;
 }
 
+// Hand blocking syscalls to the OS instead of running them here
+static bool g_deferred_syscalls = false;
+// Answers the syscalls only the OS knows about
+static SyscallHandler g_syscall_handler = NULL;
+
+static void sleep_ms(uint32_t ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000;
+
+  while (nanosleep(&ts, &ts) == -1) {
+    // If interrupted by signal, nanosleep updates ts
+    continue;
+  }
+}
+
+// Leave the request in IO_AR/IO_BR for the OS to complete later
+static bool defer_syscall(uint32_t code, uint32_t arg) {
+  if (!g_deferred_syscalls) {
+    return false;
+  }
+  THE_CPU.hw_registers[IO_AR] = code;
+  THE_CPU.hw_registers[IO_BR] = arg;
+  return true;
+}
+
+void set_deferred_syscalls(bool enabled) {
+  g_deferred_syscalls = enabled;
+}
+
+void set_syscall_handler(SyscallHandler handler) {
+  g_syscall_handler = handler;
+}
+
+bool complete_syscall(Cpu *cpu, int pid) {
+  switch (cpu->hw_registers[IO_AR]) {
+    case SYSCALL_READ_INT: {
+      // Polled, so the host never waits on the keyboard for a process
+      uint32_t value;
+      if (!keyboard_try_read_int(pid, &value)) {
+        return false;
+      }
+      cpu->gp_registers[REG_V0] = value;
+      break;
+    }
+    case SYSCALL_SLEEP_MS:
+      break; // The wait itself was the simulated time spent blocked
+    default:
+      break;
+  }
+  cpu->hw_registers[IO_AR] = 0;
+  cpu->hw_registers[IO_BR] = 0;
+  return true;
+}
+
 static void systemcall() {
   uint32_t code = (uint32_t)read_gpr(REG_V0);
 
   switch (code) {
     case 1: { // print integer in $a0
       int32_t value = read_gpr(REG_A0);
-      printf("%d", value);
-      fflush(stdout);
+      char text[12];
+      int len = snprintf(text, sizeof(text), "%d", value);
+      console_write(text, (size_t)len);
       break;
     }
     case 4: { // print string at address in $a0
       uint32_t addr = (uint32_t)read_gpr(REG_A0);
-      while (1) {
-        uint8_t ch = read_byte(addr++);
-        if (ch == 0) break;
-        putchar(ch);
-      }
-      fflush(stdout);
+      char chunk[256];
+      size_t len;
+      do {
+        len = read_string(addr, chunk, sizeof(chunk));
+        console_write(chunk, len);
+        addr += (uint32_t)len;
+      } while (len == sizeof(chunk));
       break;
     }
-    case 5: {   // read integer
-      int x;
-      if (scanf("%d", &x) == 1)
-        write_gpr(REG_V0, (uint32_t)x);
-      else
-        write_gpr(REG_V0, 0);
+    case SYSCALL_READ_INT: {   // read integer
+      if (!defer_syscall(code, 0)) {
+        console_flush(); // The prompt goes out before we wait
+        write_gpr(REG_V0, keyboard_read_int(keyboard_attached()));
+      }
     break;
     }
     case 10: {  // exit
@@ -371,44 +427,26 @@ static void systemcall() {
     }
     case 11: {  // clear_screen
       // ANSI clear + cursor home
-      printf("\033[2J\033[H");
-      fflush(stdout);
+      console_write("\033[2J\033[H", 7);
     break;
     }
-    case 12: {  // read_char_nb
-      struct termios oldt, newt;
-      tcgetattr(STDIN_FILENO, &oldt);
-      newt = oldt;
-
-      newt.c_lflag &= ~(ICANON | ECHO);
-      newt.c_cc[VTIME] = 0;  // no timeout
-      newt.c_cc[VMIN] = 0;   // non-blocking
-
-      tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
-      int ch = getchar();   // non-blocking now
-      if (ch == EOF)
-          ch = 0;           // no key pressed → return 0
-
-      tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-
-      write_gpr(REG_V0, (uint32_t)ch);
+    case SYSCALL_READ_CHAR: {  // read_char_nb
+      // Never waits, so the OS need not block the process for it
+      write_gpr(REG_V0, keyboard_read_char());
       break;
     }
-    case 13: {  // sleep_ms
+    case SYSCALL_SLEEP_MS: {  // sleep_ms
       uint32_t ms = read_gpr(REG_A0);
-
-      struct timespec ts;
-      ts.tv_sec = ms / 1000;
-      ts.tv_nsec = (ms % 1000) * 1000000;
-
-      while (nanosleep(&ts, &ts) == -1) {
-        // If interrupted by signal, nanosleep updates ts
-        continue;
-      }
+      if (!defer_syscall(code, ms))
+        sleep_ms(ms);
     break;
     }
-    case 14: {  // get_time_ms
+    case SYSCALL_GET_TIME_MS: {  // get_time_ms
+      if (g_syscall_handler) {
+        write_gpr(REG_V0, g_syscall_handler(code, 0, 0));
+        break;
+      }
+      // No OS: a bare CPU run reads the host clock
       struct timeval tv;
       gettimeofday(&tv, NULL);
 
@@ -418,6 +456,17 @@ static void systemcall() {
       write_gpr(REG_V0, (uint32_t)ms);   // wrap is fine for MIPS32
       break;
     }
+    case SYSCALL_SET_TICKETS:
+    case SYSCALL_LEND_TICKETS: {
+      if (g_syscall_handler) {
+        uint32_t a0 = (uint32_t)read_gpr(REG_A0);
+        uint32_t a1 = (uint32_t)read_gpr(REG_A1);
+        write_gpr(REG_V0, g_syscall_handler(code, a0, a1));
+      } else {
+        write_gpr(REG_V0, 0);
+      }
+      break;
+    }
     default:
       fprintf(stderr, "Unhandled syscall code %u\n", code);
       break;
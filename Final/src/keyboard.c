@@ -0,0 +1,411 @@
+#include "../include/keyboard.h"
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t pos;        // Next key to hand out
+} KeyScript;
+
+// Single producer (the reader thread) and single consumer (the process
+// it belongs to, which runs on one core at a time)
+typedef struct {
+  char data[KEYBOARD_RING_SIZE];
+  _Alignas(64) _Atomic size_t head;
+  _Alignas(64) _Atomic size_t tail;
+} KeyRing;
+
+// Indexed by pid. Only loaded before a run, so the table does not move
+// while cores read from it.
+static KeyScript **g_scripts = NULL;
+static size_t g_script_capacity = 0;
+
+#define NO_FOCUS INT_MIN
+
+// One ring per process, slot 0 for whatever runs outside a process. A
+// ring never moves once made, only the table of them does, under the lock.
+static KeyRing **g_rings = NULL;
+static size_t g_ring_capacity = 0;
+static pthread_mutex_t g_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic int g_focus = NO_FOCUS;     // pid the terminal keys go to
+static _Atomic bool g_eof = false;         // stdin is closed, the rings are all there is
+
+static pthread_mutex_t g_open_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic bool g_open = false;
+static _Atomic bool g_raw_wanted = false;  // Someone polls single keys
+static pthread_t g_reader;
+static bool g_raw = false;                 // The terminal is in raw mode
+static struct termios g_saved_termios;
+
+static _Thread_local int g_attached = -1;
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static KeyScript *script_for(int pid) {
+  if (pid < 0 || (size_t)pid >= g_script_capacity) {
+    return NULL;
+  }
+  return g_scripts[pid];
+}
+
+static size_t ring_slot(int pid) {
+  return (pid < 0) ? 0 : (size_t)pid + 1;
+}
+
+// pid's ring, made the first time it is asked for. Caller holds g_ring_lock.
+static KeyRing *ring_for_locked(int pid) {
+  size_t slot = ring_slot(pid);
+  if (slot >= g_ring_capacity) {
+    size_t count = g_ring_capacity ? g_ring_capacity : 16;
+    while (count <= slot) {
+      count *= 2;
+    }
+    KeyRing **rings = realloc(g_rings, count * sizeof(KeyRing *));
+    if (!rings) {
+      perror("realloc keyboard rings");
+      exit(EXIT_FAILURE);
+    }
+    memset(rings + g_ring_capacity, 0, (count - g_ring_capacity) * sizeof(KeyRing *));
+    g_rings = rings;
+    g_ring_capacity = count;
+  }
+  if (!g_rings[slot]) {
+    g_rings[slot] = calloc(1, sizeof(KeyRing));
+    if (!g_rings[slot]) {
+      perror("calloc keyboard ring");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return g_rings[slot];
+}
+
+static KeyRing *ring_for(int pid) {
+  pthread_mutex_lock(&g_ring_lock);
+  KeyRing *ring = ring_for_locked(pid);
+  pthread_mutex_unlock(&g_ring_lock);
+  return ring;
+}
+
+static void ring_push(KeyRing *ring, char c) {
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == KEYBOARD_RING_SIZE) {
+    return; // Nobody is reading, drop the key like a full type-ahead buffer
+  }
+  ring->data[tail % KEYBOARD_RING_SIZE] = c;
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static bool ring_pop(KeyRing *ring, char *out) {
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+    return false;
+  }
+  // The producer leaves this slot alone until head moves past it
+  *out = ring->data[head % KEYBOARD_RING_SIZE];
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return true;
+}
+
+// Deliver every key read to the process with focus. Keys typed while
+// nobody has it go nowhere, like typing at a desktop with no window.
+static void *reader_main(void *arg) {
+  (void)arg;
+  char buf[64];
+  while (true) {
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    pthread_mutex_lock(&g_ring_lock);
+    int focus = atomic_load(&g_focus);
+    if (focus != NO_FOCUS) {
+      KeyRing *ring = ring_for_locked(focus);
+      for (ssize_t i = 0; i < n; i++) {
+        ring_push(ring, buf[i]);
+      }
+    }
+    pthread_mutex_unlock(&g_ring_lock);
+  }
+  atomic_store(&g_eof, true);
+  return NULL;
+}
+
+static void restore_terminal(void) {
+  if (g_raw) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &g_saved_termios);
+    g_raw = false;
+  }
+}
+
+// The reader thread, the first time anyone needs it, and raw mode the
+// first time anyone polls single keys. Integer reads alone leave the
+// terminal in line mode, with its echo and line editing.
+static void open_terminal(bool raw) {
+  if (atomic_load_explicit(&g_open, memory_order_acquire) &&
+      (!raw || atomic_load_explicit(&g_raw_wanted, memory_order_acquire))) {
+    return;
+  }
+  pthread_mutex_lock(&g_open_lock);
+  if (raw && !atomic_load_explicit(&g_raw_wanted, memory_order_relaxed)) {
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &g_saved_termios) == 0) {
+      struct termios mode = g_saved_termios;
+      mode.c_lflag &= ~(ICANON | ECHO);
+      mode.c_cc[VMIN] = 1;   // The reader thread blocks until a key arrives
+      mode.c_cc[VTIME] = 0;
+      if (tcsetattr(STDIN_FILENO, TCSANOW, &mode) == 0) {
+        g_raw = true;
+        atexit(restore_terminal);
+      }
+    }
+    atomic_store_explicit(&g_raw_wanted, true, memory_order_release);
+  }
+  if (!atomic_load_explicit(&g_open, memory_order_relaxed)) {
+    if (pthread_create(&g_reader, NULL, reader_main, NULL) != 0) {
+      perror("pthread_create keyboard reader");
+      exit(EXIT_FAILURE);
+    }
+    atomic_store_explicit(&g_open, true, memory_order_release);
+  }
+  pthread_mutex_unlock(&g_open_lock);
+}
+
+// Does pid get the terminal keys, taking focus if nobody has it
+static bool has_focus(int pid) {
+  int focus = atomic_load(&g_focus);
+  if (focus == pid) {
+    return true;
+  }
+  return focus == NO_FOCUS && atomic_compare_exchange_strong(&g_focus, &focus, pid);
+}
+
+static int script_next(void *src) {
+  KeyScript *s = src;
+  return (s->pos < s->len) ? (unsigned char)s->data[s->pos++] : -1;
+}
+
+// Looks through the keys in a ring without taking them, so a number
+// only half typed can be left there for the next try
+typedef struct {
+  KeyRing *ring;
+  size_t pos;
+  size_t tail;
+  bool eof;          // No key will come after tail
+  bool starved;      // Ran out of keys that were not the last ones
+} RingPeek;
+
+// The next key in the ring, -1 at the end of what has been typed
+static int peek_next(void *src) {
+  RingPeek *peek = src;
+  if (peek->pos == peek->tail) {
+    peek->starved = !peek->eof;
+    return -1;
+  }
+  return (unsigned char)peek->ring->data[peek->pos++ % KEYBOARD_RING_SIZE];
+}
+
+// Skip blanks, then an optional sign and digits. Consumes the key that
+// ends the number.
+static uint32_t parse_int(int (*next)(void *), void *src) {
+  int c;
+  do {
+    c = next(src);
+  } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+  bool negative = (c == '-');
+  if (c == '-' || c == '+') {
+    c = next(src);
+  }
+  uint32_t value = 0;
+  while (c >= '0' && c <= '9') {
+    value = value * 10 + (uint32_t)(c - '0');
+    c = next(src);
+  }
+  return negative ? (uint32_t)0 - value : value;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+void keyboard_attach(int pid) {
+  g_attached = pid;
+}
+
+int keyboard_attached(void) {
+  return g_attached;
+}
+
+bool keyboard_script(int pid, const char *path) {
+  if (pid < 0) {
+    return false;
+  }
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  KeyScript *s = calloc(1, sizeof(KeyScript));
+  if (!s) {
+    perror("calloc keyboard script");
+    exit(EXIT_FAILURE);
+  }
+  size_t capacity = 256;
+  s->data = malloc(capacity);
+  if (!s->data) {
+    perror("malloc keyboard script");
+    exit(EXIT_FAILURE);
+  }
+  size_t n;
+  while ((n = fread(s->data + s->len, 1, capacity - s->len, file)) > 0) {
+    s->len += n;
+    if (s->len == capacity) {
+      capacity *= 2;
+      char *data = realloc(s->data, capacity);
+      if (!data) {
+        perror("realloc keyboard script");
+        exit(EXIT_FAILURE);
+      }
+      s->data = data;
+    }
+  }
+  fclose(file);
+
+  if ((size_t)pid >= g_script_capacity) {
+    size_t count = g_script_capacity ? g_script_capacity : 16;
+    while (count <= (size_t)pid) {
+      count *= 2;
+    }
+    KeyScript **scripts = realloc(g_scripts, count * sizeof(KeyScript *));
+    if (!scripts) {
+      perror("realloc keyboard scripts");
+      exit(EXIT_FAILURE);
+    }
+    memset(scripts + g_script_capacity, 0, (count - g_script_capacity) * sizeof(KeyScript *));
+    g_scripts = scripts;
+    g_script_capacity = count;
+  }
+  if (g_scripts[pid]) {
+    free(g_scripts[pid]->data);
+    free(g_scripts[pid]);
+  }
+  g_scripts[pid] = s;
+  return true;
+}
+
+void keyboard_rewind(void) {
+  for (size_t i = 0; i < g_script_capacity; i++) {
+    if (g_scripts[i]) {
+      g_scripts[i]->pos = 0;
+    }
+  }
+  atomic_store(&g_focus, NO_FOCUS);
+}
+
+void keyboard_focus(int pid) {
+  atomic_store(&g_focus, pid);
+}
+
+void keyboard_release(int pid) {
+  int focus = pid;
+  atomic_compare_exchange_strong(&g_focus, &focus, NO_FOCUS);
+  // Whatever it left unread is nobody else's
+  pthread_mutex_lock(&g_ring_lock);
+  size_t slot = ring_slot(pid);
+  if (slot < g_ring_capacity && g_rings[slot]) {
+    KeyRing *ring = g_rings[slot];
+    atomic_store(&ring->head, atomic_load(&ring->tail));
+  }
+  pthread_mutex_unlock(&g_ring_lock);
+}
+
+uint32_t keyboard_read_char(void) {
+  KeyScript *s = script_for(g_attached);
+  if (s) {
+    int c = script_next(s);
+    return (c < 0) ? 0 : (uint32_t)c;
+  }
+  has_focus(g_attached);
+  open_terminal(true);
+  char c;
+  return ring_pop(ring_for(g_attached), &c) ? (unsigned char)c : 0;
+}
+
+bool keyboard_try_read_int(int pid, uint32_t *value) {
+  KeyScript *s = script_for(pid);
+  if (s) {
+    *value = parse_int(script_next, s);
+    return true;
+  }
+  has_focus(pid);
+  open_terminal(false);
+  KeyRing *ring = ring_for(pid);
+  RingPeek peek = { .ring = ring };
+  peek.eof = atomic_load(&g_eof); // Before tail, so no key lands after it
+  peek.tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  peek.pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t head = peek.pos;
+  uint32_t parsed = parse_int(peek_next, &peek);
+  if (peek.starved) {
+    return false;
+  }
+  if (g_raw) {
+    // Raw mode turned the echo off, but a number is typed blind otherwise
+    for (size_t i = head; i < peek.pos; i++) {
+      fputc(ring->data[i % KEYBOARD_RING_SIZE], stdout);
+    }
+    fflush(stdout);
+  }
+  atomic_store_explicit(&ring->head, peek.pos, memory_order_release);
+  *value = parsed;
+  return true;
+}
+
+uint32_t keyboard_read_int(int pid) {
+  struct timespec poll = { 0, 1000000 };
+  uint32_t value;
+  while (!keyboard_try_read_int(pid, &value)) {
+    nanosleep(&poll, NULL);
+  }
+  return value;
+}
+
+void keyboard_close(void) {
+  if (atomic_load(&g_open)) {
+    pthread_cancel(g_reader);
+    pthread_join(g_reader, NULL);
+    atomic_store(&g_open, false);
+  }
+  atomic_store(&g_raw_wanted, false);
+  atomic_store(&g_eof, false);
+  restore_terminal();
+  for (size_t i = 0; i < g_script_capacity; i++) {
+    if (g_scripts[i]) {
+      free(g_scripts[i]->data);
+      free(g_scripts[i]);
+    }
+  }
+  free(g_scripts);
+  g_scripts = NULL;
+  g_script_capacity = 0;
+  for (size_t i = 0; i < g_ring_capacity; i++) {
+    free(g_rings[i]);
+  }
+  free(g_rings);
+  g_rings = NULL;
+  g_ring_capacity = 0;
+  atomic_store(&g_focus, NO_FOCUS);
+}
@@ -0,0 +1,227 @@
+#include "../include/kinetic.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NEVER INT64_MAX
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+// One match of the tournament. Leaves only use `winner`.
+typedef struct {
+  uint32_t winner;  // KINETIC_EMPTY when the subtree is empty
+  int64_t fail;     // When this match is next decided differently
+  int64_t min_fail; // Earliest `fail` anywhere in the subtree
+} KineticNode;
+
+struct KineticTree {
+  KineticNode *nodes; // 1-based heap layout, leaf of item i is nodes[leaves + i]
+  size_t leaves;      // Power of two
+  int64_t *arrival;   // Per item
+  int64_t *burst;
+  size_t count;
+  int64_t now;
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+// Does x score higher than y at time t
+static bool beats(const KineticTree *tree, uint32_t x, uint32_t y, int64_t t) {
+  int64_t bx = tree->burst[x];
+  int64_t by = tree->burst[y];
+  if (bx <= 0 || by <= 0) {
+    if ((bx <= 0) != (by <= 0)) {
+      return bx > 0;
+    }
+    return x < y;
+  }
+  // (t - ax) / bx against (t - ay) / by without dividing
+  int64_t lhs = (t - tree->arrival[x]) * by;
+  int64_t rhs = (t - tree->arrival[y]) * bx;
+  if (lhs != rhs) {
+    return lhs > rhs;
+  }
+  return x < y;
+}
+
+// First time after now at which `loser` overtakes `winner`
+static int64_t overtake_time(const KineticTree *tree, uint32_t winner, uint32_t loser) {
+  int64_t bw = tree->burst[winner];
+  int64_t bl = tree->burst[loser];
+  // A line can only catch up with one that grows more slowly
+  if (bw <= 0 || bl <= 0 || bl >= bw) {
+    return NEVER;
+  }
+  // The lines cross at t = (al * bw - aw * bl) / (bw - bl)
+  int64_t num = tree->arrival[loser] * bw - tree->arrival[winner] * bl;
+  int64_t den = bw - bl;
+  int64_t t = num / den;
+  if (num % den != 0 && num < 0) {
+    t--; // Round towards minus infinity
+  }
+  if (t <= tree->now) {
+    t = tree->now + 1;
+  }
+  while (!beats(tree, loser, winner, t)) {
+    t++;
+  }
+  return t;
+}
+
+static inline int64_t min64(int64_t a, int64_t b) {
+  return a < b ? a : b;
+}
+
+// Replay the match at internal node i from its children
+static void play(KineticTree *tree, size_t i) {
+  KineticNode *node = &tree->nodes[i];
+  const KineticNode *l = &tree->nodes[2 * i];
+  const KineticNode *r = &tree->nodes[2 * i + 1];
+
+  if (l->winner == KINETIC_EMPTY || r->winner == KINETIC_EMPTY) {
+    node->winner = (l->winner == KINETIC_EMPTY) ? r->winner : l->winner;
+    node->fail = NEVER;
+  } else if (beats(tree, l->winner, r->winner, tree->now)) {
+    node->winner = l->winner;
+    node->fail = overtake_time(tree, l->winner, r->winner);
+  } else {
+    node->winner = r->winner;
+    node->fail = overtake_time(tree, r->winner, l->winner);
+  }
+  node->min_fail = min64(node->fail, min64(l->min_fail, r->min_fail));
+}
+
+// Replay every match on the way from a leaf to the root
+static void replay_path(KineticTree *tree, size_t leaf) {
+  for (size_t i = leaf / 2; i >= 1; i /= 2) {
+    play(tree, i);
+  }
+}
+
+// Replay the matches below node i that have expired by now
+static void replay_expired(KineticTree *tree, size_t i) {
+  if (i >= tree->leaves || tree->nodes[i].min_fail > tree->now) {
+    return;
+  }
+  replay_expired(tree, 2 * i);
+  replay_expired(tree, 2 * i + 1);
+  play(tree, i);
+}
+
+static void *grow_array(void *old, size_t count, size_t size, const char *what) {
+  void *grown = realloc(old, count * size);
+  if (!grown) {
+    perror(what);
+    exit(EXIT_FAILURE);
+  }
+  return grown;
+}
+
+// Make room for leaves up to `item`, rebuilding every match
+static void reserve_leaves(KineticTree *tree, uint32_t item) {
+  if (item < tree->leaves) {
+    return;
+  }
+  size_t old_leaves = tree->leaves;
+  size_t leaves = old_leaves ? old_leaves : 16;
+  while (leaves <= item) {
+    leaves *= 2;
+  }
+
+  tree->arrival = grow_array(tree->arrival, leaves, sizeof(int64_t), "realloc kinetic arrivals");
+  tree->burst = grow_array(tree->burst, leaves, sizeof(int64_t), "realloc kinetic bursts");
+
+  KineticNode *nodes = malloc(2 * leaves * sizeof(KineticNode));
+  if (!nodes) {
+    perror("malloc kinetic nodes");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < leaves; i++) {
+    KineticNode *leaf = &nodes[leaves + i];
+    leaf->winner = (i < old_leaves) ? tree->nodes[old_leaves + i].winner : KINETIC_EMPTY;
+    leaf->fail = leaf->min_fail = NEVER;
+  }
+  free(tree->nodes);
+  tree->nodes = nodes;
+  tree->leaves = leaves;
+  for (size_t i = leaves - 1; i >= 1; i--) {
+    play(tree, i);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+KineticTree *kinetic_create(size_t capacity) {
+  KineticTree *tree = calloc(1, sizeof(KineticTree));
+  if (!tree) {
+    perror("calloc kinetic tree");
+    exit(EXIT_FAILURE);
+  }
+  reserve_leaves(tree, capacity > 0 ? (uint32_t)(capacity - 1) : 0);
+  return tree;
+}
+
+void kinetic_destroy(KineticTree *tree) {
+  if (!tree) {
+    return;
+  }
+  free(tree->nodes);
+  free(tree->arrival);
+  free(tree->burst);
+  free(tree);
+}
+
+void kinetic_insert(KineticTree *tree, uint32_t item, int arrival, int burst) {
+  if (item == KINETIC_EMPTY) {
+    fprintf(stderr, "kinetic_insert: invalid handle\n");
+    return;
+  }
+  reserve_leaves(tree, item);
+  size_t leaf = tree->leaves + item;
+  if (tree->nodes[leaf].winner != KINETIC_EMPTY) {
+    fprintf(stderr, "kinetic_insert: handle %u already queued\n", item);
+    return;
+  }
+  tree->arrival[item] = arrival;
+  tree->burst[item] = burst;
+  tree->nodes[leaf].winner = item;
+  tree->count++;
+  replay_path(tree, leaf);
+}
+
+bool kinetic_remove(KineticTree *tree, uint32_t item) {
+  if (item >= tree->leaves || tree->nodes[tree->leaves + item].winner == KINETIC_EMPTY) {
+    return false;
+  }
+  size_t leaf = tree->leaves + item;
+  tree->nodes[leaf].winner = KINETIC_EMPTY;
+  tree->count--;
+  replay_path(tree, leaf);
+  return true;
+}
+
+void kinetic_advance(KineticTree *tree, int now) {
+  if (now <= tree->now) {
+    return;
+  }
+  tree->now = now;
+  replay_expired(tree, 1);
+}
+
+uint32_t kinetic_peek(const KineticTree *tree) {
+  return tree->nodes[1].winner;
+}
+
+uint32_t kinetic_pop(KineticTree *tree) {
+  uint32_t item = kinetic_peek(tree);
+  if (item != KINETIC_EMPTY) {
+    kinetic_remove(tree, item);
+  }
+  return item;
+}
+
+size_t kinetic_size(const KineticTree *tree) {
+  return tree->count;
+}
@@ -0,0 +1,20 @@
+#include "../include/log.h"
+#include <string.h>
+
+LogLevel g_log_level = LOG_DEBUG;
+
+static const char *const LEVEL_NAMES[] = { "quiet", "info", "debug", "trace" };
+
+void set_log_level(LogLevel level) {
+  g_log_level = level;
+}
+
+bool parse_log_level(const char *name, LogLevel *out) {
+  for (int level = LOG_QUIET; level <= LOG_TRACE; level++) {
+    if (strcmp(name, LEVEL_NAMES[level]) == 0) {
+      *out = (LogLevel)level;
+      return true;
+    }
+  }
+  return false;
+}
@@ -4,24 +4,51 @@
 #include "../include/processes.h"
 #include "../include/isa.h"
 #include "../include/performance.h"
+#include "../include/workload.h"
+#include "../include/console.h"
+#include "../include/keyboard.h"
+#include "../include/log.h"
+#include "../include/object.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
 #include <signal.h>
-
-#define MAX_PROGRAMS 10
+#include <unistd.h>
 
 typedef struct {
   CachePolicy cache_policy;
   SchedulingAlgorithm scheduler;
   const char **program_files;
   int program_count;
+  int program_capacity;
   int *priorities;
   int *burst_estimates;
+  bool *burst_given;
+  int *arrivals;
   bool compare_all_algorithms;
   bool export_csv;
   const char *csv_filename;
+  int cores;
+  bool affinity;
+  uint64_t *hard_affinity;
+  uint64_t *soft_affinity;
+  RealTimeParams *realtime;
+  size_t swap_watermark;
+  int cfs_latency;
+  int cfs_granularity;
+  uint64_t lottery_seed;
+  int mlfq_quanta[MLFQ_MAX_LEVELS];
+  int mlfq_levels;
+  int mlfq_boost;
+  int ticks_per_ms;
+  bool paced;
+  const char *object_cache;
+  Workload *workload;
+  bool generate;
+  WorkloadConfig generator;
+  const char *generate_dir;
+  Workload *generated;
 } Options;
 
 static Options opts = {
@@ -29,11 +56,33 @@ static Options opts = {
   .scheduler = SCHED_ROUND_ROBIN,
   .program_files = NULL,
   .program_count = 0,
+  .program_capacity = 0,
   .priorities = NULL,
   .burst_estimates = NULL,
+  .burst_given = NULL,
+  .arrivals = NULL,
   .compare_all_algorithms = false,
   .export_csv = false,
-  .csv_filename = "performance_results.csv"
+  .csv_filename = "performance_results.csv",
+  .cores = 1,
+  .affinity = false,
+  .hard_affinity = NULL,
+  .soft_affinity = NULL,
+  .realtime = NULL,
+  .swap_watermark = 0,
+  .cfs_latency = 24,
+  .cfs_granularity = 3,
+  .lottery_seed = 1,
+  .mlfq_quanta = { 2, 4, 8 },
+  .mlfq_levels = 3,
+  .mlfq_boost = 100,
+  .ticks_per_ms = 1,
+  .paced = false,
+  .object_cache = ".objcache",
+  .workload = NULL,
+  .generate = false,
+  .generate_dir = "generated",
+  .generated = NULL
 };
 
 static AssemblyResult *results;
@@ -76,7 +125,11 @@ static void run_single_algorithm(SchedulingAlgorithm algo) {
       results[i].program->data_size,
       results[i].program->stack_ptr,
       opts.priorities[i],
-      results[i].program->text_size // opts.burst_estimates[i]
+      opts.burst_given[i] ? opts.burst_estimates[i] : (int)results[i].program->text_size,
+      opts.arrivals[i],
+      opts.hard_affinity[i],
+      opts.soft_affinity[i],
+      opts.realtime[i]
     );
     
     if (process_addr == UINT32_MAX) {
@@ -112,17 +165,29 @@ int main(int argc, char *argv[])
   }
 
   // Initialize memory system
-  printf("Initializing memory system...\n");
+  log_info("Initializing memory system...\n");
   init_memory(opts.cache_policy);
   memory_initialized = true;
 
   // Initialize process queues
-  printf("Initializing process queues...\n");
+  log_info("Initializing process queues...\n");
   init_queues();
   queues_initialized = true;
+  set_scheduler_cores(opts.cores);
+  if (opts.affinity && opts.cores < 2) {
+    fprintf(stderr, "Warning: --affinity only applies with --cores > 1\n");
+  }
+  set_scheduler_affinity(opts.affinity);
+  set_swap_watermark(opts.swap_watermark);
+  set_cfs_params(opts.cfs_latency, opts.cfs_granularity);
+  set_lottery_seed(opts.lottery_seed);
+  set_mlfq_params(opts.mlfq_quanta, opts.mlfq_levels, opts.mlfq_boost);
+  set_clock_params(opts.ticks_per_ms, opts.paced);
+  // Someone watching gets each line as it is printed
+  console_set_line_mode(isatty(STDOUT_FILENO));
   
   // Initialize performance tracking
-  printf("Initializing performance tracking...\n");
+  log_info("Initializing performance tracking...\n");
   init_performance_tracking();
   perf_initialized = true;
 
@@ -136,9 +201,10 @@ int main(int argc, char *argv[])
   }
 
   // Assemble all programs
-  printf("\n=== Assembling Programs ===\n");
+  set_object_cache(opts.object_cache);
+  log_info("\n=== Assembling Programs ===\n");
   for (int i = 0; i < opts.program_count; i++) {
-    printf("\n[%d/%d] Processing: %s\n", i+1, opts.program_count, opts.program_files[i]);
+    log_info("\n[%d/%d] Processing: %s\n", i+1, opts.program_count, opts.program_files[i]);
     
     results[i] = assemble(opts.program_files[i], i);
     
@@ -147,7 +213,7 @@ int main(int argc, char *argv[])
       continue;
     }
     
-    printf("  ✓ Assembly successful\n");
+    log_info("  ✓ Assembly successful\n");
   }
 
   if (opts.compare_all_algorithms) {
@@ -164,7 +230,12 @@ int main(int argc, char *argv[])
       SCHED_SRT,
       SCHED_PRIORITY,
       SCHED_HRRN,
-      SCHED_MLFQ
+      SCHED_MLFQ,
+      SCHED_CFS,
+      SCHED_LOTTERY,
+      SCHED_STRIDE,
+      SCHED_EDF,
+      SCHED_RM
     };
     
     const char *algo_names[] = {
@@ -174,10 +245,20 @@ int main(int argc, char *argv[])
       "SRT (Shortest Remaining Time)",
       "Priority",
       "HRRN (Highest Response Ratio Next)",
-      "MLFQ (Multi-Level Feedback Queue)"
+      "MLFQ (Multi-Level Feedback Queue)",
+      "CFS (Completely Fair Scheduler)",
+      "Lottery",
+      "Stride",
+      "EDF (Earliest Deadline First)",
+      "RM (Rate Monotonic)"
     };
     
     int num_algorithms = sizeof(algorithms) / sizeof(algorithms[0]);
+
+    // Only FCFS and Round Robin have multiprocessor variants
+    if (opts.cores > 1) {
+      num_algorithms = 2;
+    }
     
     for (int i = 0; i < num_algorithms; i++) {
       printf("\n");
@@ -185,6 +266,12 @@ int main(int argc, char *argv[])
       printf("                    Running: %s\n", algo_names[i]);
       printf("********************************************************************************\n");
       
+      // With --affinity, run the affinity-blind variant first as the baseline
+      if (opts.affinity && opts.cores > 1) {
+        set_scheduler_affinity(false);
+        run_single_algorithm(algorithms[i]);
+        set_scheduler_affinity(true);
+      }
       run_single_algorithm(algorithms[i]);
       
       printf("\n");
@@ -208,10 +295,10 @@ int main(int argc, char *argv[])
     
   } else {
     // Run single algorithm
-    printf("\n");
-    printf("================================================================================\n");
-    printf("                    Creating Processes for Scheduling\n");
-    printf("================================================================================\n");
+    log_info("\n");
+    log_info("================================================================================\n");
+    log_info("                    Creating Processes for Scheduling\n");
+    log_info("================================================================================\n");
     
     for (int i = 0; i < opts.program_count; i++) {
       if (!results[i].success) continue;
@@ -225,31 +312,40 @@ int main(int argc, char *argv[])
         results[i].program->data_size,
         results[i].program->stack_ptr,
         opts.priorities[i],
-        opts.burst_estimates[i]
+        opts.burst_estimates[i],
+        opts.arrivals[i],
+        opts.hard_affinity[i],
+        opts.soft_affinity[i],
+        opts.realtime[i]
       );
       
       if (process_addr == UINT32_MAX) {
         fprintf(stderr, "  ✗ Failed to create process\n");
         exit_code = EXIT_FAILURE;
       } else {
-        printf("  ✓ Process created (PID: %d, Entry: 0x%08x)\n", 
-               i, results[i].program->entry_point);
+        log_info("  ✓ Process created (PID: %d, Entry: 0x%08x)\n", 
+                 i, results[i].program->entry_point);
       }
     }
 
     // Run the scheduler
-    printf("\n=== Starting Scheduler ===\n");
-    printf("Algorithm: ");
+    log_info("\n=== Starting Scheduler ===\n");
+    log_info("Algorithm: ");
     switch (opts.scheduler) {
-      case SCHED_FCFS: printf("First-Come First-Served\n"); break;
-      case SCHED_ROUND_ROBIN: printf("Round Robin\n"); break;
-      case SCHED_PRIORITY: printf("Priority\n"); break;
-      case SCHED_SRT: printf("Shortest Remaining Time\n"); break;
-      case SCHED_HRRN: printf("Highest Response Ratio Next\n"); break;
-      case SCHED_SPN: printf("Shortest Process Next\n"); break;
-      case SCHED_MLFQ: printf("Multi-Level Feedback Queue\n"); break;
+      case SCHED_FCFS: log_info("First-Come First-Served\n"); break;
+      case SCHED_ROUND_ROBIN: log_info("Round Robin\n"); break;
+      case SCHED_PRIORITY: log_info("Priority\n"); break;
+      case SCHED_SRT: log_info("Shortest Remaining Time\n"); break;
+      case SCHED_HRRN: log_info("Highest Response Ratio Next\n"); break;
+      case SCHED_SPN: log_info("Shortest Process Next\n"); break;
+      case SCHED_MLFQ: log_info("Multi-Level Feedback Queue\n"); break;
+      case SCHED_CFS: log_info("Completely Fair Scheduler\n"); break;
+      case SCHED_LOTTERY: log_info("Lottery\n"); break;
+      case SCHED_STRIDE: log_info("Stride\n"); break;
+      case SCHED_EDF: log_info("Earliest Deadline First\n"); break;
+      case SCHED_RM: log_info("Rate Monotonic\n"); break;
     }
-    printf("\n");
+    log_info("\n");
 
     scheduler(opts.scheduler);
   }
@@ -285,6 +381,24 @@ cleanup:
     opts.burst_estimates = NULL;
   }
 
+  free(opts.burst_given);
+  opts.burst_given = NULL;
+  free(opts.arrivals);
+  opts.arrivals = NULL;
+
+  free(opts.hard_affinity);
+  opts.hard_affinity = NULL;
+  free(opts.soft_affinity);
+  opts.soft_affinity = NULL;
+  free(opts.realtime);
+  opts.realtime = NULL;
+
+  // Program paths from workloads are owned by them
+  workload_free(opts.workload);
+  opts.workload = NULL;
+  workload_free(opts.generated);
+  opts.generated = NULL;
+
   if (perf_initialized) {
     free_performance_tracking();
     perf_initialized = false;
@@ -295,6 +409,9 @@ cleanup:
     memory_initialized = false;
   }
 
+  console_free();
+  keyboard_close();
+
   if (queues_initialized){
     free_queues();
     queues_initialized = false;
@@ -304,27 +421,185 @@ cleanup:
   return exit_code;
 }
 
-static void parse_args(int argc, char* argv[]){
-  if (argc < 2) {
-    print_usage(argv[0]);
-    exit(EXIT_FAILURE);
+// "0,2-3" -> bits 0, 2 and 3. Returns 0 on a malformed list.
+static uint64_t parse_cpu_list(const char *list) {
+  uint64_t mask = 0;
+  const char *p = list;
+  while (*p) {
+    char *end;
+    long first = strtol(p, &end, 10);
+    if (end == p || first < 0 || first >= MAX_CORES) return 0;
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = strtol(p + 1, &end, 10);
+      if (end == p + 1 || last < first || last >= MAX_CORES) return 0;
+      p = end;
+    }
+    for (long c = first; c <= last; c++) {
+      mask |= UINT64_C(1) << c;
+    }
+    if (*p == ',') p++;
+    else if (*p != '\0') return 0;
   }
+  return mask;
+}
 
-  opts.program_files = malloc(sizeof(char*) * argc);
-  opts.priorities = malloc(sizeof(int) * argc);
-  opts.burst_estimates = malloc(sizeof(int) * argc);
-  
-  if (!opts.program_files || !opts.priorities || !opts.burst_estimates) {
+static void *grow_option(void *array, int capacity, size_t size) {
+  void *grown = realloc(array, (size_t)capacity * size);
+  if (!grown) {
     fprintf(stderr, "Memory allocation failed during argument parsing\n");
     exit(EXIT_FAILURE);
   }
+  return grown;
+}
+
+// Append a program to run. Negative burst or priority keeps the defaults.
+static void add_program(const char *file, int arrival, int burst, int priority,
+                        uint64_t hard_affinity, uint64_t soft_affinity,
+                        RealTimeParams realtime) {
+  if (opts.program_count == opts.program_capacity) {
+    int capacity = opts.program_capacity ? opts.program_capacity * 2 : 16;
+    opts.program_files = grow_option(opts.program_files, capacity, sizeof(char*));
+    opts.priorities = grow_option(opts.priorities, capacity, sizeof(int));
+    opts.burst_estimates = grow_option(opts.burst_estimates, capacity, sizeof(int));
+    opts.burst_given = grow_option(opts.burst_given, capacity, sizeof(bool));
+    opts.arrivals = grow_option(opts.arrivals, capacity, sizeof(int));
+    opts.hard_affinity = grow_option(opts.hard_affinity, capacity, sizeof(uint64_t));
+    opts.soft_affinity = grow_option(opts.soft_affinity, capacity, sizeof(uint64_t));
+    opts.realtime = grow_option(opts.realtime, capacity, sizeof(RealTimeParams));
+    opts.program_capacity = capacity;
+  }
+
+  int n = opts.program_count++;
+  opts.program_files[n] = file;
+  opts.priorities[n] = (priority >= 0) ? priority : n + 1;
+  opts.burst_estimates[n] = (burst >= 0) ? burst : 50 + (n * 25);
+  opts.burst_given[n] = (burst >= 0);
+  opts.arrivals[n] = arrival;
+  opts.hard_affinity[n] = hard_affinity;
+  opts.soft_affinity[n] = soft_affinity;
+  opts.realtime[n] = realtime;
+}
+
+// Real-time parameters must describe a task that can meet its deadline
+// on an idle CPU
+static void check_realtime(const char *program, RealTimeParams rt) {
+  if (rt.period == 0 && (rt.deadline > 0 || rt.wcet > 0)) {
+    fprintf(stderr, "%s: a deadline and WCET need a period\n", program);
+    exit(EXIT_FAILURE);
+  }
+  if (rt.period > 0) {
+    int deadline = rt.deadline > 0 ? rt.deadline : rt.period;
+    if (rt.wcet == 0 || deadline > rt.period || rt.wcet > deadline) {
+      fprintf(stderr, "%s: need 0 < wcet <= deadline <= period\n", program);
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+static void add_workload(const Workload *workload) {
+  for (int i = 0; i < workload->count; i++) {
+    const WorkloadEntry *e = &workload->entries[i];
+    RealTimeParams realtime = { e->period, e->deadline, e->wcet };
+    check_realtime(e->program, realtime);
+    add_program(e->program, e->arrival, e->burst, e->priority, 0, 0, realtime);
+  }
+}
+
+static const char *option_value(int argc, char *argv[], int *i, const char *expected) {
+  if (*i + 1 >= argc) {
+    fprintf(stderr, "%s requires %s\n", argv[*i], expected);
+    exit(EXIT_FAILURE);
+  }
+  return argv[++*i];
+}
+
+// "2,4,8" -> one quantum per MLFQ level, top first. Returns the number
+// of levels, 0 on a malformed list.
+static int parse_quanta(const char *list, int *quanta) {
+  int levels = 0;
+  const char *p = list;
+  while (*p) {
+    char *end;
+    long quantum = strtol(p, &end, 10);
+    if (end == p || quantum < 1 || quantum > INT32_MAX || levels == MLFQ_MAX_LEVELS) return 0;
+    quanta[levels++] = (int)quantum;
+    p = end;
+    if (*p == ',') p++;
+    else if (*p != '\0') return 0;
+  }
+  return levels;
+}
+
+static int option_int(int argc, char *argv[], int *i, int min) {
+  const char *name = argv[*i];
+  const char *value = option_value(argc, argv, i, "a number");
+  char *end;
+  long v = strtol(value, &end, 10);
+  if (end == value || *end != '\0' || v < min || v > INT32_MAX) {
+    fprintf(stderr, "Invalid value for %s: %s\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  return (int)v;
+}
+
+// Bytes, with an optional K or M suffix
+static size_t option_size(int argc, char *argv[], int *i) {
+  const char *name = argv[*i];
+  const char *value = option_value(argc, argv, i, "a size (e.g. 512K)");
+  char *end;
+  long long v = strtoll(value, &end, 10);
+  size_t unit = 1;
+  if (*end == 'K' || *end == 'k') {
+    unit = 1024;
+    end++;
+  } else if (*end == 'M' || *end == 'm') {
+    unit = 1024 * 1024;
+    end++;
+  }
+  if (end == value || *end != '\0' || v < 0 || (unsigned long long)v > SIZE_MAX / unit) {
+    fprintf(stderr, "Invalid value for %s: %s\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  return (size_t)v * unit;
+}
+
+// "exp:100" -> exponential bursts with mean 100
+static void option_burst(int argc, char *argv[], int *i, BurstSpec *spec) {
+  const char *name = argv[*i];
+  const char *value = option_value(argc, argv, i, "<fixed|uniform|exp|pareto>:<mean>");
+  const char *colon = strchr(value, ':');
+  char shape[32];
+  char *end;
+  long mean = colon ? strtol(colon + 1, &end, 10) : -1;
+  if (!colon || (size_t)(colon - value) >= sizeof(shape) ||
+      end == colon + 1 || *end != '\0' || mean < 0 || mean > INT32_MAX / 2) {
+    fprintf(stderr, "Invalid value for %s: %s\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  snprintf(shape, sizeof(shape), "%.*s", (int)(colon - value), value);
+  if (!workload_parse_burst(shape, &spec->shape)) {
+    fprintf(stderr, "Unknown burst distribution for %s: %s\n", name, shape);
+    exit(EXIT_FAILURE);
+  }
+  spec->mean = (int)mean;
+}
 
-  // Default values for each program
-  for (int i = 0; i < argc; i++) {
-    opts.priorities[i] = 5;
-    opts.burst_estimates[i] = 100;
+static void parse_args(int argc, char* argv[]){
+  if (argc < 2) {
+    print_usage(argv[0]);
+    exit(EXIT_FAILURE);
   }
 
+  workload_defaults(&opts.generator);
+  const char *workload_file = NULL;
+  uint64_t pending_hard = 0;
+  uint64_t pending_soft = 0;
+  int pending_arrival = 0;
+  RealTimeParams pending_rt = {0};
+  const char *pending_input = NULL;
+
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "--write-through") == 0) {
       opts.cache_policy = CACHE_WRITE_THROUGH;
@@ -353,6 +628,158 @@ static void parse_args(int argc, char* argv[]){
     else if (strcmp(argv[i], "--mlfq") == 0) {
       opts.scheduler = SCHED_MLFQ;
     }
+    else if (strcmp(argv[i], "--cfs") == 0) {
+      opts.scheduler = SCHED_CFS;
+    }
+    else if (strcmp(argv[i], "--lottery") == 0) {
+      opts.scheduler = SCHED_LOTTERY;
+    }
+    else if (strcmp(argv[i], "--stride") == 0) {
+      opts.scheduler = SCHED_STRIDE;
+    }
+    else if (strcmp(argv[i], "--edf") == 0) {
+      opts.scheduler = SCHED_EDF;
+    }
+    else if (strcmp(argv[i], "--rm") == 0) {
+      opts.scheduler = SCHED_RM;
+    }
+    else if (strcmp(argv[i], "--lottery-seed") == 0) {
+      opts.lottery_seed = (uint64_t)option_int(argc, argv, &i, 0);
+    }
+    else if (strcmp(argv[i], "--mlfq-quanta") == 0) {
+      const char *list = option_value(argc, argv, &i, "a list of quanta (e.g. 2,4,8)");
+      opts.mlfq_levels = parse_quanta(list, opts.mlfq_quanta);
+      if (opts.mlfq_levels == 0) {
+        fprintf(stderr, "Invalid quanta for --mlfq-quanta: %s (at most %d levels)\n",
+                list, MLFQ_MAX_LEVELS);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if (strcmp(argv[i], "--mlfq-boost") == 0) {
+      opts.mlfq_boost = option_int(argc, argv, &i, 0);
+    }
+    else if (strcmp(argv[i], "--cfs-latency") == 0) {
+      opts.cfs_latency = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--cfs-granularity") == 0) {
+      opts.cfs_granularity = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--cores") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "--cores requires a count or 'auto'\n");
+        exit(EXIT_FAILURE);
+      }
+      const char *count = argv[++i];
+      opts.cores = (strcmp(count, "auto") == 0)
+                 ? (int)sysconf(_SC_NPROCESSORS_ONLN)
+                 : atoi(count);
+      if (opts.cores < 1) {
+        opts.cores = 1;
+      }
+      if (opts.cores > MAX_CORES) {
+        fprintf(stderr, "Warning: %d CPUs requested, limiting to %d\n", opts.cores, MAX_CORES);
+        opts.cores = MAX_CORES;
+      }
+    }
+    else if (strcmp(argv[i], "--affinity") == 0) {
+      opts.affinity = true;
+    }
+    else if (strcmp(argv[i], "--hard-affinity") == 0 ||
+             strcmp(argv[i], "--soft-affinity") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "%s requires a CPU list (e.g. 0,2-3)\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      uint64_t mask = parse_cpu_list(argv[i + 1]);
+      if (mask == 0) {
+        fprintf(stderr, "Invalid CPU list for %s: %s\n", argv[i], argv[i + 1]);
+        exit(EXIT_FAILURE);
+      }
+      // Applies to the next program on the command line
+      if (argv[i][2] == 'h') {
+        pending_hard = mask;
+      } else {
+        pending_soft = mask;
+      }
+      i++;
+    }
+    else if (strcmp(argv[i], "--quiet") == 0) {
+      set_log_level(LOG_QUIET);
+    }
+    else if (strcmp(argv[i], "--log-level") == 0) {
+      const char *name = option_value(argc, argv, &i, "quiet, info, debug or trace");
+      LogLevel level;
+      if (!parse_log_level(name, &level)) {
+        fprintf(stderr, "Unknown log level: %s\n", name);
+        exit(EXIT_FAILURE);
+      }
+      set_log_level(level);
+    }
+    else if (strcmp(argv[i], "--ticks-per-ms") == 0) {
+      opts.ticks_per_ms = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--pace") == 0) {
+      opts.paced = true;
+    }
+    else if (strcmp(argv[i], "--object-cache") == 0) {
+      opts.object_cache = option_value(argc, argv, &i, "a directory");
+    }
+    else if (strcmp(argv[i], "--no-object-cache") == 0) {
+      opts.object_cache = NULL;
+    }
+    else if (strcmp(argv[i], "--swap-watermark") == 0) {
+      opts.swap_watermark = option_size(argc, argv, &i);
+    }
+    else if (strcmp(argv[i], "--arrival") == 0) {
+      // Applies to the next program on the command line
+      pending_arrival = option_int(argc, argv, &i, 0);
+    }
+    else if (strcmp(argv[i], "--period") == 0) {
+      // The real-time options apply to the next program on the command line
+      pending_rt.period = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--deadline") == 0) {
+      pending_rt.deadline = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--wcet") == 0) {
+      pending_rt.wcet = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--input") == 0) {
+      // Keys for the next program on the command line
+      pending_input = option_value(argc, argv, &i, "an input file");
+    }
+    else if (strcmp(argv[i], "--workload") == 0) {
+      workload_file = option_value(argc, argv, &i, "a workload file");
+    }
+    else if (strcmp(argv[i], "--generate") == 0) {
+      opts.generate = true;
+      opts.generator.count = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--seed") == 0) {
+      opts.generator.seed = (uint64_t)option_int(argc, argv, &i, 0);
+    }
+    else if (strcmp(argv[i], "--arrivals") == 0) {
+      const char *pattern = option_value(argc, argv, &i, "poisson, bursty or heavy");
+      if (!workload_parse_arrivals(pattern, &opts.generator.arrivals)) {
+        fprintf(stderr, "Unknown arrival pattern: %s\n", pattern);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if (strcmp(argv[i], "--mean-gap") == 0) {
+      opts.generator.mean_gap = option_int(argc, argv, &i, 0);
+    }
+    else if (strcmp(argv[i], "--cpu-burst") == 0) {
+      option_burst(argc, argv, &i, &opts.generator.cpu);
+    }
+    else if (strcmp(argv[i], "--io-burst") == 0) {
+      option_burst(argc, argv, &i, &opts.generator.io);
+    }
+    else if (strcmp(argv[i], "--phases") == 0) {
+      opts.generator.phases = option_int(argc, argv, &i, 1);
+    }
+    else if (strcmp(argv[i], "--gen-dir") == 0) {
+      opts.generate_dir = option_value(argc, argv, &i, "a directory");
+    }
     else if (strcmp(argv[i], "--compare-all") == 0) {
       opts.compare_all_algorithms = true;
     }
@@ -372,11 +799,36 @@ static void parse_args(int argc, char* argv[]){
       exit(EXIT_FAILURE);
     }
     else {
-      opts.program_files[opts.program_count] = argv[i];
-      opts.priorities[opts.program_count] = opts.program_count + 1;
-      opts.burst_estimates[opts.program_count] = 50 + (opts.program_count * 25);
-      opts.program_count++;
+      check_realtime(argv[i], pending_rt);
+      // Its pid is its index in the program list
+      if (pending_input && !keyboard_script(opts.program_count, pending_input)) {
+        perror(pending_input);
+        exit(EXIT_FAILURE);
+      }
+      add_program(argv[i], pending_arrival, -1, -1, pending_hard, pending_soft, pending_rt);
+      pending_input = NULL;
+      pending_hard = pending_soft = 0;
+      pending_arrival = 0;
+      pending_rt = (RealTimeParams){0};
+    }
+  }
+
+  if (workload_file) {
+    opts.workload = workload_load(workload_file);
+    if (!opts.workload) {
+      exit(EXIT_FAILURE);
     }
+    add_workload(opts.workload);
+  }
+
+  if (opts.generate) {
+    opts.generated = workload_generate(&opts.generator);
+    if (!workload_write(opts.generated, opts.generate_dir)) {
+      exit(EXIT_FAILURE);
+    }
+    printf("Generated %d processes (seed %llu), replay with --workload %s/workload.txt\n",
+           opts.generated->count, (unsigned long long)opts.generator.seed, opts.generate_dir);
+    add_workload(opts.generated);
   }
 
   if (opts.program_count == 0) {
@@ -384,12 +836,6 @@ static void parse_args(int argc, char* argv[]){
     print_usage(argv[0]);
     exit(EXIT_FAILURE);
   }
-
-  if (opts.program_count > MAX_PROGRAMS) {
-    fprintf(stderr, "Warning: Too many programs (%d), limiting to %d\n", 
-        opts.program_count, MAX_PROGRAMS);
-    opts.program_count = MAX_PROGRAMS;
-  }
 }
 
 static void print_usage(const char *prog_name) {
@@ -407,6 +853,73 @@ static void print_usage(const char *prog_name) {
   printf("    --hrrn                Highest Response Ratio Next scheduling\n");
   printf("    --spn                 Shortest Process Next scheduling\n");
   printf("    --mlfq                Multi-Level Feedback Queue scheduling\n");
+  printf("    --mlfq-quanta <list>  MLFQ quantum of each level, top first; one\n");
+  printf("                          level per entry (default 2,4,8)\n");
+  printf("    --mlfq-boost <t>      Move every process back to the top level every\n");
+  printf("                          t ticks, 0 never (default 100)\n");
+  printf("    --cfs                 Completely Fair Scheduler (virtual runtime)\n");
+  printf("    --cfs-latency <t>     CFS target latency: every ready process runs\n");
+  printf("                          within t ticks (default 24)\n");
+  printf("    --cfs-granularity <t> CFS minimum slice (default 3)\n");
+  printf("    --lottery             Lottery scheduling, tickets from priority\n");
+  printf("    --stride              Stride scheduling, tickets from priority\n");
+  printf("    --lottery-seed <s>    Seed for the lottery draws (default 1)\n");
+  printf("    --edf                 Earliest Deadline First (real-time)\n");
+  printf("    --rm                  Rate Monotonic (real-time)\n");
+  printf("\n");
+  printf("  Multiprocessing:\n");
+  printf("    --cores <n|auto>      Run on n simulated CPUs, one host thread each\n");
+  printf("                          (FCFS and Round Robin; default 1)\n");
+  printf("    --affinity            Keep processes on the CPU whose L1 is warm\n");
+  printf("                          (with --compare-all, also runs the blind baseline)\n");
+  printf("    --hard-affinity <cpus> Next program may only run on these CPUs (e.g. 0,2-3)\n");
+  printf("    --soft-affinity <cpus> Next program prefers these CPUs\n");
+  printf("\n");
+  printf("  Clock:\n");
+  printf("    --ticks-per-ms <n>    Instructions per simulated millisecond, as sleep_ms\n");
+  printf("                          and get_time_ms count them (default 1)\n");
+  printf("    --pace                Keep the simulated clock from running ahead of the\n");
+  printf("                          real one, for playing the interactive programs\n");
+  printf("\n");
+  printf("  Memory:\n");
+  printf("    --swap-watermark <size> Suspend processes to swap while free RAM (of 128M)\n");
+  printf("                          is below size, e.g. 131040K (default 0, never)\n");
+  printf("\n");
+  printf("  Real-Time (EDF and RM):\n");
+  printf("    --period <t>          Next program is a periodic task releasing a job\n");
+  printf("                          every t ticks from its arrival\n");
+  printf("    --deadline <t>        Its jobs' relative deadline (default the period)\n");
+  printf("    --wcet <t>            Its jobs' worst-case CPU time; a job also ends\n");
+  printf("                          when it blocks, e.g. to sleep until the next frame\n");
+  printf("\n");
+  printf("  Workloads:\n");
+  printf("    --arrival <t>         Next program arrives at simulated time t (default 0)\n");
+  printf("    --input <file>        Next program reads its keys from file instead of the\n");
+  printf("                          terminal, one per read_char_nb, so it runs headless\n");
+  printf("    --workload <file>     Run the programs listed in a workload file, one per\n");
+  printf("                          line: program [arrival [burst [priority\n");
+  printf("                          [period deadline wcet]]]]\n");
+  printf("    --generate <n>        Generate n synthetic processes, written to --gen-dir\n");
+  printf("                          as .asm programs plus a replayable workload.txt\n");
+  printf("    --seed <s>            Generator seed (default 1)\n");
+  printf("    --arrivals <pattern>  poisson (default), bursty or heavy\n");
+  printf("    --mean-gap <t>        Mean time between arrivals (default 50)\n");
+  printf("    --cpu-burst <d>:<m>   CPU burst distribution: fixed, uniform, exp or pareto\n");
+  printf("                          with mean m (default exp:100)\n");
+  printf("    --io-burst <d>:<m>    I/O burst (sleep) between CPU bursts (default none)\n");
+  printf("    --phases <n>          CPU bursts per generated process (default 1)\n");
+  printf("    --gen-dir <dir>       Where generated files go (default generated)\n");
+  printf("\n");
+  printf("  Assembly:\n");
+  printf("    --object-cache <dir>  Keep assembled objects here, keyed by a hash of the\n");
+  printf("                          source, and load unchanged programs from it\n");
+  printf("                          without assembling (default .objcache)\n");
+  printf("    --no-object-cache     Assemble every program from source\n");
+  printf("\n");
+  printf("  Output:\n");
+  printf("    --quiet               Print only the results and what the programs print\n");
+  printf("    --log-level <level>   quiet, info (setup), debug (every scheduling and\n");
+  printf("                          memory event, default) or trace (CPU state)\n");
   printf("\n");
   printf("  Performance Analysis:\n");
   printf("    --compare-all         Run all scheduling algorithms and compare\n");
@@ -422,6 +935,15 @@ static void print_usage(const char *prog_name) {
   printf("  # Compare with CSV export:\n");
   printf("  %s --compare-all --export-csv results.csv programs/*.asm\n", prog_name);
   printf("\n");
+  printf("  # Round Robin across every host core:\n");
+  printf("  %s --cores auto --round-robin programs/*.asm\n", prog_name);
+  printf("\n");
+  printf("  # Affinity-aware vs blind Round Robin on 4 CPUs:\n");
+  printf("  %s --cores 4 --affinity --compare-all programs/*.asm\n", prog_name);
+  printf("\n");
+  printf("  # Compare all algorithms on 200 bursty, heavy-tailed arrivals:\n");
+  printf("  %s --compare-all --generate 200 --arrivals bursty --cpu-burst pareto:80\n", prog_name);
+  printf("\n");
   printf("  # Run specific algorithm with write-back cache:\n");
   printf("  %s --write-back --fcfs prog1.asm prog2.asm\n", prog_name);
 }
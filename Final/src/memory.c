@@ -1,5 +1,8 @@
 // TODO add security measures to stop execution when check access fails
 #include "../include/memory.h"
+#include "../include/cpu.h"
+#include "../include/log.h"
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -13,13 +16,22 @@
 #define RAM_SIZE 128 * 1024 * 1024
 #define SSD_SIZE 256 * 1024 * 1024
 #define HDD_SIZE 512 * 1024 * 1024
-#define MAX_MEM_BLOCKS 500
+#define INITIAL_MEM_BLOCKS 500
+#define INITIAL_SWAP_SLOTS 64
 #define MEMBLOCK(id) (MEMORY_TABLE.blocks[id])
+#define L1 (L1_CACHES[current_core])
 
 #define EMPTY_ADDR -1
 #define NO_PID -1
 #define NO_VAL ((uint8_t)-1)
 
+// Simulated time a swap transfer takes: the device's access latency plus
+// the bytes at its bandwidth
+#define SSD_SWAP_LATENCY 25
+#define SSD_BYTES_PER_TICK 512
+#define HDD_SWAP_LATENCY 400
+#define HDD_BYTES_PER_TICK 128
+
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================= INTERNAL STRUCTS ========================================= */
 
@@ -76,6 +88,26 @@ typedef struct {
   size_t capacity;
 } MemoryTable;
 
+/*
+ * A block of a suspended process, parked on a swap
+ * device. It goes back to the same RAM addresses,
+ * since the program was assembled against them
+ */
+typedef struct {
+  int pid;
+  uint32_t start_addr;
+  uint32_t end_addr;
+  SwapDevice device;
+  size_t offset; // Where the block starts on the device
+} SwapSlot;
+
+// Every block currently swapped out
+typedef struct {
+  SwapSlot *slots;
+  size_t count;
+  size_t capacity;
+} SwapTable;
+
 
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================= FWD DECLARATIONS ========================================= */
@@ -95,6 +127,9 @@ uint16_t read_hword(uint32_t addr);
 // return the word at the iven memory adress
 uint32_t read_word(uint32_t addr);
 
+// copy the string at the given memory adress into a buffer
+size_t read_string(uint32_t addr, char *buf, size_t max);
+
 // write one byte of data to the given memory adress
 void write_byte(uint32_t addr, uint8_t data);
 
@@ -104,6 +139,9 @@ void write_hword(uint32_t addr, uint16_t data);
 // write one word of data (4 bytes) to the given memory adress
 void write_word(uint32_t addr, uint32_t data);
 
+// copy a block of bytes straight into RAM
+bool write_block(uint32_t addr, const void *src, size_t len);
+
 // print the number of cache hits & misses
 void print_cache_stats(void);
 
@@ -116,6 +154,12 @@ void liberate(int pid);
 // the process with access rights
 void set_current_process(int pid);
 
+// number of cores sharing the memory system
+void set_core_count(int cores);
+
+// the core whose L1 the calling thread uses
+void set_current_core(int core);
+
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================= GLOBAL VARIABLES ========================================= */
 
@@ -123,9 +167,12 @@ void set_current_process(int pid);
 static unsigned long L1cache_hit = 0, L1cache_miss = 0;
 static unsigned long L2cache_hit = 0, L2cache_miss = 0;
 static unsigned long write_backs = 0;
+// the same counters, attributed to the process that caused them, indexed by pid
+static CacheCounters *PID_CACHE_STATS = NULL;
+static size_t pid_stats_capacity = 0;
 
-// L1 cache
-static Cache L1;
+// L1 caches, one private cache per core
+static Cache L1_CACHES[MAX_CORES];
 // L2 cache
 static Cache L2;
 // RAM
@@ -136,8 +183,16 @@ static uint8_t *HDD = NULL;
 static uint8_t *SSD = NULL;
 // Memory Table
 static MemoryTable MEMORY_TABLE = {0};
-// Current process with memory acess rights
-static int current_process_id = -1;
+// Blocks swapped out to the SSD and HDD
+static SwapTable SWAP_TABLE = {0};
+// Current process with memory acess rights (per core)
+static _Thread_local int current_process_id = -1;
+// Core driven by the calling thread
+static _Thread_local int current_core = 0;
+// Number of cores that share L2 and RAM
+static int core_count = 1;
+// Serializes the shared hierarchy once more than one core is running
+static pthread_mutex_t memory_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static CachePolicy cache_policy_type = CACHE_WRITE_THROUGH;
 static bool freeze_liberate = false;
@@ -145,10 +200,49 @@ static bool freeze_liberate = false;
 /* ---------------------------------------------------------------------------------------------------- */
 /* ========================================== UTILITY FUNCTS ========================================== */
 
+// Grow the per-pid counters so `pid` has a slot (memory lock held)
+static void reserve_pid_stats(size_t pid) {
+  size_t capacity = pid_stats_capacity ? pid_stats_capacity : 64;
+  while (capacity <= pid) {
+    capacity *= 2;
+  }
+  CacheCounters *grown = realloc(PID_CACHE_STATS, capacity * sizeof(CacheCounters));
+  if (!grown) {
+    perror("realloc pid cache stats");
+    exit(EXIT_FAILURE);
+  }
+  memset(grown + pid_stats_capacity, 0,
+         (capacity - pid_stats_capacity) * sizeof(CacheCounters));
+  PID_CACHE_STATS = grown;
+  pid_stats_capacity = capacity;
+}
+
+// Counters for the running process, NULL for the system
+static inline CacheCounters *pid_stats(void) {
+  if (current_process_id < 0) {
+    return NULL;
+  }
+  if ((size_t)current_process_id >= pid_stats_capacity) {
+    reserve_pid_stats((size_t)current_process_id);
+  }
+  return &PID_CACHE_STATS[current_process_id];
+}
+
 static inline uint32_t line_base(const uint32_t addr) {
   return addr & ~(CACHE_LINE_SIZE - 1u);
 }
 
+// Only pay for the lock when another core can actually race us
+static inline void lock_memory(void) {
+  if (core_count > 1)
+    pthread_mutex_lock(&memory_lock);
+}
+
+static inline void unlock_memory(void) {
+  if (core_count > 1)
+    pthread_mutex_unlock(&memory_lock);
+}
+
 static bool in_bounds(const uint32_t base, const size_t size) {
   if (base > RAM_SIZE)
     return false;
@@ -169,6 +263,17 @@ static int find_line(const Cache *cache, const uint32_t base) {
   return EMPTY_ADDR;
 }
 
+// Keep the other cores' private L1 copies coherent (write-update snooping)
+static void update_peer_lines(const uint32_t base, const uint32_t addr, const uint8_t value) {
+  for (int c = 0; c < core_count; c++) {
+    if (c == current_core)
+      continue;
+    int idx = find_line(&L1_CACHES[c], base);
+    if (idx >= 0)
+      L1_CACHES[c].lines[idx].data[addr - base] = value;
+  }
+}
+
 // Load a line from RAM into the cache
 // Return the index used
 static int load_line(Cache *cache, const uint32_t base) {
@@ -208,9 +313,11 @@ static void evict_line(Cache *cache, size_t index) {
   }
 }
 
-static bool check_access(uint32_t addr) {
+// One past the last address of the accessible region holding addr, 0
+// if the current process may not touch addr at all
+static uint64_t accessible_end(uint32_t addr) {
   if (current_process_id == SYSTEM_PROCESS_ID) {
-    return true; // System/kernel mode - allow all access
+    return RAM_SIZE; // System/kernel mode - allow all access
   }
   
   bool valid_id = false;
@@ -222,60 +329,47 @@ static bool check_access(uint32_t addr) {
 
     valid_id = true;
     if (!b->is_free && addr >= b->start_addr && addr <= b->end_addr) {
-      return true;
+      return (uint64_t)b->end_addr + 1;
     }
   }
 
   if (!valid_id){
     fprintf(stderr, "Pocess read/write access: Invalid process id\n");
-    return false;
-  }
-
-  // Also check if address is in process's TEXT/DATA segments
-  // Process 0: TEXT_BASE (0x00400000) to TEXT_BASE + 0x00100000
-  // Process N: TEXT_BASE + (N * 0x00100000)
-  // 1MB per process
-  uint32_t process_text_start =
-      TEXT_BASE + (current_process_id * MAX_PROCESS_SIZE);
-  uint32_t process_text_end = process_text_start + MAX_PROCESS_SIZE;
-  if (addr >= process_text_start && addr < process_text_end) {
-    return true;
-  }
-
-  uint32_t process_data_start =
-      DATA_BASE + (current_process_id * MAX_PROCESS_SIZE);
-  uint32_t process_data_end = process_data_start + MAX_PROCESS_SIZE;
-  if (addr >= process_data_start && addr < process_data_end) {
-    return true;
+    return 0;
   }
 
-  // Data pushed to the stack is accessible to all procsses
-  uint32_t process_stack_base = STACK_TOP - ((current_process_id + 1) * MAX_PROCESS_SIZE);
-  uint32_t process_stack_top = STACK_TOP - (current_process_id * MAX_PROCESS_SIZE);
-  if (addr >= process_stack_base && addr < process_stack_top) {
-    return true;
-  }
+  // Text, data and stack are all blocks the loader allocated to the
+  // process, so ownership is the whole check. Windows derived from the
+  // pid would land in RAM other processes were given, and wrap for
+  // large pids.
+  return 0;
+}
 
-  return false;
+static bool check_access(uint32_t addr) {
+  return accessible_end(addr) > addr;
 }
 
 static uint8_t read_byte_no_check(uint32_t addr){
 
   uint32_t base = line_base(addr);
   int idx = EMPTY_ADDR;
+  CacheCounters *stats = pid_stats();
 
   // L1 Cache
   idx = find_line(&L1, base);
   if (idx != EMPTY_ADDR) {
     L1cache_hit++;
+    if (stats) stats->l1_hits++;
     return L1.lines[idx].data[addr - base];
   }
   L1cache_miss++;
+  if (stats) stats->l1_misses++;
 
   // L2 cache
   idx = find_line(&L2, base);
   if (idx != EMPTY_ADDR) {
     L2cache_hit++;
+    if (stats) stats->l2_hits++;
     // Copy to L1
     int l1_idx;
     if (L1.count < L1.line_count) {
@@ -294,6 +388,7 @@ static uint8_t read_byte_no_check(uint32_t addr){
     return L1.lines[l1_idx].data[addr - base];
   }
   L2cache_miss++;
+  if (stats) stats->l2_misses++;
 
   // Complete miss
   load_line(&L2, base);
@@ -313,6 +408,7 @@ static void write_through_no_check (uint32_t addr, uint8_t value){
   if (idx >= 0) {
     L1.lines[idx].data[addr - base] = value;
   }
+  update_peer_lines(base, addr, value);
 
   // Update L2 if present
   idx = find_line(&L2, base);
@@ -325,6 +421,8 @@ static void write_back_no_check(uint32_t addr, uint8_t value) {
   uint32_t base = line_base(addr);
   int idx;
 
+  update_peer_lines(base, addr, value);
+
   // L1 Cache
   idx = find_line(&L1, base);
   if (idx >= 0) {
@@ -435,9 +533,9 @@ static void init_cache(Cache *cache, const size_t size) {
     exit(EXIT_FAILURE);
   }
 
-  printf("Initialized cache at -> '%p' <- with | %lu | bytes, and | %lu | "
-         "lines [Line Size = %d]\n",
-         (void *)cache, size, cache->line_count, CACHE_LINE_SIZE);
+  log_info("Initialized cache at -> '%p' <- with | %lu | bytes, and | %lu | "
+           "lines [Line Size = %d]\n",
+           (void *)cache, size, cache->line_count, CACHE_LINE_SIZE);
 }
 
 // Initialize the memory table with one block of the entire memory space
@@ -458,14 +556,18 @@ static void init_memtab(const int num_blocks) {
 
 void init_memory(const CachePolicy policy) {
   cache_policy_type = policy;
+  core_count = 1;
   init_ram(RAM_SIZE);
   init_ssd(SSD_SIZE);
   init_hdd(HDD_SIZE);
-  init_cache(&L1, L1CACHE_SIZE);
+  init_cache(&L1_CACHES[0], L1CACHE_SIZE);
   init_cache(&L2, L2CACHE_SIZE);
-  init_memtab(MAX_MEM_BLOCKS);
-  printf("Memory initialized with %s cache policy\n",
-      policy == CACHE_WRITE_THROUGH ? "write-through" : "write-back");
+  init_memtab(INITIAL_MEM_BLOCKS);
+  if (PID_CACHE_STATS) {
+    memset(PID_CACHE_STATS, 0, pid_stats_capacity * sizeof(CacheCounters));
+  }
+  log_info("Memory initialized with %s cache policy\n",
+        policy == CACHE_WRITE_THROUGH ? "write-through" : "write-back");
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -484,11 +586,20 @@ void free_memory(void) {
   SSD = NULL;
   free(HDD);
   HDD = NULL;
-  free_cache(&L1);
+  for (int c = 0; c < MAX_CORES; c++) {
+    free_cache(&L1_CACHES[c]);
+  }
+  core_count = 1;
   free_cache(&L2);
   free(MEMORY_TABLE.blocks);
   MEMORY_TABLE.blocks = NULL;
   MEMORY_TABLE.block_count = MEMORY_TABLE.capacity = 0;
+  free(SWAP_TABLE.slots);
+  SWAP_TABLE.slots = NULL;
+  SWAP_TABLE.count = SWAP_TABLE.capacity = 0;
+  free(PID_CACHE_STATS);
+  PID_CACHE_STATS = NULL;
+  pid_stats_capacity = 0;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -496,12 +607,53 @@ void free_memory(void) {
 
 void set_current_process(const int pid) { current_process_id = pid; }
 
+void set_current_core(const int core) {
+  if (core < 0 || core >= core_count) {
+    fprintf(stderr, "set_current_core: core %d out of range\n", core);
+    return;
+  }
+  current_core = core;
+}
+
+void set_core_count(const int cores) {
+  if (cores < 1 || cores > MAX_CORES) {
+    fprintf(stderr, "set_core_count: %d cores not supported (max %d)\n",
+            cores, MAX_CORES);
+    return;
+  }
+  // Give every new core its own private L1
+  for (int c = 0; c < cores; c++) {
+    if (!L1_CACHES[c].lines) {
+      init_cache(&L1_CACHES[c], L1CACHE_SIZE);
+    }
+  }
+  core_count = cores;
+}
+
 void set_memory_freeze(bool freeze) { freeze_liberate = freeze; }
 
+static void invalidate_cache(Cache *c) {
+  for (size_t i = 0; i < c->line_count; i++) {
+    evict_line(c, i);
+    c->lines[i].is_valid = false;
+  }
+  c->front = c->count = 0;
+}
+
+void flush_caches(void) {
+  lock_memory();
+  // L2 first so a newer dirty copy in an L1 lands in RAM last
+  invalidate_cache(&L2);
+  for (int c = 0; c < MAX_CORES; c++) {
+    invalidate_cache(&L1_CACHES[c]);
+  }
+  unlock_memory();
+}
+
 // Reads a single byte
 // Uses the cache hierarchy
 // Updates cache along the way
-uint8_t read_byte(uint32_t addr) {
+static uint8_t read_byte_locked(uint32_t addr) {
   if (!in_bounds(addr, 1)) {
     fprintf(stderr, "read [byte]: out of bounds addr=0x%08x\n", addr);
     return 0;
@@ -518,7 +670,7 @@ uint8_t read_byte(uint32_t addr) {
 }
 
 // So called syntax sugar
-uint16_t read_hword(uint32_t addr) {
+static uint16_t read_hword_locked(uint32_t addr) {
   if (!in_bounds(addr, 2)) {
     fprintf(stderr, "read [hword]: out of bounds addr=0x%08x\n", addr);
     return 0;
@@ -536,7 +688,7 @@ uint16_t read_hword(uint32_t addr) {
   return (uint16_t)(b0 | (b1 << 8));
 }
 
-uint32_t read_word(uint32_t addr) {
+static uint32_t read_word_locked(uint32_t addr) {
   if (!in_bounds(addr, 4)) {
     fprintf(stderr, "read [word]: out of bounds addr=0x%08x\n", addr);
     return 0;
@@ -557,7 +709,7 @@ uint32_t read_word(uint32_t addr) {
   return v;
 }
 
-void write_byte(uint32_t addr, uint8_t value) {
+static void write_byte_locked(uint32_t addr, uint8_t value) {
   if (!in_bounds(addr, 1)) {
     fprintf(stderr, "write [byte]: out of bounds addr=0x%08x\n", addr);
     return;
@@ -573,7 +725,7 @@ void write_byte(uint32_t addr, uint8_t value) {
   (cache_policy_type == CACHE_WRITE_THROUGH) ? write_through_no_check(addr, value) : write_back_no_check(addr, value);
 }
 
-void write_hword(uint32_t addr, uint16_t data) {
+static void write_hword_locked(uint32_t addr, uint16_t data) {
   if (!in_bounds(addr, 2)) {
     fprintf(stderr, "write [hword]: out of bounds addr=0x%08x\n", addr);
     return;
@@ -598,7 +750,7 @@ void write_hword(uint32_t addr, uint16_t data) {
   }
 }
 
-void write_word(uint32_t addr, uint32_t data) {
+static void write_word_locked(uint32_t addr, uint32_t data) {
   if (!in_bounds(addr, 4)) {
     fprintf(stderr, "write [word]: out of bounds addr=0x%08x\n", addr);
     return;
@@ -627,8 +779,26 @@ void write_word(uint32_t addr, uint32_t data) {
   }
 }
 
+// Make sure the table can take `extra` more blocks, doubling it if not
+static void reserve_memtab(size_t extra) {
+  if (MEMORY_TABLE.block_count + extra <= MEMORY_TABLE.capacity) {
+    return;
+  }
+  size_t capacity = MEMORY_TABLE.capacity ? MEMORY_TABLE.capacity : INITIAL_MEM_BLOCKS;
+  while (capacity < MEMORY_TABLE.block_count + extra) {
+    capacity *= 2;
+  }
+  MemoryBlock *grown = realloc(MEMORY_TABLE.blocks, capacity * sizeof(MemoryBlock));
+  if (!grown) {
+    perror("realloc memory table blocks");
+    exit(EXIT_FAILURE);
+  }
+  MEMORY_TABLE.blocks = grown;
+  MEMORY_TABLE.capacity = capacity;
+}
+
 // Allocate memory for a specific process
-uint32_t mallocate(int pid, size_t size) {
+static uint32_t mallocate_locked(int pid, size_t size) {
   if (size > UINT32_MAX) {
     fprintf(stderr, "mallocate: size too large. [4GB limit]\n");
     return UINT32_MAX;
@@ -664,6 +834,9 @@ uint32_t mallocate(int pid, size_t size) {
     return UINT32_MAX;
   }
 
+  // Splitting adds at most a padding block and a remainder block
+  reserve_memtab(2);
+
   MemoryBlock *slot = &MEMBLOCK(best_idx);
   uint32_t old_start = slot->start_addr;
   uint32_t old_end = slot->end_addr;
@@ -688,15 +861,6 @@ uint32_t mallocate(int pid, size_t size) {
 
   // If we skipped some bytes to align, keep them as a tiny free block
   if (aligned_start > old_start) {
-    if (MEMORY_TABLE.block_count + 1 > MEMORY_TABLE.capacity) {
-      fprintf(stderr, "mallocate: memtable capacity reached\n");
-      /* rollback */
-      slot->pid = -1;
-      slot->is_free = true;
-      slot->start_addr = old_start;
-      slot->end_addr = old_end;
-      return UINT32_MAX;
-    }
     // Shift blocks right to make room
     for (size_t i = MEMORY_TABLE.block_count; i > best_idx; i--) {
       MEMBLOCK(i) = MEMBLOCK(i - 1);
@@ -713,17 +877,6 @@ uint32_t mallocate(int pid, size_t size) {
 
   // Create a new block behind the allocated block if there is space
   if (new_end < old_end) {
-    // Make sure there is enough space for a new free block
-    if (MEMORY_TABLE.block_count + 1 > MEMORY_TABLE.capacity) {
-      fprintf(stderr, "mallocate: memtable capacity reached\n");
-      /* rollback */
-      slot->pid = -1;
-      slot->is_free = true;
-      slot->start_addr = old_start;
-      slot->end_addr = old_end;
-      return UINT32_MAX;
-    }
-
     // Shift blocks right to make room
     for (size_t i = MEMORY_TABLE.block_count; i > best_idx + 1; i--) {
       MEMBLOCK(i) = MEMBLOCK(i - 1);
@@ -737,33 +890,15 @@ uint32_t mallocate(int pid, size_t size) {
     MEMORY_TABLE.block_count++;
   }
 
-  printf("mallocate: PID %d allocated %zu bytes [%u -> %u]\n", pid, size,
-         slot->start_addr, slot->end_addr);
+  log_debug("mallocate: PID %d allocated %zu bytes [%u -> %u]\n", pid, size,
+            slot->start_addr, slot->end_addr);
   return slot->start_addr;
 }
 
-// Free up the memory allocated by a specific process.
-void liberate(int pid) {
-  if (freeze_liberate) {
-    return;
-  }
-
-  size_t idx = SIZE_MAX;
-  for (size_t i = 0; i < MEMORY_TABLE.block_count; ++i) {
-    if (!MEMBLOCK(i).is_free && MEMBLOCK(i).pid == pid) {
-      idx = i;
-      break;
-    }
-  }
-  if (idx == SIZE_MAX) {
-    fprintf(stderr, "liberate: pid %d not found\n", pid);
-    return;
-  }
-
+// Give block idx back to the free pool, merging it with free neighbours
+static void free_block(size_t idx) {
   MEMBLOCK(idx).is_free = true;
   MEMBLOCK(idx).pid = -1;
-  printf("liberate: freed pid %d [%u -> %u]\n", pid, MEMBLOCK(idx).start_addr,
-         MEMBLOCK(idx).end_addr);
 
   // Merge block with the previous if it is free
   if (idx > 0 && MEMBLOCK(idx - 1).is_free) {
@@ -786,6 +921,376 @@ void liberate(int pid) {
   }
 }
 
+// First allocated block of pid, SIZE_MAX if it has none
+static size_t find_block(int pid) {
+  for (size_t i = 0; i < MEMORY_TABLE.block_count; ++i) {
+    if (!MEMBLOCK(i).is_free && MEMBLOCK(i).pid == pid) {
+      return i;
+    }
+  }
+  return SIZE_MAX;
+}
+
+// Free up the memory allocated by a specific process: its text, data
+// and stack blocks.
+static void liberate_locked(int pid) {
+  if (freeze_liberate) {
+    return;
+  }
+
+  size_t idx = find_block(pid);
+  if (idx == SIZE_MAX) {
+    fprintf(stderr, "liberate: pid %d not found\n", pid);
+    return;
+  }
+
+  do {
+    log_debug("liberate: freed pid %d [%u -> %u]\n", pid, MEMBLOCK(idx).start_addr,
+              MEMBLOCK(idx).end_addr);
+    free_block(idx);
+  } while ((idx = find_block(pid)) != SIZE_MAX);
+}
+
+// Take [start, end] out of the free block holding it, false if any of
+// it is allocated
+static bool claim_range(int pid, uint32_t start, uint32_t end) {
+  size_t idx = SIZE_MAX;
+  for (size_t i = 0; i < MEMORY_TABLE.block_count; ++i) {
+    MemoryBlock *b = &MEMBLOCK(i);
+    if (b->is_free && b->start_addr <= start && end <= b->end_addr) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx == SIZE_MAX) {
+    return false;
+  }
+
+  // The claimed range splits the free block in at most three
+  reserve_memtab(2);
+  MemoryBlock free_part = MEMBLOCK(idx);
+  size_t slot = idx;
+  if (free_part.start_addr < start) {
+    for (size_t i = MEMORY_TABLE.block_count; i > idx; i--) {
+      MEMBLOCK(i) = MEMBLOCK(i - 1);
+    }
+    MEMBLOCK(idx).end_addr = start - 1u;
+    MEMORY_TABLE.block_count++;
+    slot++;
+  }
+  if (end < free_part.end_addr) {
+    for (size_t i = MEMORY_TABLE.block_count; i > slot + 1; i--) {
+      MEMBLOCK(i) = MEMBLOCK(i - 1);
+    }
+    MEMBLOCK(slot + 1).pid = -1;
+    MEMBLOCK(slot + 1).is_free = true;
+    MEMBLOCK(slot + 1).start_addr = end + 1u;
+    MEMBLOCK(slot + 1).end_addr = free_part.end_addr;
+    MEMORY_TABLE.block_count++;
+  }
+  MEMBLOCK(slot).pid = pid;
+  MEMBLOCK(slot).is_free = false;
+  MEMBLOCK(slot).start_addr = start;
+  MEMBLOCK(slot).end_addr = end;
+  return true;
+}
+
+// Write back and drop every cached line overlapping [start, end], so
+// RAM holds the latest copy and nothing stale outlives a swap. L2
+// first so a newer dirty copy in an L1 lands in RAM last.
+static void drop_lines(uint32_t start, uint32_t end) {
+  Cache *caches[MAX_CORES + 1];
+  caches[0] = &L2;
+  for (int c = 0; c < MAX_CORES; c++) {
+    caches[c + 1] = &L1_CACHES[c];
+  }
+  uint32_t first = line_base(start);
+  for (int k = 0; k < MAX_CORES + 1; k++) {
+    Cache *cache = caches[k];
+    for (size_t i = 0; i < cache->line_count; i++) {
+      CacheLine *line = &cache->lines[i];
+      if (line->is_valid && line->tag >= first && line->tag <= end) {
+        evict_line(cache, i);
+        line->is_valid = false;
+      }
+    }
+  }
+}
+
+static uint8_t *swap_device(SwapDevice device) {
+  return device == SWAP_SSD ? SSD : HDD;
+}
+
+static int swap_cost(SwapDevice device, size_t bytes) {
+  if (device == SWAP_SSD) {
+    return SSD_SWAP_LATENCY + (int)((bytes + SSD_BYTES_PER_TICK - 1) / SSD_BYTES_PER_TICK);
+  }
+  return HDD_SWAP_LATENCY + (int)((bytes + HDD_BYTES_PER_TICK - 1) / HDD_BYTES_PER_TICK);
+}
+
+// First offset on device with `size` free bytes, SIZE_MAX if it is full
+static size_t find_swap_space(SwapDevice device, size_t size) {
+  size_t device_size = (device == SWAP_SSD) ? (size_t)SSD_SIZE : (size_t)HDD_SIZE;
+  size_t offset = 0;
+  // Slide past every slot in the way; at most one pass per slot
+  for (size_t pass = 0; pass <= SWAP_TABLE.count; pass++) {
+    bool moved = false;
+    for (size_t i = 0; i < SWAP_TABLE.count; i++) {
+      SwapSlot *s = &SWAP_TABLE.slots[i];
+      size_t s_size = (size_t)(s->end_addr - s->start_addr) + 1u;
+      if (s->device == device && s->offset < offset + size && offset < s->offset + s_size) {
+        offset = s->offset + s_size;
+        moved = true;
+      }
+    }
+    if (!moved) {
+      return (offset + size <= device_size) ? offset : SIZE_MAX;
+    }
+  }
+  return SIZE_MAX;
+}
+
+static void reserve_swap_table(size_t extra) {
+  if (SWAP_TABLE.count + extra <= SWAP_TABLE.capacity) {
+    return;
+  }
+  size_t capacity = SWAP_TABLE.capacity ? SWAP_TABLE.capacity : INITIAL_SWAP_SLOTS;
+  while (capacity < SWAP_TABLE.count + extra) {
+    capacity *= 2;
+  }
+  SwapSlot *grown = realloc(SWAP_TABLE.slots, capacity * sizeof(SwapSlot));
+  if (!grown) {
+    perror("realloc swap table");
+    exit(EXIT_FAILURE);
+  }
+  SWAP_TABLE.slots = grown;
+  SWAP_TABLE.capacity = capacity;
+}
+
+static size_t process_ram_locked(int pid) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < MEMORY_TABLE.block_count; ++i) {
+    MemoryBlock *b = &MEMBLOCK(i);
+    if (!b->is_free && b->pid == pid) {
+      bytes += (size_t)(b->end_addr - b->start_addr) + 1u;
+    }
+  }
+  return bytes;
+}
+
+// Copy all of pid's blocks, back to back, onto the SSD (the HDD once
+// the SSD is full) and free them
+static int swap_out_locked(int pid) {
+  size_t bytes = process_ram_locked(pid);
+  if (bytes == 0) {
+    fprintf(stderr, "swap_out: pid %d has no memory to swap\n", pid);
+    return -1;
+  }
+
+  SwapDevice device = SWAP_SSD;
+  size_t offset = find_swap_space(SWAP_SSD, bytes);
+  if (offset == SIZE_MAX) {
+    device = SWAP_HDD;
+    offset = find_swap_space(SWAP_HDD, bytes);
+  }
+  if (offset == SIZE_MAX) {
+    fprintf(stderr, "swap_out: no swap space left for pid %d (%zu bytes)\n", pid, bytes);
+    return -1;
+  }
+
+  size_t idx;
+  while ((idx = find_block(pid)) != SIZE_MAX) {
+    MemoryBlock *b = &MEMBLOCK(idx);
+    size_t size = (size_t)(b->end_addr - b->start_addr) + 1u;
+    drop_lines(b->start_addr, b->end_addr);
+    memcpy(swap_device(device) + offset, &RAM[b->start_addr], size);
+
+    reserve_swap_table(1);
+    SwapSlot *s = &SWAP_TABLE.slots[SWAP_TABLE.count++];
+    s->pid = pid;
+    s->start_addr = b->start_addr;
+    s->end_addr = b->end_addr;
+    s->device = device;
+    s->offset = offset;
+    offset += size;
+    free_block(idx);
+  }
+  return swap_cost(device, bytes);
+}
+
+// Put every swapped block of pid back where it came from
+static int swap_in_locked(int pid) {
+  size_t bytes = 0;
+  SwapDevice device = SWAP_SSD;
+  for (size_t i = 0; i < SWAP_TABLE.count; i++) {
+    SwapSlot *s = &SWAP_TABLE.slots[i];
+    if (s->pid != pid) {
+      continue;
+    }
+    // Check the whole process fits before touching anything
+    bool room = false;
+    for (size_t j = 0; j < MEMORY_TABLE.block_count && !room; ++j) {
+      MemoryBlock *b = &MEMBLOCK(j);
+      room = b->is_free && b->start_addr <= s->start_addr && s->end_addr <= b->end_addr;
+    }
+    if (!room) {
+      fprintf(stderr, "swap_in: RAM of pid %d [%u -> %u] was taken\n", pid,
+              s->start_addr, s->end_addr);
+      return -1;
+    }
+    bytes += (size_t)(s->end_addr - s->start_addr) + 1u;
+    device = s->device;
+  }
+  if (bytes == 0) {
+    fprintf(stderr, "swap_in: pid %d is not swapped out\n", pid);
+    return -1;
+  }
+
+  size_t i = 0;
+  while (i < SWAP_TABLE.count) {
+    SwapSlot s = SWAP_TABLE.slots[i];
+    if (s.pid != pid) {
+      i++;
+      continue;
+    }
+    claim_range(pid, s.start_addr, s.end_addr);
+    drop_lines(s.start_addr, s.end_addr);
+    memcpy(&RAM[s.start_addr], swap_device(s.device) + s.offset,
+           (size_t)(s.end_addr - s.start_addr) + 1u);
+    SWAP_TABLE.slots[i] = SWAP_TABLE.slots[--SWAP_TABLE.count];
+  }
+  return swap_cost(device, bytes);
+}
+
+// The public accessors below are the only entry points into the
+// hierarchy, so they are where the cores get serialized
+uint8_t read_byte(uint32_t addr) {
+  lock_memory();
+  uint8_t value = read_byte_locked(addr);
+  unlock_memory();
+  return value;
+}
+
+uint16_t read_hword(uint32_t addr) {
+  lock_memory();
+  uint16_t value = read_hword_locked(addr);
+  unlock_memory();
+  return value;
+}
+
+uint32_t read_word(uint32_t addr) {
+  lock_memory();
+  uint32_t value = read_word_locked(addr);
+  unlock_memory();
+  return value;
+}
+
+void write_byte(uint32_t addr, uint8_t value) {
+  lock_memory();
+  write_byte_locked(addr, value);
+  unlock_memory();
+}
+
+void write_hword(uint32_t addr, uint16_t data) {
+  lock_memory();
+  write_hword_locked(addr, data);
+  unlock_memory();
+}
+
+void write_word(uint32_t addr, uint32_t data) {
+  lock_memory();
+  write_word_locked(addr, data);
+  unlock_memory();
+}
+
+bool write_block(uint32_t addr, const void *src, size_t len) {
+  if (len == 0) {
+    return true;
+  }
+  lock_memory();
+  bool allowed = in_bounds(addr, len) && accessible_end(addr) >= (uint64_t)addr + len;
+  if (allowed) {
+    drop_lines(addr, addr + (uint32_t)(len - 1));
+    memcpy(&RAM[addr], src, len);
+  } else {
+    fprintf(stderr, "write [block]: access violation - PID %d cannot write %zu bytes at 0x%08x\n",
+            current_process_id, len, addr);
+  }
+  unlock_memory();
+  return allowed;
+}
+
+size_t read_string(uint32_t addr, char *buf, size_t max) {
+  lock_memory();
+  size_t n = 0;
+  uint64_t end = 0; // Rights checked up to here
+  while (n < max) {
+    uint32_t at = addr + (uint32_t)n;
+    if (at >= end) {
+      end = in_bounds(at, 1) ? accessible_end(at) : 0;
+      if (end <= at) {
+        fprintf(stderr,
+                "read [string]: access violation - PID %d cannot access 0x%08x\n",
+                current_process_id, at);
+        break;
+      }
+    }
+    uint8_t ch = read_byte_no_check(at);
+    if (ch == 0) {
+      break;
+    }
+    buf[n++] = (char)ch;
+  }
+  unlock_memory();
+  return n;
+}
+
+uint32_t mallocate(int pid, size_t size) {
+  lock_memory();
+  uint32_t addr = mallocate_locked(pid, size);
+  unlock_memory();
+  return addr;
+}
+
+void liberate(int pid) {
+  lock_memory();
+  liberate_locked(pid);
+  unlock_memory();
+}
+
+size_t get_free_ram(void) {
+  lock_memory();
+  size_t bytes = 0;
+  for (size_t i = 0; i < MEMORY_TABLE.block_count; ++i) {
+    if (MEMBLOCK(i).is_free) {
+      bytes += (size_t)(MEMBLOCK(i).end_addr - MEMBLOCK(i).start_addr) + 1u;
+    }
+  }
+  unlock_memory();
+  return bytes;
+}
+
+size_t get_process_ram(int pid) {
+  lock_memory();
+  size_t bytes = process_ram_locked(pid);
+  unlock_memory();
+  return bytes;
+}
+
+int swap_out(int pid) {
+  lock_memory();
+  int ticks = swap_out_locked(pid);
+  unlock_memory();
+  return ticks;
+}
+
+int swap_in(int pid) {
+  lock_memory();
+  int ticks = swap_in_locked(pid);
+  unlock_memory();
+  return ticks;
+}
+
 // print the number of cache hits & misses
 void print_cache_stats(void) {
   printf("\n=== Cache Statistics ===\n");
@@ -830,3 +1335,20 @@ unsigned long get_write_backs(void) {
     return write_backs;
 }
 
+CacheCounters get_process_cache_counters(int pid) {
+  CacheCounters counters = {0};
+  if (pid < 0) {
+    return counters;
+  }
+  lock_memory();
+  if ((size_t)pid < pid_stats_capacity) {
+    counters = PID_CACHE_STATS[pid];
+  }
+  unlock_memory();
+  return counters;
+}
+
+size_t get_L1_line_count(void) {
+  return L1CACHE_SIZE / CACHE_LINE_SIZE;
+}
+
@@ -0,0 +1,176 @@
+#include "../include/object.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t text_count;
+  uint32_t data_size;
+  uint32_t symbol_count;
+  uint32_t relocation_count;
+  int32_t entry_symbol;
+  uint64_t source_hash;
+} ObjectHeader;
+
+static const char *g_cache_dir = NULL;
+static bool g_cache_dir_made = false;
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+// Read exactly count items into a fresh array, NULL on a short read
+static void *read_array(FILE *fp, size_t count, size_t size) {
+  if (count == 0) {
+    return NULL;
+  }
+  void *array = malloc(count * size);
+  if (!array) {
+    perror("malloc object");
+    exit(EXIT_FAILURE);
+  }
+  if (fread(array, size, count, fp) != count) {
+    free(array);
+    return NULL;
+  }
+  return array;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+uint64_t object_hash(const void *data, size_t len) {
+  const uint8_t *bytes = data;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+bool object_write(const ObjectFile *obj, const char *path) {
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+  FILE *fp = fopen(tmp, "wb");
+  if (!fp) {
+    return false;
+  }
+  ObjectHeader header = {
+    .magic = OBJECT_MAGIC,
+    .version = OBJECT_VERSION,
+    .text_count = obj->text_count,
+    .data_size = obj->data_size,
+    .symbol_count = obj->symbol_count,
+    .relocation_count = obj->relocation_count,
+    .entry_symbol = obj->entry_symbol,
+    .source_hash = obj->source_hash,
+  };
+  // An empty section may have a NULL buffer, which fwrite must not see
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+         && (obj->text_count == 0
+             || fwrite(obj->text, sizeof(uint32_t), obj->text_count, fp) == obj->text_count)
+         && (obj->data_size == 0
+             || fwrite(obj->data, 1, obj->data_size, fp) == obj->data_size)
+         && (obj->symbol_count == 0
+             || fwrite(obj->symbols, sizeof(ObjectSymbol), obj->symbol_count, fp)
+                  == obj->symbol_count)
+         && (obj->relocation_count == 0
+             || fwrite(obj->relocations, sizeof(Relocation), obj->relocation_count, fp)
+                  == obj->relocation_count);
+  ok = (fclose(fp) == 0) && ok;
+  if (ok) {
+    ok = rename(tmp, path) == 0;
+  }
+  if (!ok) {
+    unlink(tmp);
+  }
+  return ok;
+}
+
+bool object_read(ObjectFile *obj, const char *path) {
+  memset(obj, 0, sizeof(*obj));
+  obj->entry_symbol = -1;
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return false;
+  }
+  ObjectHeader header;
+  bool ok = fread(&header, sizeof(header), 1, fp) == 1
+         && memcmp(header.magic, OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) == 0
+         && header.version == OBJECT_VERSION
+         && (header.entry_symbol < 0 || (uint32_t)header.entry_symbol < header.symbol_count);
+  // The counts have to fit the file before anything is allocated for
+  // them, or a corrupt header asks for gigabytes
+  struct stat st;
+  if (ok) {
+    uint64_t needed = sizeof(header)
+                    + (uint64_t)header.text_count * sizeof(uint32_t)
+                    + header.data_size
+                    + (uint64_t)header.symbol_count * sizeof(ObjectSymbol)
+                    + (uint64_t)header.relocation_count * sizeof(Relocation);
+    ok = fstat(fileno(fp), &st) == 0 && needed <= (uint64_t)st.st_size;
+  }
+  if (ok) {
+    obj->source_hash = header.source_hash;
+    obj->entry_symbol = header.entry_symbol;
+    obj->text_count = header.text_count;
+    obj->data_size = header.data_size;
+    obj->symbol_count = header.symbol_count;
+    obj->relocation_count = header.relocation_count;
+    obj->text = read_array(fp, header.text_count, sizeof(uint32_t));
+    obj->data = read_array(fp, header.data_size, 1);
+    obj->symbols = read_array(fp, header.symbol_count, sizeof(ObjectSymbol));
+    obj->relocations = read_array(fp, header.relocation_count, sizeof(Relocation));
+    ok = (obj->text || !header.text_count) && (obj->data || !header.data_size)
+      && (obj->symbols || !header.symbol_count)
+      && (obj->relocations || !header.relocation_count);
+  }
+  for (uint32_t i = 0; ok && i < obj->relocation_count; i++) {
+    ok = obj->relocations[i].symbol < obj->symbol_count
+      && obj->relocations[i].offset / 4 < obj->text_count;
+  }
+  fclose(fp);
+  if (!ok) {
+    object_free(obj);
+  }
+  return ok;
+}
+
+void object_free(ObjectFile *obj) {
+  free(obj->text);
+  free(obj->data);
+  free(obj->symbols);
+  free(obj->relocations);
+  memset(obj, 0, sizeof(*obj));
+  obj->entry_symbol = -1;
+}
+
+void set_object_cache(const char *dir) {
+  g_cache_dir = dir;
+  g_cache_dir_made = false;
+}
+
+bool object_cache_path(uint64_t source_hash, char *path, size_t size) {
+  if (!g_cache_dir) {
+    return false;
+  }
+  if (!g_cache_dir_made) {
+    if (mkdir(g_cache_dir, 0777) != 0 && errno != EEXIST) {
+      fprintf(stderr, "Object cache %s: %s, assembling without it\n",
+              g_cache_dir, strerror(errno));
+      g_cache_dir = NULL;
+      return false;
+    }
+    g_cache_dir_made = true;
+  }
+  snprintf(path, size, "%s/%016llx.obj", g_cache_dir, (unsigned long long)source_hash);
+  return true;
+}
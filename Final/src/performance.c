@@ -1,5 +1,7 @@
 #include "../include/performance.h"
 #include "../include/memory.h"
+#include "../include/log.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,11 +20,14 @@ void init_performance_tracking(void) {
   g_tracker->algorithm_count = 0;
   g_current_algorithm = -1;
   
-  printf("Performance tracking initialized\n");
+  log_info("Performance tracking initialized\n");
 }
 
 void free_performance_tracking(void) {
   if (g_tracker) {
+    for (int i = 0; i < g_tracker->algorithm_count; i++) {
+      free(g_tracker->algorithms[i].process_metrics);
+    }
     free(g_tracker);
     g_tracker = NULL;
   }
@@ -48,11 +53,17 @@ int start_algorithm_tracking(const char *algorithm_name) {
   strncpy(metrics->algorithm_name, algorithm_name, 63);
   metrics->algorithm_name[63] = '\0';
   
-  // Capture initial cache statistics
-  // Note: You'll need to add functions to memory.c to get these values
+  metrics->affinity_baseline = -1;
+
+  // Capture initial cache statistics so each run only reports its own
+  g_tracker->initial_l1_hits     = get_L1_hits();
+  g_tracker->initial_l1_misses   = get_L1_misses();
+  g_tracker->initial_l2_hits     = get_L2_hits();
+  g_tracker->initial_l2_misses   = get_L2_misses();
+  g_tracker->initial_write_backs = get_write_backs();
   metrics->start_time = 0;
   
-  printf("\n=== Starting performance tracking for: %s ===\n", algorithm_name);
+  log_info("\n=== Starting performance tracking for: %s ===\n", algorithm_name);
   
   return id;
 }
@@ -70,7 +81,18 @@ void end_algorithm_tracking(int algorithm_id) {
   // Calculate final metrics
   calculate_algorithm_metrics(algorithm_id);
   
-  printf("=== Performance tracking completed for: %s ===\n\n", metrics->algorithm_name);
+  log_info("=== Performance tracking completed for: %s ===\n\n", metrics->algorithm_name);
+}
+
+int get_current_algorithm_id(void) {
+  return g_current_algorithm;
+}
+
+const PerformanceMetrics *get_algorithm_metrics(int algorithm_id) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return NULL;
+  }
+  return &g_tracker->algorithms[algorithm_id];
 }
 
 void record_process_metrics(int algorithm_id, int pid, int arrival_time,
@@ -83,9 +105,15 @@ void record_process_metrics(int algorithm_id, int pid, int arrival_time,
   
   PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
   
-  if (metrics->process_count >= MAX_PROCESSES) {
-    fprintf(stderr, "Maximum number of processes reached for algorithm %d\n", algorithm_id);
-    return;
+  if (metrics->process_count >= metrics->process_capacity) {
+    int capacity = metrics->process_capacity ? metrics->process_capacity * 2 : 64;
+    ProcessMetrics *grown = realloc(metrics->process_metrics, (size_t)capacity * sizeof(ProcessMetrics));
+    if (!grown) {
+      perror("realloc process metrics");
+      exit(EXIT_FAILURE);
+    }
+    metrics->process_metrics = grown;
+    metrics->process_capacity = capacity;
   }
   
   ProcessMetrics *pm = &metrics->process_metrics[metrics->process_count++];
@@ -97,6 +125,7 @@ void record_process_metrics(int algorithm_id, int pid, int arrival_time,
   pm->turnaround_time = turnaround_time;
   pm->response_time = response_time;
   pm->priority = priority;
+  pm->target_cpu = -1.0;
   
   metrics->total_burst_time += burst_time;
   
@@ -106,6 +135,45 @@ void record_process_metrics(int algorithm_id, int pid, int arrival_time,
   }
 }
 
+void record_process_share(int algorithm_id, int pid, double target_cpu) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  // The process was recorded just before
+  PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
+  for (int i = metrics->process_count - 1; i >= 0; i--) {
+    if (metrics->process_metrics[i].pid == pid) {
+      metrics->process_metrics[i].target_cpu = target_cpu;
+      return;
+    }
+  }
+}
+
+void record_job(int algorithm_id, int lateness) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
+  metrics->rt_jobs++;
+  if (lateness > 0) {
+    metrics->deadline_misses++;
+    metrics->total_lateness += lateness;
+    if (lateness > metrics->max_lateness) {
+      metrics->max_lateness = lateness;
+    }
+  }
+}
+
+void record_admission_rejection(int algorithm_id) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].admission_rejections++;
+}
+
 void record_context_switch(int algorithm_id) {
   if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
     return;
@@ -114,6 +182,115 @@ void record_context_switch(int algorithm_id) {
   g_tracker->algorithms[algorithm_id].context_switches++;
 }
 
+void record_core_count(int algorithm_id, int cores) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].cores = cores;
+}
+
+void record_core_busy_time(int algorithm_id, int core, int ticks) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count ||
+      core < 0 || core >= MAX_CORES) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].core_busy_time[core] = ticks;
+}
+
+void record_idle_time(int algorithm_id, int ticks) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].idle_skipped += ticks;
+  g_tracker->algorithms[algorithm_id].idle_jumps++;
+}
+
+void record_load_balance(int algorithm_id, int steals, int migrations,
+                         int same_core_dispatches) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].steals += steals;
+  g_tracker->algorithms[algorithm_id].migrations += migrations;
+  g_tracker->algorithms[algorithm_id].same_core_dispatches += same_core_dispatches;
+}
+
+void record_affinity_run(int algorithm_id, int baseline_id) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].affinity_aware = 1;
+  g_tracker->algorithms[algorithm_id].affinity_baseline =
+    (baseline_id >= 0 && baseline_id < g_tracker->algorithm_count) ? baseline_id : -1;
+}
+
+void record_swap(int algorithm_id, bool swap_in, size_t bytes, int ticks) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
+  if (swap_in) {
+    metrics->swap_ins++;
+  } else {
+    metrics->swap_outs++;
+  }
+  metrics->swap_bytes += bytes;
+  metrics->swap_time += ticks;
+}
+
+void record_multiprogramming(int algorithm_id, double average, int peak) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  g_tracker->algorithms[algorithm_id].avg_multiprogramming = average;
+  g_tracker->algorithms[algorithm_id].peak_multiprogramming = peak;
+}
+
+static double l1_miss_rate(const PerformanceMetrics *metrics) {
+  unsigned long accesses = metrics->l1_cache_hits + metrics->l1_cache_misses;
+  return accesses > 0 ? 100.0 * metrics->l1_cache_misses / accesses : 0.0;
+}
+
+// One line comparing an affinity-aware run against its affinity-blind twin
+static void print_affinity_impact(const PerformanceMetrics *metrics) {
+  const PerformanceMetrics *blind = &g_tracker->algorithms[metrics->affinity_baseline];
+  double before = l1_miss_rate(blind);
+  double after = l1_miss_rate(metrics);
+  double reduction = before > 0.0 ? 100.0 * (before - after) / before : 0.0;
+  printf("  %-28s L1 miss rate %.2f%% -> %.2f%% (%.2f%% reduction vs %s)\n",
+         metrics->algorithm_name, before, after, reduction, blind->algorithm_name);
+}
+
+int queue_length_bucket(int length) {
+  if (length < 4) {
+    return length < 0 ? 0 : length;
+  }
+  // 4-7 -> 4, 8-15 -> 5, ... one bucket per power of two
+  int bucket = 2;
+  while (length >= 2 && bucket < QUEUE_LENGTH_BUCKETS - 1) {
+    length >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void record_queue_length_histogram(int algorithm_id, const unsigned long *buckets) {
+  if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
+    return;
+  }
+  
+  for (int b = 0; b < QUEUE_LENGTH_BUCKETS; b++) {
+    g_tracker->algorithms[algorithm_id].queue_length_histogram[b] += buckets[b];
+  }
+}
+
 void record_scheduler_time(int algorithm_id, double time_ms) {
   if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
     return;
@@ -137,11 +314,12 @@ void capture_memory_stats(int algorithm_id) {
   
   PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
   
-  metrics->l1_cache_hits   = get_L1_hits();
-  metrics->l1_cache_misses = get_L1_misses();
-  metrics->l2_cache_hits   = get_L2_hits();
-  metrics->l2_cache_misses = get_L2_misses();
-  metrics->write_backs     = get_write_backs();}
+  metrics->l1_cache_hits   = get_L1_hits()     - g_tracker->initial_l1_hits;
+  metrics->l1_cache_misses = get_L1_misses()   - g_tracker->initial_l1_misses;
+  metrics->l2_cache_hits   = get_L2_hits()     - g_tracker->initial_l2_hits;
+  metrics->l2_cache_misses = get_L2_misses()   - g_tracker->initial_l2_misses;
+  metrics->write_backs     = get_write_backs() - g_tracker->initial_write_backs;
+}
 
 void calculate_algorithm_metrics(int algorithm_id) {
   if (!g_tracker || algorithm_id < 0 || algorithm_id >= g_tracker->algorithm_count) {
@@ -169,11 +347,27 @@ void calculate_algorithm_metrics(int algorithm_id) {
   metrics->avg_turnaround_time = total_turnaround / metrics->process_count;
   metrics->avg_response_time = total_response / metrics->process_count;
   
-  // Calculate CPU utilization
+  // Jain's index over each process's slowdown, (waiting + cpu) / cpu:
+  // 1.0 when every process was delayed in proportion to its work,
+  // down to 1/n when one process took all the delay
+  double slowdown_sum = 0;
+  double slowdown_squares = 0;
+  for (int i = 0; i < metrics->process_count; i++) {
+    ProcessMetrics *pm = &metrics->process_metrics[i];
+    int cpu = pm->burst_time > 0 ? pm->burst_time : 1;
+    double slowdown = (double)(pm->waiting_time + cpu) / cpu;
+    slowdown_sum += slowdown;
+    slowdown_squares += slowdown * slowdown;
+  }
+  metrics->fairness_index = slowdown_sum * slowdown_sum /
+                            (metrics->process_count * slowdown_squares);
+  
+  // Calculate CPU utilization (capacity scales with the number of CPUs)
   int total_time = metrics->end_time - metrics->start_time;
+  int cores = metrics->cores > 1 ? metrics->cores : 1;
   if (total_time > 0) {
-    metrics->cpu_utilization = (double)metrics->total_burst_time / total_time * 100.0;
-    metrics->idle_time = total_time - metrics->total_burst_time;
+    metrics->cpu_utilization = (double)metrics->total_burst_time / ((double)total_time * cores) * 100.0;
+    metrics->idle_time = (double)total_time * cores - metrics->total_burst_time;
   } else {
     metrics->cpu_utilization = 100.0;
     metrics->idle_time = 0;
@@ -218,12 +412,23 @@ void print_process_table(int algorithm_id) {
   
   PerformanceMetrics *metrics = &g_tracker->algorithms[algorithm_id];
   
-  printf("\nPROCESS  ARRIVAL  BURST  COMPLETION  WAITING  TURNAROUND  RESPONSE  PRIORITY\n");
-  printf("===============================================================================\n");
+  // Proportional-share runs add the CPU share each process got while
+  // it was ready or running, next to the share its tickets promised
+  bool shares = false;
+  for (int i = 0; i < metrics->process_count; i++) {
+    if (metrics->process_metrics[i].target_cpu >= 0) {
+      shares = true;
+    }
+  }
+  
+  printf("\nPROCESS  ARRIVAL  BURST  COMPLETION  WAITING  TURNAROUND  RESPONSE  PRIORITY%s\n",
+         shares ? "  SHARE    TARGET" : "");
+  printf("===============================================================================%s\n",
+         shares ? "==================" : "");
   
   for (int i = 0; i < metrics->process_count; i++) {
     ProcessMetrics *pm = &metrics->process_metrics[i];
-    printf("P%-6d  %-7d  %-5d  %-10d  %-7d  %-10d  %-8d  %-8d\n",
+    printf("P%-6d  %-7d  %-5d  %-10d  %-7d  %-10d  %-8d  %-8d",
            pm->pid,
            pm->arrival_time,
            pm->burst_time,
@@ -232,8 +437,16 @@ void print_process_table(int algorithm_id) {
            pm->turnaround_time,
            pm->response_time,
            pm->priority);
+    if (shares) {
+      int runnable = pm->waiting_time + pm->burst_time;
+      double share = runnable > 0 ? 100.0 * pm->burst_time / runnable : 0.0;
+      double target = runnable > 0 ? 100.0 * pm->target_cpu / runnable : 0.0;
+      printf("  %6.2f%%  %6.2f%%", share, target);
+    }
+    printf("\n");
   }
-  printf("===============================================================================\n");
+  printf("===============================================================================%s\n",
+         shares ? "==================" : "");
 }
 
 void print_algorithm_results(int algorithm_id) {
@@ -252,6 +465,10 @@ void print_algorithm_results(int algorithm_id) {
   printf("  Total Execution Time:      %.3f time units\n", metrics->execution_time_total);
   printf("  CPU Active Time:           %.3f time units\n", (double)metrics->total_burst_time);
   printf("  CPU Idle Time:             %.3f time units\n", metrics->idle_time);
+  if (metrics->idle_jumps > 0) {
+    printf("  Idle Time Skipped:         %d time units in %d jumps\n",
+           metrics->idle_skipped, metrics->idle_jumps);
+  }
   printf("  Scheduler Overhead:        %.3f ms\n", metrics->scheduler_time);
   printf("  Context Switch Overhead:   %.3f ms\n", metrics->context_switch_time);
   
@@ -260,11 +477,56 @@ void print_algorithm_results(int algorithm_id) {
   printf("  Average Waiting Time:      %.3f\n", metrics->avg_waiting_time);
   printf("  Average Turnaround Time:   %.3f\n", metrics->avg_turnaround_time);
   printf("  Average Response Time:     %.3f\n", metrics->avg_response_time);
+  printf("  Fairness (Jain's index):   %.3f\n", metrics->fairness_index);
   
   printf("\nSystem Metrics:\n");
   printf("  CPU Utilization:           %.2f%%\n", metrics->cpu_utilization);
   printf("  Throughput:                %.3f processes/unit\n", metrics->throughput);
   printf("  Context Switches:          %d\n", metrics->context_switches);
+  if (metrics->peak_multiprogramming > 0) {
+    printf("  Multiprogramming Level:    %.3f average, %d peak\n",
+           metrics->avg_multiprogramming, metrics->peak_multiprogramming);
+  }
+  if (metrics->swap_outs + metrics->swap_ins > 0) {
+    printf("  Swap Outs / Ins:           %d / %d (%lu bytes)\n",
+           metrics->swap_outs, metrics->swap_ins, metrics->swap_bytes);
+    printf("  Swap Device Busy:          %d time units\n", metrics->swap_time);
+  }
+  if (metrics->cores > 1) {
+    printf("  CPUs:                      %d\n", metrics->cores);
+    for (int c = 0; c < metrics->cores; c++) {
+      double share = metrics->execution_time_total > 0
+                   ? 100.0 * metrics->core_busy_time[c] / metrics->execution_time_total
+                   : 0.0;
+      printf("    CPU %-2d busy:             %d ticks (%.2f%%)\n",
+             c, metrics->core_busy_time[c], share);
+    }
+    printf("  Steals:                    %d\n", metrics->steals);
+    printf("  Migrations:                %d\n", metrics->migrations);
+    printf("  Same-CPU Dispatches:       %d\n", metrics->same_core_dispatches);
+    printf("  Run Queue Length Histogram:\n");
+    static const char *bucket_labels[QUEUE_LENGTH_BUCKETS] = {
+      "0", "1", "2", "3", "4-7", "8-15", "16-31", "32+"
+    };
+    for (int b = 0; b < QUEUE_LENGTH_BUCKETS; b++) {
+      if (metrics->queue_length_histogram[b] > 0) {
+        printf("    %-6s                   %lu\n", bucket_labels[b],
+               metrics->queue_length_histogram[b]);
+      }
+    }
+  }
+  
+  if (metrics->rt_jobs + metrics->admission_rejections > 0) {
+    printf("\nReal-Time:\n");
+    printf("  Jobs Completed:            %d\n", metrics->rt_jobs);
+    printf("  Deadline Misses:           %d (%.2f%%)\n", metrics->deadline_misses,
+           metrics->rt_jobs > 0 ? 100.0 * metrics->deadline_misses / metrics->rt_jobs : 0.0);
+    if (metrics->deadline_misses > 0) {
+      printf("  Lateness of Late Jobs:     %.3f average, %d max\n",
+             (double)metrics->total_lateness / metrics->deadline_misses, metrics->max_lateness);
+    }
+    printf("  Admission Rejections:      %d\n", metrics->admission_rejections);
+  }
   
   printf("\nMemory Statistics:\n");
   printf("  L1 Cache Hits:             %lu\n", metrics->l1_cache_hits);
@@ -282,6 +544,10 @@ void print_algorithm_results(int algorithm_id) {
     printf("  L2 Hit Rate:               %.2f%%\n", l2_hit_rate);
   }
   printf("  Write-Backs:               %lu\n", metrics->write_backs);
+  if (metrics->affinity_baseline >= 0) {
+    printf("\nCache Affinity Impact:\n");
+    print_affinity_impact(metrics);
+  }
   
   print_process_table(algorithm_id);
   
@@ -298,25 +564,27 @@ void print_comparison_table(void) {
   printf("=====================================================================================================\n");
   printf("                              SCHEDULING ALGORITHM COMPARISON\n");
   printf("=====================================================================================================\n");
-  printf("%-15s %10s %12s %12s %10s %12s\n",
-         "Algorithm", "Avg Wait", "Avg T.Around", "Avg Resp", "CPU%%", "C.Switches");
+  printf("%-26s %10s %12s %12s %10s %12s %9s\n",
+         "Algorithm", "Avg Wait", "Avg T.Around", "Avg Resp", "CPU%%", "C.Switches", "Fairness");
   printf("-----------------------------------------------------------------------------------------------------\n");
   
   for (int i = 0; i < g_tracker->algorithm_count; i++) {
     PerformanceMetrics *m = &g_tracker->algorithms[i];
-    printf("%-15s %10.3f %12.3f %12.3f %9.2f%% %12d\n",
+    printf("%-26s %10.3f %12.3f %12.3f %9.2f%% %12d %9.3f\n",
            m->algorithm_name,
            m->avg_waiting_time,
            m->avg_turnaround_time,
            m->avg_response_time,
            m->cpu_utilization,
-           m->context_switches);
+           m->context_switches,
+           m->fairness_index);
   }
   printf("=====================================================================================================\n");
   
   // Find best performer in each category
   if (g_tracker->algorithm_count > 0) {
     int best_wait = 0, best_turnaround = 0, best_response = 0, best_cpu = 0, best_switches = 0;
+    int best_fairness = 0;
     
     for (int i = 1; i < g_tracker->algorithm_count; i++) {
       if (g_tracker->algorithms[i].avg_waiting_time < 
@@ -339,6 +607,10 @@ void print_comparison_table(void) {
           g_tracker->algorithms[best_switches].context_switches) {
         best_switches = i;
       }
+      if (g_tracker->algorithms[i].fairness_index > 
+          g_tracker->algorithms[best_fairness].fairness_index) {
+        best_fairness = i;
+      }
     }
     
     printf("\nBest Performers:\n");
@@ -357,6 +629,24 @@ void print_comparison_table(void) {
     printf("  Fewest Context Switches:        %s (%d)\n",
            g_tracker->algorithms[best_switches].algorithm_name,
            g_tracker->algorithms[best_switches].context_switches);
+    printf("  Fairest (Jain's index):         %s (%.3f)\n",
+           g_tracker->algorithms[best_fairness].algorithm_name,
+           g_tracker->algorithms[best_fairness].fairness_index);
+  }
+
+  bool has_affinity_runs = false;
+  for (int i = 0; i < g_tracker->algorithm_count; i++) {
+    if (g_tracker->algorithms[i].affinity_baseline >= 0) {
+      has_affinity_runs = true;
+    }
+  }
+  if (has_affinity_runs) {
+    printf("\nCache Affinity Impact:\n");
+    for (int i = 0; i < g_tracker->algorithm_count; i++) {
+      if (g_tracker->algorithms[i].affinity_baseline >= 0) {
+        print_affinity_impact(&g_tracker->algorithms[i]);
+      }
+    }
   }
   
   printf("\n");
@@ -390,11 +680,12 @@ void export_to_csv(const char *filename) {
   }
   
   fprintf(fp, "Algorithm,AvgWaitTime,AvgTurnaroundTime,AvgResponseTime,CPUUtilization,");
-  fprintf(fp, "Throughput,ContextSwitches,L1Hits,L1Misses,L2Hits,L2Misses\n");
+  fprintf(fp, "Throughput,ContextSwitches,L1Hits,L1Misses,L2Hits,L2Misses,Fairness,");
+  fprintf(fp, "DeadlineMisses,MaxLateness\n");
   
   for (int i = 0; i < g_tracker->algorithm_count; i++) {
     PerformanceMetrics *m = &g_tracker->algorithms[i];
-    fprintf(fp, "%s,%.3f,%.3f,%.3f,%.2f,%.3f,%d,%lu,%lu,%lu,%lu\n",
+    fprintf(fp, "%s,%.3f,%.3f,%.3f,%.2f,%.3f,%d,%lu,%lu,%lu,%lu,%.3f,%d,%d\n",
             m->algorithm_name,
             m->avg_waiting_time,
             m->avg_turnaround_time,
@@ -405,7 +696,10 @@ void export_to_csv(const char *filename) {
             m->l1_cache_hits,
             m->l1_cache_misses,
             m->l2_cache_hits,
-            m->l2_cache_misses);
+            m->l2_cache_misses,
+            m->fairness_index,
+            m->deadline_misses,
+            m->max_lateness);
   }
   
   fclose(fp);
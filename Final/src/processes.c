@@ -3,18 +3,40 @@
 #include "../include/memory.h"
 #include "../include/isa.h"
 #include "../include/performance.h"
-
+#include "../include/deque.h"
+#include "../include/heap.h"
+#include "../include/kinetic.h"
+#include "../include/rbtree.h"
+#include "../include/tickets.h"
+#include "../include/events.h"
+#include "../include/interrupts.h"
+#include "../include/console.h"
+#include "../include/keyboard.h"
+#include "../include/log.h"
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 //-------------------------------------Structs & Enums-------------------------------------//
 typedef enum {
   NORMAL,
   PRIORITYBURST,
-  PRIORITYPRIORITY
+  PRIORITYPRIORITY,
+  PRIORITYRATIO,
+  CFSTREE,
+  LOTTERYTICKETS,
+  STRIDEPASS,
+  DEADLINEHEAP,
+  RATEHEAP,
+  FEEDBACKLEVELS
 } QueueTypeEnum;
 
 typedef enum {
@@ -36,6 +58,9 @@ typedef struct {
   int burstTime;
   int originalBurstTime;  // For tracking
   float responseRatio;
+  uint64_t vruntime;       // CFS: CPU time weighted by priority, in 1/VRUNTIME_SCALE ticks
+  int tickets;             // Lottery and stride: its share of the CPU
+  uint64_t pass;           // Stride: virtual time of its next turn
   Cpu cpu_state;
   uint32_t text_start;
   uint32_t text_size;
@@ -49,19 +74,83 @@ typedef struct {
   int completion_time;
   int waiting_time;
   int response_time;
+  int blocked_since;       // When it last blocked on a syscall
+  int blocked_time;        // Total time spent blocked, not waiting for the CPU
   bool has_started;
+  bool swapped_out;        // Its memory is on a swap device
+  size_t swapped_bytes;    // RAM it needs back to resume
+  int last_core;           // CPU it last ran on, -1 before the first dispatch
+
+  // Affinity
+  uint64_t hard_affinity;  // CPUs it may run on, 0 = any
+  uint64_t soft_affinity;  // CPUs it prefers, 0 = none
+  int cache_footprint;     // Estimated L1 lines it owns on last_core
+  unsigned long slice_l1_misses; // Its L1 misses when the current slice began
+  unsigned long core_lines_at_leave; // last_core's lines_loaded when it left
+
+  // Proportional share
+  uint32_t lent_to;        // Handle holding its lent tickets, NO_PROCESS if none
+  int lent;                // How many it lent
+  bool share_active;       // Ready or running, its tickets count towards the total
+  double share_mark;       // g_share_clock when expected_cpu was last brought up to date
+  double expected_cpu;     // CPU time its tickets entitled it to so far
+
+  // Real-time: jobs are released at arrival + k * period
+  int period;              // 0 = best-effort
+  int rel_deadline;        // Deadline of each job after its release
+  int wcet;                // CPU one job may use
+  bool rt_checked;         // Went through admission control
+  bool realtime;           // Admitted: scheduled by its jobs' deadlines or period
+  int job;                 // Index of the current job
+  int job_release;
+  int job_deadline;        // Absolute
+  int job_used;            // CPU the current job has used
+
+  // MLFQ
+  int mlfq_level;          // 0 is the top
+  int mlfq_used;           // CPU used at this level, across every slice
+  int mlfq_burst;          // CPU used since it last woke
 } Process;
 
-//To represent a queue
+//Index of a PCB in global_process_storage. Every queue holds handles,
+//so each process has exactly one PCB and nothing goes stale.
+typedef uint32_t ProcessHandle;
+#define NO_PROCESS UINT32_MAX
+
+//To represent a queue. FIFO queues use the array as a ring starting
+//at head; the heaps keep head at 0. The array doubles when full.
 typedef struct {
-  int next;
+  int head;
+  int count;
   int capacity;
-  Process PCB[];
+  ProcessHandle *handles;
 } Queue;
 
 //-------------------------------------Constants-------------------------------------//
 #define QUANTUM 3
-// #define MAX_PROCESSES 10
+#define QUEUE_INITIAL_CAPACITY 16
+#define STORAGE_INITIAL_CAPACITY 16
+// Simulated time a console read takes, the console serves one at a time
+#define CONSOLE_LATENCY 5
+// Simulated time units per millisecond of sleep_ms and get_time_ms
+#define DEFAULT_TICKS_PER_MS 1
+// CFS: every runnable process gets a turn within the target latency, but
+// no slice is shorter than the minimum granularity
+#define CFS_DEFAULT_LATENCY 24
+#define CFS_DEFAULT_GRANULARITY QUANTUM
+// Weight of a priority 1 process; vruntime advances by exactly the time
+// run at this weight
+#define NICE_0_WEIGHT 1024
+// vruntime is kept in fractions of a tick so heavy weights still advance
+#define VRUNTIME_SCALE 1024
+// Lottery and stride: priority 1 holds BASE_TICKETS, priority n 1/n of that
+#define BASE_TICKETS 1000
+// No process may inflate itself past this many tickets
+#define MAX_TICKETS (1 << 20)
+// A stride process's pass advances STRIDE1 / tickets per tick
+#define STRIDE1 (1 << 20)
+// MLFQ: every process goes back to the top level this often
+#define MLFQ_DEFAULT_BOOST 100
 
 static Queue* Ready_Queue = NULL;
 static Queue* Running_Queue = NULL;
@@ -70,127 +159,159 @@ static Queue* Suspend_Blocked_Queue = NULL;
 static Queue* Suspend_Ready_Queue = NULL;
 static Queue* New_Queue = NULL;
 static Queue* Finished_Queue = NULL;
+// MLFQ levels, top first, and a bit per non-empty level
+static Queue* Feedback_Queues[MLFQ_MAX_LEVELS];
+static uint32_t g_feedback_nonempty = 0;
+static size_t g_feedback_ready = 0;
+// Ready processes of the burst and priority ordered policies
+static IndexedHeap* Ready_Heap = NULL;
+// Ready processes of HRRN, ordered by response ratio as time passes
+static KineticTree* Ready_Ratios = NULL;
+// Ready processes of CFS, ordered by virtual runtime
+static RBTree* Ready_Tree = NULL;
+// Ready processes of lottery scheduling, by tickets held
+static TicketTree* Ready_Tickets = NULL;
+// Pending arrivals, I/O completions and timers, in timestamp order
+static EventQueue* g_events = NULL;
 
 // Performance tracking
 static int g_current_algorithm_id = -1;
 static int g_system_time = 0;
+static int g_submitted = 0; // Processes submitted to the current run
+static int g_console_free = 0; // When the console finishes its queued reads
+
+// Medium-term scheduling: keep this much RAM free by suspending
+// processes to swap, 0 = never swap
+static size_t g_swap_watermark = 0;
+static int g_swap_free = 0;    // When the swap device finishes its queued transfers
+static int g_swapping_in = 0;  // Swap-ins still in flight
+// RAM finished processes keep for the next comparison run, free as far
+// as this run is concerned
+static size_t g_retained_ram = 0;
+// Multiprogramming level: arrived, unfinished processes resident in RAM
+static int g_resident = 0;
+static int g_peak_resident = 0;
+static int g_resident_since = 0;
+static double g_resident_area = 0.0;
+
+// Completely fair scheduling
+static int g_cfs_latency = CFS_DEFAULT_LATENCY;
+static int g_cfs_granularity = CFS_DEFAULT_GRANULARITY;
+static uint64_t g_min_vruntime = 0; // Never moves backwards
+static uint64_t g_cfs_load = 0;     // Total weight of Ready_Tree
+
+// Proportional share (lottery and stride)
+static uint64_t g_lottery_seed = 1;
+static uint64_t g_lottery_state = 1;
+static bool g_share_run = false;        // Report entitlements for this run
+static uint64_t g_global_pass = 0;     // Least pass of the ready and running, never moves backwards
+static uint64_t g_active_tickets = 0;  // Tickets of every ready or running process
+static double g_share_clock = 0.0;     // Sum over ticks of 1 / g_active_tickets
+static ProcessHandle g_running = NO_PROCESS; // On the uniprocessor CPU
+
+// Real-time admission: summed wcet / min(deadline, period) of the
+// admitted tasks still alive
+static double g_rt_density = 0.0;
+static int g_rt_tasks = 0;
+
+// MLFQ: a process's allotment at a level is that level's quantum
+static int g_mlfq_levels = 3;
+static int g_mlfq_quanta[MLFQ_MAX_LEVELS] = { 2, 4, 8 };
+static int g_mlfq_boost = MLFQ_DEFAULT_BOOST; // 0 = never
+
+// Simulated clock: g_system_time ticks are instructions, and the
+// programs see g_ticks_per_ms of them as a millisecond. Paced runs keep
+// it from getting ahead of the host clock.
+static int g_ticks_per_ms = DEFAULT_TICKS_PER_MS;
+static bool g_paced = false;
+static struct timespec g_pace_start;
+// A console read looked for its number and found it not yet typed
+static bool g_input_starved = false;
+
+// Symmetric multiprocessing
+static int g_core_count = 1;
+
+// The PCB arena, grown by doubling. Handles stay valid across a grow,
+// Process pointers do not, so nothing holds one over makeProcess.
+static Process *global_process_storage = NULL;
+static int process_storage_capacity = 0;
+static int process_storage_index = 0;
 
-//-------------------------------------Initializers for Queue-------------------------------------//
-
-static void shift_ready_left(void) {
-  if (Ready_Queue->next == 0) return;
-  for (int i = 0; i + 1 < Ready_Queue->next; i++) {
-    Ready_Queue->PCB[i] = Ready_Queue->PCB[i + 1];
-  }
-  Ready_Queue->next--;
+static inline Process *pcb(ProcessHandle h) {
+  return &global_process_storage[h];
 }
 
-static void push_ready_back(Process p) {
-  if (Ready_Queue->next >= Ready_Queue->capacity) {
-    fprintf(stderr, "Ready queue full, dropping PID %d\n", p.pid);
-    return;
+//-------------------------------------Initializers for Queue-------------------------------------//
+
+static Queue* new_Queue(const int size, const char *name) {
+  Queue* Q = calloc(1, sizeof(Queue));
+  ProcessHandle* handles = calloc((size_t)size, sizeof(ProcessHandle));
+  if (!Q || !handles) {
+    perror(name);
+    exit(EXIT_FAILURE);
   }
-  Ready_Queue->PCB[Ready_Queue->next++] = p;
+  Q->head = 0;
+  Q->count = 0;
+  Q->capacity = size;
+  Q->handles = handles;
+  return Q;
 }
 
 static void init_Ready_Queue(const int size) {
-  Ready_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Ready_Queue) {
-    perror("calloc Ready_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Ready_Queue->next = 0;
-  Ready_Queue->capacity = size;
+  Ready_Queue = new_Queue(size, "calloc Ready_Queue");
 }
 
 static void init_Running_Queue(const int size) {
-  Running_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Running_Queue) {
-    perror("calloc Running_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Running_Queue->next = 0;
-  Running_Queue->capacity = size;
+  Running_Queue = new_Queue(size, "calloc Running_Queue");
 }
 
 static void init_Blocked_Queue(const int size) {
-  Blocked_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Blocked_Queue) {
-    perror("calloc Blocked_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Blocked_Queue->next = 0;
-  Blocked_Queue->capacity = size;
+  Blocked_Queue = new_Queue(size, "calloc Blocked_Queue");
 }
 
 static void init_Suspend_Blocked_Queue(const int size) {
-  Suspend_Blocked_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Suspend_Blocked_Queue) {
-    perror("calloc Suspend_Blocked_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Suspend_Blocked_Queue->next = 0;
-  Suspend_Blocked_Queue->capacity = size;
+  Suspend_Blocked_Queue = new_Queue(size, "calloc Suspend_Blocked_Queue");
 }
 
 static void init_Suspend_Ready_Queue(const int size) {
-  Suspend_Ready_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Suspend_Ready_Queue) {
-    perror("calloc Suspend_Ready_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Suspend_Ready_Queue->next = 0;
-  Suspend_Ready_Queue->capacity = size;
+  Suspend_Ready_Queue = new_Queue(size, "calloc Suspend_Ready_Queue");
 }
 
 static void init_New_Queue(const int size) {
-  New_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!New_Queue) {
-    perror("calloc New_Queue");
-    exit(EXIT_FAILURE);
-  }
-  New_Queue->next = 0;
-  New_Queue->capacity = size;
+  New_Queue = new_Queue(size, "calloc New_Queue");
 }
 
 static void init_Finished_Queue(const int size) {
-  Finished_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!Finished_Queue) {
-    perror("calloc Finished_Queue");
-    exit(EXIT_FAILURE);
-  }
-  Finished_Queue->next = 0;
-  Finished_Queue->capacity = size;
+  Finished_Queue = new_Queue(size, "calloc Finished_Queue");
 }
 
-Queue* init_FeedBack_Queue(const int size) {
-  Queue* FeedBack_Queue = calloc(1, sizeof(Queue) + (size_t)size * sizeof(Process));
-  if (!FeedBack_Queue) {
-    perror("calloc FeedBack_Queue");
-    exit(EXIT_FAILURE);
+static void init_Feedback_Queues(const int size) {
+  for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+    Feedback_Queues[i] = new_Queue(size, "calloc Feedback_Queues");
   }
-  FeedBack_Queue->next = 0;
-  FeedBack_Queue->capacity = size;
-  return FeedBack_Queue;
 }
 
 void init_queues(void) {
-  init_Ready_Queue(MAX_PROCESSES);
-  init_Running_Queue(MAX_PROCESSES);
-  init_Blocked_Queue(MAX_PROCESSES);
-  init_Suspend_Blocked_Queue(MAX_PROCESSES);
-  init_Suspend_Ready_Queue(MAX_PROCESSES);
-  init_New_Queue(MAX_PROCESSES);
-  init_Finished_Queue(MAX_PROCESSES);
+  init_Ready_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Running_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Blocked_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Suspend_Blocked_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Suspend_Ready_Queue(QUEUE_INITIAL_CAPACITY);
+  init_New_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Finished_Queue(QUEUE_INITIAL_CAPACITY);
+  init_Feedback_Queues(QUEUE_INITIAL_CAPACITY);
+  g_events = event_queue_create(QUEUE_INITIAL_CAPACITY);
 }
 
 static void free_Queue(Queue* Q) {
   if (!Q) {
     return;
   }
+  free(Q->handles);
   free(Q);
 }
 
+// The queues only hold handles into the arena, so the arena goes with them
 void free_queues(void){
   free_Queue(Ready_Queue);
   free_Queue(Running_Queue);
@@ -199,153 +320,324 @@ void free_queues(void){
   free_Queue(Suspend_Ready_Queue);
   free_Queue(New_Queue);
   free_Queue(Finished_Queue);
+  for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+    free_Queue(Feedback_Queues[i]);
+    Feedback_Queues[i] = NULL;
+  }
+  Ready_Queue = Running_Queue = Blocked_Queue = NULL;
+  Suspend_Blocked_Queue = Suspend_Ready_Queue = NULL;
+  New_Queue = Finished_Queue = NULL;
+  event_queue_destroy(g_events);
+  g_events = NULL;
+
+  free(global_process_storage);
+  global_process_storage = NULL;
+  process_storage_capacity = 0;
+  process_storage_index = 0;
 }
 
 //-------------------------------------Helpers for Queue-------------------------------------//
 
-static void enqueueGeneric(Process elem, Queue* Q) {
-  if (Q == Finished_Queue && Q->next >= Q->capacity) {
-    Q->next = 0;
+static inline ProcessHandle queue_at(Queue* Q, int i) {
+  return Q->handles[(Q->head + i) % Q->capacity];
+}
+
+// Double the array, unrolling the ring so head is back at 0
+static void growQueue(Queue* Q) {
+  int capacity = Q->capacity ? Q->capacity * 2 : QUEUE_INITIAL_CAPACITY;
+  ProcessHandle* handles = malloc((size_t)capacity * sizeof(ProcessHandle));
+  if (!handles) {
+    perror("malloc queue handles");
+    exit(EXIT_FAILURE);
   }
+  for (int i = 0; i < Q->count; i++) {
+    handles[i] = queue_at(Q, i);
+  }
+  free(Q->handles);
+  Q->handles = handles;
+  Q->head = 0;
+  Q->capacity = capacity;
+}
 
-  if (Q->next >= Q->capacity) {
-    fprintf(stderr, "Queue is full\n");
-    return;
+static void enqueueGeneric(ProcessHandle elem, Queue* Q) {
+  if (Q->count >= Q->capacity) {
+    growQueue(Q);
   }
 
-  Q->PCB[Q->next] = elem;
-  Q->next+=1;
+  Q->handles[(Q->head + Q->count) % Q->capacity] = elem;
+  Q->count += 1;
 }
 
-static Process dequeueGeneric(Queue* Q) {
-  if (Q->next == 0) {
+static ProcessHandle dequeueGeneric(Queue* Q) {
+  if (Q->count == 0) {
     fprintf(stderr, "Queue is empty\n");
-    Process empty = {0};
-    return empty;
-  }
-
-  Process process = Q->PCB[0];
-  Q->next-=1;
-  for (int i = 0; i < Q->next; i++) {
-    Q->PCB[i] = Q->PCB[i+1];
+    return NO_PROCESS;
   }
 
+  ProcessHandle process = Q->handles[Q->head];
+  Q->head = (Q->head + 1) % Q->capacity;
+  Q->count -= 1;
   return process;
 }
 
-static void swap(Queue* Q, int swappee, int swapper) {
-  Process temp = Q->PCB[swappee];
-  Q->PCB[swappee] = Q->PCB[swapper];
-  Q->PCB[swapper] = temp;
+// Take a handle out of the middle of a FIFO queue, keeping the rest in
+// order. False if it is not queued.
+static bool removeFromQueue(Queue* Q, ProcessHandle elem) {
+  for (int i = 0; i < Q->count; i++) {
+    if (queue_at(Q, i) != elem) {
+      continue;
+    }
+    for (int j = i; j + 1 < Q->count; j++) {
+      Q->handles[(Q->head + j) % Q->capacity] = queue_at(Q, j + 1);
+    }
+    Q->count -= 1;
+    return true;
+  }
+  return false;
 }
 
-static void enqueueBurst(Process process, Queue* Q) {
-  if (Q->next >= Q->capacity) {
-    fprintf(stderr, "Priority queue is full\n");
-    return;
+// Shorter remaining burst first, creation order among equals
+static bool burstBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  if (pcb(a)->burstTime != pcb(b)->burstTime) {
+    return pcb(a)->burstTime < pcb(b)->burstTime;
   }
+  return a < b;
+}
 
-  int index = Q->next++;
-  Q->PCB[index] = process;
-  while (index != 0 && Q->PCB[(index - 1) / 2].burstTime > Q->PCB[index].burstTime) {
-    swap(Q, index, (index - 1) / 2);
-    index = (index - 1) / 2;
+// Lower priority value first, creation order among equals
+static bool priorityBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  if (pcb(a)->priority != pcb(b)->priority) {
+    return pcb(a)->priority < pcb(b)->priority;
   }
+  return a < b;
+}
+
+// Priority 1 is nice 0, each step down is nice + 1 and about 10% less
+// CPU. The table is the Linux one, nice -20 to 19.
+static const int cfs_weights[40] = {
+  88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,    36,    29,    23,    18,    15
+};
+
+static uint64_t cfsWeight(const Process *p) {
+  int nice = p->priority - 1;
+  if (nice < -20) nice = -20;
+  if (nice > 19) nice = 19;
+  return (uint64_t)cfs_weights[nice + 20];
 }
 
-static Process dequeueBurst(Queue* Q) {
-  if (Q->next == 0) {
-    fprintf(stderr, "Priority queue is empty\n");
-    Process empty = {0};
-    return empty;
+// Less virtual runtime first, creation order among equals
+static bool vruntimeBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  if (pcb(a)->vruntime != pcb(b)->vruntime) {
+    return pcb(a)->vruntime < pcb(b)->vruntime;
   }
+  return a < b;
+}
 
-  Process process = Q->PCB[0];
+// Where a process joins the timeline. Never far behind min_vruntime, so
+// a newcomer cannot hog the CPU to catch up, but one that was blocked
+// keeps up to half a latency of credit and runs soon after waking.
+static void cfsPlace(Process *p) {
+  uint64_t floor = g_min_vruntime;
+  if (p->has_started) {
+    uint64_t credit = (uint64_t)g_cfs_latency * VRUNTIME_SCALE / 2;
+    floor = (floor > credit) ? floor - credit : 0;
+  }
+  if (p->vruntime < floor) {
+    p->vruntime = floor;
+  }
+}
 
-  Q->PCB[0] = Q->PCB[--Q->next];
-  int index = 0;
-  while(true) {
-    int smallest = index;
-    int left = 2 * index + 1;
-    int right = 2 * index + 2;
+static int ticketsFor(int priority) {
+  return BASE_TICKETS / (priority > 0 ? priority : 1);
+}
 
-    if (left < Q->next && Q->PCB[left].burstTime < Q->PCB[smallest].burstTime) {
-      smallest = left;
-    }
+// Lower pass first, creation order among equals
+static bool passBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  if (pcb(a)->pass != pcb(b)->pass) {
+    return pcb(a)->pass < pcb(b)->pass;
+  }
+  return a < b;
+}
 
-    if (right < Q->next && Q->PCB[right].burstTime < Q->PCB[smallest].burstTime) {
-      smallest = right;
-    }
+// Bring p's entitlement up to now. While it is ready or running, every
+// tick owes it tickets / g_active_tickets of the CPU.
+static void shareSettle(Process *p) {
+  if (p->share_active) {
+    p->expected_cpu += p->tickets * (g_share_clock - p->share_mark);
+  }
+  p->share_mark = g_share_clock;
+}
 
-    if (smallest != index) {
-      swap(Q, index, smallest);
-      index = smallest;
-    } else {
-      break;
-    }
+// p became ready from outside the ready set (arrival, wakeup, swap-in)
+static void shareJoin(Process *p) {
+  if (p->share_active) {
+    return;
   }
-  return process;
+  shareSettle(p);
+  p->share_active = true;
+  g_active_tickets += (uint64_t)p->tickets;
 }
 
-static void enqueuePriority(Process process, Queue* Q) {
-  if (Q->next >= Q->capacity) {
-    fprintf(stderr, "Priority queue is full\n");
+// p blocked, finished or was swapped out
+static void shareLeave(Process *p) {
+  if (!p->share_active) {
     return;
   }
+  shareSettle(p);
+  p->share_active = false;
+  g_active_tickets -= (uint64_t)p->tickets;
+}
 
-  int index = Q->next++;
-  Q->PCB[index] = process;
-  while (index != 0 && Q->PCB[(index - 1) / 2].priority > Q->PCB[index].priority) {
-    swap(Q, index, (index - 1) / 2);
-    index = (index - 1) / 2;
+// One tick of CPU went to the ready and running processes
+static void shareTick(void) {
+  if (g_active_tickets > 0) {
+    g_share_clock += 1.0 / (double)g_active_tickets;
   }
 }
 
-static Process dequeuePriority(Queue* Q) {
-  if (Q->next == 0) {
-    fprintf(stderr, "Priority queue is empty\n");
-    Process empty = {0};
-    return empty;
+// EDF: earlier absolute deadline first. Best-effort processes come after
+// every real-time job, in arrival order.
+static bool deadlineBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  int da = pcb(a)->realtime ? pcb(a)->job_deadline : INT_MAX;
+  int db = pcb(b)->realtime ? pcb(b)->job_deadline : INT_MAX;
+  if (da != db) {
+    return da < db;
   }
+  if (pcb(a)->arrival_time != pcb(b)->arrival_time) {
+    return pcb(a)->arrival_time < pcb(b)->arrival_time;
+  }
+  return a < b;
+}
 
-  Process process = Q->PCB[0];
+// RM: shorter period first, best-effort processes last
+static bool rateBefore(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  int pa = pcb(a)->realtime ? pcb(a)->period : INT_MAX;
+  int pb = pcb(b)->realtime ? pcb(b)->period : INT_MAX;
+  if (pa != pb) {
+    return pa < pb;
+  }
+  if (pcb(a)->arrival_time != pcb(b)->arrival_time) {
+    return pcb(a)->arrival_time < pcb(b)->arrival_time;
+  }
+  return a < b;
+}
 
-  Q->PCB[0] = Q->PCB[--Q->next];
-  int index = 0;
-  while(true) {
-    int smallest = index;
-    int left = 2 * index + 1;
-    int right = 2 * index + 2;
+static double rtDensity(const Process *p) {
+  int window = (p->rel_deadline < p->period) ? p->rel_deadline : p->period;
+  return (double)p->wcet / (double)window;
+}
 
-    if (left < Q->next && Q->PCB[left].priority < Q->PCB[smallest].priority) {
-      smallest = left;
-    }
+// Utilization bound test when a periodic task first becomes ready. EDF
+// schedules any set whose density is at most 1, RM any set within the
+// Liu-Layland bound n(2^(1/n) - 1). A task that does not fit runs
+// best-effort.
+static void rtAdmit(Process *p, int queue_type) {
+  p->rt_checked = true;
+  if (p->period <= 0) {
+    return;
+  }
+  int n = g_rt_tasks + 1;
+  double bound = (queue_type == DEADLINEHEAP) ? 1.0 : n * (pow(2.0, 1.0 / n) - 1.0);
+  double density = g_rt_density + rtDensity(p);
+  if (density > bound + 1e-9) {
+    log_debug("<system time %d> process %d rejected: utilization %.3f over the bound %.3f,"
+              " running best-effort\n", g_system_time, p->pid, density, bound);
+    record_admission_rejection(g_current_algorithm_id);
+    return;
+  }
+  p->realtime = true;
+  g_rt_density = density;
+  g_rt_tasks++;
+  log_debug("<system time %d> process %d admitted: period %d, deadline %d, wcet %d"
+            " (utilization %.3f)\n", g_system_time, p->pid, p->period, p->rel_deadline,
+            p->wcet, density);
+}
 
-    if (right < Q->next && Q->PCB[right].priority < Q->PCB[smallest].priority) {
-      smallest = right;
-    }
+// Hold a real-time process whose next job is not released yet. True if
+// it now waits for EVENT_RELEASE.
+static bool rtHold(ProcessHandle h) {
+  Process *p = pcb(h);
+  if (!p->realtime || p->job_release <= g_system_time) {
+    return false;
+  }
+  p->state = BLOCKED;
+  p->blocked_since = g_system_time;
+  event_schedule(g_events, p->job_release, EVENT_RELEASE, h);
+  return true;
+}
 
-    if (smallest != index) {
-      swap(Q, index, smallest);
-      index = smallest;
-    } else {
-      break;
-    }
+// The current job is done at `now`: account for it, move on to the next
+static void rtJobDone(Process *p, int now) {
+  if (!p->realtime || p->job_used == 0) {
+    return;
   }
-  return process;
+  int lateness = now - p->job_deadline;
+  record_job(g_current_algorithm_id, lateness);
+  if (lateness > 0) {
+    log_debug("<system time %d> process %d missed its deadline %d by %d\n",
+              now, p->pid, p->job_deadline, lateness);
+  }
+  p->job++;
+  p->job_release = p->arrival_time + p->job * p->period;
+  p->job_deadline = p->job_release + p->rel_deadline;
+  p->job_used = 0;
 }
 
-static void enqueueHelper(Process P, int queue_type) {
+static void enqueueHelper(ProcessHandle P, int queue_type) {
   switch(queue_type) {
     case NORMAL: enqueueGeneric(P, Ready_Queue); break;
-    case PRIORITYBURST: enqueueBurst(P, Ready_Queue); break;
-    case PRIORITYPRIORITY: enqueuePriority(P, Ready_Queue); break;
+    case PRIORITYBURST:
+    case PRIORITYPRIORITY: heap_push(Ready_Heap, P); break;
+    case PRIORITYRATIO:
+      kinetic_insert(Ready_Ratios, P, pcb(P)->arrival_time, pcb(P)->burstTime);
+      break;
+    case CFSTREE:
+      cfsPlace(pcb(P));
+      rb_insert(Ready_Tree, P);
+      g_cfs_load += cfsWeight(pcb(P));
+      break;
+    case LOTTERYTICKETS:
+      shareJoin(pcb(P));
+      tickets_set(Ready_Tickets, P, (uint64_t)pcb(P)->tickets);
+      break;
+    case STRIDEPASS:
+      // A newcomer starts level with the others instead of catching up
+      if (!pcb(P)->share_active && pcb(P)->pass < g_global_pass) {
+        pcb(P)->pass = g_global_pass;
+      }
+      shareJoin(pcb(P));
+      heap_push(Ready_Heap, P);
+      break;
+    case DEADLINEHEAP:
+    case RATEHEAP:
+      if (!pcb(P)->rt_checked) {
+        rtAdmit(pcb(P), queue_type);
+      }
+      // Between jobs a periodic task waits for its next release
+      if (!rtHold(P)) {
+        heap_push(Ready_Heap, P);
+      }
+      break;
+    case FEEDBACKLEVELS:
+      enqueueGeneric(P, Feedback_Queues[pcb(P)->mlfq_level]);
+      g_feedback_nonempty |= 1u << pcb(P)->mlfq_level;
+      g_feedback_ready++;
+      break;
     default: fprintf(stderr, "Unknown Queue Type\n"); break;
   }
 }
 
-static void enqueue(Process P, int queue_type) {
-  switch (P.state) {
+static void enqueue(ProcessHandle P, int queue_type) {
+  switch (pcb(P)->state) {
     case READY: enqueueHelper(P, queue_type); break; 
     case BLOCKED: enqueueGeneric(P, Blocked_Queue); break;
     case SUSPEND_READY: enqueueGeneric(P, Suspend_Ready_Queue); break;
@@ -357,59 +649,466 @@ static void enqueue(Process P, int queue_type) {
   }
 }
 
-static Process dequeue(Queue* Q, int queue_type) {
-  Process P;
+static ProcessHandle dequeue(Queue* Q, int queue_type) {
+  ProcessHandle P;
   switch(queue_type) {
     case NORMAL: P = dequeueGeneric(Q); break;
-    case PRIORITYBURST: P = dequeueBurst(Q); break;
-    case PRIORITYPRIORITY: P = dequeuePriority(Q); break;
-    default: P = (Process){0}; break;
+    case PRIORITYBURST:
+    case PRIORITYPRIORITY: P = heap_pop(Ready_Heap); break;
+    case PRIORITYRATIO:
+      kinetic_advance(Ready_Ratios, g_system_time);
+      P = kinetic_pop(Ready_Ratios);
+      break;
+    case CFSTREE:
+      P = rb_pop_first(Ready_Tree);
+      if (P != NO_PROCESS) {
+        g_cfs_load -= cfsWeight(pcb(P));
+      }
+      break;
+    case LOTTERYTICKETS: {
+      uint64_t total = tickets_total(Ready_Tickets);
+      if (total == 0) {
+        P = NO_PROCESS;
+        break;
+      }
+      // xorshift64: reproducible for a given seed
+      g_lottery_state ^= g_lottery_state << 13;
+      g_lottery_state ^= g_lottery_state >> 7;
+      g_lottery_state ^= g_lottery_state << 17;
+      P = tickets_draw(Ready_Tickets, g_lottery_state % total);
+      tickets_set(Ready_Tickets, P, 0);
+      break;
+    }
+    case STRIDEPASS:
+    case DEADLINEHEAP:
+    case RATEHEAP:
+      P = heap_pop(Ready_Heap);
+      break;
+    case FEEDBACKLEVELS: {
+      if (g_feedback_nonempty == 0) {
+        P = NO_PROCESS;
+        break;
+      }
+      // The lowest set bit is the highest level with work
+      int level = __builtin_ctz(g_feedback_nonempty);
+      P = dequeueGeneric(Feedback_Queues[level]);
+      if (Feedback_Queues[level]->count == 0) {
+        g_feedback_nonempty &= ~(1u << level);
+      }
+      g_feedback_ready--;
+      break;
+    }
+    default: P = NO_PROCESS; break;
   } 
   return P;
 }
 
 //-------------------------------------Scheduling Helpers-------------------------------------//
 
+// Turn every new process into an arrival event at its arrival time,
+// returns how many processes were submitted
+static int scheduleArrivals(void) {
+  int submitted = 0;
+  while (New_Queue->count != 0) {
+    ProcessHandle h = dequeue(New_Queue, NORMAL);
+    event_schedule(g_events, pcb(h)->arrival_time, EVENT_ARRIVAL, h);
+    submitted++;
+  }
+  return submitted;
+}
+
+// Is the running process waiting on a syscall it just made
+static inline bool ioPending(void) {
+  return THE_CPU.hw_registers[IO_AR] != 0;
+}
+
+// Park a process that made a blocking syscall at time `now` on
+// Blocked_Queue. Console reads complete in order, sleeps set a timer.
+static void blockOn(ProcessHandle h, int now) {
+  Process *p = pcb(h);
+  uint32_t code = p->cpu_state.hw_registers[IO_AR];
+  shareLeave(p);
+  p->state = BLOCKED;
+  p->blocked_since = now;
+  enqueue(h, NORMAL);
+  if (code == SYSCALL_SLEEP_MS) {
+    int64_t until = (int64_t)now + (int64_t)p->cpu_state.hw_registers[IO_BR] * g_ticks_per_ms;
+    int wake_time = (until >= EVENT_NEVER) ? EVENT_NEVER - 1 : (int)until;
+    event_schedule(g_events, wake_time, EVENT_TIMER, h);
+    log_debug("<system time %d> process %d sleeps until %d\n", now, p->pid, wake_time);
+  } else {
+    g_console_free = (g_console_free > now ? g_console_free : now) + CONSOLE_LATENCY;
+    event_schedule(g_events, g_console_free, EVENT_IO_COMPLETE, h);
+    log_debug("<system time %d> process %d blocked on console input\n", now, p->pid);
+  }
+}
+
+static void repayLoan(ProcessHandle h);
+
+// The blocking syscall of a parked process completed at `time`. A
+// suspended one stays in swap until the medium-term scheduler resumes it.
+// False if its input is not typed yet: it stays blocked and the console
+// looks again a little later, the CPU free for others meanwhile.
+static bool wake(ProcessHandle h, int time) {
+  Process *p = pcb(h);
+  if (!complete_syscall(&p->cpu_state, p->pid)) {
+    g_input_starved = true;
+    event_schedule(g_events, g_system_time + CONSOLE_LATENCY, EVENT_IO_COMPLETE, h);
+    return false;
+  }
+  repayLoan(h);
+  p->blocked_time += time - p->blocked_since;
+  if (p->state == SUSPEND_BLOCKED) {
+    removeFromQueue(Suspend_Blocked_Queue, h);
+    p->state = SUSPEND_READY;
+    enqueue(h, NORMAL);
+  } else {
+    removeFromQueue(Blocked_Queue, h);
+    p->state = READY;
+  }
+  return true;
+}
+
+// The multiprogramming level changes by delta now. The peak only counts
+// levels held for some time, not the instant between an arrival and
+// the medium-term scheduler swapping it out.
+static void noteResident(int delta) {
+  if (g_system_time > g_resident_since) {
+    g_resident_area += (double)g_resident * (double)(g_system_time - g_resident_since);
+    if (g_resident > g_peak_resident) {
+      g_peak_resident = g_resident;
+    }
+    g_resident_since = g_system_time;
+  }
+  g_resident += delta;
+}
+
+// The running process stopped on a blocking syscall: save it and park
+// it. False if it stopped for any other reason.
+static bool blockOnIO(ProcessHandle h) {
+  Process *p = pcb(h);
+  if (p->cpu_state.hw_registers[IO_AR] == 0 || p->burstTime <= 0 ||
+      p->cpu_state.hw_registers[PC] == CPU_HALT) {
+    return false;
+  }
+  blockOn(h, g_system_time);
+  return true;
+}
+
+// A process that blocked before using a full quantum, then waited at
+// least as long as it ran, looks interactive: it moves up a level with
+// a fresh allotment. Spinning almost to the end of a slice and sleeping
+// for a tick does not qualify, the CPU it used still counts against
+// its allotment.
+static void feedbackWake(Process *p, int time) {
+  int quantum = g_mlfq_quanta[p->mlfq_level];
+  if (p->mlfq_level > 0 && p->mlfq_burst < quantum &&
+      time - p->blocked_since >= p->mlfq_burst) {
+    p->mlfq_level--;
+    p->mlfq_used = 0;
+    log_debug("<system time %d> process %d promoted to level %d\n",
+              g_system_time, p->pid, p->mlfq_level);
+  }
+  p->mlfq_burst = 0;
+}
+
+// Apply every event that is due by now
 static void transferProcesses(int queue_type) {
-  while (New_Queue->next != 0) {
-    Process p = dequeue(New_Queue, NORMAL);
-    p.state = READY;
-    p.arrival_time = g_system_time;
-    enqueueHelper(p, queue_type);
+  Event ev;
+  while (event_pop_due(g_events, g_system_time, &ev)) {
+    switch (ev.type) {
+      case EVENT_ARRIVAL:
+        // Swapped out before it arrived, it has to be brought in first
+        if (pcb(ev.subject)->swapped_out) {
+          pcb(ev.subject)->state = SUSPEND_READY;
+          enqueue(ev.subject, NORMAL);
+          break;
+        }
+        pcb(ev.subject)->state = READY;
+        noteResident(1);
+        enqueueHelper(ev.subject, queue_type);
+        break;
+      case EVENT_IO_COMPLETE:
+      case EVENT_TIMER:
+        if (!wake(ev.subject, ev.time)) {
+          break;
+        }
+        if (queue_type == FEEDBACKLEVELS) {
+          feedbackWake(pcb(ev.subject), ev.time);
+        }
+        if (pcb(ev.subject)->state == READY) {
+          enqueueHelper(ev.subject, queue_type);
+        }
+        break;
+      case EVENT_SWAP_IN:
+        g_swapping_in--;
+        pcb(ev.subject)->state = READY;
+        noteResident(1);
+        log_debug("<system time %d> process %d swapped in\n", g_system_time, pcb(ev.subject)->pid);
+        enqueueHelper(ev.subject, queue_type);
+        break;
+      case EVENT_RELEASE: {
+        Process *p = pcb(ev.subject);
+        p->blocked_time += ev.time - p->blocked_since;
+        p->state = READY;
+        enqueueHelper(ev.subject, queue_type);
+        break;
+      }
+      default:
+        fprintf(stderr, "Unhandled event type %d at time %d\n", ev.type, ev.time);
+        break;
+    }
   }
 }
 
-static float calcResponseRatio(Process P, int idleTime) {
-  if (P.burstTime == 0) return 0.0f;
-  return (float)(idleTime + P.burstTime) / (float)P.burstTime;
+static size_t readyCount(int queue_type) {
+  switch (queue_type) {
+    case PRIORITYBURST:
+    case PRIORITYPRIORITY:
+    case STRIDEPASS:
+    case DEADLINEHEAP:
+    case RATEHEAP: return heap_size(Ready_Heap);
+    case PRIORITYRATIO: return kinetic_size(Ready_Ratios);
+    case CFSTREE: return rb_size(Ready_Tree);
+    case LOTTERYTICKETS: return tickets_size(Ready_Tickets);
+    case FEEDBACKLEVELS: return g_feedback_ready;
+    default: return (size_t)Ready_Queue->count;
+  }
 }
 
-static void updateResponseRatio(Queue* Q, int idleTime) {
-  for (int i = 0; i < Q->next; i++) {
-    Q->PCB[i].responseRatio = calcResponseRatio(Q->PCB[i], idleTime);
+//-------------------------------------Medium-Term Scheduling-------------------------------------//
+
+// Take a ready process back out of the ready structure
+static bool unready(ProcessHandle h, int queue_type) {
+  switch (queue_type) {
+    case PRIORITYBURST:
+    case PRIORITYPRIORITY:
+    case DEADLINEHEAP:
+    case RATEHEAP: return heap_remove(Ready_Heap, h);
+    case PRIORITYRATIO: return kinetic_remove(Ready_Ratios, h);
+    case CFSTREE:
+      if (!rb_remove(Ready_Tree, h)) {
+        return false;
+      }
+      g_cfs_load -= cfsWeight(pcb(h));
+      return true;
+    case LOTTERYTICKETS:
+      if (tickets_get(Ready_Tickets, h) == 0) {
+        return false;
+      }
+      tickets_set(Ready_Tickets, h, 0);
+      shareLeave(pcb(h));
+      return true;
+    case STRIDEPASS:
+      if (!heap_remove(Ready_Heap, h)) {
+        return false;
+      }
+      shareLeave(pcb(h));
+      return true;
+    case FEEDBACKLEVELS: {
+      int level = pcb(h)->mlfq_level;
+      if (!removeFromQueue(Feedback_Queues[level], h)) {
+        return false;
+      }
+      if (Feedback_Queues[level]->count == 0) {
+        g_feedback_nonempty &= ~(1u << level);
+      }
+      g_feedback_ready--;
+      return true;
+    }
+    default: return removeFromQueue(Ready_Queue, h);
   }
 }
 
-static int getHighestResponseRatioIndex(void) {
-  if (Ready_Queue->next == 0) return -1;
-  
-  int best = 0;
-  for (int i = 1; i < Ready_Queue->next; i++) {
-    if (Ready_Queue->PCB[i].responseRatio > Ready_Queue->PCB[best].responseRatio) {
-      best = i;
+// The process to suspend next, NO_PROCESS if there is none. Processes
+// that have not arrived yet go first, then blocked ones, then ready
+// ones, newest first within each, always leaving one ready to run.
+static ProcessHandle swapVictim(int queue_type) {
+  ProcessHandle victim = NO_PROCESS;
+  for (int i = 0; i < process_storage_index; i++) {
+    Process *p = pcb((ProcessHandle)i);
+    if (p->state == NEW && !p->swapped_out &&
+        (victim == NO_PROCESS || p->arrival_time >= pcb(victim)->arrival_time)) {
+      victim = (ProcessHandle)i;
     }
   }
-  return best;
+  if (victim != NO_PROCESS) {
+    return victim;
+  }
+
+  if (Blocked_Queue->count > 0) {
+    return queue_at(Blocked_Queue, Blocked_Queue->count - 1);
+  }
+
+  if (readyCount(queue_type) <= 1) {
+    return NO_PROCESS;
+  }
+  if (queue_type == NORMAL) {
+    return queue_at(Ready_Queue, Ready_Queue->count - 1);
+  }
+  for (int i = 0; i < process_storage_index; i++) {
+    Process *p = pcb((ProcessHandle)i);
+    if (p->state == READY && !p->swapped_out &&
+        (victim == NO_PROCESS || p->arrival_time >= pcb(victim)->arrival_time)) {
+      victim = (ProcessHandle)i;
+    }
+  }
+  return victim;
+}
+
+// Swap a process out to free its RAM. False if it could not be swapped.
+static bool suspend(ProcessHandle h, int queue_type) {
+  Process *p = pcb(h);
+  size_t bytes = get_process_ram(p->pid);
+  int ticks = swap_out(p->pid);
+  if (ticks < 0) {
+    return false;
+  }
+  // The swap device works through its transfers one at a time
+  int start = (g_swap_free > g_system_time) ? g_swap_free : g_system_time;
+  g_swap_free = start + ticks;
+  p->swapped_out = true;
+  p->swapped_bytes = bytes;
+  record_swap(g_current_algorithm_id, false, bytes, ticks);
+  log_debug("<system time %d> process %d swapped out (%zu bytes)\n", g_system_time, p->pid, bytes);
+
+  switch (p->state) {
+    case BLOCKED:
+      removeFromQueue(Blocked_Queue, h);
+      p->state = SUSPEND_BLOCKED;
+      enqueue(h, NORMAL);
+      noteResident(-1);
+      break;
+    case READY:
+      unready(h, queue_type);
+      p->state = SUSPEND_READY;
+      enqueue(h, NORMAL);
+      noteResident(-1);
+      break;
+    default: break; // Not arrived yet, it arrives suspended
+  }
+  return true;
+}
+
+// Start reading a suspended process back in, it is ready again once the
+// swap device gets through the transfer
+static void resume(ProcessHandle h) {
+  Process *p = pcb(h);
+  int ticks = swap_in(p->pid);
+  if (ticks < 0) {
+    fprintf(stderr, "resume: process %d cannot be swapped back in\n", p->pid);
+    exit(EXIT_FAILURE);
+  }
+  int start = (g_swap_free > g_system_time) ? g_swap_free : g_system_time;
+  g_swap_free = start + ticks;
+  p->swapped_out = false;
+  g_swapping_in++;
+  event_schedule(g_events, g_swap_free, EVENT_SWAP_IN, h);
+  record_swap(g_current_algorithm_id, true, p->swapped_bytes, ticks);
+  log_debug("<system time %d> process %d swapping in, ready at %d\n",
+            g_system_time, p->pid, g_swap_free);
+}
+
+static size_t freeRam(void) {
+  return get_free_ram() + g_retained_ram;
+}
+
+// The medium-term scheduler. While free RAM is below the watermark it
+// suspends processes; it resumes them while there is room above the
+// watermark, or on demand once nothing else is left to run.
+static void balanceMemory(int queue_type) {
+  if (g_swap_watermark == 0) {
+    return;
+  }
+  while (freeRam() < g_swap_watermark) {
+    ProcessHandle victim = swapVictim(queue_type);
+    if (victim == NO_PROCESS || !suspend(victim, queue_type)) {
+      break;
+    }
+  }
+  while (Suspend_Ready_Queue->count > 0) {
+    ProcessHandle h = queue_at(Suspend_Ready_Queue, 0);
+    bool room = freeRam() >= g_swap_watermark + pcb(h)->swapped_bytes;
+    bool starved = readyCount(queue_type) == 0 && g_swapping_in == 0;
+    if (!room && !starved) {
+      break;
+    }
+    dequeueGeneric(Suspend_Ready_Queue);
+    resume(h);
+  }
+}
+
+// In a paced run, wait until the host clock catches up with the
+// simulated one. Only the idle jumps and slice ends wait, a busy
+// process still runs flat out in between.
+static void pace(void) {
+  if (!g_paced) {
+    return;
+  }
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t elapsed_ns = (int64_t)(now.tv_sec - g_pace_start.tv_sec) * 1000000000
+                     + (now.tv_nsec - g_pace_start.tv_nsec);
+  int64_t due_ns = (int64_t)g_system_time * 1000000 / g_ticks_per_ms;
+  if (due_ns <= elapsed_ns) {
+    return;
+  }
+  struct timespec wait = { (time_t)((due_ns - elapsed_ns) / 1000000000),
+                           (long)((due_ns - elapsed_ns) % 1000000000) };
+  while (nanosleep(&wait, &wait) == -1) {
+    continue;
+  }
+}
+
+// Nothing can run before `until`, jump the clock there instead of ticking
+static void skipIdle(int until) {
+  if (until <= g_system_time) {
+    return;
+  }
+  log_debug("<system time %d> CPU idle until %d\n", g_system_time, until);
+  record_idle_time(g_current_algorithm_id, until - g_system_time);
+  g_system_time = until;
+  pace();
+  if (g_input_starved && !g_paced) {
+    // Nothing to run but a process waiting on someone typing: give them
+    // host time rather than spinning the clock ahead poll after poll
+    struct timespec wait = { 0, 1000000 };
+    nanosleep(&wait, NULL);
+  }
+  g_input_starved = false;
+}
+
+// Admit whatever is due and, while nothing is runnable, skip ahead to
+// the next event. False once the run is over.
+static bool awaitWork(int queue_type) {
+  transferProcesses(queue_type);
+  balanceMemory(queue_type);
+  while (readyCount(queue_type) == 0) {
+    int next = event_next_time(g_events);
+    if (next == EVENT_NEVER) {
+      return false;
+    }
+    skipIdle(next);
+    transferProcesses(queue_type);
+    balanceMemory(queue_type);
+  }
+  return true;
+}
+
+// (waiting + service) / service, as HRRN ranks it
+static float calcResponseRatio(const Process* P, int waitTime) {
+  if (P->burstTime == 0) return 0.0f;
+  return (float)(waitTime + P->burstTime) / (float)P->burstTime;
 }
 
-static void record_process_completion(Process *p) {
-  p->completion_time = g_system_time;
+static void record_process_completion(Process *p, int now) {
+  p->completion_time = now;
   // Use the actual CPU time consumed instead of the initial burst estimate.
   int actual_cpu_time = p->originalBurstTime - p->burstTime;
   if (actual_cpu_time < 0) {
     actual_cpu_time = 0;
   }
-  p->waiting_time = p->completion_time - p->arrival_time - actual_cpu_time;
+  p->waiting_time = p->completion_time - p->arrival_time - actual_cpu_time - p->blocked_time;
   if (p->waiting_time < 0) {
     p->waiting_time = 0;
   }
@@ -426,18 +1125,224 @@ static void record_process_completion(Process *p) {
       p->response_time,
       p->priority
     );
+    if (g_share_run) {
+      record_process_share(g_current_algorithm_id, p->pid, p->expected_cpu);
+    }
   }
 }
 
-//-------------------------------------Process Creation-------------------------------------//
+// The first dispatch of a process fixes its start and response time
+static void note_first_run(Process *p, int now) {
+  if (!p->has_started) {
+    p->has_started = true;
+    p->start_time = now;
+    p->response_time = now - p->arrival_time;
+  }
+}
 
-static Process global_process_storage[MAX_PROCESSES];
-static int process_storage_index = 0;
+// Load a process onto the CPU: response bookkeeping, its register
+// file, its memory rights and its console buffer
+static Process *dispatch(ProcessHandle h) {
+  Process *p = pcb(h);
+  g_running = h;
+  note_first_run(p, g_system_time);
+  p->state = RUNNING;
+  set_current_process(p->pid);
+  console_attach(p->pid);
+  keyboard_attach(p->pid);
+  THE_CPU = p->cpu_state;
+  record_context_switch(g_current_algorithm_id);
+  return p;
+}
+
+// Take the register file back off the CPU at the end of a slice, and
+// write out what the process printed during it
+static void saveContext(Process *p) {
+  p->cpu_state = THE_CPU;
+  console_flush();
+  pace();
+}
+
+// Has the running process stopped on its own: halted, out of burst, or
+// waiting on a syscall
+static inline bool stoppedRunning(const Process *p) {
+  return p->burstTime <= 0 || THE_CPU.hw_registers[PC] == CPU_HALT || ioPending();
+}
+
+// Run the dispatched process back to back until something needs the
+// scheduler: the timer fires, the next event falls due, or the process
+// stops on its own. Nothing else can happen in between, so there is
+// nothing to check per instruction. Returns the ticks it ran.
+static int runUntilInterrupt(Process *p) {
+  int until = timer_deadline();
+  int next = event_next_time(g_events);
+  if (next < until) {
+    until = next;
+  }
+  int ran = 0;
+  while (g_system_time < until && !stoppedRunning(p)) {
+    fetch();
+    execute();
+    p->burstTime--;
+    g_system_time++;
+    ran++;
+  }
+  timer_advance(g_system_time);
+  return ran;
+}
+
+// Service pending interrupts, true if the quantum expired
+static bool quantumExpired(void) {
+  bool expired = false;
+  Interrupt intr;
+  while (check_for_interrupt(&intr)) {
+    switch (intr.irq) {
+      case IRQ_TIMER: expired = true; break;
+      default:
+        fprintf(stderr, "Unhandled IRQ %d at time %d\n", intr.irq, g_system_time);
+        break;
+    }
+  }
+  return expired;
+}
+
+//-------------------------------------Tickets-------------------------------------//
+
+// Change a process's tickets, keeping the lottery tree and the share
+// accounting in step. Stride keeps its pass, only its stride changes.
+static void setTickets(ProcessHandle h, int tickets) {
+  Process *p = pcb(h);
+  if (tickets < 1) tickets = 1;
+  if (tickets > MAX_TICKETS) tickets = MAX_TICKETS;
+  shareSettle(p);
+  if (p->share_active) {
+    g_active_tickets -= (uint64_t)p->tickets;
+    g_active_tickets += (uint64_t)tickets;
+  }
+  p->tickets = tickets;
+  if (Ready_Tickets && tickets_get(Ready_Tickets, h) > 0) {
+    tickets_set(Ready_Tickets, h, (uint64_t)tickets);
+  }
+}
+
+// Lent tickets stay with the borrower until the lender wakes from its
+// next blocking syscall, or finishes: lend, then wait on the borrower
+static void repayLoan(ProcessHandle h) {
+  Process *p = pcb(h);
+  if (p->lent_to == NO_PROCESS) {
+    return;
+  }
+  Process *borrower = pcb(p->lent_to);
+  if (borrower->state != FINISHED) {
+    int back = (borrower->tickets - 1 < p->lent) ? borrower->tickets - 1 : p->lent;
+    setTickets(p->lent_to, borrower->tickets - back);
+  }
+  setTickets(h, p->tickets + p->lent);
+  p->lent_to = NO_PROCESS;
+  p->lent = 0;
+}
+
+// SYSCALL_SET_TICKETS and SYSCALL_LEND_TICKETS, on behalf of the
+// running process
+static uint32_t ticketSyscall(uint32_t code, uint32_t a0, uint32_t a1) {
+  if (g_running == NO_PROCESS) {
+    return 0;
+  }
+  Process *p = pcb(g_running);
+  if (code == SYSCALL_SET_TICKETS) {
+    int old = p->tickets;
+    if (a0 > 0) {
+      setTickets(g_running, a0 > MAX_TICKETS ? MAX_TICKETS : (int)a0);
+      log_debug("<system time %d> process %d now holds %d tickets\n",
+                g_system_time, p->pid, p->tickets);
+    }
+    return (uint32_t)old;
+  }
+
+  ProcessHandle to = NO_PROCESS;
+  for (int i = 0; i < process_storage_index; i++) {
+    if (pcb((ProcessHandle)i)->pid == (int)a0 && pcb((ProcessHandle)i)->state != FINISHED &&
+        (ProcessHandle)i != g_running) {
+      to = (ProcessHandle)i;
+    }
+  }
+  if (to == NO_PROCESS) {
+    return 0;
+  }
+  // One loan at a time, and the lender keeps a ticket
+  repayLoan(g_running);
+  int amount = (a1 < (uint32_t)p->tickets) ? (int)a1 : p->tickets - 1;
+  if (amount <= 0) {
+    return 0;
+  }
+  setTickets(g_running, p->tickets - amount);
+  setTickets(to, pcb(to)->tickets + amount);
+  p->lent_to = to;
+  p->lent = amount;
+  log_debug("<system time %d> process %d lends %d tickets to process %d\n",
+            g_system_time, p->pid, amount, pcb(to)->pid);
+  return (uint32_t)amount;
+}
+
+// The syscalls only the OS can answer. get_time_ms reads the simulated
+// clock, so a run gives the same answers however fast the host is.
+static uint32_t osSyscall(uint32_t code, uint32_t a0, uint32_t a1) {
+  if (code == SYSCALL_GET_TIME_MS) {
+    // Wraps like a 32-bit millisecond counter would
+    return (uint32_t)(g_system_time / g_ticks_per_ms);
+  }
+  return ticketSyscall(code, a0, a1);
+}
+
+// The running process finished at `now`, account for it and free its memory
+static void retireAt(Process *p, int now) {
+  repayLoan((ProcessHandle)(p - global_process_storage));
+  shareLeave(p);
+  rtJobDone(p, now);
+  if (p->realtime) {
+    g_rt_density -= rtDensity(p);
+    g_rt_tasks--;
+  }
+  p->state = FINISHED;
+  log_debug("<system time %d> process %d finished.\n", now, p->pid);
+  keyboard_release(p->pid);
+  record_process_completion(p, now);
+  liberate(p->pid);
+  g_retained_ram += get_process_ram(p->pid);
+  noteResident(-1);
+}
+
+// The same on the one CPU, where it finished at the current time
+static void retire(Process *p) {
+  retireAt(p, g_system_time);
+}
+
+//-------------------------------------Process Creation-------------------------------------//
 
 // Public function to reset process storage between algorithm runs
 void reset_process_storage(void) {
   process_storage_index = 0;
-  memset(global_process_storage, 0, sizeof(global_process_storage));
+  if (global_process_storage) {
+    memset(global_process_storage, 0, (size_t)process_storage_capacity * sizeof(Process));
+  }
+}
+
+// Make room for one more PCB, doubling the arena when it is full
+static void reserve_process_storage(void) {
+  if (process_storage_index < process_storage_capacity) {
+    return;
+  }
+  int capacity = process_storage_capacity ? process_storage_capacity * 2
+                                          : STORAGE_INITIAL_CAPACITY;
+  Process* grown = realloc(global_process_storage, (size_t)capacity * sizeof(Process));
+  if (!grown) {
+    perror("realloc process storage");
+    exit(EXIT_FAILURE);
+  }
+  memset(grown + process_storage_capacity, 0,
+         (size_t)(capacity - process_storage_capacity) * sizeof(Process));
+  global_process_storage = grown;
+  process_storage_capacity = capacity;
 }
 
 uint32_t makeProcess(int pID, 
@@ -448,19 +1353,25 @@ uint32_t makeProcess(int pID,
                      uint32_t data_size,
                      uint32_t stack_ptr,
                      int priority, 
-                     int burstTime) {
+                     int burstTime,
+                     int arrival_time,
+                     uint64_t hard_affinity,
+                     uint64_t soft_affinity,
+                     RealTimeParams realtime) {
   
-  if (process_storage_index >= MAX_PROCESSES) {
-    fprintf(stderr, "makeProcess: Too many processes (max %d)\n", MAX_PROCESSES);
+  if (text_start == UINT32_MAX) {
+    fprintf(stderr, "makeProcess: Invalid text_start address for PID %d\n", pID);
     return UINT32_MAX;
   }
 
-  if (text_start == UINT32_MAX) {
-    fprintf(stderr, "makeProcess: Invalid text_start address for PID %d\n", pID);
+  if (process_storage_index == INT_MAX) {
+    fprintf(stderr, "makeProcess: Out of process handles\n");
     return UINT32_MAX;
   }
+  reserve_process_storage();
 
-  Process* newProcess = &global_process_storage[process_storage_index++];
+  ProcessHandle handle = (ProcessHandle)process_storage_index++;
+  Process* newProcess = pcb(handle);
   
   newProcess->pid = pID;
   newProcess->pc = entry_point;
@@ -469,7 +1380,29 @@ uint32_t makeProcess(int pID,
   newProcess->burstTime = burstTime;
   newProcess->originalBurstTime = burstTime;
   newProcess->responseRatio = 0;
+  newProcess->vruntime = 0;
+  newProcess->tickets = ticketsFor(priority);
+  newProcess->pass = 0;
+  newProcess->lent_to = NO_PROCESS;
+  newProcess->lent = 0;
+  newProcess->period = realtime.period > 0 ? realtime.period : 0;
+  newProcess->rel_deadline = realtime.deadline > 0 ? realtime.deadline : newProcess->period;
+  newProcess->wcet = realtime.wcet;
+  newProcess->rt_checked = false;
+  newProcess->realtime = false;
+  newProcess->job = 0;
+  newProcess->job_release = arrival_time;
+  newProcess->job_deadline = arrival_time + newProcess->rel_deadline;
+  newProcess->job_used = 0;
+  newProcess->mlfq_level = 0;
+  newProcess->mlfq_used = 0;
+  newProcess->mlfq_burst = 0;
   newProcess->has_started = false;
+  newProcess->last_core = -1;
+  newProcess->hard_affinity = hard_affinity;
+  newProcess->soft_affinity = soft_affinity;
+  newProcess->cache_footprint = 0;
+  newProcess->slice_l1_misses = 0;
   
   newProcess->text_start = text_start;
   newProcess->text_size = text_size;
@@ -478,7 +1411,7 @@ uint32_t makeProcess(int pID,
   newProcess->stack_ptr = stack_ptr;
   
   // Performance tracking initialization
-  newProcess->arrival_time = 0;
+  newProcess->arrival_time = arrival_time;
   newProcess->start_time = -1;
   newProcess->completion_time = 0;
   newProcess->waiting_time = 0;
@@ -491,19 +1424,27 @@ uint32_t makeProcess(int pID,
   newProcess->cpu_state.gp_registers[REG_GP] = data_start;
   newProcess->cpu_state.gp_registers[REG_ZERO] = 0;
   
-  enqueue(*newProcess, NORMAL);
+  enqueue(handle, NORMAL);
   
-  printf("  ✓ Process created:\n");
-  printf("      PID: %d\n", pID);
-  printf("      PC:  0x%08x\n", entry_point);
-  printf("      SP:  0x%08x\n", stack_ptr);
-  printf("      Text: 0x%08x - 0x%08x (%u bytes)\n", 
-         text_start, text_start + text_size, text_size);
+  log_info("  ✓ Process created:\n");
+  log_info("      PID: %d\n", pID);
+  log_info("      PC:  0x%08x\n", entry_point);
+  log_info("      SP:  0x%08x\n", stack_ptr);
+  log_info("      Text: 0x%08x - 0x%08x (%u bytes)\n", 
+           text_start, text_start + text_size, text_size);
   if (data_size > 0) {
-    printf("      Data: 0x%08x - 0x%08x (%u bytes)\n", 
-           data_start, data_start + data_size, data_size);
+    log_info("      Data: 0x%08x - 0x%08x (%u bytes)\n", 
+             data_start, data_start + data_size, data_size);
+  }
+  log_info("      Priority: %d, Burst: %d, Arrival: %d\n", priority, burstTime, arrival_time);
+  if (newProcess->period > 0) {
+    log_info("      Period: %d, Deadline: %d, WCET: %d\n",
+             newProcess->period, newProcess->rel_deadline, newProcess->wcet);
+  }
+  if (hard_affinity || soft_affinity) {
+    log_info("      Affinity: hard 0x%llx, soft 0x%llx\n",
+             (unsigned long long)hard_affinity, (unsigned long long)soft_affinity);
   }
-  printf("      Priority: %d, Burst: %d\n", priority, burstTime);
   
   return entry_point;
 }
@@ -516,56 +1457,40 @@ static void roundRobin(void) {
   g_system_time = 0;
   transferProcesses(NORMAL);
 
-  printf("\nScheduling algorithm: Round Robin\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
-
-  while (Ready_Queue->next > 0) {
-    Process *p = &Ready_Queue->PCB[0];
-    
-    // Record response time on first execution
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
-    }
+  log_info("\nScheduling algorithm: Round Robin\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
 
-    printf("<system time %d> process %d starts running\n", g_system_time, p->pid);
+  while (awaitWork(NORMAL)) {
+    ProcessHandle h = dequeueGeneric(Ready_Queue);
+    log_debug("<system time %d> process %d starts running\n", g_system_time, pcb(h)->pid);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
-
-    int slice = (p->burstTime < QUANTUM) ? p->burstTime : QUANTUM;
-    for (int i = 0; i < slice; i++) {
-      if (THE_CPU.hw_registers[PC] == CPU_HALT) break;
-      fetch();
-      execute();
-      if (p->burstTime > 0) {
-        p->burstTime--;
-        g_system_time++;
-      }
-    }
-
-    p->cpu_state = THE_CPU;
-    double ctx_time = perf_timer_end(&timer);
-    record_context_switch_time(g_current_algorithm_id, ctx_time);
+    Process *p = dispatch(h);
+
+    // Arrivals and wake-ups during the slice queue up ahead of it
+    timer_set(g_system_time + QUANTUM);
+    do {
+      runUntilInterrupt(p);
+      if (stoppedRunning(p)) break;
+      transferProcesses(NORMAL);
+    } while (!quantumExpired());
+    timer_cancel();
+
+    saveContext(p);
+    double ctx_time = perf_timer_end(&timer);
+    record_context_switch_time(g_current_algorithm_id, ctx_time);
 
     bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
     if (finished) {
-      printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-      record_process_completion(p);
-      liberate(p->pid);
-      shift_ready_left();
-    } else {
-      Process tmp = *p;
-      shift_ready_left();
-      push_ready_back(tmp);
+      retire(p);
+    } else if (!blockOnIO(h)) {
+      p->state = READY;
+      enqueueGeneric(h, Ready_Queue);
     }
   }
 
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
@@ -575,44 +1500,34 @@ static void firstComeFirstServe(void) {
   g_system_time = 0;
   transferProcesses(NORMAL);
   
-  printf("\nScheduling algorithm: FCFS\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
+  log_info("\nScheduling algorithm: FCFS\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
   
-  while (Ready_Queue->next > 0) {
-    Process *p = &Ready_Queue->PCB[0];
-    
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
-    }
-    
-    printf("<system time %d> process %d starts running\n", g_system_time, p->pid);
+  while (awaitWork(NORMAL)) {
+    ProcessHandle h = dequeueGeneric(Ready_Queue);
+    log_debug("<system time %d> process %d starts running\n", g_system_time, pcb(h)->pid);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
+    Process *p = dispatch(h);
     
-    while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
+    while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT && !ioPending()) {
       fetch();
       execute();
       p->burstTime--;
       g_system_time++;
     }
     
-    p->cpu_state = THE_CPU;
+    saveContext(p);
     double ctx_time = perf_timer_end(&timer);
     record_context_switch_time(g_current_algorithm_id, ctx_time);
     
-    printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-    record_process_completion(p);
-    liberate(p->pid);
-    shift_ready_left();
+    if (!blockOnIO(h)) {
+      retire(p);
+    }
   }
   
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
@@ -620,47 +1535,39 @@ static void shortestProcessNext(void) {
   PerfTimer timer;
   
   g_system_time = 0;
+  Ready_Heap = heap_create(QUEUE_INITIAL_CAPACITY, burstBefore, NULL);
   transferProcesses(PRIORITYBURST);
   
-  printf("\nScheduling algorithm: SPN (Shortest Process Next)\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
+  log_info("\nScheduling algorithm: SPN (Shortest Process Next)\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
   
-  while (Ready_Queue->next > 0) {
-    Process *p = &Ready_Queue->PCB[0];
-    
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
-    }
-    
-    printf("<system time %d> process %d starts running\n", g_system_time, p->pid);
+  while (awaitWork(PRIORITYBURST)) {
+    ProcessHandle h = heap_pop(Ready_Heap);
+    log_debug("<system time %d> process %d starts running\n", g_system_time, pcb(h)->pid);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
+    Process *p = dispatch(h);
     
-    while(p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
+    while(p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT && !ioPending()) {
       fetch();
       execute();
       p->burstTime--;
       g_system_time++;
     }
     
-    p->cpu_state = THE_CPU;
+    saveContext(p);
     double ctx_time = perf_timer_end(&timer);
     record_context_switch_time(g_current_algorithm_id, ctx_time);
     
-    printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-    record_process_completion(p);
-    liberate(p->pid);
-    dequeueGeneric(Ready_Queue);
-    transferProcesses(PRIORITYBURST);
+    if (!blockOnIO(h)) {
+      retire(p);
+    }
   }
   
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  heap_destroy(Ready_Heap);
+  Ready_Heap = NULL;
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
@@ -668,56 +1575,53 @@ static void priorityBased(void) {
   PerfTimer timer;
   
   g_system_time = 0;
+  Ready_Heap = heap_create(QUEUE_INITIAL_CAPACITY, priorityBefore, NULL);
   transferProcesses(PRIORITYPRIORITY);
   
-  printf("\nScheduling algorithm: Priority\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
+  log_info("\nScheduling algorithm: Priority\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
   
-  while (Ready_Queue->next > 0) {
-    Process *p = &Ready_Queue->PCB[0];
-    
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
-    }
+  while (awaitWork(PRIORITYPRIORITY)) {
+    ProcessHandle h = heap_pop(Ready_Heap);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
+    Process *p = dispatch(h);
     
+    bool preempted = false;
     while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
       fetch();
       execute();
       p->burstTime--;
       g_system_time++;
+      if (ioPending()) break;
       
       transferProcesses(PRIORITYPRIORITY);
       
-      if (Ready_Queue->next > 1 && Ready_Queue->PCB[1].priority < p->priority) {
-        p->cpu_state = THE_CPU;
-        Process tmp = *p;
-        dequeueGeneric(Ready_Queue);
-        enqueuePriority(tmp, Ready_Queue);
+      // The heap top is the best waiting process
+      ProcessHandle next = heap_peek(Ready_Heap);
+      if (next != NO_PROCESS && pcb(next)->priority < p->priority) {
+        saveContext(p);
+        p->state = READY;
+        heap_push(Ready_Heap, h);
         double ctx_time = perf_timer_end(&timer);
         record_context_switch_time(g_current_algorithm_id, ctx_time);
+        preempted = true;
         break;
       }
     }
     
-    bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
-    if (finished) {
-      p->cpu_state = THE_CPU;
-      printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-      record_process_completion(p);
-      liberate(p->pid);
-      dequeueGeneric(Ready_Queue);
+    if (!preempted) {
+      saveContext(p);
+      if (!blockOnIO(h)) {
+        retire(p);
+      }
     }
   }
   
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  heap_destroy(Ready_Heap);
+  Ready_Heap = NULL;
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
@@ -725,56 +1629,53 @@ static void shortestRemainingTime(void) {
   PerfTimer timer;
   
   g_system_time = 0;
+  Ready_Heap = heap_create(QUEUE_INITIAL_CAPACITY, burstBefore, NULL);
   transferProcesses(PRIORITYBURST);
   
-  printf("\nScheduling algorithm: SRT (Shortest Remaining Time)\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
+  log_info("\nScheduling algorithm: SRT (Shortest Remaining Time)\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
   
-  while (Ready_Queue->next > 0) {
-    Process *p = &Ready_Queue->PCB[0];
-    
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
-    }
+  while (awaitWork(PRIORITYBURST)) {
+    ProcessHandle h = heap_pop(Ready_Heap);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
+    Process *p = dispatch(h);
     
+    bool preempted = false;
     while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
       fetch();
       execute();
       p->burstTime--;
       g_system_time++;
+      if (ioPending()) break;
       
       transferProcesses(PRIORITYBURST);
       
-      if (Ready_Queue->next > 1 && Ready_Queue->PCB[1].burstTime < p->burstTime) {
-        p->cpu_state = THE_CPU;
-        Process tmp = *p;
-        dequeueGeneric(Ready_Queue);
-        enqueueBurst(tmp, Ready_Queue);
+      // The heap top is the shortest waiting process
+      ProcessHandle next = heap_peek(Ready_Heap);
+      if (next != NO_PROCESS && pcb(next)->burstTime < p->burstTime) {
+        saveContext(p);
+        p->state = READY;
+        heap_push(Ready_Heap, h);
         double ctx_time = perf_timer_end(&timer);
         record_context_switch_time(g_current_algorithm_id, ctx_time);
+        preempted = true;
         break;
       }
     }
     
-    bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
-    if (finished) {
-      p->cpu_state = THE_CPU;
-      printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-      record_process_completion(p);
-      liberate(p->pid);
-      dequeueGeneric(Ready_Queue);
+    if (!preempted) {
+      saveContext(p);
+      if (!blockOnIO(h)) {
+        retire(p);
+      }
     }
   }
   
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  heap_destroy(Ready_Heap);
+  Ready_Heap = NULL;
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
@@ -782,196 +1683,904 @@ static void highestResponseRatioNext(void) {
   PerfTimer timer;
   
   g_system_time = 0;
-  transferProcesses(NORMAL);
-  
-  printf("\nScheduling algorithm: HRRN (Highest Response Ratio Next)\n");
-  printf("Total %d tasks to be scheduled\n", Ready_Queue->next);
-  printf("=============================\n");
+  Ready_Ratios = kinetic_create(QUEUE_INITIAL_CAPACITY);
+  transferProcesses(PRIORITYRATIO);
   
-  int total_time = 0;
+  log_info("\nScheduling algorithm: HRRN (Highest Response Ratio Next)\n");
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
   
-  while (Ready_Queue->next > 0) {
-    updateResponseRatio(Ready_Queue, total_time);
+  while (awaitWork(PRIORITYRATIO)) {
+    ProcessHandle h = dequeue(NULL, PRIORITYRATIO);
+    Process *p = pcb(h);
+    p->responseRatio = calcResponseRatio(p, g_system_time - p->arrival_time);
+    log_debug("<system time %d> process %d starts running\n", g_system_time, p->pid);
     
-    int best_idx = getHighestResponseRatioIndex();
-    if (best_idx < 0) break;
+    perf_timer_start(&timer);
+    dispatch(h);
     
-    if (best_idx != 0) {
-      swap(Ready_Queue, 0, best_idx);
+    while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT && !ioPending()) {
+      fetch();
+      execute();
+      p->burstTime--;
+      g_system_time++;
     }
     
-    Process *p = &Ready_Queue->PCB[0];
+    saveContext(p);
+    double ctx_time = perf_timer_end(&timer);
+    record_context_switch_time(g_current_algorithm_id, ctx_time);
     
-    if (!p->has_started) {
-      p->has_started = true;
-      p->start_time = g_system_time;
-      p->response_time = g_system_time - p->arrival_time;
+    if (!blockOnIO(h)) {
+      retire(p);
     }
-    
-    printf("<system time %d> process %d starts running\n", g_system_time, p->pid);
+  }
+  
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  kinetic_destroy(Ready_Ratios);
+  Ready_Ratios = NULL;
+  set_current_process(SYSTEM_PROCESS_ID);
+}
+
+// Charge `ticks` of CPU to p, scaled so a heavier process ages slower
+static void cfsCharge(Process *p, int ticks) {
+  p->vruntime += (uint64_t)ticks * NICE_0_WEIGHT * VRUNTIME_SCALE / cfsWeight(p);
+
+  // min_vruntime follows the least of the running and waiting processes
+  uint64_t least = p->vruntime;
+  ProcessHandle first = rb_first(Ready_Tree);
+  if (first != NO_PROCESS && pcb(first)->vruntime < least) {
+    least = pcb(first)->vruntime;
+  }
+  if (least > g_min_vruntime) {
+    g_min_vruntime = least;
+  }
+}
+
+// The running process's share of the scheduling period. The period is
+// the target latency, stretched when there are too many processes to
+// give each the minimum granularity within it.
+static int cfsSlice(const Process *p) {
+  uint64_t weight = cfsWeight(p);
+  uint64_t running = rb_size(Ready_Tree) + 1;
+  uint64_t period = (uint64_t)g_cfs_latency;
+  if (running * (uint64_t)g_cfs_granularity > period) {
+    period = running * (uint64_t)g_cfs_granularity;
+  }
+  int slice = (int)(period * weight / (g_cfs_load + weight));
+  return slice > g_cfs_granularity ? slice : g_cfs_granularity;
+}
+
+static void completelyFair(void) {
+  PerfTimer timer;
+  
+  g_system_time = 0;
+  g_min_vruntime = 0;
+  g_cfs_load = 0;
+  Ready_Tree = rb_create(QUEUE_INITIAL_CAPACITY, vruntimeBefore, NULL);
+  transferProcesses(CFSTREE);
+  
+  log_info("\nScheduling algorithm: CFS (Completely Fair Scheduler)\n");
+  log_info("Target latency %d, minimum granularity %d\n", g_cfs_latency, g_cfs_granularity);
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
+  
+  while (awaitWork(CFSTREE)) {
+    ProcessHandle h = dequeue(NULL, CFSTREE);
+    Process *p = pcb(h);
+    log_debug("<system time %d> process %d starts running\n", g_system_time, p->pid);
     
     perf_timer_start(&timer);
-    set_current_process(p->pid);
-    THE_CPU = p->cpu_state;
-    record_context_switch(g_current_algorithm_id);
-    
-    int process_time = p->burstTime;
+    dispatch(h);
     
+    int slice = cfsSlice(p);
+    int ran = 0;
+    bool preempted = false;
     while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
       fetch();
       execute();
       p->burstTime--;
       g_system_time++;
+      cfsCharge(p, 1);
+      if (ioPending()) break;
+      
+      transferProcesses(CFSTREE);
+      if (++ran < slice) {
+        continue;
+      }
+      
+      // Slice used up: step aside only for someone further behind,
+      // otherwise carry on without a context switch
+      ProcessHandle next = rb_first(Ready_Tree);
+      if (next != NO_PROCESS && pcb(next)->vruntime < p->vruntime) {
+        saveContext(p);
+        p->state = READY;
+        enqueueHelper(h, CFSTREE);
+        double ctx_time = perf_timer_end(&timer);
+        record_context_switch_time(g_current_algorithm_id, ctx_time);
+        preempted = true;
+        break;
+      }
+      slice = cfsSlice(p);
+      ran = 0;
+    }
+    
+    if (!preempted) {
+      saveContext(p);
+      double ctx_time = perf_timer_end(&timer);
+      record_context_switch_time(g_current_algorithm_id, ctx_time);
+      if (!blockOnIO(h)) {
+        retire(p);
+      }
+    }
+  }
+  
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  rb_destroy(Ready_Tree);
+  Ready_Tree = NULL;
+  set_current_process(SYSTEM_PROCESS_ID);
+}
+
+// Lottery (draw a ticket from the tree) or stride (lowest pass from the
+// heap) with a fixed quantum. Every tick is charged to the entitlement
+// of the ready and running processes so the share each achieved can be
+// set against the share its tickets promised.
+static void proportionalShare(int queue_type) {
+  PerfTimer timer;
+  
+  g_system_time = 0;
+  g_share_clock = 0.0;
+  g_active_tickets = 0;
+  g_global_pass = 0;
+  g_lottery_state = g_lottery_seed ? g_lottery_seed : 1;
+  if (queue_type == LOTTERYTICKETS) {
+    Ready_Tickets = tickets_create(QUEUE_INITIAL_CAPACITY);
+  } else {
+    Ready_Heap = heap_create(QUEUE_INITIAL_CAPACITY, passBefore, NULL);
+  }
+  transferProcesses(queue_type);
+  
+  if (queue_type == LOTTERYTICKETS) {
+    log_info("\nScheduling algorithm: Lottery (seed %llu)\n", (unsigned long long)g_lottery_seed);
+  } else {
+    log_info("\nScheduling algorithm: Stride\n");
+  }
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
+  
+  while (awaitWork(queue_type)) {
+    ProcessHandle h = dequeue(NULL, queue_type);
+    log_debug("<system time %d> process %d starts running (%d tickets)\n",
+              g_system_time, pcb(h)->pid, pcb(h)->tickets);
+    
+    perf_timer_start(&timer);
+    Process *p = dispatch(h);
+    
+    for (int i = 0; i < QUANTUM; i++) {
+      if (p->burstTime <= 0 || THE_CPU.hw_registers[PC] == CPU_HALT) break;
+      fetch();
+      execute();
+      p->burstTime--;
+      g_system_time++;
+      shareTick();
+      if (queue_type == STRIDEPASS) {
+        p->pass += STRIDE1 / (uint64_t)p->tickets;
+        uint64_t least = p->pass;
+        ProcessHandle next = heap_peek(Ready_Heap);
+        if (next != NO_PROCESS && pcb(next)->pass < least) {
+          least = pcb(next)->pass;
+        }
+        if (least > g_global_pass) {
+          g_global_pass = least;
+        }
+      }
+      if (ioPending()) break;
+      transferProcesses(queue_type);
     }
     
-    p->cpu_state = THE_CPU;
+    saveContext(p);
     double ctx_time = perf_timer_end(&timer);
     record_context_switch_time(g_current_algorithm_id, ctx_time);
-    total_time += process_time;
     
-    printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-    record_process_completion(p);
-    liberate(p->pid);
-    shift_ready_left();
-    
-    transferProcesses(NORMAL);
+    bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
+    if (finished) {
+      retire(p);
+    } else if (!blockOnIO(h)) {
+      p->state = READY;
+      enqueueHelper(h, queue_type);
+    }
   }
   
-  printf("<system time %d> All processes finished.\n", g_system_time);
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  if (queue_type == LOTTERYTICKETS) {
+    tickets_destroy(Ready_Tickets);
+    Ready_Tickets = NULL;
+  } else {
+    heap_destroy(Ready_Heap);
+    Ready_Heap = NULL;
+  }
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
-static void feedBack(void) {
-  Queue* feedBack_Q2 = init_FeedBack_Queue(MAX_PROCESSES);
-  Queue* feedBack_Q3 = init_FeedBack_Queue(MAX_PROCESSES);
-  int quantum1 = 2;
-  int quantum2 = 4;
+// EDF (deadline-ordered heap) or RM (period-ordered heap), preemptive.
+// A job ends when it has used its WCET or blocks, e.g. a game loop
+// sleeping until its next frame; the task then waits for its next
+// release. Best-effort processes only run when no job is ready.
+static void realTime(int queue_type) {
   PerfTimer timer;
+  HeapBefore before = (queue_type == DEADLINEHEAP) ? deadlineBefore : rateBefore;
+  
   g_system_time = 0;
-  transferProcesses(NORMAL);
-  printf("\nScheduling algorithm: MLFQ (Multi-Level Feedback Queue)\n");
-  printf("Total processes to be scheduled\n");
-  printf("=============================\n");
-  while(Ready_Queue->next > 0 || feedBack_Q2->next > 0 || feedBack_Q3->next > 0) {
-    transferProcesses(NORMAL);
-    if (Ready_Queue->next > 0) {
-      Process *p = &Ready_Queue->PCB[0];
-
-      if (!p->has_started) {
-        p->has_started = true;
-        p->start_time = g_system_time;
-        p->response_time = g_system_time - p->arrival_time;
-      }
-
-      perf_timer_start(&timer);
-      set_current_process(p->pid);
-      THE_CPU = p->cpu_state;
-      record_context_switch(g_current_algorithm_id);
-
-      for (int i = 0; i < quantum1 && p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT; i++) {
-        fetch();
-        execute();
-        p->burstTime--;
-        g_system_time++;
+  g_rt_density = 0.0;
+  g_rt_tasks = 0;
+  Ready_Heap = heap_create(QUEUE_INITIAL_CAPACITY, before, NULL);
+  transferProcesses(queue_type);
+  
+  if (queue_type == DEADLINEHEAP) {
+    log_info("\nScheduling algorithm: EDF (Earliest Deadline First)\n");
+  } else {
+    log_info("\nScheduling algorithm: RM (Rate Monotonic)\n");
+  }
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
+  
+  while (awaitWork(queue_type)) {
+    ProcessHandle h = heap_pop(Ready_Heap);
+    Process *p = pcb(h);
+    if (p->realtime) {
+      log_debug("<system time %d> process %d starts running (job %d, deadline %d)\n",
+                g_system_time, p->pid, p->job, p->job_deadline);
+    } else {
+      log_debug("<system time %d> process %d starts running\n", g_system_time, p->pid);
+    }
+    
+    perf_timer_start(&timer);
+    dispatch(h);
+    
+    bool preempted = false;
+    while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
+      fetch();
+      execute();
+      p->burstTime--;
+      g_system_time++;
+      if (p->realtime) {
+        p->job_used++;
       }
-
-      p->cpu_state = THE_CPU;
+      if (ioPending()) break;
+      
+      bool job_over = false;
+      if (p->realtime && p->job_used >= p->wcet) {
+        rtJobDone(p, g_system_time);
+        job_over = p->job_release > g_system_time;
+      }
+      transferProcesses(queue_type);
+      
+      // One that just ran out of work retires now instead of waiting
+      // for a release it has no job for
+      if (p->burstTime <= 0 || THE_CPU.hw_registers[PC] == CPU_HALT) break;
+
+      ProcessHandle next = heap_peek(Ready_Heap);
+      if (job_over || (next != NO_PROCESS && before(next, h, NULL))) {
+        saveContext(p);
+        p->state = READY;
+        enqueueHelper(h, queue_type);
+        double ctx_time = perf_timer_end(&timer);
+        record_context_switch_time(g_current_algorithm_id, ctx_time);
+        preempted = true;
+        break;
+      }
+    }
+    
+    if (!preempted) {
+      saveContext(p);
       double ctx_time = perf_timer_end(&timer);
       record_context_switch_time(g_current_algorithm_id, ctx_time);
-
-      bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
-      if (finished) {
-        printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-        record_process_completion(p);
-        liberate(p->pid);
-        shift_ready_left();
+      if (blockOnIO(h)) {
+        rtJobDone(p, g_system_time);
       } else {
-        Process tmp = *p;
-        shift_ready_left();
-        enqueueGeneric(tmp, feedBack_Q2);
+        retire(p);
       }
-      continue;
     }
+  }
+  
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  heap_destroy(Ready_Heap);
+  Ready_Heap = NULL;
+  set_current_process(SYSTEM_PROCESS_ID);
+}
 
-    if (feedBack_Q2->next > 0) {
-      Process *p = &feedBack_Q2->PCB[0];
+// Every process goes back to the top level with a fresh allotment, so
+// nothing starves below a stream of interactive work and a process
+// whose behaviour changed gets another chance at a short slice
+static void feedbackBoost(void) {
+  for (int level = 1; level < g_mlfq_levels; level++) {
+    while (Feedback_Queues[level]->count > 0) {
+      enqueueGeneric(dequeueGeneric(Feedback_Queues[level]), Feedback_Queues[0]);
+    }
+  }
+  if (g_feedback_nonempty != 0) {
+    g_feedback_nonempty = 1;
+  }
+  for (int i = 0; i < process_storage_index; i++) {
+    pcb((ProcessHandle)i)->mlfq_level = 0;
+    pcb((ProcessHandle)i)->mlfq_used = 0;
+  }
+  log_debug("<system time %d> priority boost\n", g_system_time);
+}
 
-      if (!p->has_started) {
-        p->has_started = true;
-        p->start_time = g_system_time;
-        p->response_time = g_system_time - p->arrival_time;
+// Round robin within each level, the highest non-empty level first. A
+// process moves down once it has used its level's quantum in total,
+// however it split that up, and a process becoming ready on a higher
+// level takes the CPU at the next tick.
+static void feedBack(void) {
+  PerfTimer timer;
+  g_system_time = 0;
+  g_feedback_nonempty = 0;
+  g_feedback_ready = 0;
+  int next_boost = g_mlfq_boost;
+  transferProcesses(FEEDBACKLEVELS);
+  log_info("\nScheduling algorithm: MLFQ (Multi-Level Feedback Queue)\n");
+  log_info("Levels: %d, quanta:", g_mlfq_levels);
+  for (int level = 0; level < g_mlfq_levels; level++) {
+    log_info(" %d", g_mlfq_quanta[level]);
+  }
+  if (g_mlfq_boost > 0) {
+    log_info(", boost every %d\n", g_mlfq_boost);
+  } else {
+    log_info(", no boost\n");
+  }
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
+
+  while (awaitWork(FEEDBACKLEVELS)) {
+    if (g_mlfq_boost > 0 && g_system_time >= next_boost) {
+      feedbackBoost();
+      while (next_boost <= g_system_time) {
+        next_boost += g_mlfq_boost;
       }
+    }
+    ProcessHandle h = dequeue(NULL, FEEDBACKLEVELS);
+    Process *p = pcb(h);
+    int level = p->mlfq_level;
+    int quantum = g_mlfq_quanta[level];
+    log_debug("<system time %d> process %d starts running (level %d)\n",
+              g_system_time, p->pid, level);
 
-      perf_timer_start(&timer);
-      set_current_process(p->pid);
-      THE_CPU = p->cpu_state;
-      record_context_switch(g_current_algorithm_id);
+    perf_timer_start(&timer);
+    dispatch(h);
+
+    // The quantum counts what is left of its allotment at this level
+    timer_set(g_system_time + quantum - p->mlfq_used);
+    do {
+      int ran = runUntilInterrupt(p);
+      p->mlfq_used += ran;
+      p->mlfq_burst += ran;
+      if (stoppedRunning(p)) break;
+      transferProcesses(FEEDBACKLEVELS);
+      if (g_feedback_nonempty & ((1u << level) - 1)) break;
+    } while (!quantumExpired());
+    timer_cancel();
+
+    saveContext(p);
+    double ctx_time = perf_timer_end(&timer);
+    record_context_switch_time(g_current_algorithm_id, ctx_time);
 
-      for (int i = 0; i < quantum2 && p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT; i++) {
-        fetch();
-        execute();
-        p->burstTime--;
-        g_system_time++;
+    bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
+    if (finished) {
+      retire(p);
+      continue;
+    }
+    if (p->mlfq_used >= quantum) {
+      p->mlfq_used = 0;
+      if (level + 1 < g_mlfq_levels) {
+        p->mlfq_level++;
       }
+    }
+    if (!blockOnIO(h)) {
+      p->state = READY;
+      enqueueHelper(h, FEEDBACKLEVELS);
+    }
+  }
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
+  set_current_process(SYSTEM_PROCESS_ID);
+}
 
-      p->cpu_state = THE_CPU;
-      double ctx_time = perf_timer_end(&timer);
-      record_context_switch_time(g_current_algorithm_id, ctx_time);
+//-------------------------------------Symmetric Multiprocessing-------------------------------------//
 
-      bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
-      if (finished) {
-        printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-        record_process_completion(p);
-        liberate(p->pid);
-        dequeueGeneric(feedBack_Q2);
-      } else {
-        Process tmp = dequeueGeneric(feedBack_Q2);
-        enqueueGeneric(tmp, feedBack_Q3);
+// One simulated core, driven by its own host thread. The register
+// file lives in the thread's THE_CPU, the PCB it is running lives in
+// global_process_storage. Every core owns a run queue; when it runs
+// dry the core steals from the others instead of going idle.
+typedef struct {
+  int id;
+  pthread_t thread;
+  WorkDeque *run_queue;
+  ProcessHandle current;       // NO_PROCESS when idle
+  int slice_left;
+  int busy_ticks;
+
+  // Processes handed to us during a round, drained by the owner when the
+  // next round starts
+  pthread_mutex_t inbox_lock;
+  ProcessHandle *inbox;
+  int inbox_count;
+  int inbox_capacity;
+
+  // Processes that blocked on a syscall this round, parked by the serial
+  // thread at the barrier (the event queue is not shared between threads)
+  ProcessHandle *blocked;
+  int blocked_count;
+  int blocked_capacity;
+
+  // L1 lines filled on this core so far, used to age other processes' warmth
+  _Atomic unsigned long lines_loaded;
+
+  // Load balancing, kept per core and merged once the threads join
+  int context_switches;
+  int steals;
+  int migrations;
+  int same_core_dispatches;
+  unsigned long queue_lengths[QUEUE_LENGTH_BUCKETS];
+} CoreContext;
+
+// A warm process is only stolen once its core has this many waiting
+#define AFFINITY_BACKLOG 2
+
+static CoreContext g_cores[MAX_CORES];
+static pthread_mutex_t g_completion_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t g_round_barrier;
+static int g_live_processes = 0;
+static int g_blocked_processes = 0; // Live but parked on a syscall
+static bool g_smp_done = false;
+static int g_smp_quantum = QUANTUM; // 0 = run to completion
+static bool g_affinity_mode = false;
+static int g_warm_threshold = 1;    // L1 lines that make a process worth keeping put
+// Last affinity-blind run of each policy, the baseline for affinity runs
+static int g_blind_run_id[SCHED_RM + 1] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+void set_scheduler_cores(int cores) {
+  if (cores < 1 || cores > MAX_CORES) {
+    fprintf(stderr, "set_scheduler_cores: %d cores not supported (max %d)\n",
+            cores, MAX_CORES);
+    return;
+  }
+  g_core_count = cores;
+}
+
+void set_scheduler_affinity(bool enabled) {
+  g_affinity_mode = enabled;
+}
+
+static inline bool core_in_mask(uint64_t mask, int core) {
+  return (mask >> core) & 1u;
+}
+
+static inline bool smp_allowed(const Process *p, int core) {
+  return p->hard_affinity == 0 || core_in_mask(p->hard_affinity, core);
+}
+
+// Least loaded core the process may run on. In affinity mode cores in
+// its soft mask win over the rest.
+static int smp_home_core(const Process *p) {
+  int best = -1;
+  int best_load = 0;
+  bool best_preferred = false;
+  for (int c = 0; c < g_core_count; c++) {
+    if (!smp_allowed(p, c)) continue;
+    bool preferred = g_affinity_mode && core_in_mask(p->soft_affinity, c);
+    int load = (int)deque_size(g_cores[c].run_queue);
+    if (best < 0 || (preferred && !best_preferred) ||
+        (preferred == best_preferred && load < best_load)) {
+      best = c;
+      best_load = load;
+      best_preferred = preferred;
+    }
+  }
+  return best;
+}
+
+static void smp_hand_off(ProcessHandle h, int core) {
+  CoreContext *target = &g_cores[core];
+  pthread_mutex_lock(&target->inbox_lock);
+  if (target->inbox_count >= target->inbox_capacity) {
+    int capacity = target->inbox_capacity ? target->inbox_capacity * 2 : QUEUE_INITIAL_CAPACITY;
+    ProcessHandle *grown = realloc(target->inbox, (size_t)capacity * sizeof(ProcessHandle));
+    if (!grown) {
+      perror("realloc core inbox");
+      exit(EXIT_FAILURE);
+    }
+    target->inbox = grown;
+    target->inbox_capacity = capacity;
+  }
+  target->inbox[target->inbox_count++] = h;
+  pthread_mutex_unlock(&target->inbox_lock);
+}
+
+static void smp_drain_inbox(CoreContext *core) {
+  pthread_mutex_lock(&core->inbox_lock);
+  for (int i = 0; i < core->inbox_count; i++) {
+    deque_push(core->run_queue, core->inbox[i]);
+  }
+  core->inbox_count = 0;
+  pthread_mutex_unlock(&core->inbox_lock);
+}
+
+// Lines of p likely still in this core's L1: what it brought in, less
+// whatever has been pulled in (and so evicted, the L1 is FIFO) since
+static int smp_warm_lines(const Process *p, CoreContext *core) {
+  if (p->last_core != core->id) {
+    return 0;
+  }
+  unsigned long since = atomic_load(&core->lines_loaded) - p->core_lines_at_leave;
+  return since >= (unsigned long)p->cache_footprint ? 0 : p->cache_footprint - (int)since;
+}
+
+static void smp_enqueue(ProcessHandle h, int core, bool started) {
+  if (started) {
+    smp_hand_off(h, core);
+  } else {
+    deque_push(g_cores[core].run_queue, h);
+  }
+}
+
+// Admit every arrival due by now to its home core, and send every
+// process whose syscall completed back to a core. Before the cores
+// start the run queues are pushed directly, afterwards (from the serial
+// thread at a round barrier) through the inboxes. Returns the arrivals.
+static int smp_admit(bool started) {
+  uint64_t all_cores = (g_core_count >= 64) ? UINT64_MAX : ((UINT64_C(1) << g_core_count) - 1);
+  int count = 0;
+  Event ev;
+  while (event_pop_due(g_events, g_system_time, &ev)) {
+    ProcessHandle h = ev.subject;
+    Process *p = pcb(h);
+    if (ev.type == EVENT_IO_COMPLETE || ev.type == EVENT_TIMER) {
+      if (!wake(h, ev.time)) {
+        continue;
       }
+      g_blocked_processes--;
+      // Its cache is still warm where it blocked
+      bool stay = g_affinity_mode && p->last_core >= 0;
+      smp_enqueue(h, stay ? p->last_core : smp_home_core(p), started);
       continue;
     }
+    if (ev.type != EVENT_ARRIVAL) {
+      fprintf(stderr, "Unhandled event type %d at time %d\n", ev.type, ev.time);
+      continue;
+    }
+    if (p->hard_affinity != 0 && (p->hard_affinity & all_cores) == 0) {
+      fprintf(stderr, "Process %d: hard affinity 0x%llx names no CPU, ignoring it\n",
+              p->pid, (unsigned long long)p->hard_affinity);
+      p->hard_affinity = 0;
+    }
+    p->state = READY;
+    noteResident(1);
+    smp_enqueue(h, smp_home_core(p), started);
+    count++;
+  }
+  return count;
+}
 
-    if (feedBack_Q3->next > 0) {
-      Process *p = &feedBack_Q3->PCB[0];
-
-      if (!p->has_started) {
-        p->has_started = true;
-        p->start_time = g_system_time;
-        p->response_time = g_system_time - p->arrival_time;
+// Oldest process on our own queue first, otherwise steal from the
+// next core over that has anything queued
+static ProcessHandle smp_next(CoreContext *core) {
+  ProcessHandle h = deque_steal(core->run_queue);
+  if (h != DEQUE_EMPTY) {
+    return h;
+  }
+  for (int k = 1; k < g_core_count; k++) {
+    CoreContext *victim = &g_cores[(core->id + k) % g_core_count];
+    while ((h = deque_steal(victim->run_queue)) != DEQUE_EMPTY) {
+      Process *p = pcb(h);
+      if (!smp_allowed(p, core->id)) {
+        smp_hand_off(h, smp_home_core(p));
+        continue;
+      }
+      // Moving a warm process throws its cache away, only worth it
+      // when its own core is backed up
+      if (g_affinity_mode && smp_warm_lines(p, victim) >= g_warm_threshold &&
+          deque_size(victim->run_queue) + 1 < AFFINITY_BACKLOG) {
+        smp_hand_off(h, victim->id);
+        break;
       }
+      core->steals++;
+      return h;
+    }
+  }
+  return NO_PROCESS;
+}
+
+static bool smp_dispatch(CoreContext *core, int now) {
+  ProcessHandle h = smp_next(core);
+  if (h == NO_PROCESS) {
+    return false;
+  }
+  Process *p = pcb(h);
+
+  if (p->last_core == core->id) {
+    core->same_core_dispatches++;
+  } else if (p->last_core >= 0) {
+    core->migrations++;
+  }
+  p->cache_footprint = smp_warm_lines(p, core);
+  p->slice_l1_misses = get_process_cache_counters(p->pid).l1_misses;
+  p->last_core = core->id;
+  p->state = RUNNING;
+  note_first_run(p, now);
+  core->context_switches++;
+
+  log_debug("<system time %d> process %d starts running on cpu %d\n", now, p->pid, core->id);
+  set_current_process(p->pid);
+  console_attach(p->pid);
+  keyboard_attach(p->pid);
+  THE_CPU = p->cpu_state;
+  core->current = h;
+  core->slice_left = g_smp_quantum;
+  return true;
+}
+
+// Fold the lines a slice pulled into L1 into the footprint estimate
+static void smp_end_slice(CoreContext *core, Process *p) {
+  unsigned long misses = get_process_cache_counters(p->pid).l1_misses - p->slice_l1_misses;
+  unsigned long footprint = (unsigned long)p->cache_footprint + misses;
+  size_t l1_lines = get_L1_line_count();
+  p->cache_footprint = footprint > l1_lines ? (int)l1_lines : (int)footprint;
+  p->core_lines_at_leave = atomic_fetch_add(&core->lines_loaded, misses) + misses;
+  saveContext(p);
+}
 
-      perf_timer_start(&timer);
-      set_current_process(p->pid);
-      THE_CPU = p->cpu_state;
-      record_context_switch(g_current_algorithm_id);
+// A preempted process goes back to this core, unless in affinity mode
+// it prefers another core, then it heads home. Either way it goes
+// through an inbox: it has already used part of this round, so no
+// core may pick it up again before the next one.
+static void smp_requeue(CoreContext *core, ProcessHandle h) {
+  Process *p = pcb(h);
+  p->state = READY;
+  int target = core->id;
+  if (g_affinity_mode && p->soft_affinity != 0 &&
+      !core_in_mask(p->soft_affinity, core->id)) {
+    int home = smp_home_core(p);
+    if (home >= 0) {
+      target = home;
+    }
+  }
+  smp_hand_off(h, target);
+}
 
-      while (p->burstTime > 0 && THE_CPU.hw_registers[PC] != CPU_HALT) {
+// Set aside a process that blocked, until the serial thread parks it
+static void smp_set_aside(CoreContext *core, ProcessHandle h) {
+  if (core->blocked_count >= core->blocked_capacity) {
+    int capacity = core->blocked_capacity ? core->blocked_capacity * 2 : QUEUE_INITIAL_CAPACITY;
+    ProcessHandle *grown = realloc(core->blocked, (size_t)capacity * sizeof(ProcessHandle));
+    if (!grown) {
+      perror("realloc core blocked list");
+      exit(EXIT_FAILURE);
+    }
+    core->blocked = grown;
+    core->blocked_capacity = capacity;
+  }
+  core->blocked[core->blocked_count++] = h;
+}
+
+// Serial thread: park everything the cores set aside this round
+static void smp_park_blocked(void) {
+  for (int c = 0; c < g_core_count; c++) {
+    CoreContext *core = &g_cores[c];
+    for (int i = 0; i < core->blocked_count; i++) {
+      ProcessHandle h = core->blocked[i];
+      blockOn(h, pcb(h)->blocked_since);
+      g_blocked_processes++;
+    }
+    core->blocked_count = 0;
+  }
+}
+
+// Each round every core gets QUANTUM ticks of simulated time, then all
+// cores meet at the barrier so simulated time advances in lockstep.
+static void *smp_core_main(void *arg) {
+  CoreContext *core = arg;
+  set_current_core(core->id);
+
+  while (true) {
+    int round_start = g_system_time;
+    int executed = 0;
+    smp_drain_inbox(core);
+    core->queue_lengths[queue_length_bucket((int)deque_size(core->run_queue))]++;
+
+    while (executed < QUANTUM) {
+      if (core->current == NO_PROCESS && !smp_dispatch(core, round_start + executed)) {
+        break; // nothing runnable anywhere, idle for the rest of the round
+      }
+
+      Process *p = pcb(core->current);
+      while (executed < QUANTUM && p->burstTime > 0 &&
+             THE_CPU.hw_registers[PC] != CPU_HALT && !ioPending() &&
+             (g_smp_quantum == 0 || core->slice_left > 0)) {
         fetch();
         execute();
         p->burstTime--;
-        g_system_time++;
+        core->slice_left--;
+        executed++;
       }
 
-      p->cpu_state = THE_CPU;
-      double ctx_time = perf_timer_end(&timer);
-      record_context_switch_time(g_current_algorithm_id, ctx_time);
+      bool finished = (p->burstTime <= 0) || (THE_CPU.hw_registers[PC] == CPU_HALT);
+      if (finished) {
+        smp_end_slice(core, p);
+        // The same bookkeeping as on one CPU, one core at a time
+        pthread_mutex_lock(&g_completion_lock);
+        retireAt(p, round_start + executed);
+        g_live_processes--;
+        pthread_mutex_unlock(&g_completion_lock);
+        core->current = NO_PROCESS;
+      } else if (ioPending()) {
+        smp_end_slice(core, p);
+        p->blocked_since = round_start + executed;
+        smp_set_aside(core, core->current);
+        core->current = NO_PROCESS;
+      } else if (g_smp_quantum > 0 && core->slice_left <= 0) {
+        smp_end_slice(core, p);
+        smp_requeue(core, core->current);
+        core->current = NO_PROCESS;
+      }
+    }
+    core->busy_ticks += executed;
+
+    // First barrier: everyone finished the round. The serial thread
+    // advances the clock and decides whether there is another round.
+    if (pthread_barrier_wait(&g_round_barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+      smp_park_blocked();
+      g_system_time += QUANTUM;
+      pace();
+      g_live_processes += smp_admit(true);
+      if (g_live_processes == g_blocked_processes && event_next_time(g_events) != EVENT_NEVER) {
+        // Every CPU is idle until the next arrival or wakeup
+        skipIdle(event_next_time(g_events));
+        g_live_processes += smp_admit(true);
+      }
+      g_smp_done = (g_live_processes == 0 && event_count(g_events) == 0);
+    }
+    pthread_barrier_wait(&g_round_barrier);
+    if (g_smp_done) break;
+  }
+
+  set_current_process(SYSTEM_PROCESS_ID);
+  return NULL;
+}
+
+// Per-core multiprocessor scheduling. FCFS keeps a process on its
+// core until it finishes, every other policy time-shares with QUANTUM.
+static void symmetricMultiprocessing(SchedulingAlgorithm algorithm) {
+  g_system_time = 0;
+  g_smp_quantum = (algorithm == SCHED_FCFS) ? 0 : QUANTUM;
+  g_smp_done = false;
+  g_blocked_processes = 0;
+  g_warm_threshold = (int)(get_L1_line_count() / 8);
+  if (g_warm_threshold < 1) g_warm_threshold = 1;
+
+  // Every multiprocessor run starts from cold caches so runs compare fairly
+  flush_caches();
+
+  for (int i = 0; i < g_core_count; i++) {
+    memset(&g_cores[i], 0, sizeof(CoreContext));
+    g_cores[i].id = i;
+    g_cores[i].current = NO_PROCESS;
+    g_cores[i].run_queue = deque_create(QUEUE_INITIAL_CAPACITY);
+    pthread_mutex_init(&g_cores[i].inbox_lock, NULL);
+    atomic_init(&g_cores[i].lines_loaded, 0);
+  }
+  g_live_processes = smp_admit(false);
+
+  log_info("\nScheduling algorithm: %s on %d CPUs\n",
+           algorithm == SCHED_FCFS ? "FCFS" : "Round Robin", g_core_count);
+  log_info("Total %d tasks to be scheduled\n", g_submitted);
+  log_info("=============================\n");
+
+  // Nothing due at time 0, idle until the first arrival
+  if (g_live_processes == 0 && event_next_time(g_events) != EVENT_NEVER) {
+    skipIdle(event_next_time(g_events));
+    g_live_processes = smp_admit(false);
+  }
+
+  if (g_live_processes > 0) {
+    set_core_count(g_core_count);
+    pthread_barrier_init(&g_round_barrier, NULL, (unsigned)g_core_count);
+
+    for (int i = 0; i < g_core_count; i++) {
+      if (pthread_create(&g_cores[i].thread, NULL, smp_core_main, &g_cores[i]) != 0) {
+        perror("pthread_create core");
+        exit(EXIT_FAILURE);
+      }
+    }
 
-      printf("<system time %d> process %d finished.\n", g_system_time, p->pid);
-      record_process_completion(p);
-      liberate(p->pid);
-      dequeueGeneric(feedBack_Q3);
+    for (int i = 0; i < g_core_count; i++) {
+      CoreContext *core = &g_cores[i];
+      pthread_join(core->thread, NULL);
+      record_core_busy_time(g_current_algorithm_id, i, core->busy_ticks);
+      record_load_balance(g_current_algorithm_id, core->steals, core->migrations,
+                          core->same_core_dispatches);
+      record_queue_length_histogram(g_current_algorithm_id, core->queue_lengths);
+      for (int k = 0; k < core->context_switches; k++) {
+        record_context_switch(g_current_algorithm_id);
+      }
     }
+
+    pthread_barrier_destroy(&g_round_barrier);
+    set_core_count(1);
   }
-  printf("<system time %d> All processes finished.\n", g_system_time);
-  free_Queue(feedBack_Q2);
-  free_Queue(feedBack_Q3);
+
+  for (int i = 0; i < g_core_count; i++) {
+    deque_destroy(g_cores[i].run_queue);
+    g_cores[i].run_queue = NULL;
+    free(g_cores[i].inbox);
+    g_cores[i].inbox = NULL;
+    free(g_cores[i].blocked);
+    g_cores[i].blocked = NULL;
+    pthread_mutex_destroy(&g_cores[i].inbox_lock);
+  }
+
+  log_debug("<system time %d> All processes finished.\n", g_system_time);
   set_current_process(SYSTEM_PROCESS_ID);
 }
 
 //-------------------------------------Scheduler-------------------------------------//
+void set_swap_watermark(size_t bytes) {
+  g_swap_watermark = bytes;
+}
+
+void set_lottery_seed(uint64_t seed) {
+  g_lottery_seed = seed;
+}
+
+void set_clock_params(int ticks_per_ms, bool paced) {
+  g_ticks_per_ms = ticks_per_ms > 0 ? ticks_per_ms : DEFAULT_TICKS_PER_MS;
+  g_paced = paced;
+}
+
+void set_cfs_params(int latency, int granularity) {
+  g_cfs_granularity = granularity > 0 ? granularity : CFS_DEFAULT_GRANULARITY;
+  g_cfs_latency = latency >= g_cfs_granularity ? latency : g_cfs_granularity;
+}
+
+void set_mlfq_params(const int *quanta, int levels, int boost) {
+  if (levels < 1) levels = 1;
+  if (levels > MLFQ_MAX_LEVELS) levels = MLFQ_MAX_LEVELS;
+  g_mlfq_levels = levels;
+  for (int level = 0; level < levels; level++) {
+    g_mlfq_quanta[level] = quanta[level] > 0 ? quanta[level] : QUANTUM;
+  }
+  g_mlfq_boost = boost > 0 ? boost : 0;
+}
+
+static void run_uniprocessor(SchedulingAlgorithm algorithm) {
+  switch (algorithm) {
+    case SCHED_ROUND_ROBIN: roundRobin(); break;
+    case SCHED_PRIORITY: priorityBased(); break;
+    case SCHED_SRT: shortestRemainingTime(); break;
+    case SCHED_HRRN: highestResponseRatioNext(); break;
+    case SCHED_FCFS: firstComeFirstServe(); break;
+    case SCHED_SPN: shortestProcessNext(); break;
+    case SCHED_MLFQ: feedBack(); break;
+    case SCHED_CFS: completelyFair(); break;
+    case SCHED_LOTTERY: proportionalShare(LOTTERYTICKETS); break;
+    case SCHED_STRIDE: proportionalShare(STRIDEPASS); break;
+    case SCHED_EDF: realTime(DEADLINEHEAP); break;
+    case SCHED_RM: realTime(RATEHEAP); break;
+    default: fprintf(stderr, "Unknown Scheduler Type\n"); break;
+  }
+}
+
 void scheduler(SchedulingAlgorithm algorithm) {
   PerfTimer overall_timer;
   perf_timer_start(&overall_timer);
+  // Blocking syscalls block the process, not the simulator
+  set_deferred_syscalls(true);
+  init_interrupt_controller();
+  keyboard_rewind();
+  g_console_free = 0;
+  g_swap_free = 0;
+  g_swapping_in = 0;
+  g_retained_ram = 0;
+  g_resident = g_peak_resident = g_resident_since = 0;
+  g_resident_area = 0.0;
   const char *algo_name = "Unknown";
   switch (algorithm) {
     case SCHED_FCFS: algo_name = "FCFS"; break;
@@ -981,19 +2590,58 @@ void scheduler(SchedulingAlgorithm algorithm) {
     case SCHED_HRRN: algo_name = "HRRN"; break;
     case SCHED_SPN: algo_name = "SPN"; break;
     case SCHED_MLFQ: algo_name = "MLFQ"; break;
+    case SCHED_CFS: algo_name = "CFS"; break;
+    case SCHED_LOTTERY: algo_name = "Lottery"; break;
+    case SCHED_STRIDE: algo_name = "Stride"; break;
+    case SCHED_EDF: algo_name = "EDF"; break;
+    case SCHED_RM: algo_name = "RM"; break;
     default: break;
   }
-  g_current_algorithm_id = start_algorithm_tracking(algo_name);
-  switch (algorithm) {
-    case SCHED_ROUND_ROBIN: roundRobin(); break;
-    case SCHED_PRIORITY: priorityBased(); break;
-    case SCHED_SRT: shortestRemainingTime(); break;
-    case SCHED_HRRN: highestResponseRatioNext(); break;
-    case SCHED_FCFS: firstComeFirstServe(); break;
-    case SCHED_SPN: shortestProcessNext(); break;
-    case SCHED_MLFQ: feedBack(); break;
-    default: fprintf(stderr, "Unknown Scheduler Type\n"); break;
+
+  g_running = NO_PROCESS;
+  set_syscall_handler(osSyscall);
+  clock_gettime(CLOCK_MONOTONIC, &g_pace_start);
+  if (g_core_count > 1) {
+    if (algorithm != SCHED_FCFS && algorithm != SCHED_ROUND_ROBIN) {
+      fprintf(stderr, "%s has no multiprocessor variant, running Round Robin on %d CPUs\n",
+              algo_name, g_core_count);
+      algorithm = SCHED_ROUND_ROBIN;
+      algo_name = "Round Robin";
+    }
+    char smp_name[64];
+    snprintf(smp_name, sizeof(smp_name), "%s x%d%s", algo_name, g_core_count,
+             g_affinity_mode ? " +affinity" : "");
+    g_current_algorithm_id = start_algorithm_tracking(smp_name);
+    record_core_count(g_current_algorithm_id, g_core_count);
+    if (g_affinity_mode) {
+      record_affinity_run(g_current_algorithm_id, g_blind_run_id[algorithm]);
+    } else {
+      g_blind_run_id[algorithm] = g_current_algorithm_id;
+    }
+    if (g_swap_watermark > 0) {
+      fprintf(stderr, "Swapping is not supported on %d CPUs, ignoring the swap watermark\n",
+              g_core_count);
+    }
+    g_submitted = scheduleArrivals();
+    symmetricMultiprocessing(algorithm);
+  } else {
+    g_current_algorithm_id = start_algorithm_tracking(algo_name);
+    g_submitted = scheduleArrivals();
+    g_share_run = (algorithm == SCHED_LOTTERY || algorithm == SCHED_STRIDE);
+    run_uniprocessor(algorithm);
+    g_share_run = false;
+    noteResident(0);
+    if (g_system_time > 0) {
+      record_multiprogramming(g_current_algorithm_id, g_resident_area / g_system_time,
+                              g_peak_resident);
+    }
   }
+
+  set_syscall_handler(NULL);
+  set_deferred_syscalls(false);
+  console_attach(SYSTEM_PROCESS_ID);
+  keyboard_attach(SYSTEM_PROCESS_ID);
+
   double total_time = perf_timer_end_seconds(&overall_timer);
   if (g_current_algorithm_id >= 0) {
     record_scheduler_time(g_current_algorithm_id, total_time * 1000.0);
@@ -0,0 +1,402 @@
+#include "../include/rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL RB_EMPTY
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+typedef enum {
+  RED,
+  BLACK
+} Color;
+
+typedef struct {
+  uint32_t left;
+  uint32_t right;
+  uint32_t parent;
+  Color color;
+  bool linked;     // Currently in the tree
+} RBNode;
+
+struct RBTree {
+  RBNode *nodes;   // Indexed by handle
+  size_t node_capacity;
+  uint32_t root;
+  uint32_t first;  // Leftmost handle
+  size_t count;
+
+  RBBefore before;
+  void *ctx;
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+// Make sure `item` has a node
+static void reserve_nodes(RBTree *tree, uint32_t item) {
+  if (item < tree->node_capacity) {
+    return;
+  }
+  size_t capacity = tree->node_capacity ? tree->node_capacity : 16;
+  while (capacity <= item) {
+    capacity *= 2;
+  }
+  RBNode *nodes = realloc(tree->nodes, capacity * sizeof(RBNode));
+  if (!nodes) {
+    perror("realloc rbtree nodes");
+    exit(EXIT_FAILURE);
+  }
+  memset(nodes + tree->node_capacity, 0, (capacity - tree->node_capacity) * sizeof(RBNode));
+  tree->nodes = nodes;
+  tree->node_capacity = capacity;
+}
+
+static inline RBNode *node(const RBTree *tree, uint32_t i) {
+  return &tree->nodes[i];
+}
+
+// Missing children count as black
+static inline Color color_of(const RBTree *tree, uint32_t i) {
+  return i == NIL ? BLACK : tree->nodes[i].color;
+}
+
+static inline void set_color(RBTree *tree, uint32_t i, Color color) {
+  if (i != NIL) {
+    tree->nodes[i].color = color;
+  }
+}
+
+static uint32_t leftmost(const RBTree *tree, uint32_t i) {
+  while (node(tree, i)->left != NIL) {
+    i = node(tree, i)->left;
+  }
+  return i;
+}
+
+// Point whoever pointed at `old` (parent or root) at `young` instead
+static void replace_child(RBTree *tree, uint32_t old, uint32_t young) {
+  uint32_t parent = node(tree, old)->parent;
+  if (parent == NIL) {
+    tree->root = young;
+  } else if (node(tree, parent)->left == old) {
+    node(tree, parent)->left = young;
+  } else {
+    node(tree, parent)->right = young;
+  }
+  if (young != NIL) {
+    node(tree, young)->parent = parent;
+  }
+}
+
+static void rotate_left(RBTree *tree, uint32_t x) {
+  uint32_t y = node(tree, x)->right;
+  node(tree, x)->right = node(tree, y)->left;
+  if (node(tree, y)->left != NIL) {
+    node(tree, node(tree, y)->left)->parent = x;
+  }
+  replace_child(tree, x, y);
+  node(tree, y)->left = x;
+  node(tree, x)->parent = y;
+}
+
+static void rotate_right(RBTree *tree, uint32_t x) {
+  uint32_t y = node(tree, x)->left;
+  node(tree, x)->left = node(tree, y)->right;
+  if (node(tree, y)->right != NIL) {
+    node(tree, node(tree, y)->right)->parent = x;
+  }
+  replace_child(tree, x, y);
+  node(tree, y)->right = x;
+  node(tree, x)->parent = y;
+}
+
+// A red node was just linked in at z, repair any red-red edge above it
+static void insert_fixup(RBTree *tree, uint32_t z) {
+  while (color_of(tree, node(tree, z)->parent) == RED) {
+    uint32_t p = node(tree, z)->parent;
+    uint32_t g = node(tree, p)->parent;
+    if (p == node(tree, g)->left) {
+      uint32_t uncle = node(tree, g)->right;
+      if (color_of(tree, uncle) == RED) {
+        set_color(tree, p, BLACK);
+        set_color(tree, uncle, BLACK);
+        set_color(tree, g, RED);
+        z = g;
+        continue;
+      }
+      if (z == node(tree, p)->right) {
+        z = p;
+        rotate_left(tree, z);
+        p = node(tree, z)->parent;
+      }
+      set_color(tree, p, BLACK);
+      set_color(tree, g, RED);
+      rotate_right(tree, g);
+    } else {
+      uint32_t uncle = node(tree, g)->left;
+      if (color_of(tree, uncle) == RED) {
+        set_color(tree, p, BLACK);
+        set_color(tree, uncle, BLACK);
+        set_color(tree, g, RED);
+        z = g;
+        continue;
+      }
+      if (z == node(tree, p)->left) {
+        z = p;
+        rotate_right(tree, z);
+        p = node(tree, z)->parent;
+      }
+      set_color(tree, p, BLACK);
+      set_color(tree, g, RED);
+      rotate_left(tree, g);
+    }
+  }
+  set_color(tree, tree->root, BLACK);
+}
+
+// A black node was taken out above x (which may be NIL, hence the
+// explicit parent), leaving x's side one black short
+static void remove_fixup(RBTree *tree, uint32_t x, uint32_t parent) {
+  while (x != tree->root && color_of(tree, x) == BLACK) {
+    if (x == node(tree, parent)->left) {
+      uint32_t w = node(tree, parent)->right;
+      if (color_of(tree, w) == RED) {
+        set_color(tree, w, BLACK);
+        set_color(tree, parent, RED);
+        rotate_left(tree, parent);
+        w = node(tree, parent)->right;
+      }
+      if (color_of(tree, node(tree, w)->left) == BLACK &&
+          color_of(tree, node(tree, w)->right) == BLACK) {
+        set_color(tree, w, RED);
+        x = parent;
+        parent = node(tree, x)->parent;
+        continue;
+      }
+      if (color_of(tree, node(tree, w)->right) == BLACK) {
+        set_color(tree, node(tree, w)->left, BLACK);
+        set_color(tree, w, RED);
+        rotate_right(tree, w);
+        w = node(tree, parent)->right;
+      }
+      set_color(tree, w, node(tree, parent)->color);
+      set_color(tree, parent, BLACK);
+      set_color(tree, node(tree, w)->right, BLACK);
+      rotate_left(tree, parent);
+    } else {
+      uint32_t w = node(tree, parent)->left;
+      if (color_of(tree, w) == RED) {
+        set_color(tree, w, BLACK);
+        set_color(tree, parent, RED);
+        rotate_right(tree, parent);
+        w = node(tree, parent)->left;
+      }
+      if (color_of(tree, node(tree, w)->left) == BLACK &&
+          color_of(tree, node(tree, w)->right) == BLACK) {
+        set_color(tree, w, RED);
+        x = parent;
+        parent = node(tree, x)->parent;
+        continue;
+      }
+      if (color_of(tree, node(tree, w)->left) == BLACK) {
+        set_color(tree, node(tree, w)->right, BLACK);
+        set_color(tree, w, RED);
+        rotate_left(tree, w);
+        w = node(tree, parent)->left;
+      }
+      set_color(tree, w, node(tree, parent)->color);
+      set_color(tree, parent, BLACK);
+      set_color(tree, node(tree, w)->left, BLACK);
+      rotate_right(tree, parent);
+    }
+    x = tree->root;
+  }
+  set_color(tree, x, BLACK);
+}
+
+// Black height of the subtree at i, -1 if it breaks an invariant
+static int check_subtree(const RBTree *tree, uint32_t i, uint32_t parent) {
+  if (i == NIL) {
+    return 1;
+  }
+  const RBNode *n = node(tree, i);
+  if (!n->linked || n->parent != parent) {
+    return -1;
+  }
+  if (n->color == RED &&
+      (color_of(tree, n->left) == RED || color_of(tree, n->right) == RED)) {
+    return -1;
+  }
+  if (n->left != NIL && !tree->before(n->left, i, tree->ctx)) {
+    return -1;
+  }
+  if (n->right != NIL && !tree->before(i, n->right, tree->ctx)) {
+    return -1;
+  }
+  int left = check_subtree(tree, n->left, i);
+  int right = check_subtree(tree, n->right, i);
+  if (left < 0 || left != right) {
+    return -1;
+  }
+  return left + (n->color == BLACK);
+}
+
+static size_t count_subtree(const RBTree *tree, uint32_t i) {
+  if (i == NIL) {
+    return 0;
+  }
+  return 1 + count_subtree(tree, node(tree, i)->left) + count_subtree(tree, node(tree, i)->right);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+RBTree *rb_create(size_t capacity, RBBefore before, void *ctx) {
+  RBTree *tree = calloc(1, sizeof(RBTree));
+  if (!tree) {
+    perror("calloc rbtree");
+    exit(EXIT_FAILURE);
+  }
+  tree->root = NIL;
+  tree->first = NIL;
+  tree->before = before;
+  tree->ctx = ctx;
+  if (capacity > 0) {
+    reserve_nodes(tree, (uint32_t)(capacity - 1));
+  }
+  return tree;
+}
+
+void rb_destroy(RBTree *tree) {
+  if (!tree) {
+    return;
+  }
+  free(tree->nodes);
+  free(tree);
+}
+
+void rb_insert(RBTree *tree, uint32_t item) {
+  if (item == NIL) {
+    fprintf(stderr, "rb_insert: RB_EMPTY is reserved\n");
+    return;
+  }
+  reserve_nodes(tree, item);
+  if (node(tree, item)->linked) {
+    fprintf(stderr, "rb_insert: handle %u is already in the tree\n", item);
+    return;
+  }
+
+  uint32_t parent = NIL;
+  uint32_t cur = tree->root;
+  bool went_left = false;
+  while (cur != NIL) {
+    parent = cur;
+    went_left = tree->before(item, cur, tree->ctx);
+    cur = went_left ? node(tree, cur)->left : node(tree, cur)->right;
+  }
+
+  RBNode *n = node(tree, item);
+  n->left = n->right = NIL;
+  n->parent = parent;
+  n->color = RED;
+  n->linked = true;
+  if (parent == NIL) {
+    tree->root = item;
+  } else if (went_left) {
+    node(tree, parent)->left = item;
+  } else {
+    node(tree, parent)->right = item;
+  }
+  if (tree->first == NIL || tree->before(item, tree->first, tree->ctx)) {
+    tree->first = item;
+  }
+  tree->count++;
+  insert_fixup(tree, item);
+}
+
+bool rb_remove(RBTree *tree, uint32_t item) {
+  if (!rb_contains(tree, item)) {
+    return false;
+  }
+  RBNode *z = node(tree, item);
+
+  // The leftmost node has no left child: its successor is the leftmost
+  // of its right subtree, or its parent
+  if (tree->first == item) {
+    tree->first = (z->right != NIL) ? leftmost(tree, z->right) : z->parent;
+  }
+
+  uint32_t x;
+  uint32_t x_parent;
+  Color removed = z->color;
+  if (z->left == NIL) {
+    x = z->right;
+    x_parent = z->parent;
+    replace_child(tree, item, x);
+  } else if (z->right == NIL) {
+    x = z->left;
+    x_parent = z->parent;
+    replace_child(tree, item, x);
+  } else {
+    // Two children: the successor takes z's place and colour
+    uint32_t y = leftmost(tree, z->right);
+    removed = node(tree, y)->color;
+    x = node(tree, y)->right;
+    if (node(tree, y)->parent == item) {
+      x_parent = y;
+    } else {
+      x_parent = node(tree, y)->parent;
+      replace_child(tree, y, x);
+      node(tree, y)->right = z->right;
+      node(tree, z->right)->parent = y;
+    }
+    replace_child(tree, item, y);
+    node(tree, y)->left = z->left;
+    node(tree, z->left)->parent = y;
+    node(tree, y)->color = z->color;
+  }
+
+  z->linked = false;
+  tree->count--;
+  if (removed == BLACK) {
+    remove_fixup(tree, x, x_parent);
+  }
+  return true;
+}
+
+uint32_t rb_first(const RBTree *tree) {
+  return tree->first;
+}
+
+uint32_t rb_pop_first(RBTree *tree) {
+  uint32_t item = tree->first;
+  if (item != NIL) {
+    rb_remove(tree, item);
+  }
+  return item;
+}
+
+bool rb_contains(const RBTree *tree, uint32_t item) {
+  return item < tree->node_capacity && tree->nodes[item].linked;
+}
+
+size_t rb_size(const RBTree *tree) {
+  return tree->count;
+}
+
+bool rb_valid(const RBTree *tree) {
+  if (color_of(tree, tree->root) != BLACK) {
+    return false;
+  }
+  if (check_subtree(tree, tree->root, NIL) < 0) {
+    return false;
+  }
+  if (count_subtree(tree, tree->root) != tree->count) {
+    return false;
+  }
+  uint32_t expected = (tree->root == NIL) ? NIL : leftmost(tree, tree->root);
+  return tree->first == expected;
+}
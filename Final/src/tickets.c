@@ -0,0 +1,144 @@
+#include "../include/tickets.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+struct TicketTree {
+  uint64_t *sums;    // 1-based Fenwick tree, sums[i] covers (i - lowbit(i), i]
+  uint64_t *counts;  // Tickets per handle
+  size_t capacity;   // Power of two
+  uint64_t total;
+  size_t holders;    // Handles with a non-zero count
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static inline size_t lowbit(size_t i) {
+  return i & (~i + 1);
+}
+
+// Add delta (two's complement for a decrease) to the handle's prefix sums
+static void add(TicketTree *tree, uint32_t item, uint64_t delta) {
+  for (size_t i = (size_t)item + 1; i <= tree->capacity; i += lowbit(i)) {
+    tree->sums[i] += delta;
+  }
+}
+
+// Make sure `item` has a slot, rebuilding the sums at the new size
+static void reserve(TicketTree *tree, uint32_t item) {
+  if (item < tree->capacity) {
+    return;
+  }
+  size_t capacity = tree->capacity;
+  while (capacity <= item) {
+    capacity *= 2;
+  }
+  uint64_t *counts = realloc(tree->counts, capacity * sizeof(uint64_t));
+  if (!counts) {
+    perror("realloc ticket counts");
+    exit(EXIT_FAILURE);
+  }
+  memset(counts + tree->capacity, 0, (capacity - tree->capacity) * sizeof(uint64_t));
+  uint64_t *sums = calloc(capacity + 1, sizeof(uint64_t));
+  if (!sums) {
+    perror("calloc ticket sums");
+    exit(EXIT_FAILURE);
+  }
+  // Linear-time build: every node pushes its sum to its parent
+  for (size_t i = 1; i <= capacity; i++) {
+    sums[i] += counts[i - 1];
+    size_t parent = i + lowbit(i);
+    if (parent <= capacity) {
+      sums[parent] += sums[i];
+    }
+  }
+  free(tree->sums);
+  tree->counts = counts;
+  tree->sums = sums;
+  tree->capacity = capacity;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+TicketTree *tickets_create(size_t capacity) {
+  TicketTree *tree = calloc(1, sizeof(TicketTree));
+  if (!tree) {
+    perror("calloc ticket tree");
+    exit(EXIT_FAILURE);
+  }
+  size_t size = 16;
+  while (size < capacity) {
+    size *= 2;
+  }
+  tree->counts = calloc(size, sizeof(uint64_t));
+  tree->sums = calloc(size + 1, sizeof(uint64_t));
+  if (!tree->counts || !tree->sums) {
+    perror("calloc ticket tree");
+    exit(EXIT_FAILURE);
+  }
+  tree->capacity = size;
+  return tree;
+}
+
+void tickets_destroy(TicketTree *tree) {
+  if (!tree) {
+    return;
+  }
+  free(tree->sums);
+  free(tree->counts);
+  free(tree);
+}
+
+void tickets_set(TicketTree *tree, uint32_t item, uint64_t count) {
+  if (item == TICKETS_EMPTY) {
+    fprintf(stderr, "tickets_set: TICKETS_EMPTY is reserved\n");
+    return;
+  }
+  if (item >= tree->capacity) {
+    if (count == 0) {
+      return;
+    }
+    reserve(tree, item);
+  }
+  uint64_t old = tree->counts[item];
+  if (old == count) {
+    return;
+  }
+  tree->holders += (old == 0) - (count == 0);
+  tree->counts[item] = count;
+  tree->total += count - old;
+  add(tree, item, count - old);
+}
+
+uint64_t tickets_get(const TicketTree *tree, uint32_t item) {
+  return item < tree->capacity ? tree->counts[item] : 0;
+}
+
+uint64_t tickets_total(const TicketTree *tree) {
+  return tree->total;
+}
+
+uint32_t tickets_draw(const TicketTree *tree, uint64_t ticket) {
+  if (ticket >= tree->total) {
+    return TICKETS_EMPTY;
+  }
+  // Descend from the top bit: find the last position whose prefix sum
+  // does not pass the ticket, the winner is the one after it
+  size_t pos = 0;
+  for (size_t step = tree->capacity; step > 0; step /= 2) {
+    if (pos + step <= tree->capacity && tree->sums[pos + step] <= ticket) {
+      pos += step;
+      ticket -= tree->sums[pos];
+    }
+  }
+  return (uint32_t)pos;
+}
+
+size_t tickets_size(const TicketTree *tree) {
+  return tree->holders;
+}
@@ -0,0 +1,442 @@
+#include "../include/workload.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define WORKLOAD_INITIAL_CAPACITY 16
+#define MAX_WORKLOAD_LINE 1024
+
+// Shape of the Pareto tails, heavy enough that the variance is infinite
+#define PARETO_ALPHA 1.5
+// Draws are capped at this many times the mean to stay inside an int
+#define MAX_DRAW_FACTOR 1000.0
+// Bursty arrivals: mean cluster size, and how much tighter the gaps
+// inside a cluster are than the overall mean gap
+#define CLUSTER_SIZE 4.0
+#define CLUSTER_SQUEEZE 10.0
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================= INTERNAL STRUCTS ========================================= */
+
+// splitmix64, so a seed gives the same workload on every libc
+typedef struct {
+  uint64_t state;
+} Rng;
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ========================================== UTILITY FUNCTS ========================================== */
+
+static uint64_t rng_next(Rng *rng) {
+  uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Uniform in (0, 1], never 0 so it is safe to take the log of
+static double rng_unit(Rng *rng) {
+  return ((double)(rng_next(rng) >> 11) + 1.0) / 9007199254740992.0;
+}
+
+static double draw_exponential(Rng *rng, double mean) {
+  return -mean * log(rng_unit(rng));
+}
+
+static double draw_pareto(Rng *rng, double mean) {
+  double scale = mean * (PARETO_ALPHA - 1.0) / PARETO_ALPHA;
+  return scale / pow(rng_unit(rng), 1.0 / PARETO_ALPHA);
+}
+
+static int clamp_draw(double x, int mean, int min) {
+  double cap = (mean > 0 ? mean : 1) * MAX_DRAW_FACTOR;
+  if (cap > INT32_MAX / 2) {
+    cap = INT32_MAX / 2;
+  }
+  if (x > cap) {
+    x = cap;
+  }
+  int v = (int)(x + 0.5);
+  return v < min ? min : v;
+}
+
+static int draw_burst(Rng *rng, const BurstSpec *spec) {
+  if (spec->mean <= 0) {
+    return 0;
+  }
+  switch (spec->shape) {
+    case BURST_UNIFORM:
+      return 1 + (int)(rng_next(rng) % (uint64_t)(2 * spec->mean - 1));
+    case BURST_EXPONENTIAL:
+      return clamp_draw(draw_exponential(rng, spec->mean), spec->mean, 1);
+    case BURST_PARETO:
+      return clamp_draw(draw_pareto(rng, spec->mean), spec->mean, 1);
+    case BURST_FIXED:
+    default:
+      return spec->mean;
+  }
+}
+
+// Gap before the next arrival. `in_cluster` carries the bursty
+// pattern's state: arrivals left in the current cluster.
+static int draw_gap(Rng *rng, const WorkloadConfig *cfg, int *in_cluster) {
+  double mean = cfg->mean_gap;
+  switch (cfg->arrivals) {
+    case ARRIVAL_BURSTY: {
+      if (*in_cluster > 0) {
+        (*in_cluster)--;
+        return clamp_draw(draw_exponential(rng, mean / CLUSTER_SQUEEZE), cfg->mean_gap, 0);
+      }
+      // Start a new cluster, sized so the long run rate matches mean_gap
+      *in_cluster = 0;
+      while (rng_unit(rng) > 1.0 / CLUSTER_SIZE) {
+        (*in_cluster)++;
+      }
+      double quiet = mean * (CLUSTER_SIZE - (CLUSTER_SIZE - 1.0) / CLUSTER_SQUEEZE);
+      return clamp_draw(draw_exponential(rng, quiet), cfg->mean_gap, 0);
+    }
+    case ARRIVAL_HEAVY_TAILED:
+      return clamp_draw(draw_pareto(rng, mean), cfg->mean_gap, 0);
+    case ARRIVAL_POISSON:
+    default:
+      return clamp_draw(draw_exponential(rng, mean), cfg->mean_gap, 0);
+  }
+}
+
+// Instructions write_load takes to put value in a register
+static int load_length(int value) {
+  return (value >= -32768 && value <= 32767) ? 1 : 2;
+}
+
+// Load a constant. The assembler's li is a single instruction, which
+// for anything wider than 16 bits loads only the upper half, so those
+// are spelled out as lui and ori.
+static void write_load(FILE *fp, const char *reg, int value) {
+  if (load_length(value) == 1) {
+    fprintf(fp, "    li %s, %d\n", reg, value);
+    return;
+  }
+  uint32_t bits = (uint32_t)value;
+  fprintf(fp, "    lui %s, 0x%x\n", reg, bits >> 16);
+  fprintf(fp, "    ori %s, %s, 0x%x\n", reg, reg, bits & 0xFFFF);
+}
+
+// Spin iterations for a CPU burst, each is an addiu and a bne
+static int spin_count(int cpu_burst) {
+  int n = (cpu_burst - 2) / 2;
+  return n < 1 ? 1 : n;
+}
+
+// Exactly how many instructions the program from workload_write_asm runs
+static int program_length(const WorkloadEntry *e) {
+  int length = 2; // li $v0, 10 / syscall
+  for (int i = 0; i < e->phases; i++) {
+    int n = spin_count(e->cpu_bursts[i]);
+    length += load_length(n) + 2 * n + 1; // Load, loop, nop on the way out
+    if (i + 1 < e->phases && e->io_bursts[i] > 0) {
+      length += load_length(e->io_bursts[i]) + 2; // Load $a0, li $v0, syscall
+    }
+  }
+  return length;
+}
+
+static Workload *workload_create(void) {
+  Workload *w = calloc(1, sizeof(Workload));
+  if (!w) {
+    perror("calloc workload");
+    exit(EXIT_FAILURE);
+  }
+  return w;
+}
+
+static WorkloadEntry *workload_append(Workload *w) {
+  if (w->count == w->capacity) {
+    int capacity = w->capacity ? w->capacity * 2 : WORKLOAD_INITIAL_CAPACITY;
+    WorkloadEntry *grown = realloc(w->entries, (size_t)capacity * sizeof(WorkloadEntry));
+    if (!grown) {
+      perror("realloc workload");
+      exit(EXIT_FAILURE);
+    }
+    w->entries = grown;
+    w->capacity = capacity;
+  }
+  WorkloadEntry *e = &w->entries[w->count++];
+  memset(e, 0, sizeof(*e));
+  e->burst = -1;
+  e->priority = -1;
+  return e;
+}
+
+static char *copy_string(const char *s) {
+  char *copy = malloc(strlen(s) + 1);
+  if (!copy) {
+    perror("malloc workload string");
+    exit(EXIT_FAILURE);
+  }
+  strcpy(copy, s);
+  return copy;
+}
+
+// `dir/name`, or just `name` when dir is empty
+static char *join_path(const char *dir, size_t dir_len, const char *name) {
+  char *path = malloc(dir_len + strlen(name) + 2);
+  if (!path) {
+    perror("malloc workload path");
+    exit(EXIT_FAILURE);
+  }
+  if (dir_len == 0) {
+    strcpy(path, name);
+  } else {
+    sprintf(path, "%.*s/%s", (int)dir_len, dir, name);
+  }
+  return path;
+}
+
+static bool parse_int_field(const char *s, int *out) {
+  char *end;
+  errno = 0;
+  long v = strtol(s, &end, 10);
+  if (end == s || *end != '\0' || errno != 0 || v < 0 || v > INT32_MAX) {
+    return false;
+  }
+  *out = (int)v;
+  return true;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+/* ============================================ API FUNCTS ============================================ */
+
+void workload_defaults(WorkloadConfig *cfg) {
+  cfg->seed = 1;
+  cfg->count = 20;
+  cfg->arrivals = ARRIVAL_POISSON;
+  cfg->mean_gap = 50;
+  cfg->cpu.shape = BURST_EXPONENTIAL;
+  cfg->cpu.mean = 100;
+  cfg->io.shape = BURST_EXPONENTIAL;
+  cfg->io.mean = 0;
+  cfg->phases = 1;
+  cfg->max_priority = 10;
+}
+
+Workload *workload_generate(const WorkloadConfig *cfg) {
+  Workload *w = workload_create();
+  Rng rng = { cfg->seed };
+  int phases = cfg->phases > 0 ? cfg->phases : 1;
+  int max_priority = cfg->max_priority > 0 ? cfg->max_priority : 1;
+  int in_cluster = 0;
+  int now = 0;
+
+  for (int i = 0; i < cfg->count; i++) {
+    if (i > 0) {
+      int gap = draw_gap(&rng, cfg, &in_cluster);
+      now = (gap > INT32_MAX - now) ? INT32_MAX : now + gap;
+    }
+    WorkloadEntry *e = workload_append(w);
+    e->arrival = now;
+    e->priority = 1 + (int)(rng_next(&rng) % (uint64_t)max_priority);
+    e->phases = phases;
+    e->cpu_bursts = malloc((size_t)phases * sizeof(int));
+    e->io_bursts = calloc((size_t)phases, sizeof(int));
+    if (!e->cpu_bursts || !e->io_bursts) {
+      perror("malloc workload bursts");
+      exit(EXIT_FAILURE);
+    }
+    for (int p = 0; p < phases; p++) {
+      e->cpu_bursts[p] = draw_burst(&rng, &cfg->cpu);
+      if (e->cpu_bursts[p] < 1) {
+        e->cpu_bursts[p] = 1;
+      }
+      if (p + 1 < phases) {
+        e->io_bursts[p] = draw_burst(&rng, &cfg->io);
+      }
+    }
+    e->burst = program_length(e);
+  }
+  return w;
+}
+
+Workload *workload_load(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Cannot open workload %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+
+  // Programs are found relative to the workload file
+  const char *slash = strrchr(path, '/');
+  size_t dir_len = slash ? (size_t)(slash - path) : 0;
+
+  Workload *w = workload_create();
+  char line[MAX_WORKLOAD_LINE];
+  int line_no = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    line_no++;
+    char *hash = strchr(line, '#');
+    if (hash) {
+      *hash = '\0';
+    }
+
+    char *fields[8];
+    int nfields = 0;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(line, " \t\r\n", &saveptr); tok;
+         tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+      if (nfields == 7) {
+        nfields++;
+        break;
+      }
+      fields[nfields++] = tok;
+    }
+    if (nfields == 0) {
+      continue;
+    }
+
+    // arrival, burst, priority, then the real-time fields all or none
+    int values[6] = { 0, -1, -1, 0, 0, 0 };
+    bool ok = nfields <= 4 || nfields == 7;
+    for (int f = 1; ok && f < nfields; f++) {
+      ok = parse_int_field(fields[f], &values[f - 1]);
+    }
+    if (!ok) {
+      fprintf(stderr, "%s:%d: expected: program [arrival [burst [priority"
+              " [period deadline wcet]]]]\n", path, line_no);
+      fclose(fp);
+      workload_free(w);
+      return NULL;
+    }
+
+    WorkloadEntry *e = workload_append(w);
+    e->program = (fields[0][0] == '/') ? copy_string(fields[0])
+                                       : join_path(path, dir_len, fields[0]);
+    e->arrival = values[0];
+    e->burst = values[1];
+    e->priority = values[2];
+    e->period = values[3];
+    e->deadline = values[4];
+    e->wcet = values[5];
+  }
+  fclose(fp);
+  return w;
+}
+
+bool workload_write_asm(const WorkloadEntry *e, const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  fprintf(fp, "# Generated workload process: arrives at %d, priority %d\n", e->arrival, e->priority);
+  fprintf(fp, "# %d CPU burst(s), %d instructions in total\n", e->phases, e->burst);
+  fprintf(fp, ".text\n.globl main\nmain:\n");
+  for (int i = 0; i < e->phases; i++) {
+    fprintf(fp, "    # CPU burst of %d\n", e->cpu_bursts[i]);
+    write_load(fp, "$t0", spin_count(e->cpu_bursts[i]));
+    fprintf(fp, "spin%d:\n", i);
+    fprintf(fp, "    addiu $t0, $t0, -1\n");
+    fprintf(fp, "    bne $t0, $zero, spin%d\n", i);
+    fprintf(fp, "    nop\n");
+    if (i + 1 < e->phases && e->io_bursts[i] > 0) {
+      fprintf(fp, "    # I/O burst of %d\n", e->io_bursts[i]);
+      write_load(fp, "$a0", e->io_bursts[i]);
+      fprintf(fp, "    li $v0, 13\n");
+      fprintf(fp, "    syscall\n");
+    }
+  }
+  fprintf(fp, "    li $v0, 10\n    syscall\n");
+  if (fclose(fp) != 0) {
+    fprintf(stderr, "Cannot write %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool workload_write(Workload *w, const char *dir) {
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Cannot create %s: %s\n", dir, strerror(errno));
+    return false;
+  }
+
+  char *spec_path = join_path(dir, strlen(dir), "workload.txt");
+  FILE *spec = fopen(spec_path, "w");
+  if (!spec) {
+    fprintf(stderr, "Cannot write %s: %s\n", spec_path, strerror(errno));
+    free(spec_path);
+    return false;
+  }
+  fprintf(spec, "# program            arrival  burst  priority\n");
+
+  bool ok = true;
+  for (int i = 0; ok && i < w->count; i++) {
+    WorkloadEntry *e = &w->entries[i];
+    const char *name = e->program;
+    char generated[32];
+    if (!name) {
+      snprintf(generated, sizeof(generated), "gen_%04d.asm", i);
+      e->program = join_path(dir, strlen(dir), generated);
+      ok = workload_write_asm(e, e->program);
+      name = generated;
+    }
+    fprintf(spec, "%-20s %-8d", name, e->arrival);
+    if (e->burst >= 0) {
+      fprintf(spec, " %-6d", e->burst);
+      if (e->priority >= 0) {
+        fprintf(spec, " %d", e->priority);
+        if (e->period > 0) {
+          fprintf(spec, " %d %d %d", e->period, e->deadline, e->wcet);
+        }
+      }
+    }
+    fprintf(spec, "\n");
+  }
+
+  if (fclose(spec) != 0) {
+    fprintf(stderr, "Cannot write %s: %s\n", spec_path, strerror(errno));
+    ok = false;
+  }
+  free(spec_path);
+  return ok;
+}
+
+void workload_free(Workload *w) {
+  if (!w) {
+    return;
+  }
+  for (int i = 0; i < w->count; i++) {
+    free(w->entries[i].program);
+    free(w->entries[i].cpu_bursts);
+    free(w->entries[i].io_bursts);
+  }
+  free(w->entries);
+  free(w);
+}
+
+bool workload_parse_arrivals(const char *name, ArrivalPattern *out) {
+  if (strcmp(name, "poisson") == 0) {
+    *out = ARRIVAL_POISSON;
+  } else if (strcmp(name, "bursty") == 0) {
+    *out = ARRIVAL_BURSTY;
+  } else if (strcmp(name, "heavy") == 0 || strcmp(name, "heavy-tailed") == 0) {
+    *out = ARRIVAL_HEAVY_TAILED;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool workload_parse_burst(const char *name, BurstDistribution *out) {
+  if (strcmp(name, "fixed") == 0) {
+    *out = BURST_FIXED;
+  } else if (strcmp(name, "uniform") == 0) {
+    *out = BURST_UNIFORM;
+  } else if (strcmp(name, "exp") == 0 || strcmp(name, "exponential") == 0) {
+    *out = BURST_EXPONENTIAL;
+  } else if (strcmp(name, "pareto") == 0) {
+    *out = BURST_PARETO;
+  } else {
+    return false;
+  }
+  return true;
+}
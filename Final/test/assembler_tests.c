@@ -0,0 +1,256 @@
+#include "../include/assembler.h"
+#include "../include/memory.h"
+#include "../include/object.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// A comment with a ':' in it, a label sharing its line with an
+// instruction and a string holding a ':', with every relocation type
+static const char *const PROGRAM =
+  ".data\n"
+  "prompt: .asciiz \"Score: \"\n"
+  "count:  .word 7\n"
+  ".text\n"
+  ".globl main\n"
+  "main:   li $v0, 5            # syscall 5: read int\n"
+  "loop: addiu $t0, $t0, 1\n"
+  "        bne $t0, $zero, loop\n"
+  "        la $a0, prompt\n"
+  "        jal done\n"
+  "        j main\n"
+  "done:   jr $ra\n";
+
+// Write source to a temporary file and assemble it as process pid
+static AssemblyResult assemble_source(const char *source, int pid) {
+  AssemblyResult result = {0};
+  char path[] = "/tmp/assembler_testXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return result;
+  }
+  size_t len = strlen(source);
+  bool written = write(fd, source, len) == (ssize_t)len;
+  close(fd);
+  if (written) {
+    result = assemble(path, pid);
+  }
+  unlink(path);
+  return result;
+}
+
+// The text of PROGRAM as it has to be loaded, wherever that is
+static void check_program(const AssemblyResult *result) {
+  const AssembledProgram *prog = result->program;
+  uint32_t text = prog->text_start;
+  uint32_t data = prog->data_start;
+  ASSERT_TRUE(result->success);
+  ASSERT_EQ(prog->text_size, 7 * 4);
+  ASSERT_EQ(prog->entry_point, text);
+
+  // Nothing came out of the comment
+  ASSERT_EQ(result->symbol_count, 5);
+  ASSERT_EQ(get_symbol_by_name(result, "main"), (int)text);
+  ASSERT_EQ(get_symbol_by_name(result, "loop"), (int)(text + 4));
+  ASSERT_EQ(get_symbol_by_name(result, "done"), (int)(text + 24));
+  ASSERT_EQ(get_symbol_by_name(result, "prompt"), (int)data);
+  ASSERT_EQ(get_symbol_by_name(result, "count"), (int)(data + 8));
+
+  // The string once, terminated, with the word after it
+  char prompt[16];
+  for (int i = 0; i < 8; i++) {
+    prompt[i] = (char)read_byte(data + i);
+  }
+  ASSERT_TRUE(memcmp(prompt, "Score: ", 8) == 0);
+  ASSERT_EQ(read_word(data + 8), 7);
+
+  ASSERT_TRUE(data <= 32767); // la is a single addiu for this address
+  ASSERT_EQ(read_word(text + 0), 0x24020005);                       // addiu $v0, $zero, 5
+  ASSERT_EQ(read_word(text + 4), 0x25080001);                       // addiu $t0, $t0, 1
+  ASSERT_EQ(read_word(text + 8), 0x1500fffe);                       // bne $t0, $zero, -2
+  ASSERT_EQ(read_word(text + 12), 0x24040000 | data);               // la $a0, prompt
+  ASSERT_EQ(read_word(text + 16), 0x0c000000 | ((text + 24) >> 2)); // jal done
+  ASSERT_EQ(read_word(text + 20), 0x08000000 | (text >> 2));        // j main
+  ASSERT_EQ(read_word(text + 24), 0x03e00008);                      // jr $ra
+}
+
+// ============================================
+// Parsing
+// ============================================
+
+TEST_CASE(Assembler, CommentsLabelsAndStringsWithColons) {
+  harness_reset();
+  AssemblyResult result = assemble_source(PROGRAM, 0);
+  check_program(&result);
+  free_program(&result);
+}
+
+TEST_CASE(Assembler, LabelAloneOnItsLine) {
+  harness_reset();
+  AssemblyResult result = assemble_source(
+    ".text\n"
+    "start:\n"
+    "\n"
+    "main:  # entry: here\n"
+    "    nop\n"
+    "end: syscall\n", 0);
+  ASSERT_TRUE(result.success);
+  uint32_t text = result.program->text_start;
+  ASSERT_EQ(result.program->text_size, 2 * 4);
+  ASSERT_EQ(get_symbol_by_name(&result, "start"), (int)text);
+  ASSERT_EQ(get_symbol_by_name(&result, "main"), (int)text);
+  ASSERT_EQ(get_symbol_by_name(&result, "end"), (int)(text + 4));
+  ASSERT_EQ(read_word(text + 4), 0x0000000c);
+  free_program(&result);
+}
+
+// ============================================
+// Relocation
+// ============================================
+
+TEST_CASE(Assembler, AddressesFollowTheLoadedSegments) {
+  // Process 2 is loaded after the others, well away from where it
+  // was assembled
+  harness_reset();
+  AssemblyResult first = assemble_source(PROGRAM, 0);
+  AssemblyResult second = assemble_source(PROGRAM, 1);
+  AssemblyResult third = assemble_source(PROGRAM, 2);
+  ASSERT_TRUE(third.program->text_start != first.program->text_start);
+  check_program(&first);
+  check_program(&second);
+  check_program(&third);
+  free_program(&first);
+  free_program(&second);
+  free_program(&third);
+}
+
+TEST_CASE(Assembler, CachedObjectIsRelocatedWhenLoaded) {
+  char dir[] = "/tmp/assembler_cacheXXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  harness_reset();
+  set_object_cache(dir);
+
+  // The first assembles and caches, the others only load the object
+  AssemblyResult first = assemble_source(PROGRAM, 1);
+  char cache_path[4096];
+  ASSERT_TRUE(object_cache_path(object_hash(PROGRAM, strlen(PROGRAM)),
+                                cache_path, sizeof(cache_path)));
+  ASSERT_EQ(access(cache_path, F_OK), 0);
+  AssemblyResult second = assemble_source(PROGRAM, 3);
+  AssemblyResult third = assemble_source(PROGRAM, 4);
+  check_program(&first);
+  check_program(&second);
+  check_program(&third);
+  free_program(&first);
+  free_program(&second);
+  free_program(&third);
+
+  set_object_cache(NULL);
+  unlink(cache_path);
+  rmdir(dir);
+}
+
+TEST_CASE(Assembler, GeneratedProgramPastTheOldSymbolLimitRuns) {
+  // A chain of 1100 labels, each jumped to from the one before, the
+  // shape of a large generated workload. A jump that went nowhere would
+  // fall into the addiu after it.
+  enum { LINKS = 1100 };
+  size_t size = (size_t)LINKS * 80 + 128;
+  char *source = malloc(size);
+  ASSERT_TRUE(source != NULL);
+  size_t len = (size_t)snprintf(source, size, ".text\nmain:\n    j L0\n");
+  for (int i = 0; i < LINKS - 1; i++) {
+    len += (size_t)snprintf(source + len, size - len,
+                            "L%d: addiu $t0, $t0, 1\n    j L%d\n    addiu $t1, $t1, 1\n",
+                            i, i + 1);
+  }
+  snprintf(source + len, size - len,
+           "L%d: addiu $t0, $t0, 1\n    li $v0, 10\n    syscall\n", LINKS - 1);
+
+  harness_reset();
+  ASSERT_TRUE(harness_submit(source, 1, 1, 10 * LINKS, 0));
+  free(source);
+  const ProcessMetrics *pm = harness_process(harness_run(SCHED_FCFS), 1);
+  ASSERT_TRUE(pm != NULL);
+  ASSERT_EQ(pm->burst_time, 1 + 2 * (LINKS - 1) + 3);
+}
+
+// ============================================
+// Symbols
+// ============================================
+
+// Far more labels than the table starts with, and more than a 16-bit
+// relocation could name. L756691 and L2085940 hash alike.
+#define MANY_LABELS 70000
+
+static char *many_labels_source(void) {
+  size_t size = (size_t)MANY_LABELS * 32 + 256;
+  char *source = malloc(size);
+  if (!source) {
+    perror("malloc many labels");
+    exit(EXIT_FAILURE);
+  }
+  size_t len = (size_t)snprintf(source, size, ".text\nmain:\n");
+  for (int i = 0; i < MANY_LABELS; i++) {
+    len += (size_t)snprintf(source + len, size - len, "L%d: addiu $t0, $t0, 1\n", i);
+  }
+  snprintf(source + len, size - len,
+           "L756691: addiu $t1, $t1, 1\n"
+           "L2085940: addiu $t2, $t2, 1\n"
+           "    j L756691\n"
+           "    j L2085940\n"
+           "    j L%d\n"
+           "    bne $t0, $zero, L%d\n", MANY_LABELS - 1, MANY_LABELS - 1);
+  return source;
+}
+
+static void check_many_labels(const AssemblyResult *result) {
+  ASSERT_TRUE(result->success);
+  uint32_t text = result->program->text_start;
+  uint32_t end = text + MANY_LABELS * 4;
+  ASSERT_EQ(result->symbol_count, MANY_LABELS + 3);
+  ASSERT_EQ(get_symbol_by_name(result, "L1099"), (int)(text + 1099 * 4));
+  ASSERT_EQ(get_symbol_by_name(result, "L69999"), (int)(text + 69999 * 4));
+  ASSERT_EQ(get_symbol_by_name(result, "L756691"), (int)end);
+  ASSERT_EQ(get_symbol_by_name(result, "L2085940"), (int)(end + 4));
+  ASSERT_EQ(read_word(end + 8), 0x08000000 | (end >> 2));                    // j L756691
+  ASSERT_EQ(read_word(end + 12), 0x08000000 | ((end + 4) >> 2));             // j L2085940
+  ASSERT_EQ(read_word(end + 16), 0x08000000 | ((text + 69999 * 4) >> 2));    // j L69999
+  ASSERT_EQ(read_word(end + 20), 0x1500fff9);                                // bne to L69999
+}
+
+TEST_CASE(Assembler, SymbolTableGrows) {
+  char *source = many_labels_source();
+  harness_reset();
+  AssemblyResult result = assemble_source(source, 1);
+  check_many_labels(&result);
+  free_program(&result);
+  free(source);
+}
+
+TEST_CASE(Assembler, WideSymbolIndexSurvivesTheCache) {
+  char dir[] = "/tmp/assembler_cacheXXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  char *source = many_labels_source();
+  harness_reset();
+  set_object_cache(dir);
+  AssemblyResult first = assemble_source(source, 1);
+  AssemblyResult second = assemble_source(source, 2);
+  check_many_labels(&first);
+  check_many_labels(&second);
+  free_program(&first);
+  free_program(&second);
+
+  char cache_path[4096];
+  ASSERT_TRUE(object_cache_path(object_hash(source, strlen(source)),
+                                cache_path, sizeof(cache_path)));
+  set_object_cache(NULL);
+  unlink(cache_path);
+  rmdir(dir);
+  free(source);
+}
@@ -0,0 +1,240 @@
+#include "../include/console.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// stdout goes to a temporary file between capture_begin and capture_end
+static char g_capture_path[] = "/tmp/console_testXXXXXX";
+static int g_capture_fd = -1;
+static int g_saved_stdout = -1;
+
+static void capture_begin(void) {
+  strcpy(g_capture_path, "/tmp/console_testXXXXXX");
+  fflush(stdout);
+  g_capture_fd = mkstemp(g_capture_path);
+  g_saved_stdout = dup(STDOUT_FILENO);
+  dup2(g_capture_fd, STDOUT_FILENO);
+}
+
+// What has reached stdout so far, as a string
+static const char *captured(void) {
+  static char out[8192];
+  fflush(stdout);
+  ssize_t n = pread(g_capture_fd, out, sizeof(out) - 1, 0);
+  out[(n > 0) ? n : 0] = '\0';
+  return out;
+}
+
+static void capture_end(void) {
+  fflush(stdout);
+  dup2(g_saved_stdout, STDOUT_FILENO);
+  close(g_saved_stdout);
+  close(g_capture_fd);
+  unlink(g_capture_path);
+}
+
+// ============================================
+// Buffering
+// ============================================
+
+TEST_CASE(Console, OutputWaitsForAFlush) {
+  capture_begin();
+  console_attach(1);
+  console_write("held", 4);
+  ASSERT_TRUE(strcmp(captured(), "") == 0);
+  console_flush();
+  ASSERT_TRUE(strcmp(captured(), "held") == 0);
+  console_attach(-1);
+  console_write("direct", 6); // Nothing attached, nothing held
+  ASSERT_TRUE(strcmp(captured(), "helddirect") == 0);
+  capture_end();
+  console_free();
+}
+
+TEST_CASE(Console, EachProcessHasItsOwnBuffer) {
+  capture_begin();
+  console_attach(1);
+  console_write("one", 3);
+  console_attach(2); // Taking 1 off the console writes it out
+  ASSERT_TRUE(strcmp(captured(), "one") == 0);
+  console_write("two", 3);
+  ASSERT_TRUE(strcmp(captured(), "one") == 0);
+  console_attach(1);
+  ASSERT_TRUE(strcmp(captured(), "onetwo") == 0);
+  console_attach(-1);
+  capture_end();
+  console_free();
+}
+
+TEST_CASE(Console, FullBufferGoesOut) {
+  char data[CONSOLE_BUFFER_SIZE + 10];
+  memset(data, 'x', sizeof(data));
+  capture_begin();
+  console_attach(1);
+  console_write(data, sizeof(data));
+  ASSERT_EQ(strlen(captured()), CONSOLE_BUFFER_SIZE);
+  console_flush();
+  ASSERT_EQ(strlen(captured()), sizeof(data));
+  console_attach(-1);
+  capture_end();
+  console_free();
+}
+
+TEST_CASE(Console, LineModeFlushesAtNewline) {
+  capture_begin();
+  console_set_line_mode(true);
+  console_attach(1);
+  console_write("ab\ncd", 5);
+  ASSERT_TRUE(strcmp(captured(), "ab\ncd") == 0);
+  console_write("ef", 2);
+  ASSERT_TRUE(strcmp(captured(), "ab\ncd") == 0);
+  console_set_line_mode(false);
+  console_write("g\n", 2);
+  ASSERT_TRUE(strcmp(captured(), "ab\ncd") == 0);
+  console_attach(-1);
+  ASSERT_TRUE(strcmp(captured(), "ab\ncdefg\n") == 0);
+  capture_end();
+  console_free();
+}
+
+// A second core, printing for pid 3 while the main thread prints for pid 4
+static pthread_barrier_t g_turns;
+
+static void *print_on_another_core(void *arg) {
+  (void)arg;
+  console_attach(3);
+  for (int i = 0; i < 4; i++) {
+    pthread_barrier_wait(&g_turns);
+    console_write("3333", 4);
+    pthread_barrier_wait(&g_turns);
+  }
+  console_attach(-1);
+  return NULL;
+}
+
+TEST_CASE(Console, CoresPrintingAtOnceDoNotMix) {
+  capture_begin();
+  pthread_barrier_init(&g_turns, NULL, 2);
+  pthread_t core;
+  ASSERT_TRUE(pthread_create(&core, NULL, print_on_another_core, NULL) == 0);
+  console_attach(4);
+  for (int i = 0; i < 4; i++) {
+    pthread_barrier_wait(&g_turns);
+    console_write("4444", 4);
+    pthread_barrier_wait(&g_turns);
+  }
+  console_attach(-1);
+  pthread_join(core, NULL);
+  pthread_barrier_destroy(&g_turns);
+  const char *out = captured();
+  ASSERT_TRUE(strcmp(out, "44444444444444443333333333333333") == 0 ||
+              strcmp(out, "33333333333333334444444444444444") == 0);
+  capture_end();
+  console_free();
+}
+
+// ============================================
+// Programs
+// ============================================
+
+// Prints `text` with syscall 4, spins `spin` iterations and exits
+static const char *printer(char *buf, size_t size, const char *text, int spin) {
+  snprintf(buf, size,
+           ".data\n"
+           "msg: .asciiz \"%s\"\n"
+           ".text\n"
+           ".globl main\n"
+           "main:\n"
+           "    la $a0, msg\n"
+           "    li $v0, 4\n"
+           "    syscall\n"
+           "    li $t0, %d\n"
+           "spin:\n"
+           "    addiu $t0, $t0, -1\n"
+           "    bne $t0, $zero, spin\n"
+           "    li $v0, 10\n"
+           "    syscall\n",
+           text, spin);
+  return buf;
+}
+
+TEST_CASE(Console, QuantumEndAndExitFlush) {
+  // A prints first and spins on; B prints after it and exits long
+  // before A does. Held until exit, B's would come out first.
+  char a[512], b[512], out[64];
+  harness_reset();
+  ASSERT_TRUE(harness_submit(printer(a, sizeof(a), "A", 500), 0, 1, 10000, 0));
+  ASSERT_TRUE(harness_submit(printer(b, sizeof(b), "B", 1), 1, 1, 10000, 0));
+  const PerformanceMetrics *run = harness_run_printing(SCHED_ROUND_ROBIN, out, sizeof(out));
+  ASSERT_TRUE(harness_process(run, 1)->completion_time < harness_process(run, 0)->completion_time);
+  ASSERT_TRUE(strcmp(out, "AB") == 0);
+}
+
+TEST_CASE(Console, StringLongerThanAChunkPrintsWhole) {
+  // Syscall 4 reads 256 bytes at a time; 512 ends exactly on a chunk
+  static const int lengths[] = { 700, 512 };
+  for (int i = 0; i < 2; i++) {
+    int len = lengths[i];
+    char text[1024], source[2048], out[2048];
+    for (int j = 0; j < len; j++) {
+      text[j] = (char)('a' + j % 26);
+    }
+    text[len] = '\0';
+    harness_reset();
+    ASSERT_TRUE(harness_submit(printer(source, sizeof(source), text, 1), 0, 1, 100, 0));
+    harness_run_printing(SCHED_FCFS, out, sizeof(out));
+    ASSERT_TRUE(strcmp(out, text) == 0);
+  }
+}
+
+// Prints its line four times, a line per syscall
+static const char *line_printer(char *buf, size_t size, const char *line) {
+  snprintf(buf, size,
+           ".data\n"
+           "msg: .asciiz \"%s\\n\"\n"
+           ".text\n"
+           ".globl main\n"
+           "main:\n"
+           "    li $t0, 4\n"
+           "loop:\n"
+           "    la $a0, msg\n"
+           "    li $v0, 4\n"
+           "    syscall\n"
+           "    addiu $t0, $t0, -1\n"
+           "    bne $t0, $zero, loop\n"
+           "    li $v0, 10\n"
+           "    syscall\n",
+           line);
+  return buf;
+}
+
+TEST_CASE(Console, TwoProcessesInterleaveWholeLines) {
+  char a[512], b[512], out[256];
+  harness_reset();
+  ASSERT_TRUE(harness_submit(line_printer(a, sizeof(a), "aaaa"), 0, 1, 1000, 0));
+  ASSERT_TRUE(harness_submit(line_printer(b, sizeof(b), "bbbb"), 1, 1, 1000, 0));
+  harness_run_printing(SCHED_ROUND_ROBIN, out, sizeof(out));
+
+  // Eight lines, each all one process's, and the second process's
+  // first line before the first process's last
+  ASSERT_EQ(strlen(out), 8 * 5);
+  int as = 0, bs = 0, first_b = -1, last_a = -1;
+  for (int i = 0; i < 8; i++) {
+    const char *line = out + i * 5;
+    if (strncmp(line, "aaaa\n", 5) == 0) {
+      as++;
+      last_a = i;
+    } else if (strncmp(line, "bbbb\n", 5) == 0) {
+      bs++;
+      if (first_b < 0) first_b = i;
+    }
+  }
+  ASSERT_EQ(as, 4);
+  ASSERT_EQ(bs, 4);
+  ASSERT_TRUE(first_b < last_a);
+}
@@ -0,0 +1,111 @@
+#include "../include/deque.h"
+#include "framework.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+// ============================================
+// Single Thread Tests
+// ============================================
+
+TEST_CASE(Deque, EmptyReturnsSentinel) {
+  WorkDeque *dq = deque_create(4);
+  ASSERT_EQ(deque_pop(dq), DEQUE_EMPTY);
+  ASSERT_EQ(deque_steal(dq), DEQUE_EMPTY);
+  ASSERT_EQ(deque_size(dq), 0);
+  deque_destroy(dq);
+}
+
+TEST_CASE(Deque, PopIsLifoStealIsFifo) {
+  WorkDeque *dq = deque_create(4);
+  deque_push(dq, 1);
+  deque_push(dq, 2);
+  deque_push(dq, 3);
+  ASSERT_EQ(deque_steal(dq), 1);
+  ASSERT_EQ(deque_pop(dq), 3);
+  ASSERT_EQ(deque_pop(dq), 2);
+  ASSERT_EQ(deque_pop(dq), DEQUE_EMPTY);
+  deque_destroy(dq);
+}
+
+TEST_CASE(Deque, GrowsPastCapacity) {
+  WorkDeque *dq = deque_create(2);
+  for (uint32_t i = 1; i <= 100; i++) {
+    deque_push(dq, i);
+  }
+  ASSERT_EQ(deque_size(dq), 100);
+  for (uint32_t i = 1; i <= 100; i++) {
+    ASSERT_EQ(deque_steal(dq), i);
+  }
+  deque_destroy(dq);
+}
+
+// ============================================
+// Concurrent Stealing
+// ============================================
+
+#define STEAL_ITEMS 20000
+#define THIEVES 3
+
+typedef struct {
+  WorkDeque *dq;
+  long sum;
+  int taken;
+} Thief;
+
+static void *thief_main(void *arg) {
+  Thief *t = arg;
+  int misses = 0;
+  // Give up once the deque has looked empty for a while
+  while (misses < 100000) {
+    uint32_t item = deque_steal(t->dq);
+    if (item != DEQUE_EMPTY) {
+      t->sum += item;
+      t->taken++;
+      misses = 0;
+    } else {
+      misses++;
+    }
+  }
+  return NULL;
+}
+
+TEST_CASE(Deque, EveryItemTakenExactlyOnce) {
+  WorkDeque *dq = deque_create(16);
+  Thief thieves[THIEVES] = {0};
+  pthread_t threads[THIEVES];
+  for (int i = 0; i < THIEVES; i++) {
+    thieves[i].dq = dq;
+    pthread_create(&threads[i], NULL, thief_main, &thieves[i]);
+  }
+
+  long owner_sum = 0;
+  int owner_taken = 0;
+  for (uint32_t i = 1; i <= STEAL_ITEMS; i++) {
+    deque_push(dq, i);
+    if (i % 3 == 0) {
+      uint32_t item = deque_pop(dq);
+      if (item != DEQUE_EMPTY) {
+        owner_sum += item;
+        owner_taken++;
+      }
+    }
+  }
+  uint32_t item;
+  while ((item = deque_pop(dq)) != DEQUE_EMPTY) {
+    owner_sum += item;
+    owner_taken++;
+  }
+
+  long total = owner_sum;
+  int taken = owner_taken;
+  for (int i = 0; i < THIEVES; i++) {
+    pthread_join(threads[i], NULL);
+    total += thieves[i].sum;
+    taken += thieves[i].taken;
+  }
+
+  ASSERT_EQ(taken, STEAL_ITEMS);
+  ASSERT_EQ(total, (long)STEAL_ITEMS * (STEAL_ITEMS + 1) / 2);
+  deque_destroy(dq);
+}
@@ -0,0 +1,89 @@
+#include "../include/events.h"
+#include "framework.h"
+
+#include <stdlib.h>
+
+// ============================================
+// Ordering
+// ============================================
+
+TEST_CASE(Events, EmptyQueueHasNoNextTime) {
+  EventQueue *q = event_queue_create(4);
+  Event ev;
+  ASSERT_EQ(event_next_time(q), EVENT_NEVER);
+  ASSERT_TRUE(!event_pop_due(q, 1000, &ev));
+  ASSERT_EQ(event_count(q), 0);
+  event_queue_destroy(q);
+}
+
+TEST_CASE(Events, PopsInTimestampOrder) {
+  EventQueue *q = event_queue_create(2);
+  srand(3);
+  for (uint32_t i = 0; i < 500; i++) {
+    event_schedule(q, rand() % 10000, EVENT_ARRIVAL, i);
+  }
+  ASSERT_EQ(event_count(q), 500);
+
+  Event ev;
+  int last = -1;
+  int popped = 0;
+  while (event_pop_due(q, EVENT_NEVER, &ev)) {
+    ASSERT_TRUE(ev.time >= last);
+    last = ev.time;
+    popped++;
+  }
+  ASSERT_EQ(popped, 500);
+  event_queue_destroy(q);
+}
+
+TEST_CASE(Events, EqualTimesKeepScheduleOrder) {
+  EventQueue *q = event_queue_create(4);
+  event_schedule(q, 5, EVENT_ARRIVAL, 1);
+  event_schedule(q, 5, EVENT_TIMER, 2);
+  event_schedule(q, 5, EVENT_IO_COMPLETE, 3);
+
+  Event ev;
+  ASSERT_TRUE(event_pop_due(q, 5, &ev));
+  ASSERT_EQ(ev.subject, 1);
+  ASSERT_TRUE(event_pop_due(q, 5, &ev));
+  ASSERT_EQ(ev.subject, 2);
+  ASSERT_EQ(ev.type, EVENT_TIMER);
+  ASSERT_TRUE(event_pop_due(q, 5, &ev));
+  ASSERT_EQ(ev.subject, 3);
+  event_queue_destroy(q);
+}
+
+// ============================================
+// Time Skipping
+// ============================================
+
+TEST_CASE(Events, OnlyDueEventsPop) {
+  EventQueue *q = event_queue_create(4);
+  event_schedule(q, 100, EVENT_ARRIVAL, 7);
+  event_schedule(q, 10, EVENT_ARRIVAL, 8);
+
+  Event ev;
+  ASSERT_TRUE(!event_pop_due(q, 9, &ev));
+  ASSERT_EQ(event_next_time(q), 10);
+  ASSERT_TRUE(event_pop_due(q, 50, &ev));
+  ASSERT_EQ(ev.subject, 8);
+  ASSERT_TRUE(!event_pop_due(q, 50, &ev));
+
+  // An idle CPU jumps straight to the next event
+  int now = event_next_time(q);
+  ASSERT_EQ(now, 100);
+  ASSERT_TRUE(event_pop_due(q, now, &ev));
+  ASSERT_EQ(ev.subject, 7);
+  ASSERT_EQ(event_next_time(q), EVENT_NEVER);
+  event_queue_destroy(q);
+}
+
+TEST_CASE(Events, ClearDropsEverything) {
+  EventQueue *q = event_queue_create(4);
+  event_schedule(q, 1, EVENT_ARRIVAL, 0);
+  event_schedule(q, 2, EVENT_ARRIVAL, 1);
+  event_queue_clear(q);
+  ASSERT_EQ(event_count(q), 0);
+  ASSERT_EQ(event_next_time(q), EVENT_NEVER);
+  event_queue_destroy(q);
+}
@@ -0,0 +1,200 @@
+#include "harness.h"
+#include "../include/assembler.h"
+#include "../include/console.h"
+#include "../include/keyboard.h"
+#include "../include/log.h"
+#include "../include/memory.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Programs assembled since the last reset, freed by the next one
+static AssemblyResult *g_programs = NULL;
+static int g_program_count = 0;
+static int g_program_capacity = 0;
+
+// Opens the report print_algorithm_results writes after a run
+#define REPORT_RULE "========================================"
+
+// The real stdin while a pipe stands in for it
+static int g_saved_stdin = -1;
+
+static void free_programs(void) {
+  for (int i = 0; i < g_program_count; i++) {
+    free_program(&g_programs[i]);
+  }
+  g_program_count = 0;
+}
+
+void harness_reset(void) {
+  free_programs();
+  free_memory();
+  init_memory(CACHE_WRITE_THROUGH);
+  free_queues();
+  init_queues();
+  reset_process_storage();
+  free_performance_tracking();
+  init_performance_tracking();
+
+  int quanta[] = { 2, 4, 8 };
+  set_scheduler_cores(1);
+  set_scheduler_affinity(false);
+  set_swap_watermark(0);
+  set_cfs_params(24, 3);
+  set_lottery_seed(1);
+  set_mlfq_params(quanta, 3, 100);
+  set_clock_params(1, false);
+  console_set_line_mode(false);
+}
+
+// Assemble and submit with the given affinity masks and real-time parameters
+static bool submit_file(const char *path, int pid, int priority, int burst, int arrival,
+                        uint64_t hard_affinity, uint64_t soft_affinity,
+                        RealTimeParams realtime) {
+  if (g_program_count == g_program_capacity) {
+    int capacity = g_program_capacity ? g_program_capacity * 2 : 8;
+    AssemblyResult *grown = realloc(g_programs, (size_t)capacity * sizeof(AssemblyResult));
+    if (!grown) {
+      perror("realloc harness programs");
+      exit(EXIT_FAILURE);
+    }
+    g_programs = grown;
+    g_program_capacity = capacity;
+  }
+  AssemblyResult *result = &g_programs[g_program_count++];
+  *result = assemble(path, pid);
+  if (!result->success) {
+    return false;
+  }
+  const AssembledProgram *prog = result->program;
+  return makeProcess(pid, prog->entry_point, prog->text_start, prog->text_size,
+                     prog->data_start, prog->data_size, prog->stack_ptr,
+                     priority, burst, arrival, hard_affinity, soft_affinity,
+                     realtime) != UINT32_MAX;
+}
+
+bool harness_submit_file(const char *path, int pid, int priority, int burst, int arrival) {
+  RealTimeParams none = { 0, 0, 0 };
+  return submit_file(path, pid, priority, burst, arrival, 0, 0, none);
+}
+
+// The same for source text, through a temporary file
+static bool submit_source(const char *source, int pid, int priority, int burst, int arrival,
+                          uint64_t hard_affinity, uint64_t soft_affinity,
+                          RealTimeParams realtime) {
+  char path[] = "/tmp/harness_programXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return false;
+  }
+  size_t len = strlen(source);
+  bool ok = write(fd, source, len) == (ssize_t)len;
+  close(fd);
+  ok = ok && submit_file(path, pid, priority, burst, arrival, hard_affinity, soft_affinity,
+                         realtime);
+  unlink(path);
+  return ok;
+}
+
+bool harness_submit(const char *source, int pid, int priority, int burst, int arrival) {
+  RealTimeParams none = { 0, 0, 0 };
+  return submit_source(source, pid, priority, burst, arrival, 0, 0, none);
+}
+
+bool harness_submit_affine(const char *source, int pid, int burst,
+                           uint64_t hard_affinity, uint64_t soft_affinity) {
+  RealTimeParams none = { 0, 0, 0 };
+  return submit_source(source, pid, 1, burst, 0, hard_affinity, soft_affinity, none);
+}
+
+bool harness_submit_periodic(const char *source, int pid, int burst, int arrival,
+                             int period, int deadline, int wcet) {
+  RealTimeParams realtime = { period, deadline, wcet };
+  return submit_source(source, pid, 1, burst, arrival, 0, 0, realtime);
+}
+
+// Run with stdout sent to out_fd, which is where the programs print
+static const PerformanceMetrics *run_into(SchedulingAlgorithm algorithm, int out_fd) {
+  LogLevel saved_level = g_log_level;
+  set_log_level(LOG_QUIET);
+  fflush(stdout);
+  int saved_stdout = dup(STDOUT_FILENO);
+  if (saved_stdout >= 0 && out_fd >= 0) {
+    dup2(out_fd, STDOUT_FILENO);
+  }
+
+  scheduler(algorithm);
+
+  fflush(stdout);
+  if (saved_stdout >= 0 && out_fd >= 0) {
+    dup2(saved_stdout, STDOUT_FILENO);
+  }
+  if (saved_stdout >= 0) close(saved_stdout);
+  set_log_level(saved_level);
+  return get_algorithm_metrics(get_current_algorithm_id());
+}
+
+const PerformanceMetrics *harness_run(SchedulingAlgorithm algorithm) {
+  int null_fd = open("/dev/null", O_WRONLY);
+  const PerformanceMetrics *run = run_into(algorithm, null_fd);
+  if (null_fd >= 0) close(null_fd);
+  return run;
+}
+
+const PerformanceMetrics *harness_run_printing(SchedulingAlgorithm algorithm,
+                                               char *out, size_t size) {
+  out[0] = '\0';
+  char path[] = "/tmp/harness_outputXXXXXX";
+  int fd = mkstemp(path);
+  const PerformanceMetrics *run = run_into(algorithm, fd);
+  if (fd >= 0) {
+    ssize_t n = pread(fd, out, size - 1, 0);
+    out[(n > 0) ? n : 0] = '\0';
+    // The scheduler's report comes after everything the programs print
+    char *report = strstr(out, "\n" REPORT_RULE);
+    if (report) {
+      *report = '\0';
+    }
+    close(fd);
+    unlink(path);
+  }
+  return run;
+}
+
+int harness_pipe_stdin(void) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  if (g_saved_stdin < 0) {
+    g_saved_stdin = dup(STDIN_FILENO);
+  }
+  dup2(fds[0], STDIN_FILENO);
+  close(fds[0]);
+  return fds[1];
+}
+
+void harness_restore_stdin(void) {
+  keyboard_close(); // The reader thread goes before the pipe does
+  if (g_saved_stdin >= 0) {
+    dup2(g_saved_stdin, STDIN_FILENO);
+    close(g_saved_stdin);
+    g_saved_stdin = -1;
+  }
+}
+
+const ProcessMetrics *harness_process(const PerformanceMetrics *run, int pid) {
+  if (!run) {
+    return NULL;
+  }
+  for (int i = 0; i < run->process_count; i++) {
+    if (run->process_metrics[i].pid == pid) {
+      return &run->process_metrics[i];
+    }
+  }
+  return NULL;
+}
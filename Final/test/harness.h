@@ -0,0 +1,57 @@
+#ifndef TEST_HARNESS_H
+#define TEST_HARNESS_H
+
+#include "../include/performance.h"
+#include "../include/processes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Runs whole programs through the scheduler, for the tests of the
+ * policies themselves. A test resets, submits a few programs, runs one
+ * policy and reads the run's metrics back.
+ */
+
+// Fresh memory, queues and metrics, and every scheduler setting back to
+// its default
+void harness_reset(void);
+
+// Assemble a program as process pid and submit it. False if it does
+// not assemble.
+bool harness_submit_file(const char *path, int pid, int priority, int burst, int arrival);
+
+// The same for a program given as source text
+bool harness_submit(const char *source, int pid, int priority, int burst, int arrival);
+
+// Source text arriving at 0 with priority 1, held to the CPUs in
+// hard_affinity and preferring those in soft_affinity (0 = any)
+bool harness_submit_affine(const char *source, int pid, int burst,
+                           uint64_t hard_affinity, uint64_t soft_affinity);
+
+// Source text as a periodic real-time task with priority 1, see
+// RealTimeParams
+bool harness_submit_periodic(const char *source, int pid, int burst, int arrival,
+                             int period, int deadline, int wcet);
+
+// Run everything submitted to completion, with what the scheduler and
+// the programs print thrown away. The metrics of the run.
+const PerformanceMetrics *harness_run(SchedulingAlgorithm algorithm);
+
+// The same, with what the programs print copied into out as a string,
+// cut short at size - 1 bytes. The scheduler's report is left out.
+const PerformanceMetrics *harness_run_printing(SchedulingAlgorithm algorithm,
+                                               char *out, size_t size);
+
+// Stand a pipe in for stdin, so tests can type at the terminal. The
+// write end, -1 if no pipe could be made.
+int harness_pipe_stdin(void);
+
+// Stop the keyboard and give stdin back
+void harness_restore_stdin(void);
+
+// A finished process's metrics, NULL if it did not finish
+const ProcessMetrics *harness_process(const PerformanceMetrics *run, int pid);
+
+#endif // TEST_HARNESS_H
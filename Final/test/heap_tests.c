@@ -0,0 +1,111 @@
+#include "../include/heap.h"
+#include "framework.h"
+#include "keyed.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// ============================================
+// Ordering
+// ============================================
+
+TEST_CASE(Heap, EmptyReturnsSentinel) {
+  IndexedHeap *heap = heap_create(4, key_before, NULL);
+  ASSERT_EQ(heap_pop(heap), HEAP_EMPTY);
+  ASSERT_EQ(heap_peek(heap), HEAP_EMPTY);
+  ASSERT_EQ(heap_size(heap), 0);
+  heap_destroy(heap);
+}
+
+TEST_CASE(Heap, PopsInKeyOrder) {
+  fill_keys(7);
+  IndexedHeap *heap = heap_create(2, key_before, NULL);
+  for (uint32_t i = 0; i < KEYED_ITEMS; i++) {
+    heap_push(heap, i);
+  }
+  ASSERT_EQ(heap_size(heap), KEYED_ITEMS);
+
+  uint32_t prev = heap_pop(heap);
+  for (int i = 1; i < KEYED_ITEMS; i++) {
+    uint32_t next = heap_pop(heap);
+    ASSERT_TRUE(!key_before(next, prev, NULL));
+    prev = next;
+  }
+  ASSERT_EQ(heap_pop(heap), HEAP_EMPTY);
+  heap_destroy(heap);
+}
+
+// ============================================
+// Indexed Operations
+// ============================================
+
+TEST_CASE(Heap, DecreaseKeyMovesToFront) {
+  fill_keys(11);
+  IndexedHeap *heap = heap_create(16, key_before, NULL);
+  for (uint32_t i = 0; i < 100; i++) {
+    heap_push(heap, i);
+  }
+  keys[57] = -1;
+  heap_decrease_key(heap, 57);
+  ASSERT_EQ(heap_peek(heap), 57);
+  ASSERT_EQ(heap_size(heap), 100);
+  heap_destroy(heap);
+}
+
+TEST_CASE(Heap, UpdateMovesBackwards) {
+  for (int i = 0; i < 10; i++) {
+    keys[i] = i;
+  }
+  IndexedHeap *heap = heap_create(16, key_before, NULL);
+  for (uint32_t i = 0; i < 10; i++) {
+    heap_push(heap, i);
+  }
+  keys[0] = 100;
+  heap_update(heap, 0);
+  for (uint32_t i = 1; i < 10; i++) {
+    ASSERT_EQ(heap_pop(heap), i);
+  }
+  ASSERT_EQ(heap_pop(heap), 0);
+  heap_destroy(heap);
+}
+
+TEST_CASE(Heap, RemoveByHandle) {
+  fill_keys(23);
+  IndexedHeap *heap = heap_create(16, key_before, NULL);
+  for (uint32_t i = 0; i < 200; i++) {
+    heap_push(heap, i);
+  }
+  for (uint32_t i = 0; i < 200; i += 3) {
+    ASSERT_TRUE(heap_remove(heap, i));
+  }
+  ASSERT_TRUE(!heap_remove(heap, 0));
+  ASSERT_TRUE(!heap_contains(heap, 3));
+  ASSERT_TRUE(heap_contains(heap, 4));
+
+  int left = 0;
+  uint32_t prev = heap_pop(heap);
+  ASSERT_TRUE(prev % 3 != 0);
+  left++;
+  while (heap_size(heap) > 0) {
+    uint32_t next = heap_pop(heap);
+    ASSERT_TRUE(next % 3 != 0);
+    ASSERT_TRUE(!key_before(next, prev, NULL));
+    prev = next;
+    left++;
+  }
+  ASSERT_EQ(left, 200 - 67);
+  heap_destroy(heap);
+}
+
+TEST_CASE(Heap, HandleQueuedOnlyOnce) {
+  fill_keys(5);
+  IndexedHeap *heap = heap_create(4, key_before, NULL);
+  heap_push(heap, 9);
+  heap_push(heap, 9);
+  ASSERT_EQ(heap_size(heap), 1);
+  ASSERT_EQ(heap_pop(heap), 9);
+  ASSERT_TRUE(!heap_contains(heap, 9));
+  heap_push(heap, 9);
+  ASSERT_EQ(heap_size(heap), 1);
+  heap_destroy(heap);
+}
@@ -0,0 +1,154 @@
+#include "../include/interrupts.h"
+#include "framework.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+// ============================================
+// Pending Interrupts
+// ============================================
+
+TEST_CASE(Interrupts, NothingPendingAfterInit) {
+  init_interrupt_controller();
+  Interrupt intr;
+  ASSERT_TRUE(!check_for_interrupt(&intr));
+  ASSERT_EQ(pending_interrupts(), 0);
+  ASSERT_EQ(timer_deadline(), TIMER_OFF);
+}
+
+TEST_CASE(Interrupts, HighestPriorityFirstThenRaiseOrder) {
+  init_interrupt_controller();
+  add_interrupt(IRQ_TIMER, 5);
+  add_interrupt(IRQ_TIMER, 1);
+  add_interrupt(IRQ_TIMER, 5);
+  add_interrupt(IRQ_TIMER, 3);
+  ASSERT_EQ(pending_interrupts(), 4);
+
+  int expected[] = { 1, 3, 5, 5 };
+  Interrupt intr;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(check_for_interrupt(&intr));
+    ASSERT_EQ(intr.priority, expected[i]);
+  }
+  ASSERT_TRUE(!check_for_interrupt(&intr));
+}
+
+// ============================================
+// Timer
+// ============================================
+
+TEST_CASE(Interrupts, TimerFiresOnceAtDeadline) {
+  init_interrupt_controller();
+  timer_set(10);
+  ASSERT_EQ(timer_deadline(), 10);
+  timer_advance(9);
+  ASSERT_EQ(pending_interrupts(), 0);
+  timer_advance(12);
+  ASSERT_EQ(pending_interrupts(), 1);
+  ASSERT_EQ(timer_deadline(), TIMER_OFF);
+
+  // One-shot: nothing more until it is armed again
+  timer_advance(20);
+  Interrupt intr;
+  ASSERT_TRUE(check_for_interrupt(&intr));
+  ASSERT_EQ(intr.irq, IRQ_TIMER);
+  ASSERT_TRUE(!check_for_interrupt(&intr));
+}
+
+TEST_CASE(Interrupts, RearmingDropsStaleTimerInterrupt) {
+  init_interrupt_controller();
+  timer_set(3);
+  timer_advance(3);
+  add_interrupt(IRQ_TIMER, 7);
+  timer_set(8);
+  ASSERT_EQ(pending_interrupts(), 0);
+  timer_cancel();
+  timer_advance(100);
+  ASSERT_EQ(pending_interrupts(), 0);
+}
+
+// ============================================
+// Inbox
+// ============================================
+
+TEST_CASE(Interrupts, InboxDrainsIntoHeapWhenChecked) {
+  init_interrupt_controller();
+  InterruptInbox *inbox = interrupt_inbox_create(4);
+  interrupt_attach_inbox(inbox);
+  ASSERT_TRUE(interrupt_post(inbox, IRQ_TIMER, 9));
+  ASSERT_TRUE(interrupt_post(inbox, IRQ_TIMER, 2));
+  ASSERT_EQ(pending_interrupts(), 0);
+
+  Interrupt intr;
+  ASSERT_TRUE(check_for_interrupt(&intr));
+  ASSERT_EQ(intr.priority, 2);
+  ASSERT_TRUE(check_for_interrupt(&intr));
+  ASSERT_EQ(intr.priority, 9);
+  ASSERT_TRUE(!check_for_interrupt(&intr));
+  interrupt_attach_inbox(NULL);
+  interrupt_inbox_destroy(inbox);
+}
+
+TEST_CASE(Interrupts, FullInboxRefusesPosts) {
+  init_interrupt_controller();
+  InterruptInbox *inbox = interrupt_inbox_create(16);
+  interrupt_attach_inbox(inbox);
+  for (int i = 0; i < 16; i++) {
+    ASSERT_TRUE(interrupt_post(inbox, IRQ_TIMER, i));
+  }
+  ASSERT_TRUE(!interrupt_post(inbox, IRQ_TIMER, 16));
+  ASSERT_EQ(interrupt_drain(), 16);
+  ASSERT_TRUE(interrupt_post(inbox, IRQ_TIMER, 16));
+  interrupt_attach_inbox(NULL);
+  interrupt_inbox_destroy(inbox);
+  init_interrupt_controller();
+}
+
+#define DEVICES 4
+#define POSTS_PER_DEVICE 20000
+
+static void *device_main(void *arg) {
+  InterruptInbox *inbox = arg;
+  for (int i = 0; i < POSTS_PER_DEVICE; i++) {
+    while (!interrupt_post(inbox, IRQ_TIMER, i)) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+TEST_CASE(Interrupts, ConcurrentDevicesLoseNothing) {
+  init_interrupt_controller();
+  InterruptInbox *inbox = interrupt_inbox_create(64);
+  interrupt_attach_inbox(inbox);
+  pthread_t devices[DEVICES];
+  for (int i = 0; i < DEVICES; i++) {
+    pthread_create(&devices[i], NULL, device_main, inbox);
+  }
+
+  // Every priority was posted once by each device
+  static int seen[POSTS_PER_DEVICE];
+  memset(seen, 0, sizeof(seen));
+  int received = 0;
+  Interrupt intr;
+  while (received < DEVICES * POSTS_PER_DEVICE) {
+    if (check_for_interrupt(&intr)) {
+      seen[intr.priority]++;
+      received++;
+    } else {
+      sched_yield();
+    }
+  }
+  for (int i = 0; i < DEVICES; i++) {
+    pthread_join(devices[i], NULL);
+  }
+  bool all = true;
+  for (int i = 0; i < POSTS_PER_DEVICE; i++) {
+    all = all && seen[i] == DEVICES;
+  }
+  ASSERT_TRUE(all);
+  ASSERT_TRUE(!check_for_interrupt(&intr));
+  interrupt_attach_inbox(NULL);
+  interrupt_inbox_destroy(inbox);
+}
@@ -0,0 +1,162 @@
+#include "../include/keyboard.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Write `keys` to a fresh temporary file and hand it to pid as its script
+static void script(int pid, const char *keys) {
+  char path[] = "/tmp/keyboard_scriptXXXXXX";
+  int fd = mkstemp(path);
+  FILE *fp = fdopen(fd, "w");
+  fputs(keys, fp);
+  fclose(fp);
+  keyboard_script(pid, path);
+  unlink(path);
+}
+
+// The next key for pid, waiting up to a second for the reader thread
+// to deliver one. 0 if none came.
+static uint32_t next_key(int pid) {
+  struct timespec poll = { 0, 1000000 };
+  keyboard_attach(pid);
+  uint32_t c = keyboard_read_char();
+  for (int i = 0; c == 0 && i < 1000; i++) {
+    nanosleep(&poll, NULL);
+    c = keyboard_read_char();
+  }
+  return c;
+}
+
+// ============================================
+// Scripted Input
+// ============================================
+
+TEST_CASE(Keyboard, ScriptedKeysOnePerPollThenNothing) {
+  script(3, "wd");
+  keyboard_attach(3);
+  ASSERT_EQ(keyboard_read_char(), 'w');
+  ASSERT_EQ(keyboard_read_char(), 'd');
+  ASSERT_EQ(keyboard_read_char(), 0);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  keyboard_attach(-1);
+  keyboard_close();
+}
+
+TEST_CASE(Keyboard, ScriptedIntegers) {
+  script(0, "  42\n-17 x");
+  ASSERT_EQ(keyboard_read_int(0), 42);
+  ASSERT_EQ((int32_t)keyboard_read_int(0), -17);
+  ASSERT_EQ(keyboard_read_int(0), 0);
+  keyboard_close();
+}
+
+TEST_CASE(Keyboard, EachProcessReadsItsOwnScript) {
+  script(1, "a");
+  script(2, "b");
+  keyboard_attach(2);
+  ASSERT_EQ(keyboard_read_char(), 'b');
+  keyboard_attach(1);
+  ASSERT_EQ(keyboard_read_char(), 'a');
+  keyboard_attach(-1);
+  keyboard_close();
+}
+
+TEST_CASE(Keyboard, RewindReplaysScripts) {
+  script(0, "7q");
+  keyboard_attach(0);
+  ASSERT_EQ(keyboard_read_int(0), 7);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  keyboard_rewind();
+  ASSERT_EQ(keyboard_read_char(), '7');
+  ASSERT_EQ(keyboard_read_char(), 'q');
+  keyboard_attach(-1);
+  keyboard_close();
+}
+
+TEST_CASE(Keyboard, MissingScriptIsRefused) {
+  ASSERT_TRUE(!keyboard_script(0, "/nonexistent/keys.txt"));
+}
+
+// ============================================
+// Terminal Input
+// ============================================
+
+TEST_CASE(Keyboard, TerminalKeysGoToTheFocusedProcess) {
+  int fd = harness_pipe_stdin();
+  ASSERT_TRUE(fd >= 0);
+  keyboard_attach(1);
+  ASSERT_EQ(keyboard_read_char(), 0); // The first to poll takes focus
+  ASSERT_TRUE(write(fd, "ab", 2) == 2);
+  ASSERT_EQ(next_key(1), 'a');
+  ASSERT_EQ(next_key(1), 'b');
+  ASSERT_TRUE(write(fd, "c", 1) == 1);
+  keyboard_attach(2);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  ASSERT_EQ(next_key(1), 'c');
+  keyboard_attach(-1);
+  close(fd);
+  harness_restore_stdin();
+}
+
+TEST_CASE(Keyboard, KeysFollowTheFocus) {
+  int fd = harness_pipe_stdin();
+  ASSERT_TRUE(fd >= 0);
+  keyboard_focus(2);
+  ASSERT_TRUE(write(fd, "x", 1) == 1);
+  ASSERT_EQ(next_key(2), 'x');
+  keyboard_focus(1);
+  ASSERT_TRUE(write(fd, "y", 1) == 1);
+  ASSERT_EQ(next_key(1), 'y');
+  keyboard_attach(2);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  keyboard_attach(-1);
+  close(fd);
+  harness_restore_stdin();
+}
+
+TEST_CASE(Keyboard, ReleaseHandsFocusToTheNextReader) {
+  int fd = harness_pipe_stdin();
+  ASSERT_TRUE(fd >= 0);
+  keyboard_attach(1);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  keyboard_release(1);
+  keyboard_attach(2);
+  ASSERT_EQ(keyboard_read_char(), 0);
+  ASSERT_TRUE(write(fd, "z", 1) == 1);
+  ASSERT_EQ(next_key(2), 'z');
+  keyboard_attach(-1);
+  close(fd);
+  harness_restore_stdin();
+}
+
+TEST_CASE(Keyboard, TerminalIntegersComeThroughTheRing) {
+  int fd = harness_pipe_stdin();
+  ASSERT_TRUE(fd >= 0);
+  ASSERT_TRUE(write(fd, " 42\n-7 ", 7) == 7);
+  ASSERT_EQ(keyboard_read_int(5), 42);
+  ASSERT_EQ((int32_t)keyboard_read_int(5), -7);
+  close(fd); // End of input holds no number
+  ASSERT_EQ(keyboard_read_int(5), 0);
+  harness_restore_stdin();
+}
+
+TEST_CASE(Keyboard, HalfTypedNumberIsLeftForTheNextTry) {
+  int fd = harness_pipe_stdin();
+  ASSERT_TRUE(fd >= 0);
+  uint32_t value = 99;
+  ASSERT_TRUE(write(fd, "4", 1) == 1);
+  ASSERT_TRUE(!keyboard_try_read_int(6, &value));
+  ASSERT_EQ(value, 99);
+  ASSERT_TRUE(write(fd, "2 ", 2) == 2);
+  struct timespec poll = { 0, 1000000 };
+  for (int i = 0; i < 1000 && !keyboard_try_read_int(6, &value); i++) {
+    nanosleep(&poll, NULL);
+  }
+  ASSERT_EQ(value, 42);
+  close(fd);
+  harness_restore_stdin();
+}
@@ -0,0 +1,20 @@
+#include "keyed.h"
+
+#include <stdlib.h>
+
+int keys[KEYED_ITEMS];
+
+bool key_before(uint32_t a, uint32_t b, void *ctx) {
+  (void)ctx;
+  if (keys[a] != keys[b]) {
+    return keys[a] < keys[b];
+  }
+  return a < b;
+}
+
+void fill_keys(unsigned seed) {
+  srand(seed);
+  for (int i = 0; i < KEYED_ITEMS; i++) {
+    keys[i] = rand() % 500;
+  }
+}
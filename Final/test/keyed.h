@@ -0,0 +1,18 @@
+#ifndef TEST_KEYED_H
+#define TEST_KEYED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Handles index into this key table, lower keys first, for the tests of
+// the handle-ordered containers
+#define KEYED_ITEMS 1000
+extern int keys[KEYED_ITEMS];
+
+// Lower key first, lower handle among equals
+bool key_before(uint32_t a, uint32_t b, void *ctx);
+
+// Random keys in 0..499, the same for the same seed
+void fill_keys(unsigned seed);
+
+#endif // TEST_KEYED_H
@@ -0,0 +1,117 @@
+#include "../include/kinetic.h"
+#include "framework.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Brute force reference: highest (now - arrival) / burst, lower handle on ties
+#define RATIO_ITEMS 300
+static int arrivals[RATIO_ITEMS];
+static int bursts[RATIO_ITEMS];
+static bool present[RATIO_ITEMS];
+
+static uint32_t best_at(int now) {
+  uint32_t best = KINETIC_EMPTY;
+  for (uint32_t i = 0; i < RATIO_ITEMS; i++) {
+    if (!present[i]) {
+      continue;
+    }
+    if (best == KINETIC_EMPTY) {
+      best = i;
+      continue;
+    }
+    long lhs = (long)(now - arrivals[i]) * bursts[best];
+    long rhs = (long)(now - arrivals[best]) * bursts[i];
+    if (lhs > rhs) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// ============================================
+// Basic Behaviour
+// ============================================
+
+TEST_CASE(Kinetic, EmptyReturnsSentinel) {
+  KineticTree *tree = kinetic_create(4);
+  ASSERT_EQ(kinetic_peek(tree), KINETIC_EMPTY);
+  ASSERT_EQ(kinetic_pop(tree), KINETIC_EMPTY);
+  ASSERT_EQ(kinetic_size(tree), 0);
+  kinetic_destroy(tree);
+}
+
+TEST_CASE(Kinetic, ShortJobOvertakesOldLongJob) {
+  KineticTree *tree = kinetic_create(4);
+  kinetic_insert(tree, 0, 0, 100); // Waiting longest, but long
+  kinetic_insert(tree, 1, 10, 5);  // Arrives later, short
+  kinetic_advance(tree, 10);
+  ASSERT_EQ(kinetic_peek(tree), 0); // 10/100 beats 0/5
+  kinetic_advance(tree, 11);
+  ASSERT_EQ(kinetic_peek(tree), 1); // 1/5 beats 11/100
+  kinetic_destroy(tree);
+}
+
+TEST_CASE(Kinetic, EqualRatiosGoToLowerHandle) {
+  KineticTree *tree = kinetic_create(4);
+  kinetic_insert(tree, 2, 0, 10);
+  kinetic_insert(tree, 1, 0, 20);
+  ASSERT_EQ(kinetic_peek(tree), 1); // Both 0 at time 0
+  kinetic_advance(tree, 1);
+  ASSERT_EQ(kinetic_peek(tree), 2);
+  kinetic_destroy(tree);
+}
+
+TEST_CASE(Kinetic, ZeroBurstAlwaysLoses) {
+  KineticTree *tree = kinetic_create(4);
+  kinetic_insert(tree, 0, 0, 0);
+  kinetic_insert(tree, 1, 50, 1000);
+  kinetic_advance(tree, 60);
+  ASSERT_EQ(kinetic_pop(tree), 1);
+  ASSERT_EQ(kinetic_pop(tree), 0);
+  kinetic_destroy(tree);
+}
+
+// ============================================
+// Against Brute Force
+// ============================================
+
+TEST_CASE(Kinetic, MatchesLinearScan) {
+  srand(42);
+  KineticTree *tree = kinetic_create(2);
+  int now = 0;
+  int mismatches = 0;
+  for (uint32_t i = 0; i < RATIO_ITEMS; i++) {
+    present[i] = false;
+  }
+
+  for (int step = 0; step < 3000; step++) {
+    now += rand() % 4;
+    kinetic_advance(tree, now);
+
+    uint32_t item = (uint32_t)(rand() % RATIO_ITEMS);
+    int op = rand() % 3;
+    if (op < 2 && !present[item]) {
+      arrivals[item] = now - rand() % 50;
+      bursts[item] = 1 + rand() % 200;
+      present[item] = true;
+      kinetic_insert(tree, item, arrivals[item], bursts[item]);
+    } else if (op == 2 && present[item]) {
+      present[item] = false;
+      ASSERT_TRUE(kinetic_remove(tree, item));
+    }
+
+    if (kinetic_peek(tree) != best_at(now)) {
+      mismatches++;
+    }
+    if (step % 7 == 0 && kinetic_size(tree) > 0) {
+      uint32_t popped = kinetic_pop(tree);
+      if (popped != best_at(now)) {
+        mismatches++;
+      }
+      present[popped] = false;
+    }
+  }
+  ASSERT_EQ(mismatches, 0);
+  kinetic_destroy(tree);
+}
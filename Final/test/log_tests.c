@@ -0,0 +1,23 @@
+#include "../include/log.h"
+#include "framework.h"
+
+TEST_CASE(Log, ParsesLevelNames) {
+  LogLevel level = LOG_DEBUG;
+  ASSERT_TRUE(parse_log_level("quiet", &level));
+  ASSERT_EQ(level, LOG_QUIET);
+  ASSERT_TRUE(parse_log_level("trace", &level));
+  ASSERT_EQ(level, LOG_TRACE);
+  ASSERT_TRUE(!parse_log_level("verbose", &level));
+  ASSERT_EQ(level, LOG_TRACE);
+}
+
+TEST_CASE(Log, LevelGatesMessages) {
+  LogLevel saved = g_log_level;
+  set_log_level(LOG_INFO);
+  // Unless the build compiled info messages out
+  ASSERT_EQ(log_enabled(LOG_INFO), LOG_INFO <= LOG_MAX_LEVEL);
+  ASSERT_TRUE(!log_enabled(LOG_DEBUG));
+  set_log_level(LOG_QUIET);
+  ASSERT_TRUE(!log_enabled(LOG_INFO));
+  set_log_level(saved);
+}
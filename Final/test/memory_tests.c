@@ -218,6 +218,40 @@ TEST_CASE(Memory, SystemProcessCanAccessAll) {
   ASSERT_EQ(read_word(1000), 0xAAAAAAAA);
 }
 
+TEST_CASE(Memory, LargePidsCannotTouchEachOther) {
+  // Pid 4096's 1MB text window would wrap to TEXT_BASE and pid 124's
+  // would run to the end of RAM, both over memory given to someone else
+  reset_memory();
+  uint32_t low = mallocate(1, TEXT_BASE);
+  uint32_t m = mallocate(5000, 1024);
+  uint32_t n = mallocate(4096, 1024);
+  uint32_t k = mallocate(124, 1024);
+  ASSERT_EQ(low, 0);
+  ASSERT_TRUE(m >= TEXT_BASE && m < TEXT_BASE + MAX_PROCESS_SIZE);
+
+  set_current_process(5000);
+  write_word(m, 0x11111111);
+  set_current_process(4096);
+  write_word(n, 0x22222222);
+  write_word(m, 0xdeadbeef);
+  ASSERT_EQ(read_word(m), 0);
+  set_current_process(124);
+  write_word(m, 0xdeadbeef);
+  ASSERT_EQ(read_word(n), 0);
+  ASSERT_EQ(read_word(k), 0);
+  set_current_process(5000);
+  ASSERT_EQ(read_word(n), 0);
+  ASSERT_EQ(read_word(m), 0x11111111);
+
+  set_current_process(SYSTEM_PROCESS_ID);
+  ASSERT_EQ(read_word(m), 0x11111111);
+  ASSERT_EQ(read_word(n), 0x22222222);
+  liberate(1);
+  liberate(124);
+  liberate(4096);
+  liberate(5000);
+}
+
 TEST_CASE(Memory, ProcessCanAccessTextSegment) {
   reset_memory();
   set_current_process(0);
@@ -336,6 +370,63 @@ TEST_CASE(Memory, CoalesceAdjacentFreeBlocks) {
   ASSERT_TRUE(addr3 != UINT32_MAX);
 }
 
+TEST_CASE(Memory, LiberateFreesEveryBlock) {
+  reset_memory();
+  size_t before = get_free_ram();
+  mallocate(1, 256);
+  mallocate(1, 4096);
+  mallocate(2, 128);
+  ASSERT_EQ(get_process_ram(1), 256 + 4096);
+  liberate(1);
+  ASSERT_EQ(get_process_ram(1), 0);
+  ASSERT_EQ(get_free_ram(), before - 128);
+}
+
+// ============================================
+// Swapping Tests
+// ============================================
+
+TEST_CASE(Memory, SwapRoundTripRestoresContents) {
+  reset_memory_write_back();
+  size_t before = get_free_ram();
+  uint32_t text = mallocate(1, 256);
+  uint32_t stack = mallocate(1, 1024);
+  uint32_t other = mallocate(2, 64);
+  set_current_process(1);
+  write_word(text, 0xCAFEF00D);
+  write_word(stack + 1020, 0x0BADBEEF);
+  set_current_process(SYSTEM_PROCESS_ID);
+
+  ASSERT_TRUE(swap_out(1) > 0);
+  ASSERT_EQ(get_process_ram(1), 0);
+  ASSERT_EQ(get_free_ram(), before - 64);
+  // Nothing cached survives the swap, so clobbering RAM shows through
+  write_word(text, 0);
+  write_word(stack + 1020, 0);
+  ASSERT_TRUE(swap_out(1) < 0);
+
+  ASSERT_TRUE(swap_in(1) > 0);
+  ASSERT_EQ(get_process_ram(1), 256 + 1024);
+  set_current_process(1);
+  ASSERT_EQ(read_word(text), 0xCAFEF00D);
+  ASSERT_EQ(read_word(stack + 1020), 0x0BADBEEF);
+  set_current_process(SYSTEM_PROCESS_ID);
+  ASSERT_TRUE(swap_in(1) < 0);
+  (void)other;
+}
+
+TEST_CASE(Memory, SwapInNeedsItsOwnAddresses) {
+  reset_memory();
+  uint32_t addr = mallocate(1, 512);
+  ASSERT_TRUE(swap_out(1) > 0);
+  // Someone else takes the hole it left behind
+  ASSERT_EQ(mallocate(2, 512), addr);
+  ASSERT_TRUE(swap_in(1) < 0);
+  liberate(2);
+  ASSERT_TRUE(swap_in(1) > 0);
+  ASSERT_EQ(get_process_ram(1), 512);
+}
+
 // ============================================
 // Stress Tests
 // ============================================
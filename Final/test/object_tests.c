@@ -0,0 +1,147 @@
+#include "../include/assembler.h"
+#include "../include/object.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// ============================================
+// Object Files
+// ============================================
+
+TEST_CASE(Object, WriteThenReadRoundTrips) {
+  uint32_t text[] = { 0x24080005, 0x0c000000, 0x0000000c };
+  uint8_t data[] = { 'h', 'i', 0 };
+  ObjectSymbol symbols[2] = {
+    { .name = "main", .value = 0, .segment = SEGMENT_TEXT, .is_global = true },
+    { .name = "msg", .value = 0, .segment = SEGMENT_DATA },
+  };
+  Relocation relocations[] = { { .offset = 4, .type = RELOC_JUMP, .symbol = 0 } };
+  ObjectFile obj = {
+    .source_hash = object_hash("main: li $t0, 5", 15),
+    .text = text, .text_count = 3,
+    .data = data, .data_size = 3,
+    .symbols = symbols, .symbol_count = 2,
+    .relocations = relocations, .relocation_count = 1,
+    .entry_symbol = 0,
+  };
+  char path[] = "/tmp/object_testXXXXXX";
+  close(mkstemp(path));
+  ASSERT_TRUE(object_write(&obj, path));
+
+  ObjectFile loaded;
+  ASSERT_TRUE(object_read(&loaded, path));
+  unlink(path);
+  ASSERT_EQ(loaded.source_hash, obj.source_hash);
+  ASSERT_EQ(loaded.text_count, 3);
+  ASSERT_EQ(loaded.text[2], 0x0000000c);
+  ASSERT_EQ(loaded.data_size, 3);
+  ASSERT_TRUE(strcmp((const char *)loaded.data, "hi") == 0);
+  ASSERT_EQ(loaded.symbol_count, 2);
+  ASSERT_TRUE(strcmp(loaded.symbols[1].name, "msg") == 0);
+  ASSERT_EQ(loaded.symbols[1].segment, SEGMENT_DATA);
+  ASSERT_EQ(loaded.relocation_count, 1);
+  ASSERT_EQ(loaded.relocations[0].offset, 4);
+  ASSERT_EQ(loaded.entry_symbol, 0);
+  object_free(&loaded);
+}
+
+TEST_CASE(Object, EmptySectionsRoundTrip) {
+  // Nothing but a header, with NULL for every section
+  ObjectFile obj = { .source_hash = object_hash("", 0), .entry_symbol = -1 };
+  char path[] = "/tmp/object_testXXXXXX";
+  close(mkstemp(path));
+  ASSERT_TRUE(object_write(&obj, path));
+
+  ObjectFile loaded;
+  ASSERT_TRUE(object_read(&loaded, path));
+  unlink(path);
+  ASSERT_EQ(loaded.source_hash, obj.source_hash);
+  ASSERT_EQ(loaded.text_count, 0);
+  ASSERT_EQ(loaded.data_size, 0);
+  ASSERT_EQ(loaded.symbol_count, 0);
+  ASSERT_EQ(loaded.relocation_count, 0);
+  ASSERT_EQ(loaded.entry_symbol, -1);
+  object_free(&loaded);
+}
+
+TEST_CASE(Object, TruncatedFileIsRejected) {
+  char path[] = "/tmp/object_testXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(write(fd, OBJECT_MAGIC, sizeof(OBJECT_MAGIC)) == sizeof(OBJECT_MAGIC));
+  close(fd);
+  ObjectFile loaded;
+  ASSERT_TRUE(!object_read(&loaded, path));
+  ASSERT_EQ(loaded.text_count, 0);
+  unlink(path);
+  ASSERT_TRUE(!object_read(&loaded, path));
+}
+
+TEST_CASE(Object, CountsBeyondTheFileAreRejected) {
+  uint32_t text[] = { 0x0000000c };
+  ObjectFile obj = { .text = text, .text_count = 1, .entry_symbol = -1 };
+  char path[] = "/tmp/object_testXXXXXX";
+  close(mkstemp(path));
+  ASSERT_TRUE(object_write(&obj, path));
+
+  // Every count, after the magic and the version. Allocating for the
+  // symbols alone would fail outright.
+  uint32_t huge[4] = { 0x40000000, 0xfffffff0, 0xffffffff, 0xffffffff };
+  int fd = open(path, O_WRONLY);
+  ASSERT_TRUE(pwrite(fd, huge, sizeof(huge), 8 + sizeof(uint32_t)) == sizeof(huge));
+  close(fd);
+  ObjectFile loaded;
+  ASSERT_TRUE(!object_read(&loaded, path));
+  ASSERT_TRUE(loaded.text == NULL && loaded.symbols == NULL);
+  unlink(path);
+}
+
+TEST_CASE(Object, HashFollowsEveryByte) {
+  ASSERT_TRUE(object_hash("addi $t0, $t0, 1", 16) == object_hash("addi $t0, $t0, 1", 16));
+  ASSERT_TRUE(object_hash("addi $t0, $t0, 1", 16) != object_hash("addi $t0, $t0, 2", 16));
+  ASSERT_TRUE(!object_cache_path(0, NULL, 0)); // Off unless a directory is set
+}
+
+// ============================================
+// Object Cache
+// ============================================
+
+// Assemble source with the cache in dir. Whether it was cached.
+static bool assembled_and_cached(const char *dir, const char *source) {
+  char path[] = "/tmp/object_sourceXXXXXX";
+  int fd = mkstemp(path);
+  size_t len = strlen(source);
+  bool written = write(fd, source, len) == (ssize_t)len;
+  close(fd);
+
+  harness_reset();
+  set_object_cache(dir);
+  AssemblyResult result = assemble(path, 0);
+  free_program(&result);
+  unlink(path);
+
+  char cache_path[4096];
+  bool cached = written
+             && object_cache_path(object_hash(source, len), cache_path, sizeof(cache_path))
+             && access(cache_path, F_OK) == 0;
+  if (cached) {
+    unlink(cache_path);
+  }
+  set_object_cache(NULL);
+  return cached;
+}
+
+TEST_CASE(Object, ProgramWithErrorsIsNotCached) {
+  char dir[] = "/tmp/object_cacheXXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  ASSERT_TRUE(assembled_and_cached(dir, "main:\n    j main\n"));
+  ASSERT_TRUE(!assembled_and_cached(dir, "main:\n    j nowhere\n"));
+  ASSERT_TRUE(!assembled_and_cached(dir, "main:\n    beq $t0, $zero, nowhere\n"));
+  ASSERT_TRUE(!assembled_and_cached(dir, "main:\n    la $a0, nowhere\n"));
+  ASSERT_TRUE(!assembled_and_cached(dir, "main:\n    addu $t0, $q9, $t1\n"));
+  rmdir(dir);
+}
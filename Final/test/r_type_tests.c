@@ -345,6 +345,23 @@ TEST_CASE(RType, SyscallHaltsCpu) {
   ASSERT_EQ(THE_CPU.hw_registers[PC], CPU_HALT);
 }
 
+TEST_CASE(RType, DeferredSleepLeavesRequest) {
+  reset_cpu_state();
+  THE_CPU.hw_registers[PC] = 0x30;
+  write_gpr(REG_V0, SYSCALL_SLEEP_MS);
+  write_gpr(REG_A0, 250);
+  set_deferred_syscalls(true);
+  execute_instruction(make_r_instruction(REG_ZERO, REG_ZERO, REG_ZERO, 0, FUNCT_SYSCALL));
+  set_deferred_syscalls(false);
+  ASSERT_EQ(THE_CPU.hw_registers[IO_AR], SYSCALL_SLEEP_MS);
+  ASSERT_EQ(THE_CPU.hw_registers[IO_BR], 250);
+  ASSERT_EQ(THE_CPU.hw_registers[PC], 0x30);
+
+  complete_syscall(&THE_CPU, 0);
+  ASSERT_EQ(THE_CPU.hw_registers[IO_AR], 0);
+  ASSERT_EQ(THE_CPU.hw_registers[IO_BR], 0);
+}
+
 TEST_CASE(RType, BreakHaltsCpu) {
   reset_cpu_state();
   THE_CPU.hw_registers[PC] = 0x20;
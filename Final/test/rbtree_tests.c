@@ -0,0 +1,99 @@
+#include "../include/rbtree.h"
+#include "framework.h"
+#include "keyed.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// ============================================
+// Ordering
+// ============================================
+
+TEST_CASE(RBTree, EmptyReturnsSentinel) {
+  RBTree *tree = rb_create(4, key_before, NULL);
+  ASSERT_EQ(rb_first(tree), RB_EMPTY);
+  ASSERT_EQ(rb_pop_first(tree), RB_EMPTY);
+  ASSERT_EQ(rb_size(tree), 0);
+  ASSERT_TRUE(!rb_remove(tree, 3));
+  ASSERT_TRUE(rb_valid(tree));
+  rb_destroy(tree);
+}
+
+TEST_CASE(RBTree, PopsInKeyOrder) {
+  fill_keys(11);
+  RBTree *tree = rb_create(2, key_before, NULL);
+  for (uint32_t i = 0; i < KEYED_ITEMS; i++) {
+    rb_insert(tree, i);
+  }
+  ASSERT_EQ(rb_size(tree), KEYED_ITEMS);
+  ASSERT_TRUE(rb_valid(tree));
+
+  uint32_t prev = rb_pop_first(tree);
+  for (int i = 1; i < KEYED_ITEMS; i++) {
+    if (i % 50 == 0) {
+      ASSERT_TRUE(rb_valid(tree));
+    }
+    uint32_t next = rb_pop_first(tree);
+    ASSERT_TRUE(key_before(prev, next, NULL));
+    prev = next;
+  }
+  ASSERT_EQ(rb_size(tree), 0);
+  rb_destroy(tree);
+}
+
+// ============================================
+// Arbitrary Removal
+// ============================================
+
+TEST_CASE(RBTree, RandomInsertRemoveKeepsInvariants) {
+  fill_keys(5);
+  RBTree *tree = rb_create(8, key_before, NULL);
+  bool in[KEYED_ITEMS] = {false};
+  size_t count = 0;
+  for (int step = 0; step < 20000; step++) {
+    uint32_t item = (uint32_t)(rand() % KEYED_ITEMS);
+    if (in[item]) {
+      ASSERT_TRUE(rb_remove(tree, item));
+      count--;
+    } else {
+      rb_insert(tree, item);
+      count++;
+    }
+    in[item] = !in[item];
+    if (step % 97 == 0) {
+      ASSERT_TRUE(rb_valid(tree));
+    }
+  }
+  ASSERT_EQ(rb_size(tree), count);
+  ASSERT_TRUE(rb_valid(tree));
+
+  // The cached first handle is the smallest one left
+  uint32_t best = RB_EMPTY;
+  for (uint32_t i = 0; i < KEYED_ITEMS; i++) {
+    ASSERT_EQ(rb_contains(tree, i), in[i]);
+    if (in[i] && (best == RB_EMPTY || key_before(i, best, NULL))) {
+      best = i;
+    }
+  }
+  ASSERT_EQ(rb_first(tree), best);
+  rb_destroy(tree);
+}
+
+TEST_CASE(RBTree, ReinsertAfterKeyChange) {
+  fill_keys(3);
+  RBTree *tree = rb_create(4, key_before, NULL);
+  for (uint32_t i = 0; i < 50; i++) {
+    rb_insert(tree, i);
+  }
+  // Push the first handle to the back, as a run slice would
+  uint32_t first = rb_pop_first(tree);
+  keys[first] = 1000;
+  rb_insert(tree, first);
+  ASSERT_TRUE(rb_valid(tree));
+  ASSERT_TRUE(rb_first(tree) != first);
+  for (int i = 0; i < 49; i++) {
+    rb_pop_first(tree);
+  }
+  ASSERT_EQ(rb_pop_first(tree), first);
+  rb_destroy(tree);
+}
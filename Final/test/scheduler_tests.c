@@ -0,0 +1,645 @@
+#include "../include/processes.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// Runs until its burst runs out
+static const char *const SPIN_FOREVER =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    j main\n";
+
+// A spin of `warm` iterations, a sleep of `ms`, then `work` more
+// iterations and exit. Each iteration is two instructions.
+static const char *sleeper(char *buf, size_t size, int warm, int ms, int work) {
+  snprintf(buf, size,
+           ".text\n"
+           ".globl main\n"
+           "main:\n"
+           "    li $t0, %d\n"
+           "warm:\n"
+           "    addiu $t0, $t0, -1\n"
+           "    bne $t0, $zero, warm\n"
+           "    li $a0, %d\n"
+           "    li $v0, 13\n"
+           "    syscall\n"
+           "    li $t0, %d\n"
+           "work:\n"
+           "    addiu $t0, $t0, -1\n"
+           "    bne $t0, $zero, work\n"
+           "    li $v0, 10\n"
+           "    syscall\n",
+           warm, ms, work);
+  return buf;
+}
+
+// ============================================
+// CFS
+// ============================================
+
+TEST_CASE(Scheduler, CfsSplitsByWeight) {
+  // Priority 1 weighs 1024 and priority 6 weighs 335, so the first gets
+  // 1024 / 1359 of the CPU and finishes its 3000 ticks at about 3981
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 3000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 6, 3000, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_CFS);
+  const ProcessMetrics *heavy = harness_process(run, 0);
+  const ProcessMetrics *light = harness_process(run, 1);
+  ASSERT_TRUE(heavy != NULL && light != NULL);
+  ASSERT_EQ(heavy->burst_time, 3000);
+  ASSERT_EQ(light->burst_time, 3000);
+  ASSERT_TRUE(heavy->completion_time > 3940 && heavy->completion_time < 4020);
+  ASSERT_EQ(light->completion_time, 6000);
+}
+
+TEST_CASE(Scheduler, CfsSliceFollowsLatencyAndGranularity) {
+  // Two equal processes get half the latency each, and one keeps the CPU
+  // for a second slice while the other is not behind it
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 2400, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 2400, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_CFS);
+  ASSERT_TRUE(run->context_switches >= 4800 / 24 && run->context_switches <= 4800 / 24 + 2);
+
+  harness_reset();
+  set_cfs_params(240, 3);
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 2400, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 2400, 0));
+  run = harness_run(SCHED_CFS);
+  ASSERT_TRUE(run->context_switches >= 4800 / 240 && run->context_switches <= 4800 / 240 + 2);
+
+  // Eight processes cannot share a latency of 24 in slices of 6, so the
+  // period stretches rather than the slices shrinking
+  harness_reset();
+  set_cfs_params(24, 6);
+  for (int pid = 0; pid < 8; pid++) {
+    ASSERT_TRUE(harness_submit(SPIN_FOREVER, pid, 1, 600, 0));
+  }
+  run = harness_run(SCHED_CFS);
+  int stretched = run->context_switches;
+  ASSERT_TRUE(stretched <= 4800 / 6 + 8);
+
+  harness_reset();
+  set_cfs_params(24, 3);
+  for (int pid = 0; pid < 8; pid++) {
+    ASSERT_TRUE(harness_submit(SPIN_FOREVER, pid, 1, 600, 0));
+  }
+  run = harness_run(SCHED_CFS);
+  ASSERT_TRUE(run->context_switches > stretched + stretched / 2);
+}
+
+TEST_CASE(Scheduler, CfsNewcomerStartsLevel) {
+  // Placed at min_vruntime, the late arrival shares the CPU from the
+  // start instead of running alone for 1000 ticks to catch up, which
+  // would finish it at 2000
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 2000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 1000, 1000));
+  const PerformanceMetrics *run = harness_run(SCHED_CFS);
+  const ProcessMetrics *late = harness_process(run, 1);
+  ASSERT_TRUE(late != NULL);
+  ASSERT_TRUE(late->response_time <= 24);
+  ASSERT_TRUE(late->completion_time > 2900);
+}
+
+TEST_CASE(Scheduler, CfsSleeperCreditIsBounded) {
+  // The sleeper is away for 1000 ticks while the other process runs. It
+  // wakes at most half a latency behind, so its remaining 2000 ticks
+  // are shared evenly and end about 4000 later, not 1000 sooner.
+  char buf[512];
+  harness_reset();
+  ASSERT_TRUE(harness_submit(sleeper(buf, sizeof(buf), 100, 1000, 1000), 0, 1, 100000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 4000, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_CFS);
+  const ProcessMetrics *sleepy = harness_process(run, 0);
+  ASSERT_TRUE(sleepy != NULL);
+  ASSERT_TRUE(sleepy->completion_time > 5000);
+  ASSERT_EQ(harness_process(run, 1)->completion_time, sleepy->burst_time + 4000);
+}
+
+// ============================================
+// Lottery and Stride
+// ============================================
+
+// Priority 1 holds 1000 tickets and priority 2 holds 500, so the first
+// gets two thirds of the CPU while both are ready
+TEST_CASE(Scheduler, StrideSplitsByTickets) {
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 3000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 2, 3000, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_STRIDE);
+  const ProcessMetrics *rich = harness_process(run, 0);
+  const ProcessMetrics *poor = harness_process(run, 1);
+  ASSERT_TRUE(rich != NULL && poor != NULL);
+  ASSERT_EQ(rich->completion_time, 4500);
+  ASSERT_EQ(poor->completion_time, 6000);
+  // Stride is deterministic, it gets exactly what its tickets promised
+  ASSERT_TRUE(rich->target_cpu > 2990 && rich->target_cpu < 3010);
+}
+
+TEST_CASE(Scheduler, LotterySplitsByTickets) {
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 6000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 2, 6000, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_LOTTERY);
+  const ProcessMetrics *rich = harness_process(run, 0);
+  ASSERT_TRUE(rich != NULL);
+  // Within 5% of the 9000 its share works out to
+  int finished = rich->completion_time;
+  ASSERT_TRUE(finished > 8550 && finished < 9450);
+  ASSERT_TRUE(rich->target_cpu > 0.95 * 6000 && rich->target_cpu < 1.05 * 6000);
+
+  // The same seed draws the same schedule
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 6000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 2, 6000, 0));
+  run = harness_run(SCHED_LOTTERY);
+  ASSERT_EQ(harness_process(run, 0)->completion_time, finished);
+}
+
+// Raises its 500 tickets to 4000 and checks the old count came back,
+// then spins; exits at once if the syscall misbehaved
+static const char *const RAISE_TICKETS =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $a0, 4000\n"
+  "    li $v0, 15\n"
+  "    syscall\n"
+  "    li $t1, 500\n"
+  "    bne $v0, $t1, fail\n"
+  "    li $t0, 1500\n"
+  "spin:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, spin\n"
+  "fail:\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+TEST_CASE(Scheduler, SetTicketsSyscallChangesTheShare) {
+  harness_reset();
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 3000, 0));
+  ASSERT_TRUE(harness_submit(RAISE_TICKETS, 1, 2, 100000, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_STRIDE);
+  const ProcessMetrics *raised = harness_process(run, 1);
+  ASSERT_TRUE(raised != NULL);
+  ASSERT_TRUE(raised->burst_time > 3000);
+  // 4000 of 5000 tickets: its 3000 ticks end well before the other's
+  ASSERT_TRUE(raised->completion_time < 3900);
+}
+
+// Process 0 lends 600 of its 1000 tickets to process 1 and sleeps.
+// Process 1 checks it holds 1600, spins past the lender's wakeup and
+// checks the loan went back, and the lender checks it has its 1000
+// again. Each exits at once on a wrong count, and spins 1000 ticks
+// when all is well.
+static const char *const LENDER =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $a0, 1\n"
+  "    li $a1, 600\n"
+  "    li $v0, 16\n"
+  "    syscall\n"
+  "    li $t1, 600\n"
+  "    bne $v0, $t1, fail\n"
+  "    li $a0, 50\n"
+  "    li $v0, 13\n"
+  "    syscall\n"
+  "    li $a0, 0\n"
+  "    li $v0, 15\n"
+  "    syscall\n"
+  "    li $t1, 1000\n"
+  "    bne $v0, $t1, fail\n"
+  "    li $t0, 500\n"
+  "spin:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, spin\n"
+  "fail:\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+static const char *const BORROWER =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $t0, 10\n"
+  "before:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, before\n"
+  "    li $a0, 0\n"
+  "    li $v0, 15\n"
+  "    syscall\n"
+  "    li $t1, 1600\n"
+  "    bne $v0, $t1, fail\n"
+  "    li $t0, 100\n"
+  "after:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, after\n"
+  "    li $a0, 0\n"
+  "    li $v0, 15\n"
+  "    syscall\n"
+  "    li $t1, 1000\n"
+  "    bne $v0, $t1, fail\n"
+  "    li $t0, 500\n"
+  "spin:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, spin\n"
+  "fail:\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+TEST_CASE(Scheduler, LentTicketsComeBackWhenTheLenderWakes) {
+  SchedulingAlgorithm policies[] = { SCHED_STRIDE, SCHED_LOTTERY };
+  for (int i = 0; i < 2; i++) {
+    harness_reset();
+    ASSERT_TRUE(harness_submit(LENDER, 0, 1, 100000, 0));
+    ASSERT_TRUE(harness_submit(BORROWER, 1, 1, 100000, 0));
+    const PerformanceMetrics *run = harness_run(policies[i]);
+    const ProcessMetrics *lender = harness_process(run, 0);
+    const ProcessMetrics *borrower = harness_process(run, 1);
+    ASSERT_TRUE(lender != NULL && borrower != NULL);
+    ASSERT_TRUE(lender->burst_time > 1000);
+    ASSERT_TRUE(borrower->burst_time > 1000);
+  }
+}
+
+// ============================================
+// MLFQ
+// ============================================
+
+static const char *const INTERACTIVE =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $t0, 20\n"
+  "sink:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, sink\n"
+  "    li $a0, 10\n"
+  "    li $s0, 20\n"
+  "round:\n"
+  "    li $v0, 13\n"
+  "    syscall\n"
+  "    addiu $s0, $s0, -1\n"
+  "    bne $s0, $zero, round\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+// A process with no competition, so every dispatch is one slice
+static int mlfq_slices(int burst, int boost) {
+  int quanta[] = { 2, 4, 8 };
+  harness_reset();
+  set_mlfq_params(quanta, 3, boost);
+  if (!harness_submit(SPIN_FOREVER, 0, 1, burst, 0)) {
+    return -1;
+  }
+  return harness_run(SCHED_MLFQ)->context_switches;
+}
+
+TEST_CASE(Scheduler, MlfqCpuBoundProcessSinks) {
+  // 2 and 4 ticks on the way down, then 8-tick slices at the bottom
+  ASSERT_EQ(mlfq_slices(100, 0), 2 + (100 - 6) / 8 + 1);
+  ASSERT_EQ(mlfq_slices(6, 0), 2);
+}
+
+TEST_CASE(Scheduler, MlfqInteractiveProcessMovesUp) {
+  int quanta[] = { 2, 4, 8 };
+  harness_reset();
+  set_mlfq_params(quanta, 3, 0);
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 2000, 0));
+  ASSERT_TRUE(harness_submit(INTERACTIVE, 1, 1, 100000, 0));
+  const ProcessMetrics *pm = harness_process(harness_run(SCHED_MLFQ), 1);
+  ASSERT_TRUE(pm != NULL);
+
+  // About 40 ticks behind the hog while the opening loop sinks it. Left
+  // at the bottom it would then wait out most of an 8-tick slice after
+  // each of its 20 sleeps, over 200 ticks in all; moved back up it
+  // takes the CPU as soon as it wakes.
+  ASSERT_TRUE(pm->waiting_time < 40 + 20 * 2);
+}
+
+TEST_CASE(Scheduler, MlfqBoostReturnsEveryProcessToTheTop) {
+  // Boosts at 30, 60 and 90 each start it over with a 2 and a 4
+  ASSERT_EQ(mlfq_slices(100, 30), 18);
+
+  int quanta[] = { 2, 4, 8 };
+  int switches[2];
+  for (int run = 0; run < 2; run++) {
+    harness_reset();
+    set_mlfq_params(quanta, 3, run ? 50 : 0);
+    ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 260, 0));
+    ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 260, 0));
+    switches[run] = harness_run(SCHED_MLFQ)->context_switches;
+  }
+  // Both sink and then share 8-tick slices
+  ASSERT_EQ(switches[0], 4 + 2 * ((260 - 6 + 7) / 8));
+  // Each of the ten boosts puts both of them through a 2 and a 4 again,
+  // at least two more dispatches a boost than without
+  ASSERT_TRUE(switches[1] >= switches[0] + 10 * 2);
+}
+
+// ============================================
+// EDF and RM
+// ============================================
+
+// Completion times of processes 0 and 1
+static void rt_pair(SchedulingAlgorithm algorithm, int *first, int *second) {
+  const PerformanceMetrics *run = harness_run(algorithm);
+  *first = harness_process(run, 0) ? harness_process(run, 0)->completion_time : -1;
+  *second = harness_process(run, 1) ? harness_process(run, 1)->completion_time : -1;
+}
+
+TEST_CASE(Scheduler, EdfRunsTheEarliestDeadlineFirst) {
+  // Same period and release, process 1's deadline is sooner
+  int first, second;
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 5, 0, 20, 20, 5));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 5, 0, 20, 8, 5));
+  rt_pair(SCHED_EDF, &first, &second);
+  ASSERT_EQ(second, 5);
+  ASSERT_EQ(first, 10);
+
+  // A job released with an earlier deadline preempts the running one
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 50, 0, 100, 0, 50));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 2, 5, 10, 0, 2));
+  rt_pair(SCHED_EDF, &first, &second);
+  ASSERT_EQ(second, 7);
+  ASSERT_EQ(first, 52);
+}
+
+TEST_CASE(Scheduler, RmRunsTheShortestPeriodFirst) {
+  int first, second;
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 3, 0, 10, 0, 3));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 2, 0, 5, 0, 2));
+  rt_pair(SCHED_RM, &first, &second);
+  ASSERT_EQ(second, 2);
+  ASSERT_EQ(first, 5);
+
+  // Deadlines play no part, equal periods go in arrival order
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 5, 0, 20, 20, 5));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 5, 0, 20, 8, 5));
+  rt_pair(SCHED_RM, &first, &second);
+  ASSERT_EQ(first, 5);
+  ASSERT_EQ(second, 10);
+}
+
+TEST_CASE(Scheduler, AdmissionFollowsTheUtilizationBound) {
+  // Utilization 2/5 + 4/7 = 0.971: within EDF's bound of 1, over RM's
+  // 2(2^(1/2) - 1) = 0.828 for two tasks
+  SchedulingAlgorithm algorithms[] = { SCHED_EDF, SCHED_RM };
+  for (int a = 0; a < 2; a++) {
+    harness_reset();
+    ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 14, 0, 5, 0, 2));
+    ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 20, 0, 7, 0, 4));
+    const PerformanceMetrics *run = harness_run(algorithms[a]);
+    ASSERT_TRUE(run != NULL);
+    ASSERT_EQ(run->deadline_misses, 0);
+    // Rejected, process 1 still runs to completion best-effort
+    const ProcessMetrics *pm = harness_process(run, 1);
+    ASSERT_TRUE(pm != NULL);
+    ASSERT_EQ(pm->burst_time, 20);
+    if (algorithms[a] == SCHED_EDF) {
+      ASSERT_EQ(run->admission_rejections, 0);
+      ASSERT_EQ(run->rt_jobs, 7 + 5);
+    } else {
+      ASSERT_EQ(run->admission_rejections, 1);
+      ASSERT_EQ(run->rt_jobs, 7);
+    }
+  }
+}
+
+TEST_CASE(Scheduler, EdfRejectsDensityOverOne) {
+  // Utilization 0.6, but process 0 has to fit 3 ticks in 4, a density
+  // of 0.75, and the two together come to 1.05
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 3, 0, 10, 4, 3));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 3, 0, 10, 0, 3));
+  const PerformanceMetrics *run = harness_run(SCHED_EDF);
+  ASSERT_TRUE(run != NULL);
+  ASSERT_EQ(run->admission_rejections, 1);
+  ASSERT_EQ(run->rt_jobs, 1);
+
+  // Best-effort work waits for every real-time job
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 0, 6, 0, 10, 0, 6));
+  ASSERT_TRUE(harness_submit_periodic(SPIN_FOREVER, 1, 5, 0, 10, 0, 5));
+  int first, second;
+  rt_pair(SCHED_EDF, &first, &second);
+  ASSERT_EQ(first, 6);
+  ASSERT_EQ(second, 11);
+}
+
+TEST_CASE(Scheduler, EdfCountsMissedDeadlines) {
+  // Period 10, 8 ticks a job. Job 0 ends when it goes to sleep at 6 and
+  // it wakes at 31, past job 1's deadline of 20. Jobs 1-3 then finish
+  // at 39, 47 and 54 against deadlines 20, 30 and 40.
+  char buf[512];
+  harness_reset();
+  ASSERT_TRUE(harness_submit_periodic(sleeper(buf, sizeof(buf), 1, 25, 10), 0, 1000, 0, 10, 0, 8));
+  const PerformanceMetrics *run = harness_run(SCHED_EDF);
+  ASSERT_TRUE(run != NULL);
+  ASSERT_EQ(run->rt_jobs, 4);
+  ASSERT_EQ(run->deadline_misses, 3);
+  ASSERT_EQ(run->max_lateness, 19);
+  ASSERT_EQ(run->total_lateness, 19 + 17 + 14);
+  ASSERT_EQ(harness_process(run, 0)->completion_time, 54);
+}
+
+// ============================================
+// Multiprocessor
+// ============================================
+
+TEST_CASE(Scheduler, SmpRunsEveryProcessToCompletion) {
+  int cores[] = { 2, 4 };
+  for (int c = 0; c < 2; c++) {
+    harness_reset();
+    set_scheduler_cores(cores[c]);
+    int total = 0;
+    for (int pid = 0; pid < 10; pid++) {
+      int burst = 50 + 37 * pid;
+      ASSERT_TRUE(harness_submit(SPIN_FOREVER, pid, 1, burst, 3 * pid));
+      total += burst;
+    }
+    const PerformanceMetrics *run = harness_run(SCHED_ROUND_ROBIN);
+    ASSERT_TRUE(run != NULL);
+    ASSERT_EQ(run->cores, cores[c]);
+    ASSERT_EQ(run->process_count, 10);
+    for (int pid = 0; pid < 10; pid++) {
+      const ProcessMetrics *pm = harness_process(run, pid);
+      ASSERT_TRUE(pm != NULL);
+      ASSERT_EQ(pm->burst_time, 50 + 37 * pid);
+    }
+
+    // Every tick a core was busy executed one instruction of someone
+    int busy = 0;
+    for (int core = 0; core < cores[c]; core++) {
+      ASSERT_TRUE(run->core_busy_time[core] > 0);
+      busy += run->core_busy_time[core];
+    }
+    ASSERT_EQ(busy, total);
+  }
+}
+
+TEST_CASE(Scheduler, SmpIdleCoreStealsQueuedWork) {
+  // Arrivals alternate between the cores, so core 0 holds the long
+  // process with process 2 queued behind it. Core 1 runs out first.
+  harness_reset();
+  set_scheduler_cores(2);
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 0, 1, 1000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 10, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 2, 1, 10, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 3, 1, 10, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_FCFS);
+  ASSERT_TRUE(run != NULL);
+  ASSERT_TRUE(run->steals >= 1);
+  const ProcessMetrics *stolen = harness_process(run, 2);
+  ASSERT_TRUE(stolen != NULL);
+  ASSERT_TRUE(stolen->completion_time < 100);
+  ASSERT_EQ(run->core_busy_time[0] + run->core_busy_time[1], 1030);
+}
+
+TEST_CASE(Scheduler, SmpHardAffinityIsRespected) {
+  // Core 0 runs out of its own work first but may not steal the rest
+  harness_reset();
+  set_scheduler_cores(2);
+  ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 0, 500, 0x2, 0));
+  ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 1, 500, 0x2, 0));
+  ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 2, 20, 0x1, 0));
+  ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 3, 500, 0x2, 0));
+  const PerformanceMetrics *run = harness_run(SCHED_ROUND_ROBIN);
+  ASSERT_TRUE(run != NULL);
+  ASSERT_EQ(run->process_count, 4);
+  ASSERT_EQ(run->core_busy_time[0], 20);
+  ASSERT_EQ(run->core_busy_time[1], 1500);
+  ASSERT_EQ(run->steals, 0);
+}
+
+TEST_CASE(Scheduler, SmpSoftAffinityPrefersTheHomeCore) {
+  // Process 0 prefers core 1 and process 1 core 0
+  int busy[2][2];
+  for (int aware = 0; aware < 2; aware++) {
+    harness_reset();
+    set_scheduler_cores(2);
+    set_scheduler_affinity(aware);
+    ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 0, 300, 0, 0x2));
+    ASSERT_TRUE(harness_submit_affine(SPIN_FOREVER, 1, 100, 0, 0x1));
+    const PerformanceMetrics *run = harness_run(SCHED_ROUND_ROBIN);
+    ASSERT_TRUE(run != NULL);
+    ASSERT_EQ(run->process_count, 2);
+    busy[aware][0] = run->core_busy_time[0];
+    busy[aware][1] = run->core_busy_time[1];
+    ASSERT_EQ(run->migrations, 0);
+  }
+  // Blind, they land on the emptier core in arrival order; aware, each
+  // runs on the core it prefers
+  ASSERT_EQ(busy[0][0], 300);
+  ASSERT_EQ(busy[0][1], 100);
+  ASSERT_EQ(busy[1][0], 100);
+  ASSERT_EQ(busy[1][1], 300);
+}
+
+// ============================================
+// Clock
+// ============================================
+
+// 101 instructions of warm-up, a sleep of 7ms from the end of the 104th,
+// then get_time_ms and a countdown of what it returned: 6 + 3n more
+static const char *const SLEEP_THEN_TELL_TIME =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $t0, 50\n"
+  "warm:\n"
+  "    addiu $t0, $t0, -1\n"
+  "    bne $t0, $zero, warm\n"
+  "    li $a0, 7\n"
+  "    li $v0, 13\n"
+  "    syscall\n"
+  "    li $v0, 14\n"
+  "    syscall\n"
+  "    addu $t0, $v0, $zero\n"
+  "count:\n"
+  "    beq $t0, $zero, done\n"
+  "    addiu $t0, $t0, -1\n"
+  "    j count\n"
+  "done:\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+TEST_CASE(Scheduler, SleepAndTimeFollowTicksPerMs) {
+  // At 10 ticks a millisecond the 7ms sleep ends at 104 + 70, and
+  // get_time_ms, a tick or two later, returns 17
+  harness_reset();
+  set_clock_params(10, false);
+  ASSERT_TRUE(harness_submit(SLEEP_THEN_TELL_TIME, 0, 1, 1000, 0));
+  const ProcessMetrics *pm = harness_process(harness_run(SCHED_FCFS), 0);
+  ASSERT_TRUE(pm != NULL);
+  ASSERT_EQ(pm->burst_time, 104 + 6 + 3 * 17);
+  ASSERT_EQ(pm->completion_time, 104 + 70 + 6 + 3 * 17);
+}
+
+// ============================================
+// Console Input
+// ============================================
+
+// Reads a number n, counts it down and exits: 6 + 3n instructions
+static const char *const COUNT_DOWN =
+  ".text\n"
+  ".globl main\n"
+  "main:\n"
+  "    li $v0, 5\n"
+  "    syscall\n"
+  "    addu $t0, $v0, $zero\n"
+  "loop:\n"
+  "    beq $t0, $zero, done\n"
+  "    addiu $t0, $t0, -1\n"
+  "    j loop\n"
+  "done:\n"
+  "    li $v0, 10\n"
+  "    syscall\n";
+
+static int g_typist_fd = -1;
+
+// Someone at the keyboard, who takes a while to answer
+static void *type_slowly(void *arg) {
+  (void)arg;
+  struct timespec think = { 0, 100000000 };
+  nanosleep(&think, NULL);
+  if (write(g_typist_fd, "3\n", 2) != 2) {
+    perror("write typed keys");
+  }
+  return NULL;
+}
+
+TEST_CASE(Scheduler, BlockedReadFreesTheCpuUntilTyped) {
+  // The reader blocks after two instructions. The number only comes
+  // long after the spinner, which had the CPU to itself, is done.
+  g_typist_fd = harness_pipe_stdin();
+  ASSERT_TRUE(g_typist_fd >= 0);
+  harness_reset();
+  ASSERT_TRUE(harness_submit(COUNT_DOWN, 0, 1, 1000, 0));
+  ASSERT_TRUE(harness_submit(SPIN_FOREVER, 1, 1, 1000, 0));
+  pthread_t typist;
+  ASSERT_TRUE(pthread_create(&typist, NULL, type_slowly, NULL) == 0);
+  const PerformanceMetrics *run = harness_run(SCHED_ROUND_ROBIN);
+  pthread_join(typist, NULL);
+  close(g_typist_fd);
+  harness_restore_stdin();
+
+  const ProcessMetrics *reader = harness_process(run, 0);
+  const ProcessMetrics *spinner = harness_process(run, 1);
+  ASSERT_TRUE(reader != NULL && spinner != NULL);
+  ASSERT_EQ(spinner->completion_time, 2 + 1000);
+  ASSERT_EQ(reader->burst_time, 6 + 3 * 3);
+  ASSERT_TRUE(reader->completion_time > spinner->completion_time);
+}
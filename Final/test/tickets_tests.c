@@ -0,0 +1,85 @@
+#include "../include/tickets.h"
+#include "framework.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Brute force reference: walk the handles in order until the ticket is covered
+#define TICKET_ITEMS 300
+static uint64_t held[TICKET_ITEMS];
+
+static uint32_t owner_of(uint64_t ticket) {
+  for (uint32_t i = 0; i < TICKET_ITEMS; i++) {
+    if (ticket < held[i]) {
+      return i;
+    }
+    ticket -= held[i];
+  }
+  return TICKETS_EMPTY;
+}
+
+// ============================================
+// Basic Behaviour
+// ============================================
+
+TEST_CASE(Tickets, EmptyDrawsNothing) {
+  TicketTree *tree = tickets_create(4);
+  ASSERT_EQ(tickets_total(tree), 0);
+  ASSERT_EQ(tickets_size(tree), 0);
+  ASSERT_EQ(tickets_draw(tree, 0), TICKETS_EMPTY);
+  ASSERT_EQ(tickets_get(tree, 1000), 0);
+  tickets_destroy(tree);
+}
+
+TEST_CASE(Tickets, TicketRangesFollowHandles) {
+  TicketTree *tree = tickets_create(4);
+  tickets_set(tree, 0, 3);
+  tickets_set(tree, 2, 5);
+  tickets_set(tree, 3, 1);
+  ASSERT_EQ(tickets_total(tree), 9);
+  ASSERT_EQ(tickets_size(tree), 3);
+  ASSERT_EQ(tickets_draw(tree, 0), 0);
+  ASSERT_EQ(tickets_draw(tree, 2), 0);
+  ASSERT_EQ(tickets_draw(tree, 3), 2);
+  ASSERT_EQ(tickets_draw(tree, 7), 2);
+  ASSERT_EQ(tickets_draw(tree, 8), 3);
+  ASSERT_EQ(tickets_draw(tree, 9), TICKETS_EMPTY);
+
+  // Taking a handle out closes the gap
+  tickets_set(tree, 2, 0);
+  ASSERT_EQ(tickets_total(tree), 4);
+  ASSERT_EQ(tickets_size(tree), 2);
+  ASSERT_EQ(tickets_draw(tree, 3), 3);
+  tickets_destroy(tree);
+}
+
+// ============================================
+// Growth and Random Updates
+// ============================================
+
+TEST_CASE(Tickets, MatchesBruteForceWhileGrowing) {
+  srand(17);
+  for (int i = 0; i < TICKET_ITEMS; i++) {
+    held[i] = 0;
+  }
+  TicketTree *tree = tickets_create(2);
+  uint64_t total = 0;
+  for (int step = 0; step < 5000; step++) {
+    uint32_t item = (uint32_t)(rand() % TICKET_ITEMS);
+    uint64_t count = (rand() % 3 == 0) ? 0 : (uint64_t)(rand() % 1000);
+    total += count - held[item];
+    held[item] = count;
+    tickets_set(tree, item, count);
+    ASSERT_EQ(tickets_get(tree, item), count);
+
+    if (step % 50 == 0 && total > 0) {
+      ASSERT_EQ(tickets_total(tree), total);
+      for (int d = 0; d < 20; d++) {
+        uint64_t ticket = (uint64_t)rand() % total;
+        ASSERT_EQ(tickets_draw(tree, ticket), owner_of(ticket));
+      }
+      ASSERT_EQ(tickets_draw(tree, total - 1), owner_of(total - 1));
+    }
+  }
+  tickets_destroy(tree);
+}
@@ -0,0 +1,211 @@
+#include "../include/workload.h"
+#include "framework.h"
+#include "harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static WorkloadConfig config(ArrivalPattern arrivals, BurstDistribution cpu, int count) {
+  WorkloadConfig cfg;
+  workload_defaults(&cfg);
+  cfg.seed = 7;
+  cfg.count = count;
+  cfg.arrivals = arrivals;
+  cfg.cpu.shape = cpu;
+  return cfg;
+}
+
+// Mean gap between arrivals, in hundredths
+static long mean_gap_x100(const Workload *w) {
+  return (long)w->entries[w->count - 1].arrival * 100 / (w->count - 1);
+}
+
+// ============================================
+// Generator
+// ============================================
+
+TEST_CASE(Workload, SameSeedSameWorkload) {
+  WorkloadConfig cfg = config(ARRIVAL_BURSTY, BURST_PARETO, 100);
+  cfg.phases = 3;
+  cfg.io.mean = 20;
+  Workload *a = workload_generate(&cfg);
+  Workload *b = workload_generate(&cfg);
+  ASSERT_EQ(a->count, 100);
+  ASSERT_EQ(b->count, 100);
+  for (int i = 0; i < a->count; i++) {
+    ASSERT_EQ(a->entries[i].arrival, b->entries[i].arrival);
+    ASSERT_EQ(a->entries[i].burst, b->entries[i].burst);
+    ASSERT_EQ(a->entries[i].priority, b->entries[i].priority);
+    ASSERT_EQ(a->entries[i].io_bursts[1], b->entries[i].io_bursts[1]);
+  }
+  cfg.seed = 8;
+  Workload *c = workload_generate(&cfg);
+  int differ = 0;
+  for (int i = 0; i < a->count; i++) {
+    differ += a->entries[i].arrival != c->entries[i].arrival;
+  }
+  ASSERT_TRUE(differ > 0);
+  workload_free(a);
+  workload_free(b);
+  workload_free(c);
+}
+
+TEST_CASE(Workload, ArrivalsAreOrderedWithTheRequestedRate) {
+  ArrivalPattern patterns[] = { ARRIVAL_POISSON, ARRIVAL_BURSTY, ARRIVAL_HEAVY_TAILED };
+  for (int p = 0; p < 3; p++) {
+    WorkloadConfig cfg = config(patterns[p], BURST_EXPONENTIAL, 20000);
+    Workload *w = workload_generate(&cfg);
+    ASSERT_EQ(w->entries[0].arrival, 0);
+    for (int i = 1; i < w->count; i++) {
+      ASSERT_TRUE(w->entries[i].arrival >= w->entries[i - 1].arrival);
+    }
+    // Within 15% of the configured mean gap of 50
+    long gap = mean_gap_x100(w);
+    ASSERT_TRUE(gap > 4250 && gap < 5750);
+    workload_free(w);
+  }
+}
+
+TEST_CASE(Workload, BurstyArrivalsCluster) {
+  WorkloadConfig cfg = config(ARRIVAL_BURSTY, BURST_EXPONENTIAL, 5000);
+  Workload *bursty = workload_generate(&cfg);
+  cfg.arrivals = ARRIVAL_POISSON;
+  Workload *poisson = workload_generate(&cfg);
+
+  // Far more arrivals land right on the heels of the previous one
+  int close_bursty = 0;
+  int close_poisson = 0;
+  for (int i = 1; i < cfg.count; i++) {
+    close_bursty += bursty->entries[i].arrival - bursty->entries[i - 1].arrival <= 5;
+    close_poisson += poisson->entries[i].arrival - poisson->entries[i - 1].arrival <= 5;
+  }
+  ASSERT_TRUE(close_bursty > 2 * close_poisson);
+  workload_free(bursty);
+  workload_free(poisson);
+}
+
+TEST_CASE(Workload, FixedBurstsAreExact) {
+  WorkloadConfig cfg = config(ARRIVAL_POISSON, BURST_FIXED, 10);
+  cfg.cpu.mean = 40;
+  cfg.phases = 2;
+  cfg.io.shape = BURST_FIXED;
+  cfg.io.mean = 7;
+  Workload *w = workload_generate(&cfg);
+  for (int i = 0; i < w->count; i++) {
+    ASSERT_EQ(w->entries[i].cpu_bursts[0], 40);
+    ASSERT_EQ(w->entries[i].cpu_bursts[1], 40);
+    ASSERT_EQ(w->entries[i].io_bursts[0], 7);
+    ASSERT_TRUE(w->entries[i].priority >= 1 && w->entries[i].priority <= cfg.max_priority);
+  }
+  workload_free(w);
+}
+
+// ============================================
+// Generated Programs
+// ============================================
+
+TEST_CASE(Workload, WideBurstsRunInFull) {
+  // A spin count and a sleep neither of which fits a 16-bit immediate
+  WorkloadConfig cfg = config(ARRIVAL_POISSON, BURST_FIXED, 1);
+  cfg.cpu.mean = 140000;
+  cfg.phases = 2;
+  cfg.io.shape = BURST_FIXED;
+  cfg.io.mean = 40000;
+  Workload *w = workload_generate(&cfg);
+  WorkloadEntry *e = &w->entries[0];
+
+  char path[] = "/tmp/workload_asmXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  close(fd);
+  ASSERT_TRUE(workload_write_asm(e, path));
+
+  // Room to spare, so a miscounted program would overrun its estimate
+  harness_reset();
+  ASSERT_TRUE(harness_submit_file(path, 0, 1, 2 * e->burst, 0));
+  unlink(path);
+  const ProcessMetrics *pm = harness_process(harness_run(SCHED_FCFS), 0);
+  ASSERT_TRUE(pm != NULL);
+  ASSERT_EQ(pm->burst_time, e->burst);
+  ASSERT_EQ(pm->turnaround_time, e->burst + 40000);
+  workload_free(w);
+}
+
+// ============================================
+// Workload Files
+// ============================================
+
+TEST_CASE(Workload, WrittenWorkloadLoadsBack) {
+  char dir[] = "/tmp/workload_testXXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+
+  WorkloadConfig cfg = config(ARRIVAL_HEAVY_TAILED, BURST_UNIFORM, 12);
+  cfg.phases = 2;
+  cfg.io.mean = 10;
+  Workload *w = workload_generate(&cfg);
+  ASSERT_TRUE(workload_write(w, dir));
+
+  char spec[64];
+  snprintf(spec, sizeof(spec), "%s/workload.txt", dir);
+  Workload *loaded = workload_load(spec);
+  ASSERT_TRUE(loaded != NULL);
+  ASSERT_EQ(loaded->count, w->count);
+  for (int i = 0; i < w->count; i++) {
+    ASSERT_TRUE(strcmp(loaded->entries[i].program, w->entries[i].program) == 0);
+    ASSERT_EQ(loaded->entries[i].arrival, w->entries[i].arrival);
+    ASSERT_EQ(loaded->entries[i].burst, w->entries[i].burst);
+    ASSERT_EQ(loaded->entries[i].priority, w->entries[i].priority);
+    ASSERT_EQ(access(w->entries[i].program, R_OK), 0);
+    unlink(w->entries[i].program);
+  }
+  unlink(spec);
+  rmdir(dir);
+  workload_free(w);
+  workload_free(loaded);
+}
+
+TEST_CASE(Workload, OptionalFieldsAndErrors) {
+  char path[] = "/tmp/workload_specXXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_TRUE(fd >= 0);
+  FILE *fp = fdopen(fd, "w");
+  fprintf(fp, "# comment\n\n/abs/a.asm\nb.asm 30 # trailing\nc.asm 5 200 3\n");
+  fclose(fp);
+
+  Workload *w = workload_load(path);
+  ASSERT_TRUE(w != NULL);
+  ASSERT_EQ(w->count, 3);
+  ASSERT_TRUE(strcmp(w->entries[0].program, "/abs/a.asm") == 0);
+  ASSERT_TRUE(strcmp(w->entries[1].program, "/tmp/b.asm") == 0);
+  ASSERT_EQ(w->entries[0].arrival, 0);
+  ASSERT_EQ(w->entries[0].burst, -1);
+  ASSERT_EQ(w->entries[1].arrival, 30);
+  ASSERT_EQ(w->entries[1].priority, -1);
+  ASSERT_EQ(w->entries[2].burst, 200);
+  ASSERT_EQ(w->entries[2].priority, 3);
+  workload_free(w);
+
+  // The real-time fields come as a set
+  fp = fopen(path, "w");
+  fprintf(fp, "rt.asm 0 500 1 40 30 10\n");
+  fclose(fp);
+  w = workload_load(path);
+  ASSERT_TRUE(w != NULL);
+  ASSERT_EQ(w->entries[0].period, 40);
+  ASSERT_EQ(w->entries[0].deadline, 30);
+  ASSERT_EQ(w->entries[0].wcet, 10);
+  workload_free(w);
+
+  fp = fopen(path, "w");
+  fprintf(fp, "rt.asm 0 500 1 40\n");
+  fclose(fp);
+  ASSERT_TRUE(workload_load(path) == NULL);
+
+  fp = fopen(path, "w");
+  fprintf(fp, "a.asm -4\n");
+  fclose(fp);
+  ASSERT_TRUE(workload_load(path) == NULL);
+  unlink(path);
+}